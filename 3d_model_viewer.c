@@ -1,13 +1,49 @@
 #define APP_NAME "3D Model Viewer"
 #define APP_GPU_RENDERING
-#define APP_IMGUI
 
 #if defined(WINDOWS)
+#define APP_IMGUI
 #include <windows/pg_windows.h>
+#elif defined(LINUX)
+// NOTE: The Linux target is headless (no window, no GPU). It drives `init_app`
+// and `update_app` through a stub renderer to benchmark the CPU side of a
+// frame.
+#define APP_BENCHMARK
+#include "linux_platform.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
 #else
 static_assert(0, "no supported platform is defined");
 #endif
 
+#include "file_map.c"
+#include "job.c"
+#if defined(APP_PIPELINED_FRAMES)
+#include <stddef.h>
+#include "frame_pipeline.c"
+#endif
+#include "glb.c"
+#if defined(APP_PAGED_ASSETS)
+#include "asset_loader.c"
+#include "model_pager.c"
+#endif
+#include "asset_ext.c"
+#include "mesh_optimize.c"
+#include "frustum.c"
+#include "meshlet.c"
+#include "bounds.c"
+#include "lod.c"
+#include "skinning.c"
+#include "animation.c"
+#include "scene.c"
+#include "draw_list.c"
+#if defined(APP_COMPACT_VERTICES)
+#include "compact_vertex.c"
+#endif
+
 typedef enum
 {
     GRAPHICS_BUFFER_PER_FRAME_CB,
@@ -15,6 +51,10 @@ typedef enum
     GRAPHICS_BUFFER_INDICES_SB,
     GRAPHICS_BUFFER_JOINT_TRANSFORMS_SB,
     GRAPHICS_BUFFER_MATERIAL_PROPERTIES_SB,
+    GRAPHICS_BUFFER_VERTEX_COLORS_SB, // NOTE: Compact vertices only.
+    GRAPHICS_BUFFER_VERTEX_SKINS_SB,  // NOTE: Compact vertices only.
+    GRAPHICS_BUFFER_SKINNED_VERTICES_SB,
+    GRAPHICS_BUFFER_INSTANCES_SB,
     GRAPHICS_BUFFER_COUNT
 } graphics_buffer;
 
@@ -32,6 +72,20 @@ typedef enum
     INPUT_ACTION_TYPE_COUNT
 } input_action_type;
 
+typedef enum
+{
+    FRAME_STAGE_INPUT,
+    FRAME_STAGE_ANIMATE,
+    FRAME_STAGE_MATRICES,
+    FRAME_STAGE_DRAWABLES,
+    FRAME_STAGE_CULL,
+    FRAME_STAGE_SKIN,
+    FRAME_STAGE_BUFFERS,
+    FRAME_STAGE_TEXTURES,
+    FRAME_STAGE_DRAW_DATA,
+    FRAME_STAGE_COUNT
+} frame_stage;
+
 // NOTE: This represents constant buffer data, which requires 16-byte alignment.
 // This may require padding a struct member to 16 bytes.
 typedef struct
@@ -41,18 +95,38 @@ typedef struct
     u32 material_id;
     u32 texture_id;
     pg_f32_4x4 global_transform;
+#if defined(APP_COMPACT_VERTICES)
+    pg_f32_3x position_min;
+    u32 vertex_flags; // compact_vertex_stream
+    pg_f32_3x position_extent;
+    f32 padding0;
+#endif
 } constants_cb;
 
 // NOTE: This represents constant buffer data, which requires 16-byte alignment.
 // This may require padding a struct member to 16 bytes.
 typedef struct
 {
-    pg_f32_4x4 world_from_model;
     pg_f32_4x4 clip_from_world;
     pg_f32_3x camera_pos;
-    f32 padding0;
+    u32 pre_skinned;         // GRAPHICS_BUFFER_SKINNED_VERTICES_SB is valid.
+    u32 skinned_vertex_base; // Of the model, in the vertex arena
+    u32 padding0;
+    u32 padding1;
+    u32 padding2;
 } per_frame_cb;
 
+// NOTE: This represents structured buffer data. It mirrors `instance_data` in
+// shaders.hlsl.
+typedef struct
+{
+    pg_f32_4x4 world_from_model;
+    u32 joint_offset; // Of the instance's joint transforms
+    u32 padding0;
+    u32 padding1;
+    u32 padding2;
+} instance_sb;
+
 typedef struct
 {
     f32 repeat_rate;
@@ -61,29 +135,61 @@ typedef struct
 
 typedef struct
 {
-    b8 fullscreen;
-    b8 vsync;
     b8 wireframe_mode;
     b8 auto_rotate;
+    b8 drawable_culling;
+    b8 meshlet_culling;
+    b8 lod_selection;
+    b8 pre_skinning;
+    b8 animation_sampling;
     u32 model_id;
     u32 model_animation_count;
+    b8 animation_layering; // Crossfades and additive layers reach every node
+    u32 instance_count; // Of the model, in crowd mode (otherwise 1)
+    skinning_kernel skinning_kernel;
     pg_f32_3x scaling;
     pg_f32_3x rotation;
     pg_f32_3x translation;
+    pg_f32_4x4 world_from_model; // Of scaling, rotation and translation
+    b8 world_from_model_dirty;
     pg_animation animation;                                   // align: 4
+    pg_animation fade_animation;                              // align: 4
+    pg_animation additive_animation;                          // align: 4
+    f32 fade_time; // ms since `fade_animation` began fading out
+    f32 additive_weight;
+    animation_cursors animation_cursors[ANIMATION_LAYER_COUNT];
     pg_camera camera;                                         // align: 4
     input_action input_action_map[PG_INPUT_EVENT_TYPE_COUNT]; // align: 4
-    pg_graphics_api gfx_api;                                  // align: 4
-    pg_graphics_api supported_gfx_apis;                       // align: 4
-    pg_graphics_metrics* metrics;
+    pg_graphics_metrics* metrics; // Of the last frame rendered
+    bounds_cull_stats drawable_stats;       // last frame
+    meshlet_cull_stats meshlet_stats;       // last frame
+    lod_select_stats lod_stats;             // last frame
+    skinning_stats skinning_stats;          // last frame
+    animation_sample_stats animation_stats; // last frame
+    scene_update_stats scene_stats;         // last frame
+    job_stats job_stats;                    // last frame
+    draw_list_stats draw_list_stats;        // last frame
 } application_state;
 
+// NOTE: Only the thread that renders uses the graphics state, even when frames
+// are updated on another thread (see frame_pipeline.c).
+typedef struct
+{
+    b8 fullscreen;
+    b8 vsync;
+    pg_graphics_api gfx_api;
+    pg_graphics_api supported_gfx_apis;
+    pg_graphics_metrics* metrics;
+} graphics_state;
+
 typedef struct
 {
     u32 model_id_last_frame;
     u32 max_vertex_count;
     u32 max_index_count;
     u32 max_joint_count;
+    u32 max_skinned_vertex_count; // Of models with joints
+
     u32 max_material_count;
     u32 total_texture_count;
 } models_metadata;
@@ -116,20 +222,362 @@ GLOBAL c8* model_names[] = {"None",
                             "Virtual City",
                             "Water Bottle"};
 
+// NOTE: When frames are pipelined, they are updated on the pipeline's update
+// thread while the main thread renders the last one (see frame_pipeline.c).
+#if defined(APP_PIPELINED_FRAMES)
+#define APP_FRAME_BUFFER_COUNT FRAME_SNAPSHOT_COUNT
+#else
+#define APP_FRAME_BUFFER_COUNT 1
+#endif
+
+#if defined(APP_PAGED_ASSETS)
+// NOTE: Byte budget for resident model pages. Permanent memory only needs to
+// fit this on top of the table of contents and other bookkeeping.
+#if !defined(MODEL_PAGER_BUDGET)
+#define MODEL_PAGER_BUDGET PG_MEBIBYTE(256)
+#endif
+#define MODEL_PAGER_PREFETCH_RADIUS 1
+#define MODEL_PAGER_LOADER_THREAD_COUNT 2
+// NOTE: Pages read in the background become resident for at most this long
+// (in microseconds) at the start of a frame. However many do, the frame
+// declares textures again once.
+#define MODEL_PAGER_FRAME_COMPLETION_BUDGET 500
+// NOTE: Job workers' scratch memory is also permanent, and so are the crowd's
+// instances, cursors and joint transforms (the instances and joint transforms
+// once per frame snapshot) and the snapshots' transient memory.
+#define APP_PERMANENT_MEM_SIZE                                                 \
+    (MODEL_PAGER_BUDGET + PG_MEBIBYTE(16)                                      \
+     + (APP_FRAME_BUFFER_COUNT * (PG_MEBIBYTE(32) + APP_TRANSIENT_MEM_SIZE))   \
+     + (JOB_MAX_WORKER_COUNT * JOB_WORKER_MEM_SIZE))
+#else
+#define APP_PERMANENT_MEM_SIZE PG_MEBIBYTE(1024)
+#endif
+#define APP_TRANSIENT_MEM_SIZE PG_MEBIBYTE(1)
+#define APP_INPUT_QUEUE_EVENT_COUNT 10
+
 GLOBAL pg_config config
     = {.gamepad_count = 1,
-       .input_queue_event_count = 10,
+       .input_queue_event_count = APP_INPUT_QUEUE_EVENT_COUNT,
        .gamepad_deadzone = PG_INPUT_GAMEPAD_DEFAULT_DEADZONE,
-       .permanent_mem_size = PG_MEBIBYTE(1024),
-       .transient_mem_size = PG_KIBIBYTE(256),
+       .permanent_mem_size = APP_PERMANENT_MEM_SIZE,
+       .transient_mem_size = APP_TRANSIENT_MEM_SIZE,
        .min_gpu_mem_size = PG_MEBIBYTE(512)};
 
 GLOBAL application_state app_state
-    = {.vsync = true,
-       .auto_rotate = true,
+    = {.auto_rotate = true,
+       .drawable_culling = true,
+       .meshlet_culling = true,
+       .lod_selection = true,
+       .pre_skinning = true,
+       .animation_sampling = true,
+       .fade_animation = {.id = ANIMATION_NO_CLIP},
+       .additive_animation = {.id = ANIMATION_NO_CLIP},
+       .additive_weight = 1.0f,
        .model_id = MODEL_DAMAGED_HELMET,
+       .instance_count = 1,
        .camera = {.arcball = true, .up_axis = {.y = 1.0f}}};
 
+GLOBAL graphics_state gfx_state = {.vsync = true};
+
+#if defined(APP_PAGED_ASSETS)
+GLOBAL asset_loader loader;
+GLOBAL model_pager pager;
+#endif
+
+// NOTE: Extension sections are used in place from the mapped file, so they are
+// never copied into permanent memory.
+GLOBAL asset_ext ext;
+GLOBAL PG_GRAPHICS_INDEX_TYPE* model_ext_indices[MODEL_COUNT];
+GLOBAL u32 model_ext_index_counts[MODEL_COUNT]; // Including LOD indices
+GLOBAL meshlets model_meshlets[MODEL_COUNT];
+GLOBAL bounds model_bounds[MODEL_COUNT];
+GLOBAL lods model_lods[MODEL_COUNT];
+GLOBAL animations model_animations[MODEL_COUNT];
+
+// NOTE: Sized for the model with the most nodes and the clip with the most
+// channels, so animation layers are evaluated without allocating.
+#define ANIMATION_CROSSFADE_TIME PG_MILLISECOND(0.25f)
+GLOBAL animation_pose_pool pose_pool;
+GLOBAL animation_sampler keyframe_sampler;
+GLOBAL pg_f32_4x4* node_globals;
+
+// NOTE: Hierarchies persist between frames (and while other models are shown),
+// so their global transforms are only recomputed where something moved.
+GLOBAL scene model_scenes[MODEL_COUNT];
+GLOBAL scene_hierarchy model_hierarchies[MODEL_COUNT];
+
+// NOTE: Worker 0 is the thread that runs `update_app`. Batches are sized so
+// that a job is worth more than the cost of stealing it.
+#define CULL_BATCH_SIZE 32       // drawables
+#define SKIN_BATCH_SIZE 2048     // vertices
+#define DRAW_DATA_BATCH_SIZE 256 // draw ranges
+static_assert(SKIN_BATCH_SIZE % SKINNING_BATCH_SIZE == 0,
+              "skin jobs must not split a skinning batch");
+GLOBAL job_system jobs;
+GLOBAL u32 job_thread_count; // 0 for one worker per core
+
+#if defined(APP_PIPELINED_FRAMES)
+GLOBAL frame_pipeline pipeline;
+
+// NOTE: While frames are pipelined, the update thread owns `app_state`, and the
+// render thread only reads the copy of it that each snapshot was updated with
+// (`ui_state`), which its UI edits. What the render thread changes (input, UI
+// edits, the render resolution and metrics) is posted to `app_delta`, and the
+// update thread takes it at the start of its next frame. Either thread only
+// holds the pipeline's lock to copy the delta.
+typedef struct
+{
+    usize offset;
+    usize size;
+} app_state_field;
+
+#define APP_STATE_FIELD(name)                                                  \
+    {offsetof(application_state, name), sizeof(((application_state*)0)->name)}
+
+// NOTE: The fields that the UI edits.
+GLOBAL app_state_field app_state_ui_fields[]
+    = {APP_STATE_FIELD(wireframe_mode),
+       APP_STATE_FIELD(drawable_culling),
+       APP_STATE_FIELD(meshlet_culling),
+       APP_STATE_FIELD(lod_selection),
+       APP_STATE_FIELD(pre_skinning),
+       APP_STATE_FIELD(animation_sampling),
+       APP_STATE_FIELD(model_id),
+       APP_STATE_FIELD(instance_count),
+       APP_STATE_FIELD(skinning_kernel),
+       APP_STATE_FIELD(animation.id),
+       APP_STATE_FIELD(additive_animation.id),
+       APP_STATE_FIELD(additive_weight)};
+
+typedef struct
+{
+    application_state values;               // Of the edited fields
+    u64 edit_ids[CAP(app_state_ui_fields)]; // Of each field's last edit, or 0
+} app_state_edits;
+
+typedef struct
+{
+    app_state_edits edits; // Not yet taken
+    u64 edit_count;        // Posted so far
+    pg_input_event events[APP_INPUT_QUEUE_EVENT_COUNT]; // Not yet taken
+    u32 event_count;
+    f32 held_durations[PG_INPUT_EVENT_TYPE_COUNT]; // Since last taken
+    b8 released[PG_INPUT_EVENT_TYPE_COUNT];        // Since last taken
+    pg_f32_2x render_res;
+    pg_graphics_metrics metrics;
+    b8 graphics_reloaded;
+} app_state_delta;
+
+GLOBAL app_state_delta app_delta; // Under the pipeline's lock
+
+// NOTE: Of the update thread.
+GLOBAL pg_input_queue update_input_queue;
+GLOBAL pg_input_event update_input_events[APP_INPUT_QUEUE_EVENT_COUNT];
+GLOBAL pg_graphics_metrics update_metrics;
+GLOBAL pg_f32_2x update_render_res;
+GLOBAL u64 update_edit_count; // Taken so far
+GLOBAL application_state snapshot_states[FRAME_SNAPSHOT_COUNT];
+GLOBAL u64 snapshot_edit_counts[FRAME_SNAPSHOT_COUNT]; // Taken when updated
+
+// NOTE: Of the render thread.
+GLOBAL application_state ui_state;
+GLOBAL application_state ui_state_last; // Before the UI ran
+GLOBAL app_state_edits ui_edits;        // Every edit posted
+GLOBAL u64 ui_edit_count;
+GLOBAL f32 posted_held_durations[PG_INPUT_EVENT_TYPE_COUNT];
+#endif
+
+// NOTE: Crowd instances are placed on a grid (in world space), and each plays
+// the model's clip from its own offset with its own joint transforms when the
+// clip is sampled. Each worker samples with its own sampler and pose.
+// NOTE: Crowds are only built with APP_CROWDS, since their buffers are sized
+// for the largest crowd. Otherwise, the only instance is the model itself.
+#if defined(APP_CROWDS)
+#define CROWD_MAX_INSTANCE_COUNT 10000
+GLOBAL u32 crowd_instance_counts[] = {1, 100, CROWD_MAX_INSTANCE_COUNT};
+#else
+#define CROWD_MAX_INSTANCE_COUNT 1
+GLOBAL u32 crowd_instance_counts[] = {1};
+#endif
+#define CROWD_SPACING 2.0f
+#define CROWD_BATCH_SIZE 64 // instances
+
+typedef struct
+{
+    animation_sampler sampler;
+    animation_pose pose;
+    pg_f32_4x4* globals; // One per node
+} crowd_worker;
+
+GLOBAL animation_cursors* crowd_cursors;
+GLOBAL crowd_worker* crowd_workers; // One per job worker
+GLOBAL u32 crowd_joint_capacity;    // Per instance
+
+// NOTE: Buffers that a frame writes in place (rather than in its transient
+// memory) have a copy per frame snapshot, so that a frame is never written
+// into buffers that the last one is still rendered from.
+// NOTE: Skinned vertices are indexed like the model's vertices. Compact
+// vertices that were renumbered at pack time no longer line up with the .pga
+// vertices the CPU skins, so those models are skinned in `vs`.
+typedef struct
+{
+    skinned_vertex* skinned_vertices;
+    instance_sb* crowd_instances;
+    pg_f32_4x4* crowd_joint_transforms; // Joint count per instance
+    u32 crowd_layout_instance_count;    // Of `crowd_instances`
+    u32 crowd_layout_joint_stride;      // Of `crowd_instances`
+    b8 crowd_layout_stale; // The model's transform changed since
+} snapshot_buffers;
+
+GLOBAL snapshot_buffers snapshot_buffer_sets[APP_FRAME_BUFFER_COUNT];
+GLOBAL b8 model_remapped_vertices[MODEL_COUNT];
+GLOBAL u64 shader_blend_count; // Of the current model, with every drawable
+GLOBAL b8 skinning_kernels_supported[SKINNING_KERNEL_COUNT];
+
+// NOTE: The level each drawable drew last frame, for LOD hysteresis. There is
+// one per instance of the model with the most (see lod.c), and drawables past
+// the end (only of models packed before instances were counted) are selected
+// without hysteresis.
+GLOBAL u8* drawable_lod_levels;
+GLOBAL u32 drawable_lod_level_count;
+#if defined(APP_COMPACT_VERTICES)
+GLOBAL compact_vertices model_compact_vertices[MODEL_COUNT];
+#endif
+
+// NOTE: Every model's vertices, indices and material properties are packed
+// once into resident buffers, so switching models only changes the offsets
+// drawables are rebased by. The buffers have memory of their own, sized from
+// the totals of the models read at init, so permanent memory only needs to
+// hold the .pga. In paged mode, models are not all resident, so the bases are
+// 0 and only the current model's geometry and materials are bound (when it
+// changes).
+typedef struct
+{
+#if defined(APP_COMPACT_VERTICES)
+    compact_vertex* vertices;
+    u32* colors;                // NOTE: Undefined for models without colors.
+    compact_vertex_skin* skins; // NOTE: Undefined for models without skins.
+#else
+    pg_vertex* vertices;
+#endif
+    PG_GRAPHICS_INDEX_TYPE* indices;
+    pg_asset_material_properties* material_properties;
+    u32 vertex_count;
+    u32 index_count;
+    u32 material_count;
+    u32 vertex_bases[MODEL_COUNT];
+    u32 index_bases[MODEL_COUNT];
+    u32 material_bases[MODEL_COUNT];
+} geometry_arena;
+
+GLOBAL geometry_arena geometry;
+
+#if !defined(APP_PAGED_ASSETS)
+// Returns `size` bytes of zeroed memory outside of the app's arenas (never
+// freed), or 0.
+FUNCTION void*
+geometry_arena_alloc_memory(usize size)
+{
+#if defined(LINUX)
+    void* memory = mmap(0,
+                        size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS,
+                        -1,
+                        0);
+    return memory == MAP_FAILED ? 0 : memory;
+#elif defined(WINDOWS)
+    return VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#endif
+}
+#endif
+
+// NOTE: Texture declarations are built once per model, in model order. Unless
+// assets are paged, `table` holds them twice in a row, so the declarations of
+// any current model (required) followed by those of every other model in
+// order after it (optional, wrapping around) are a rotated view of it starting
+// at the current model's offset, and declaring textures copies nothing. In
+// paged mode, only resident models may be declared, so their ranges are
+// copied into `declarations` in the same order instead. A model's range is
+// built when it is first declared after its page is loaded (a page loaded
+// back into the same memory keeps its range).
+typedef struct
+{
+    pg_graphics_texture_data* table;        // Every model's textures
+    pg_graphics_texture_data* declarations; // For the upcoming frame
+    u32 offsets[MODEL_COUNT];               // Of each model, in `table`
+    u32 counts[MODEL_COUNT];
+#if defined(APP_PAGED_ASSETS)
+    pg_asset_model* models[MODEL_COUNT]; // That each range was built from
+#endif
+} texture_declarations;
+
+GLOBAL texture_declarations texture_decls;
+
+#if defined(APP_BENCHMARK)
+#define BENCHMARK_SKINNING_ITERATION_COUNT 100
+#define BENCHMARK_ANIMATION_ITERATION_COUNT 1000
+#define BENCHMARK_LIBRARY_ITERATION_COUNT 100
+#define BENCHMARK_CROWD_FRAME_COUNT 30
+
+typedef struct
+{
+    f64 stage_start;
+    f64 stage_times[FRAME_STAGE_COUNT]; // ms
+
+    // NOTE: The inputs of the last Skin stage, to check and time the skinning
+    // kernels with.
+    pg_vertex* skin_vertices;
+    u32 skin_vertex_count;
+    pg_f32_4x4* skin_joint_transforms;
+    u32 skin_joint_count;
+
+    // NOTE: The inputs of the last Drawables stage, to compare the viewer's
+    // sampled joint transforms with the asset library's, and to time the
+    // asset library with and without the clip.
+    pg_assets* drawable_assets;
+    u32 drawable_model_id;
+    pg_animation drawable_animation;
+    pg_f32_4x4 drawable_view_from_model;
+    pg_f32_4x4* sampled_joint_transforms;
+    u32 sampled_joint_count;
+} benchmark_state;
+
+GLOBAL benchmark_state benchmark;
+
+GLOBAL c8* frame_stage_names[] = {"Input",
+                                  "Animate",
+                                  "Matrices",
+                                  "Drawables",
+                                  "Cull",
+                                  "Skin",
+                                  "Buffers",
+                                  "Textures",
+                                  "Draw Data"};
+
+FUNCTION f64
+benchmark_get_time(void)
+{
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((f64)ts.tv_sec * 1000.0) + ((f64)ts.tv_nsec / 1000000.0);
+}
+
+// NOTE: Each stage is timed from the end of the previous stage, so the stages
+// of a frame must be ended in order.
+#define FRAME_STAGE_BEGIN() (benchmark.stage_start = benchmark_get_time())
+#define FRAME_STAGE_END(stage)                                                 \
+    do                                                                         \
+    {                                                                          \
+        f64 stage_end = benchmark_get_time();                                  \
+        benchmark.stage_times[stage] = stage_end - benchmark.stage_start;      \
+        benchmark.stage_start = stage_end;                                     \
+    } while (0)
+#else
+#define FRAME_STAGE_BEGIN()
+#define FRAME_STAGE_END(stage)
+#endif
+
 FUNCTION void
 reset_view(void)
 {
@@ -137,7 +585,14 @@ reset_view(void)
     app_state.scaling = (pg_f32_3x){0};
     app_state.rotation = (pg_f32_3x){0};
     app_state.translation = (pg_f32_3x){0};
+    app_state.world_from_model_dirty = true;
     app_state.animation = (pg_animation){0};
+    app_state.fade_animation = (pg_animation){.id = ANIMATION_NO_CLIP};
+    app_state.additive_animation = (pg_animation){.id = ANIMATION_NO_CLIP};
+    for (u32 l = 0; l < ANIMATION_LAYER_COUNT; l += 1)
+    {
+        app_state.animation_cursors[l].clip_id = ANIMATION_NO_CLIP;
+    }
     app_state.camera.position
         = (pg_f32_3x){.x = PG_PI / 2.0f, .y = PG_PI / 2.0f, .z = 6.0f};
 
@@ -193,18 +648,18 @@ reset_view(void)
     }
 }
 
+// Runs the UI on `state`.
+// NOTE: Switching models does not reset the view, which is left to the caller.
 FUNCTION void
-imgui_ui(void)
+imgui_state_ui(application_state* state)
 {
 #if defined(APP_IMGUI)
-    pg_imgui_graphics_header(app_state.supported_gfx_apis,
-                             app_state.metrics,
-                             &app_state.gfx_api,
-                             &app_state.fullscreen,
-                             &app_state.vsync,
-                             &app_state.wireframe_mode);
-
-    u32 model_id = app_state.model_id;
+    pg_imgui_graphics_header(gfx_state.supported_gfx_apis,
+                             gfx_state.metrics,
+                             &gfx_state.gfx_api,
+                             &gfx_state.fullscreen,
+                             &gfx_state.vsync,
+                             &state->wireframe_mode);
 
     b8 model_selection_active
         = ImGui_CollapsingHeader("Models", ImGuiTreeNodeFlags_DefaultOpen);
@@ -213,23 +668,19 @@ imgui_ui(void)
         for (asset_type_model i = 1; i < MODEL_COUNT; i += 1)
         {
             ImGui_RadioButtonIntPtr(model_names[i],
-                                    (s32*)&app_state.model_id,
+                                    (s32*)&state->model_id,
                                     i);
         }
-        if (app_state.model_id != model_id)
-        {
-            reset_view();
-        }
     }
 
-    if (app_state.model_animation_count)
+    if (state->model_animation_count)
     {
         b8 animation_selection_active
             = ImGui_CollapsingHeader("Animations",
                                      ImGuiTreeNodeFlags_DefaultOpen);
         if (animation_selection_active)
         {
-            for (u32 i = 1; i <= app_state.model_animation_count; i += 1)
+            for (u32 i = 1; i <= state->model_animation_count; i += 1)
             {
                 c8 animation_label[15] = {0};
                 StringCchPrintfA(animation_label,
@@ -237,11 +688,158 @@ imgui_ui(void)
                                  "Animation %u",
                                  i);
                 ImGui_RadioButtonIntPtr(animation_label,
-                                        (s32*)&app_state.animation.id,
+                                        (s32*)&state->animation.id,
                                         i - 1);
             }
+            if (model_animations[state->model_id].clip_count)
+            {
+                animation_sample_stats* as = &state->animation_stats;
+                ImGui_Checkbox("Keyframe Cursors",
+                               (bool*)&state->animation_sampling);
+                ImGui_Text("Channels: %u (%u searched, %u keys advanced)",
+                           as->channel_count,
+                           as->search_count,
+                           as->advance_count);
+                ImGui_Text("Poses blended: %u", as->blend_count);
+
+                if (!state->animation_layering)
+                {
+                    ImGui_Text("Layers: repack with --animations");
+                }
+                else
+                {
+                    // NOTE: ANIMATION_NO_CLIP is -1 as an s32.
+                    ImGui_Text("Additive Layer:");
+                    ImGui_RadioButtonIntPtr(
+                        "None",
+                        (s32*)&state->additive_animation.id,
+                        (s32)ANIMATION_NO_CLIP);
+                    for (u32 i = 1; i <= state->model_animation_count;
+                         i += 1)
+                    {
+                        c8 additive_label[24] = {0};
+                        StringCchPrintfA(additive_label,
+                                         sizeof(additive_label),
+                                         "Additive %u",
+                                         i);
+                        ImGui_RadioButtonIntPtr(
+                            additive_label,
+                            (s32*)&state->additive_animation.id,
+                            i - 1);
+                    }
+                    ImGui_SliderFloat("Additive Weight",
+                                      &state->additive_weight,
+                                      0.0f,
+                                      1.0f);
+                }
+            }
+        }
+    }
+
+    b8 culling_active
+        = ImGui_CollapsingHeader("Culling", ImGuiTreeNodeFlags_DefaultOpen);
+    if (culling_active)
+    {
+        bounds_cull_stats* ds = &state->drawable_stats;
+        meshlet_cull_stats* ms = &state->meshlet_stats;
+        if (model_bounds[state->model_id].primitive_count)
+        {
+            ImGui_Checkbox("Drawable Culling",
+                           (bool*)&state->drawable_culling);
+        }
+        if (model_meshlets[state->model_id].meshlet_count)
+        {
+            ImGui_Checkbox("Meshlet Culling",
+                           (bool*)&state->meshlet_culling);
+        }
+        if (model_lods[state->model_id].primitive_count)
+        {
+            ImGui_Checkbox("LOD Selection", (bool*)&state->lod_selection);
+        }
+        ImGui_Text("Drawables: %u (%u frustum culled)",
+                   ds->drawable_count,
+                   ds->culled_drawable_count);
+        if (model_scenes[state->model_id].node_count)
+        {
+            scene_update_stats* ss = &state->scene_stats;
+            ImGui_Text("Nodes: %u (%u updated, %u boxes reused)",
+                       ss->node_count,
+                       ss->updated_count,
+                       ss->cached_drawable_count);
+        }
+        ImGui_Text("Meshlets: %u (%u frustum, %u cone culled)",
+                   ms->meshlet_count,
+                   ms->frustum_culled_count,
+                   ms->cone_culled_count);
+        ImGui_Text("LODs: %u/%u/%u/%u drawables",
+                   state->lod_stats.drawable_counts[0],
+                   state->lod_stats.drawable_counts[1],
+                   state->lod_stats.drawable_counts[2],
+                   state->lod_stats.drawable_counts[3]);
+        ImGui_Text("Triangles: %llu/%llu in %u draws",
+                   (unsigned long long)ms->drawn_triangle_count,
+                   (unsigned long long)ms->triangle_count,
+                   ms->range_count);
+        draw_list_stats* dls = &state->draw_list_stats;
+        ImGui_Text("Draws: %u (%u before merging)",
+                   dls->draw_count,
+                   dls->range_count);
+        ImGui_Text("Material Changes: %u (%u unsorted)",
+                   dls->sorted_material_change_count,
+                   dls->material_change_count);
+    }
+
+    if (state->skinning_stats.shader_blend_count)
+    {
+        b8 skinning_active = ImGui_CollapsingHeader(
+            "Skinning",
+            ImGuiTreeNodeFlags_DefaultOpen);
+        if (skinning_active)
+        {
+            skinning_stats* ss = &state->skinning_stats;
+            ImGui_Checkbox("Pre-Skinning", (bool*)&state->pre_skinning);
+            for (skinning_kernel k = 0; k < SKINNING_KERNEL_COUNT; k += 1)
+            {
+                if (skinning_kernels_supported[k])
+                {
+                    ImGui_RadioButtonIntPtr(skinning_kernel_names[k],
+                                            (s32*)&state->skinning_kernel,
+                                            k);
+                }
+            }
+            ImGui_Text("Vertices Skinned: %llu (vs: %llu joint blends)",
+                       (unsigned long long)ss->skinned_vertex_count,
+                       (unsigned long long)ss->shader_blend_count);
+        }
+    }
+
+#if defined(APP_CROWDS)
+    b8 crowd_active
+        = ImGui_CollapsingHeader("Crowd", ImGuiTreeNodeFlags_DefaultOpen);
+    if (crowd_active)
+    {
+        for (u32 i = 0; i < CAP(crowd_instance_counts); i += 1)
+        {
+            c8 crowd_label[24] = {0};
+            StringCchPrintfA(crowd_label,
+                             sizeof(crowd_label),
+                             "%u Instances",
+                             crowd_instance_counts[i]);
+            ImGui_RadioButtonIntPtr(crowd_label,
+                                    (s32*)&state->instance_count,
+                                    crowd_instance_counts[i]);
         }
     }
+#endif
+
+    b8 jobs_active
+        = ImGui_CollapsingHeader("Jobs", ImGuiTreeNodeFlags_DefaultOpen);
+    if (jobs_active)
+    {
+        job_stats* js = &state->job_stats;
+        ImGui_Text("Workers: %u", js->worker_count);
+        ImGui_Text("Jobs: %u (%u stolen)", js->job_count, js->steal_count);
+    }
 
     b8 mouse_controls_active
         = ImGui_CollapsingHeader("Mouse Controls",
@@ -276,9 +874,100 @@ imgui_ui(void)
         ImGui_Text("[Left/Right Stick]: Rotate");
         ImGui_Text("[Right Trigger/Left Trigger]: Zoom In/Zoom Out");
     }
+#else
+    (void)state;
 #endif
 }
 
+FUNCTION void
+imgui_ui(void)
+{
+    u32 model_id = app_state.model_id;
+    imgui_state_ui(&app_state);
+    if (app_state.model_id != model_id)
+    {
+        reset_view();
+    }
+}
+
+// Builds the texture declarations of model `model_id`.
+FUNCTION void
+build_texture_declarations(u32 model_id,
+                           pg_asset_model* model,
+                           u32 max_material_count)
+{
+    pg_graphics_texture_data* td
+        = &texture_decls.table[texture_decls.offsets[model_id]];
+    u32 count = 0;
+    for (u32 j = 0; j < model->material_count; j += 1)
+    {
+        for (u32 k = 0; k < model->materials[j].texture_count
+                        && count < texture_decls.counts[model_id];
+             k += 1)
+        {
+            pg_asset_texture* texture = &model->materials[j].textures[k];
+            td[count] = (pg_graphics_texture_data){
+                .id = (u32)pg_3d_to_1d_index(texture->type,
+                                             j,
+                                             model_id,
+                                             PG_TEXTURE_TYPE_COUNT,
+                                             max_material_count),
+                .texture = texture};
+            count += 1;
+        }
+    }
+}
+
+#if defined(APP_PAGED_ASSETS)
+// Copies the texture declarations of every resident model into
+// `declarations`, those of model `model_id` (required) first and those of all
+// other models in order after it (optional, wrapping around) after them.
+FUNCTION void
+order_texture_declarations(u32 model_id,
+                           u32 model_count,
+                           u32 max_material_count,
+                           pg_graphics_texture_data* declarations,
+                           u32* required_texture_count,
+                           u32* optional_texture_count,
+                           pg_error* err)
+{
+    *required_texture_count = 0;
+    *optional_texture_count = 0;
+    for (u32 i = 0; i < model_count; i += 1)
+    {
+        u32 id = (model_id + i) % model_count;
+
+        // NOTE: Only resident models have textures to declare.
+        pg_asset_model* m = model_pager_get_resident(&pager, id);
+        if (m && m != texture_decls.models[id])
+        {
+            build_texture_declarations(id, m, max_material_count);
+            texture_decls.models[id] = m;
+        }
+        u32 texture_count = m ? texture_decls.counts[id] : 0;
+        if (texture_count)
+        {
+            usize size = texture_count * sizeof(pg_graphics_texture_data);
+            pg_copy(&texture_decls.table[texture_decls.offsets[id]],
+                    size,
+                    &declarations[*required_texture_count
+                                  + *optional_texture_count],
+                    size,
+                    err);
+        }
+
+        if (i == 0)
+        {
+            *required_texture_count += texture_count;
+        }
+        else
+        {
+            *optional_texture_count += texture_count;
+        }
+    }
+}
+#endif
+
 FUNCTION void
 init_app(pg_file_read_fp pg_file_read,
          pg_scratch_allocator* permanent_mem,
@@ -288,6 +977,69 @@ init_app(pg_file_read_fp pg_file_read,
          pg_graphics_renderer_data* renderer_data,
          pg_error* err)
 {
+#if defined(APP_PAGED_ASSETS)
+    // Read model table of contents. Models are paged in on demand.
+    *assets = 0;
+    asset_loader_init(&loader, MODEL_PAGER_LOADER_THREAD_COUNT, err);
+    model_pager_init(&pager,
+                     MODEL_PAGER_BUDGET,
+                     pg_file_read,
+                     &loader,
+                     permanent_mem,
+                     err);
+    if (pager.model_count != MODEL_COUNT)
+    {
+        PG_ERROR_MAJOR("unexpected model count in table of contents");
+    }
+
+    // NOTE: The first model and its neighbors are read while the rest of the
+    // app initializes, so the first frame does not wait for all of them.
+    if (app_state.model_id < pager.model_count)
+    {
+        model_pager_request(&pager, app_state.model_id, err);
+        model_pager_prefetch(&pager,
+                             app_state.model_id,
+                             MODEL_PAGER_PREFETCH_RADIUS,
+                             err);
+    }
+    static_assert(CAP(model_names) == MODEL_COUNT,
+                  "unexpected model names count");
+
+    // Get models metadata.
+    for (u32 i = 0; i < pager.model_count; i += 1)
+    {
+        model_toc_entry* entry = &pager.toc[i];
+
+        if (entry->vertex_count > metadata->max_vertex_count)
+        {
+            metadata->max_vertex_count = entry->vertex_count;
+        }
+
+        if (entry->index_count > metadata->max_index_count)
+        {
+            metadata->max_index_count = entry->index_count;
+        }
+
+        if (entry->joint_count > metadata->max_joint_count)
+        {
+            metadata->max_joint_count = entry->joint_count;
+        }
+
+        if (entry->joint_count
+            && entry->vertex_count > metadata->max_skinned_vertex_count)
+        {
+            metadata->max_skinned_vertex_count = entry->vertex_count;
+        }
+
+        if (entry->material_count > metadata->max_material_count)
+        {
+            metadata->max_material_count = entry->material_count;
+        }
+
+        metadata->total_texture_count += entry->texture_count;
+    }
+    u32 model_count = pager.model_count;
+#else
     // Read assets file.
     *assets = pg_assets_read_pga(pg_string_create(PG_ASSET_FILE_NAME, 0, err),
                                  pg_file_read,
@@ -317,6 +1069,12 @@ init_app(pg_file_read_fp pg_file_read,
             metadata->max_joint_count = model->joint_count;
         }
 
+        if (model->joint_count
+            && model->vertex_count > metadata->max_skinned_vertex_count)
+        {
+            metadata->max_skinned_vertex_count = model->vertex_count;
+        }
+
         if (model->material_count > metadata->max_material_count)
         {
             metadata->max_material_count = model->material_count;
@@ -327,38 +1085,597 @@ init_app(pg_file_read_fp pg_file_read,
             metadata->total_texture_count += model->materials[j].texture_count;
         }
     }
+    u32 model_count = (*assets)->model_count;
+#endif
 
-    // Initialize input queue.
+    // Build texture declarations.
+    // NOTE: In paged mode, models are not resident yet, so only the ranges
+    // are laid out.
+    usize table_size
+        = metadata->total_texture_count * sizeof(pg_graphics_texture_data);
+#if !defined(APP_PAGED_ASSETS)
+    table_size *= 2;
+#endif
     pg_scratch_alloc(permanent_mem,
-                     config.input_queue_event_count * sizeof(pg_input_event),
-                     alignof(pg_input_event),
-                     &input_queue->events,
+                     table_size,
+                     alignof(pg_graphics_texture_data),
+                     &texture_decls.table,
                      err);
-    input_queue->event_count = config.input_queue_event_count;
+    u32 texture_offset = 0;
+    for (u32 i = 0; i < model_count && i < MODEL_COUNT; i += 1)
+    {
+        texture_decls.offsets[i] = texture_offset;
+#if defined(APP_PAGED_ASSETS)
+        texture_decls.counts[i] = pager.toc[i].texture_count;
+#else
+        pg_asset_model* model = &(*assets)->models[i];
+        for (u32 j = 0; j < model->material_count; j += 1)
+        {
+            texture_decls.counts[i] += model->materials[j].texture_count;
+        }
+        build_texture_declarations(i, model, metadata->max_material_count);
+#endif
+        texture_offset += texture_decls.counts[i];
+    }
 
-    // Set input action map.
-    for (pg_input_event_type et = 0; et < PG_INPUT_EVENT_TYPE_COUNT; et += 1)
+#if defined(APP_PAGED_ASSETS)
+    pg_scratch_alloc(permanent_mem,
+                     table_size,
+                     alignof(pg_graphics_texture_data),
+                     &texture_decls.declarations,
+                     err);
+#else
+    pg_copy(texture_decls.table,
+            table_size / 2,
+            &texture_decls.table[metadata->total_texture_count],
+            table_size / 2,
+            err);
+#endif
+
+    // Read extension indices (optimized and/or with LODs appended).
+    asset_ext_open(ASSET_EXT_FILE_NAME, &ext, err);
+    for (u32 i = 0; i < model_count && i < MODEL_COUNT; i += 1)
     {
-        input_action* at = &app_state.input_action_map[et];
-        switch (et)
+#if defined(APP_PAGED_ASSETS)
+        u32 index_count = pager.toc[i].index_count;
+#else
+        u32 index_count = (*assets)->models[i].index_count;
+#endif
+        u64 section_size = 0;
+        mesh_indices_header* header = asset_ext_find(&ext,
+                                                     ASSET_EXT_SECTION_INDICES,
+                                                     i,
+                                                     &section_size);
+        if (!header)
         {
-            case PG_KEYBOARD_S:
-            case PG_KEYBOARD_DOWN:
-            case PG_GAMEPAD_DOWN:
-            case PG_KEYBOARD_D:
-            case PG_KEYBOARD_RIGHT:
-            case PG_GAMEPAD_RIGHT:
-            {
-                at->repeat_rate = PG_MILLISECOND(1.0f / 2.0f);
-                at->type = INPUT_ACTION_TYPE_NEXT_MODEL;
-                break;
-            }
-            case PG_KEYBOARD_W:
-            case PG_KEYBOARD_UP:
-            case PG_GAMEPAD_UP:
-            case PG_KEYBOARD_A:
-            case PG_KEYBOARD_LEFT:
-            case PG_GAMEPAD_LEFT:
+            continue;
+        }
+        if (section_size < sizeof(mesh_indices_header)
+                               + (((u64)index_count + header->lod_index_count)
+                                  * sizeof(PG_GRAPHICS_INDEX_TYPE))
+            || header->index_count != index_count)
+        {
+            PG_ERROR_MINOR("stale indices (repack with --optimize-meshes or "
+                           "--lods)");
+            continue;
+        }
+#if !defined(APP_COMPACT_VERTICES)
+        // NOTE: Remapped indices only match the compact vertex order.
+        if (header->flags & MESH_INDICES_REMAPPED_VERTICES)
+        {
+            continue;
+        }
+#endif
+        model_ext_indices[i]
+            = (PG_GRAPHICS_INDEX_TYPE*)((u8*)header
+                                        + sizeof(mesh_indices_header));
+        model_remapped_vertices[i]
+            = (header->flags & MESH_INDICES_REMAPPED_VERTICES) != 0;
+        model_ext_index_counts[i] = index_count + header->lod_index_count;
+        if (model_ext_index_counts[i] > metadata->max_index_count)
+        {
+            metadata->max_index_count = model_ext_index_counts[i];
+        }
+    }
+
+    // Read meshlets.
+    for (u32 i = 0; i < model_count && i < MODEL_COUNT; i += 1)
+    {
+#if defined(APP_PAGED_ASSETS)
+        u32 index_count = pager.toc[i].index_count;
+#else
+        u32 index_count = (*assets)->models[i].index_count;
+#endif
+        u64 section_size = 0;
+        u8* section = asset_ext_find(&ext,
+                                     ASSET_EXT_SECTION_MESHLETS,
+                                     i,
+                                     &section_size);
+        meshlets* ms = &model_meshlets[i];
+        if (!section || !meshlets_read(section, section_size, ms))
+        {
+            continue;
+        }
+
+        // NOTE: Meshlets are index ranges, so they are only valid for the
+        // indices they were built from.
+        b8 valid = ((ms->flags & MESHLETS_EXT_INDICES) != 0)
+                   == (model_ext_indices[i] != 0);
+        for (u32 j = 0; valid && j < ms->meshlet_count; j += 1)
+        {
+            valid = ms->meshlets[j].index_offset + ms->meshlets[j].index_count
+                    <= index_count;
+        }
+        if (!valid)
+        {
+            PG_ERROR_MINOR("stale meshlets (repack with --meshlets)");
+            *ms = (meshlets){0};
+        }
+    }
+
+    // Read bounds.
+    for (u32 i = 0; i < model_count && i < MODEL_COUNT; i += 1)
+    {
+#if defined(APP_PAGED_ASSETS)
+        u32 index_count = pager.toc[i].index_count;
+#else
+        u32 index_count = (*assets)->models[i].index_count;
+#endif
+        u64 section_size = 0;
+        u8* section
+            = asset_ext_find(&ext, ASSET_EXT_SECTION_BOUNDS, i, &section_size);
+        bounds* bs = &model_bounds[i];
+        if (!section || !bounds_read(section, section_size, bs))
+        {
+            continue;
+        }
+
+        b8 valid = true;
+        for (u32 j = 0; valid && j < bs->primitive_count; j += 1)
+        {
+            valid = bs->primitives[j].index_offset
+                        + bs->primitives[j].index_count
+                    <= index_count;
+        }
+        if (!valid)
+        {
+            PG_ERROR_MINOR("stale bounds (repack with --bounds)");
+            *bs = (bounds){0};
+        }
+    }
+
+    // Read LODs.
+    for (u32 i = 0; i < model_count && i < MODEL_COUNT; i += 1)
+    {
+#if defined(APP_PAGED_ASSETS)
+        u32 index_count = pager.toc[i].index_count;
+#else
+        u32 index_count = (*assets)->models[i].index_count;
+#endif
+        u64 section_size = 0;
+        u8* section
+            = asset_ext_find(&ext, ASSET_EXT_SECTION_LODS, i, &section_size);
+        lods* ls = &model_lods[i];
+        if (!section || !lods_read(section, section_size, ls))
+        {
+            continue;
+        }
+
+        // NOTE: Levels live in the INDICES section, after the model's indices.
+        b8 valid = model_ext_indices[i] != 0;
+        for (u32 j = 0; valid && j < ls->primitive_count; j += 1)
+        {
+            valid = ls->primitives[j].index_offset
+                        + ls->primitives[j].index_count
+                    <= index_count;
+        }
+        for (u32 j = 0; valid && j < ls->level_count; j += 1)
+        {
+            valid = ls->levels[j].index_offset + ls->levels[j].index_count
+                    <= model_ext_index_counts[i];
+        }
+        if (!valid)
+        {
+            PG_ERROR_MINOR("stale LODs (repack with --lods)");
+            *ls = (lods){0};
+        }
+        if (ls->instance_count > drawable_lod_level_count)
+        {
+            drawable_lod_level_count = ls->instance_count;
+        }
+    }
+    if (drawable_lod_level_count)
+    {
+        pg_scratch_alloc(permanent_mem,
+                         drawable_lod_level_count * sizeof(u8),
+                         alignof(u8),
+                         &drawable_lod_levels,
+                         err);
+        if (!drawable_lod_levels)
+        {
+            drawable_lod_level_count = 0;
+        }
+    }
+
+    // Read animations.
+    u32 max_clip_channel_count = 0;
+    u32 max_node_count = 0;
+    for (u32 i = 0; i < model_count && i < MODEL_COUNT; i += 1)
+    {
+#if defined(APP_PAGED_ASSETS)
+        u32 joint_count = pager.toc[i].joint_count;
+        u32 animation_count = pager.toc[i].animation_count;
+#else
+        u32 joint_count = (*assets)->models[i].joint_count;
+        u32 animation_count = (*assets)->models[i].animation_count;
+#endif
+        u64 section_size = 0;
+        u8* section = asset_ext_find(&ext,
+                                     ASSET_EXT_SECTION_ANIMATIONS,
+                                     i,
+                                     &section_size);
+        animations* as = &model_animations[i];
+        if (!section || !animations_read(section, section_size, as))
+        {
+            continue;
+        }
+
+        if (as->joint_count != joint_count
+            || as->clip_count != animation_count)
+        {
+            PG_ERROR_MINOR("stale animations (repack with --animations)");
+            *as = (animations){0};
+            continue;
+        }
+        if (as->max_clip_channel_count > max_clip_channel_count)
+        {
+            max_clip_channel_count = as->max_clip_channel_count;
+        }
+        if (as->node_count > max_node_count)
+        {
+            max_node_count = as->node_count;
+        }
+        if (as->joint_count > crowd_joint_capacity)
+        {
+            crowd_joint_capacity = as->joint_count;
+        }
+    }
+
+#if defined(APP_COMPACT_VERTICES)
+    // Read compact vertex streams.
+    if (!ext.view.data)
+    {
+        PG_ERROR_MAJOR("failed to open asset extension file");
+    }
+    for (u32 i = 0; i < model_count && i < MODEL_COUNT; i += 1)
+    {
+#if defined(APP_PAGED_ASSETS)
+        u32 vertex_count = pager.toc[i].vertex_count;
+#else
+        u32 vertex_count = (*assets)->models[i].vertex_count;
+#endif
+        u64 section_size = 0;
+        u8* section = asset_ext_find(&ext,
+                                     ASSET_EXT_SECTION_COMPACT_VERTICES,
+                                     i,
+                                     &section_size);
+        if (!compact_vertices_read(section,
+                                   section_size,
+                                   &model_compact_vertices[i])
+            || model_compact_vertices[i].vertex_count != vertex_count)
+        {
+            PG_ERROR_MAJOR("missing or stale compact vertices (repack with "
+                           "--compact-vertices)");
+        }
+    }
+#endif
+
+#if defined(APP_PAGED_ASSETS)
+    // NOTE: Only the current model's materials are bound.
+    pg_scratch_alloc(permanent_mem,
+                     metadata->max_material_count
+                         * sizeof(pg_asset_material_properties),
+                     alignof(pg_asset_material_properties),
+                     &geometry.material_properties,
+                     err);
+#else
+    // Pack every model's geometry and materials into the arena.
+    for (u32 i = 0; i < model_count; i += 1)
+    {
+        pg_asset_model* model = &(*assets)->models[i];
+        geometry.vertex_bases[i] = geometry.vertex_count;
+        geometry.index_bases[i] = geometry.index_count;
+        geometry.material_bases[i] = geometry.material_count;
+        geometry.vertex_count += model->vertex_count;
+        geometry.index_count += model_ext_indices[i]
+                                    ? model_ext_index_counts[i]
+                                    : model->index_count;
+        geometry.material_count += model->material_count;
+    }
+
+    // NOTE: Each array is padded by its alignment.
+    usize geometry_mem_size
+        = (geometry.index_count * sizeof(PG_GRAPHICS_INDEX_TYPE))
+          + (geometry.material_count * sizeof(pg_asset_material_properties))
+#if defined(APP_COMPACT_VERTICES)
+          + (geometry.vertex_count
+             * (sizeof(compact_vertex) + sizeof(u32)
+                + sizeof(compact_vertex_skin)))
+          + alignof(compact_vertex) + alignof(u32)
+          + alignof(compact_vertex_skin)
+#else
+          + (geometry.vertex_count * sizeof(pg_vertex)) + alignof(pg_vertex)
+#endif
+          + alignof(PG_GRAPHICS_INDEX_TYPE)
+          + alignof(pg_asset_material_properties);
+    void* geometry_memory = geometry_arena_alloc_memory(geometry_mem_size);
+    if (!geometry_memory)
+    {
+        PG_ERROR_MAJOR("failed to allocate geometry memory");
+    }
+    pg_scratch_allocator geometry_mem = {0};
+    pg_scratch_init(&geometry_mem, geometry_memory, geometry_mem_size);
+#if defined(APP_COMPACT_VERTICES)
+    pg_scratch_alloc(&geometry_mem,
+                     geometry.vertex_count * sizeof(compact_vertex),
+                     alignof(compact_vertex),
+                     &geometry.vertices,
+                     err);
+    pg_scratch_alloc(&geometry_mem,
+                     geometry.vertex_count * sizeof(u32),
+                     alignof(u32),
+                     &geometry.colors,
+                     err);
+    pg_scratch_alloc(&geometry_mem,
+                     geometry.vertex_count * sizeof(compact_vertex_skin),
+                     alignof(compact_vertex_skin),
+                     &geometry.skins,
+                     err);
+#else
+    pg_scratch_alloc(&geometry_mem,
+                     geometry.vertex_count * sizeof(pg_vertex),
+                     alignof(pg_vertex),
+                     &geometry.vertices,
+                     err);
+#endif
+    pg_scratch_alloc(&geometry_mem,
+                     geometry.index_count * sizeof(PG_GRAPHICS_INDEX_TYPE),
+                     alignof(PG_GRAPHICS_INDEX_TYPE),
+                     &geometry.indices,
+                     err);
+    pg_scratch_alloc(&geometry_mem,
+                     geometry.material_count
+                         * sizeof(pg_asset_material_properties),
+                     alignof(pg_asset_material_properties),
+                     &geometry.material_properties,
+                     err);
+    for (u32 i = 0; i < model_count; i += 1)
+    {
+        pg_asset_model* model = &(*assets)->models[i];
+        u32 vertex_base = geometry.vertex_bases[i];
+#if defined(APP_COMPACT_VERTICES)
+        compact_vertices* cvs = &model_compact_vertices[i];
+        pg_copy(cvs->vertices,
+                cvs->vertex_count * sizeof(compact_vertex),
+                &geometry.vertices[vertex_base],
+                cvs->vertex_count * sizeof(compact_vertex),
+                err);
+        if (cvs->colors)
+        {
+            pg_copy(cvs->colors,
+                    cvs->vertex_count * sizeof(u32),
+                    &geometry.colors[vertex_base],
+                    cvs->vertex_count * sizeof(u32),
+                    err);
+        }
+        if (cvs->skins)
+        {
+            pg_copy(cvs->skins,
+                    cvs->vertex_count * sizeof(compact_vertex_skin),
+                    &geometry.skins[vertex_base],
+                    cvs->vertex_count * sizeof(compact_vertex_skin),
+                    err);
+        }
+#else
+        pg_copy(model->vertices,
+                model->vertex_count * sizeof(pg_vertex),
+                &geometry.vertices[vertex_base],
+                model->vertex_count * sizeof(pg_vertex),
+                err);
+#endif
+
+        PG_GRAPHICS_INDEX_TYPE* indices
+            = model_ext_indices[i] ? model_ext_indices[i] : model->indices;
+        u32 index_count = model_ext_indices[i] ? model_ext_index_counts[i]
+                                               : model->index_count;
+        pg_copy(indices,
+                index_count * sizeof(PG_GRAPHICS_INDEX_TYPE),
+                &geometry.indices[geometry.index_bases[i]],
+                index_count * sizeof(PG_GRAPHICS_INDEX_TYPE),
+                err);
+
+        for (u32 j = 0; j < model->material_count; j += 1)
+        {
+            geometry.material_properties[geometry.material_bases[i] + j]
+                = model->materials[j].properties;
+        }
+    }
+#endif
+
+    // Allocate skinned vertices and pick the fastest kernel the CPU supports.
+    for (skinning_kernel k = 0; k < SKINNING_KERNEL_COUNT; k += 1)
+    {
+        skinning_kernels_supported[k] = skinning_kernel_supported(k);
+    }
+    app_state.skinning_kernel = skinning_best_kernel();
+    for (u32 i = 0; metadata->max_skinned_vertex_count
+                    && i < APP_FRAME_BUFFER_COUNT;
+         i += 1)
+    {
+        pg_scratch_alloc(permanent_mem,
+                         metadata->max_skinned_vertex_count
+                             * sizeof(skinned_vertex),
+                         alignof(skinned_vertex),
+                         &snapshot_buffer_sets[i].skinned_vertices,
+                         err);
+    }
+
+    // Start the job system.
+    job_system_init(&jobs, job_thread_count, permanent_mem, err);
+
+    // Read scene hierarchies.
+    // NOTE: A sampled pose is applied to the scene's nodes, so the two must
+    // share their nodes.
+    for (u32 i = 0; i < model_count && i < MODEL_COUNT; i += 1)
+    {
+        u64 section_size = 0;
+        u8* section
+            = asset_ext_find(&ext, ASSET_EXT_SECTION_SCENE, i, &section_size);
+        scene* sc = &model_scenes[i];
+        if (!section || !scene_read(section, section_size, sc))
+        {
+            continue;
+        }
+
+        animations* as = &model_animations[i];
+        b8 valid = !as->clip_count || as->node_count == sc->node_count;
+        for (u32 j = 0; valid && as->clip_count && j < sc->node_count; j += 1)
+        {
+            valid = as->nodes[j].parent == sc->nodes[j].parent;
+        }
+        if (!valid)
+        {
+            PG_ERROR_MINOR("stale scene (repack with --scene)");
+            *sc = (scene){0};
+            continue;
+        }
+
+        scene_hierarchy_init(&model_hierarchies[i], sc, permanent_mem, err);
+        scene_hierarchy_reset(&model_hierarchies[i], sc);
+    }
+
+    // Allocate keyframe cursors (one set per animation layer), poses and
+    // batches.
+    if (max_clip_channel_count)
+    {
+        for (u32 l = 0; l < ANIMATION_LAYER_COUNT; l += 1)
+        {
+            pg_scratch_alloc(permanent_mem,
+                             max_clip_channel_count * sizeof(u32),
+                             alignof(u32),
+                             &app_state.animation_cursors[l].keys,
+                             err);
+        }
+        animation_pose_pool_init(&pose_pool,
+                                 ANIMATION_LAYER_COUNT,
+                                 max_node_count,
+                                 permanent_mem,
+                                 err);
+        animation_sampler_init(&keyframe_sampler,
+                               max_clip_channel_count,
+                               permanent_mem,
+                               err);
+        pg_scratch_alloc(permanent_mem,
+                         max_node_count * sizeof(pg_f32_4x4),
+                         alignof(pg_f32_4x4),
+                         &node_globals,
+                         err);
+    }
+    for (u32 l = 0; l < ANIMATION_LAYER_COUNT; l += 1)
+    {
+        app_state.animation_cursors[l].clip_id = ANIMATION_NO_CLIP;
+    }
+
+    // Allocate crowd instances, and the cursors and joint transforms of each
+    // instance of a sampled model.
+    for (u32 i = 0; i < APP_FRAME_BUFFER_COUNT; i += 1)
+    {
+        pg_scratch_alloc(permanent_mem,
+                         CROWD_MAX_INSTANCE_COUNT * sizeof(instance_sb),
+                         alignof(instance_sb),
+                         &snapshot_buffer_sets[i].crowd_instances,
+                         err);
+    }
+#if defined(APP_CROWDS)
+    if (max_clip_channel_count)
+    {
+        pg_scratch_alloc(permanent_mem,
+                         CROWD_MAX_INSTANCE_COUNT * sizeof(animation_cursors),
+                         alignof(animation_cursors),
+                         &crowd_cursors,
+                         err);
+        for (u32 i = 0; crowd_cursors && i < CROWD_MAX_INSTANCE_COUNT; i += 1)
+        {
+            crowd_cursors[i].clip_id = ANIMATION_NO_CLIP;
+            pg_scratch_alloc(permanent_mem,
+                             max_clip_channel_count * sizeof(u32),
+                             alignof(u32),
+                             &crowd_cursors[i].keys,
+                             err);
+        }
+        for (u32 i = 0; i < APP_FRAME_BUFFER_COUNT; i += 1)
+        {
+            pg_scratch_alloc(permanent_mem,
+                             CROWD_MAX_INSTANCE_COUNT * crowd_joint_capacity
+                                 * sizeof(pg_f32_4x4),
+                             alignof(pg_f32_4x4),
+                             &snapshot_buffer_sets[i].crowd_joint_transforms,
+                             err);
+        }
+
+        pg_scratch_alloc(permanent_mem,
+                         jobs.worker_count * sizeof(crowd_worker),
+                         alignof(crowd_worker),
+                         &crowd_workers,
+                         err);
+        for (u32 i = 0; crowd_workers && i < jobs.worker_count; i += 1)
+        {
+            crowd_worker* cw = &crowd_workers[i];
+            animation_sampler_init(&cw->sampler,
+                                   max_clip_channel_count,
+                                   permanent_mem,
+                                   err);
+            animation_pose_init(&cw->pose, max_node_count, permanent_mem, err);
+            pg_scratch_alloc(permanent_mem,
+                             max_node_count * sizeof(pg_f32_4x4),
+                             alignof(pg_f32_4x4),
+                             &cw->globals,
+                             err);
+        }
+    }
+#endif
+
+    // Initialize input queue.
+    pg_scratch_alloc(permanent_mem,
+                     config.input_queue_event_count * sizeof(pg_input_event),
+                     alignof(pg_input_event),
+                     &input_queue->events,
+                     err);
+    input_queue->event_count = config.input_queue_event_count;
+
+    // Set input action map.
+    for (pg_input_event_type et = 0; et < PG_INPUT_EVENT_TYPE_COUNT; et += 1)
+    {
+        input_action* at = &app_state.input_action_map[et];
+        switch (et)
+        {
+            case PG_KEYBOARD_S:
+            case PG_KEYBOARD_DOWN:
+            case PG_GAMEPAD_DOWN:
+            case PG_KEYBOARD_D:
+            case PG_KEYBOARD_RIGHT:
+            case PG_GAMEPAD_RIGHT:
+            {
+                at->repeat_rate = PG_MILLISECOND(1.0f / 2.0f);
+                at->type = INPUT_ACTION_TYPE_NEXT_MODEL;
+                break;
+            }
+            case PG_KEYBOARD_W:
+            case PG_KEYBOARD_UP:
+            case PG_GAMEPAD_UP:
+            case PG_KEYBOARD_A:
+            case PG_KEYBOARD_LEFT:
+            case PG_GAMEPAD_LEFT:
             {
                 at->repeat_rate = PG_MILLISECOND(1.0f / 2.0f);
                 at->type = INPUT_ACTION_TYPE_PREVIOUS_MODEL;
@@ -407,6 +1724,15 @@ init_app(pg_file_read_fp pg_file_read,
 
     // Initialize renderer data.
     {
+#if defined(APP_PAGED_ASSETS)
+        u32 max_vertex_count = metadata->max_vertex_count;
+        u32 max_index_count = metadata->max_index_count;
+        u32 max_material_count = metadata->max_material_count;
+#else
+        u32 max_vertex_count = geometry.vertex_count;
+        u32 max_index_count = geometry.index_count;
+        u32 max_material_count = geometry.material_count;
+#endif
         pg_graphics_buffer_data buffer_data[]
             = {{.id = GRAPHICS_BUFFER_PER_FRAME_CB,
                 .shader_stage = PG_SHADER_STAGE_VERTEX,
@@ -414,20 +1740,59 @@ init_app(pg_file_read_fp pg_file_read,
                 .elem_size = sizeof(per_frame_cb)},
                {.id = GRAPHICS_BUFFER_VERTICES_SB,
                 .shader_stage = PG_SHADER_STAGE_VERTEX,
-                .max_elem_count = metadata->max_vertex_count,
+                .max_elem_count = max_vertex_count,
+#if defined(APP_COMPACT_VERTICES)
+                .elem_size = sizeof(compact_vertex)},
+#else
                 .elem_size = sizeof(pg_vertex)},
+#endif
                {.id = GRAPHICS_BUFFER_INDICES_SB,
                 .shader_stage = PG_SHADER_STAGE_VERTEX,
-                .max_elem_count = metadata->max_index_count,
+                .max_elem_count = max_index_count,
                 .elem_size = sizeof(PG_GRAPHICS_INDEX_TYPE)},
+               // NOTE: Crowds of sampled models upload the joint
+               // transforms of every instance.
                {.id = GRAPHICS_BUFFER_JOINT_TRANSFORMS_SB,
                 .shader_stage = PG_SHADER_STAGE_VERTEX,
-                .max_elem_count = metadata->max_joint_count,
+                .max_elem_count
+                = metadata->max_joint_count
+                  + (CROWD_MAX_INSTANCE_COUNT * crowd_joint_capacity),
                 .elem_size = sizeof(pg_f32_4x4)},
                {.id = GRAPHICS_BUFFER_MATERIAL_PROPERTIES_SB,
                 .shader_stage = PG_SHADER_STAGE_PIXEL,
-                .max_elem_count = metadata->max_material_count,
-                .elem_size = sizeof(pg_asset_material_properties)}};
+                .max_elem_count = max_material_count,
+                .elem_size = sizeof(pg_asset_material_properties)},
+#if defined(APP_COMPACT_VERTICES)
+               {.id = GRAPHICS_BUFFER_VERTEX_COLORS_SB,
+                .shader_stage = PG_SHADER_STAGE_VERTEX,
+                .max_elem_count = max_vertex_count,
+                .elem_size = sizeof(u32)},
+               {.id = GRAPHICS_BUFFER_VERTEX_SKINS_SB,
+                .shader_stage = PG_SHADER_STAGE_VERTEX,
+                .max_elem_count = max_vertex_count,
+                .elem_size = sizeof(compact_vertex_skin)},
+#else
+               // NOTE: The full vertex format is interleaved, so the split
+               // streams are never bound.
+               {.id = GRAPHICS_BUFFER_VERTEX_COLORS_SB,
+                .shader_stage = PG_SHADER_STAGE_VERTEX,
+                .max_elem_count = 1,
+                .elem_size = sizeof(u32)},
+               {.id = GRAPHICS_BUFFER_VERTEX_SKINS_SB,
+                .shader_stage = PG_SHADER_STAGE_VERTEX,
+                .max_elem_count = 1,
+                .elem_size = sizeof(u32)},
+#endif
+               {.id = GRAPHICS_BUFFER_SKINNED_VERTICES_SB,
+                .shader_stage = PG_SHADER_STAGE_VERTEX,
+                .max_elem_count = metadata->max_skinned_vertex_count
+                                      ? metadata->max_skinned_vertex_count
+                                      : 1,
+                .elem_size = sizeof(skinned_vertex)},
+               {.id = GRAPHICS_BUFFER_INSTANCES_SB,
+                .shader_stage = PG_SHADER_STAGE_VERTEX,
+                .max_elem_count = CROWD_MAX_INSTANCE_COUNT,
+                .elem_size = sizeof(instance_sb)}};
         static_assert(CAP(buffer_data) == GRAPHICS_BUFFER_COUNT,
                       "unexpected buffer data count");
 
@@ -437,7 +1802,7 @@ init_app(pg_file_read_fp pg_file_read,
             .depth_buffer_bit_count = 32,
             .constant_count = sizeof(constants_cb) / sizeof(u32),
             .buffer_count = CAP(buffer_data),
-            .max_texture_count = (*assets)->model_count
+            .max_texture_count = model_count
                                  * metadata->max_material_count
                                  * PG_TEXTURE_TYPE_COUNT};
 
@@ -452,8 +1817,36 @@ init_app(pg_file_read_fp pg_file_read,
                 renderer_data->buffer_data,
                 renderer_data->buffer_count * sizeof(pg_graphics_buffer_data),
                 err);
+
+#if !defined(APP_PAGED_ASSETS)
+        // NOTE: The arena is bound once, and never changes after this.
+        pg_graphics_buffer_data* bd = renderer_data->buffer_data;
+        bd[GRAPHICS_BUFFER_VERTICES_SB].elem_count = geometry.vertex_count;
+        bd[GRAPHICS_BUFFER_VERTICES_SB].buffer = geometry.vertices;
+        bd[GRAPHICS_BUFFER_INDICES_SB].elem_count = geometry.index_count;
+        bd[GRAPHICS_BUFFER_INDICES_SB].buffer = geometry.indices;
+        bd[GRAPHICS_BUFFER_MATERIAL_PROPERTIES_SB].elem_count
+            = geometry.material_count;
+        bd[GRAPHICS_BUFFER_MATERIAL_PROPERTIES_SB].buffer
+            = geometry.material_properties;
+#if defined(APP_COMPACT_VERTICES)
+        bd[GRAPHICS_BUFFER_VERTEX_COLORS_SB].elem_count = geometry.vertex_count;
+        bd[GRAPHICS_BUFFER_VERTEX_COLORS_SB].buffer = geometry.colors;
+        bd[GRAPHICS_BUFFER_VERTEX_SKINS_SB].elem_count = geometry.vertex_count;
+        bd[GRAPHICS_BUFFER_VERTEX_SKINS_SB].buffer = geometry.skins;
+#endif
+#endif
     }
 
+#if defined(APP_PIPELINED_FRAMES)
+    // Allocate frame snapshots, each with transient memory of its own.
+    frame_pipeline_init(&pipeline,
+                        renderer_data,
+                        config.transient_mem_size,
+                        permanent_mem,
+                        err);
+#endif
+
     reset_view();
 }
 
@@ -540,31 +1933,465 @@ process_action(input_action_type at, pg_f32_2x event_value, pg_error* err)
     }
 }
 
+// Advances `animation` by `frame_time` (in ms), looping its clip. Does nothing
+// if `animation` has no clip.
 FUNCTION void
-update_app(pg_assets* assets,
-           pg_input_queue* iq,
-           models_metadata* metadata,
-           pg_f32_2x render_res,
-           pg_scratch_allocator* transient_mem,
-           pg_graphics_renderer_data* renderer_data,
-           pg_error* err)
+advance_animation(pg_asset_model* model,
+                  pg_animation* animation,
+                  f32 frame_time)
 {
-    f32 frame_time = app_state.metrics->cpu_last_frame_time;
-
-    // Process input.
+    if (animation->id >= model->animation_count)
     {
-        // Process inputs in event queue.
-        for (; iq->read_idx != iq->write_idx;
-             iq->read_idx = (iq->read_idx + 1) % iq->event_count)
-        {
-            pg_input_event ie = iq->events[iq->read_idx];
-            input_action* ia = &app_state.input_action_map[ie.event_type];
+        return;
+    }
 
-            // Skip any input event that does not have a mapped input action.
-            if (!ia->type)
-            {
-                continue;
-            }
+    animation->time += frame_time;
+
+    // Loop the animation.
+    if (animation->time > model->animations[animation->id].duration)
+    {
+        animation->time -= model->animations[animation->id].duration;
+    }
+}
+
+// Returns the time of `animation` in seconds, the unit of its clip's keys.
+// NOTE: The playback time is rescaled by the clip's duration.
+FUNCTION f32
+get_clip_time(animations* as, pg_asset_model* model, pg_animation* animation)
+{
+    if (animation->id >= as->clip_count)
+    {
+        return 0.0f;
+    }
+
+    f32 duration = model->animations[animation->id].duration;
+    return duration > 0.0f ? animation->time
+                                 * (as->clips[animation->id].duration
+                                    / duration)
+                           : 0.0f;
+}
+
+// NOTE: Culling counts and ranges are kept per batch of drawables, so jobs
+// never write the same counts and the ranges can be gathered in order.
+typedef struct
+{
+    meshlet_draw_range* ranges; // In the memory of the worker that culled it
+    u32 range_count;
+    u32 cached_drawable_count;
+    meshlet_cull_stats meshlet_stats;
+    lod_select_stats lod_stats;
+} cull_batch;
+
+typedef struct
+{
+    pg_graphics_drawable* drawables;
+    bounds* bs;
+    meshlets* ms;
+    lods* ls;
+    scene* sc;
+    scene_hierarchy* sh;
+    pg_f32_4x4* joint_transforms;
+    u32 joint_count;
+    frustum_aabbs* aabbs;
+    b8* visible;
+    pg_f32_4x4 world_from_model;
+    pg_f32_4x4 clip_from_world;
+    pg_f32_3x camera_position;
+    f32 world_from_model_scale;
+    f32 projection_scale;
+    f32 render_height;
+    b8 lod_selection;
+    b8 meshlet_culling;
+    cull_batch* batches; // One per CULL_BATCH_SIZE drawables
+    pg_error* err;
+} cull_job_data;
+
+typedef struct
+{
+    skinning_kernel kernel;
+    pg_vertex* vertices;
+    pg_f32_4x4* joint_transforms;
+    u32 joint_count;
+    skinned_vertex* skinned_vertices;
+    u32* skinned_counts; // One per SKIN_BATCH_SIZE vertices
+} skin_job_data;
+
+typedef struct
+{
+    meshlet_draw_range* draw_ranges;
+    pg_graphics_drawable* drawables;
+    u32 opaque_drawable_count;
+    u32 max_material_count;
+    u32 instance_count;
+    u32 vertex_base; // Of the model, in the arena
+    u32 index_base;
+    u32 material_base;
+    constants_cb* constants; // One per draw range
+    pg_graphics_draw_data* draw_data;
+    pg_error* err;
+} draw_data_job_data;
+
+typedef struct
+{
+    animations* as;
+    u32 clip_id;
+    f32 time;                      // Of instance 0, in seconds
+    pg_f32_4x4* joint_transforms;  // Of instance 0 onwards
+    animation_sample_stats* stats; // One per CROWD_BATCH_SIZE instances
+} crowd_job_data;
+
+// Returns the clip time of crowd instance `instance_id`, given the time of
+// instance 0.
+// NOTE: Offsets step by the golden ratio, so neighbors never play in step.
+FUNCTION f32
+crowd_get_clip_time(u32 instance_id, f32 time, f32 duration)
+{
+    f32 phase = (f32)instance_id * 0.618034f;
+    phase -= (f32)(u32)phase;
+    time += phase * duration;
+
+    return time >= duration ? time - duration : time;
+}
+
+// Samples and builds the joint transforms of crowd instances `begin + 1` to
+// `end + 1` (instance 0 is sampled with every layer).
+FUNCTION void
+crowd_animation_job(job_worker* worker, void* data, u32 begin, u32 end)
+{
+    crowd_job_data* cj = data;
+    crowd_worker* cw = &crowd_workers[worker->id];
+    animations* as = cj->as;
+    animation_sample_stats* stats = &cj->stats[begin / CROWD_BATCH_SIZE];
+    f32 duration = as->clips[cj->clip_id].duration;
+
+    for (u32 i = begin + 1; i < end + 1; i += 1)
+    {
+        animation_sample(as,
+                         cj->clip_id,
+                         crowd_get_clip_time(i, cj->time, duration),
+                         &crowd_cursors[i],
+                         &cw->sampler,
+                         &cw->pose,
+                         stats);
+        animation_build_joint_transforms(
+            as,
+            &cw->pose,
+            cw->globals,
+            &cj->joint_transforms[i * as->joint_count]);
+    }
+}
+
+// Places `instance_count` instances on a square grid centered on the origin,
+// each offset by `joint_stride` joint transforms from the one before.
+FUNCTION void
+crowd_layout(pg_f32_4x4* world_from_model,
+             u32 instance_count,
+             u32 joint_stride,
+             instance_sb* instances)
+{
+    u32 side = 1;
+    while (side * side < instance_count)
+    {
+        side += 1;
+    }
+
+    f32 origin = -0.5f * CROWD_SPACING * (f32)(side - 1);
+    for (u32 i = 0; i < instance_count; i += 1)
+    {
+        instance_sb* inst = &instances[i];
+        *inst = (instance_sb){.world_from_model = *world_from_model,
+                              .joint_offset = i * joint_stride};
+
+        // NOTE: The translation is the last column.
+        f32* translation = &((f32*)&inst->world_from_model)[12];
+        translation[0] += origin + (CROWD_SPACING * (f32)(i % side));
+        translation[2] += origin + (CROWD_SPACING * (f32)(i / side));
+    }
+}
+
+// Computes the model space bounding boxes of drawables `begin` to `end`.
+// NOTE: Boxes of drawables whose node did not move are reused.
+FUNCTION void
+cull_boxes_job(job_worker* worker, void* data, u32 begin, u32 end)
+{
+    (void)worker;
+    cull_job_data* cj = data;
+    cull_batch* batch = &cj->batches[begin / CULL_BATCH_SIZE];
+    frustum_aabbs* aabbs = cj->aabbs;
+    scene_hierarchy* sh = cj->sh;
+
+    for (u32 i = begin; i < end; i += 1)
+    {
+        pg_graphics_drawable* d = &cj->drawables[i];
+        primitive_bounds* pb = bounds_find_primitive(cj->bs, d->index_offset);
+        pg_f32_3x center = {0};
+        pg_f32_3x extent = pg_f32_3x_pack(BOUNDS_UNBOUNDED_EXTENT);
+        u32 node = scene_get_drawable_node(sh, cj->sc, i);
+        u32 instance = node != SCENE_NO_NODE ? sh->drawable_instances[i] : 0;
+        if (node != SCENE_NO_NODE && sh->instance_cached[instance]
+            && !sh->updated[node])
+        {
+            center = sh->instance_centers[instance];
+            extent = sh->instance_extents[instance];
+            batch->cached_drawable_count += 1;
+        }
+        else if (pb && pb->index_count == d->index_count)
+        {
+            bounds_get_drawable_aabb(cj->bs,
+                                     pb,
+                                     &d->global_transform,
+                                     cj->joint_transforms,
+                                     cj->joint_count,
+                                     &center,
+                                     &extent);
+            if (node != SCENE_NO_NODE && !pb->joint_bounds_count)
+            {
+                sh->instance_centers[instance] = center;
+                sh->instance_extents[instance] = extent;
+                sh->instance_cached[instance] = true;
+            }
+        }
+        aabbs->center_x[i] = center.x;
+        aabbs->center_y[i] = center.y;
+        aabbs->center_z[i] = center.z;
+        aabbs->extent_x[i] = extent.x;
+        aabbs->extent_y[i] = extent.y;
+        aabbs->extent_z[i] = extent.z;
+    }
+}
+
+// Selects the LODs of the visible drawables `begin` to `end` and culls their
+// meshlets, writing the index ranges to draw to the worker's memory.
+FUNCTION void
+cull_ranges_job(job_worker* worker, void* data, u32 begin, u32 end)
+{
+    cull_job_data* cj = data;
+    cull_batch* batch = &cj->batches[begin / CULL_BATCH_SIZE];
+    frustum_aabbs* aabbs = cj->aabbs;
+    lods* ls = cj->ls;
+    pg_error* err = cj->err;
+
+    u32 max_range_count = 0;
+    for (u32 i = begin; i < end; i += 1)
+    {
+        meshlet_primitive* p
+            = meshlets_find_primitive(cj->ms, cj->drawables[i].index_offset);
+        max_range_count += p ? p->meshlet_count : 1;
+    }
+    pg_scratch_alloc(&worker->mem,
+                     max_range_count * sizeof(meshlet_draw_range),
+                     alignof(meshlet_draw_range),
+                     &batch->ranges,
+                     err);
+    if (!batch->ranges)
+    {
+        return;
+    }
+
+    for (u32 i = begin; i < end; i += 1)
+    {
+        pg_graphics_drawable* d = &cj->drawables[i];
+        if (!cj->visible[i])
+        {
+            batch->meshlet_stats.triangle_count += d->index_count / 3;
+            continue;
+        }
+
+        // Select the coarsest level whose error is below a pixel. Levels are
+        // measured from the nearest point of the drawable's bounds, or from
+        // its origin if it has none.
+        pg_f32_4x4 world_from_mesh
+            = pg_f32_4x4_mul(cj->world_from_model, d->global_transform);
+        lod_primitive* lp = cj->lod_selection
+                                ? lods_find_primitive(ls, d->index_offset)
+                                : 0;
+        u32 level = 0;
+        if (lp && lp->index_count == d->index_count)
+        {
+            pg_f32_3x center
+                = frustum_transform(&world_from_mesh, (pg_f32_3x){0}, 1.0f);
+            f32 radius = 0.0f;
+            if (aabbs->extent_x[i] < BOUNDS_UNBOUNDED_EXTENT)
+            {
+                pg_f32_3x e = {aabbs->extent_x[i],
+                               aabbs->extent_y[i],
+                               aabbs->extent_z[i]};
+                center = frustum_transform(&cj->world_from_model,
+                                           (pg_f32_3x){aabbs->center_x[i],
+                                                       aabbs->center_y[i],
+                                                       aabbs->center_z[i]},
+                                           1.0f);
+                radius = cj->world_from_model_scale
+                         * lod_sqrt((e.x * e.x) + (e.y * e.y) + (e.z * e.z));
+            }
+            f32 pixels_per_unit
+                = lod_pixels_per_unit(lod_matrix_scale(&world_from_mesh),
+                                      center,
+                                      radius,
+                                      cj->camera_position,
+                                      cj->projection_scale,
+                                      cj->render_height);
+            level = lods_select(ls,
+                                lp,
+                                pixels_per_unit,
+                                i < drawable_lod_level_count
+                                    ? drawable_lod_levels[i]
+                                    : 0);
+        }
+        if (i < drawable_lod_level_count)
+        {
+            drawable_lod_levels[i] = (u8)level;
+        }
+        batch->lod_stats.drawable_counts[level] += 1;
+
+        meshlet_primitive* p
+            = cj->meshlet_culling && !level
+                  ? meshlets_find_primitive(cj->ms, d->index_offset)
+                  : 0;
+        meshlet_draw_range* ranges = &batch->ranges[batch->range_count];
+        meshlet_cull_stats* ms = &batch->meshlet_stats;
+        if (level)
+        {
+            lod_level* l = &ls->levels[lp->level_offset + level - 1];
+            *ranges = (meshlet_draw_range){.drawable_id = i,
+                                           .index_offset = l->index_offset,
+                                           .index_count = l->index_count};
+            batch->range_count += 1;
+            ms->range_count += 1;
+            ms->triangle_count += d->index_count / 3;
+            ms->drawn_triangle_count += l->index_count / 3;
+        }
+        else if (p && p->index_count == d->index_count)
+        {
+            pg_f32_4x4 clip_from_mesh
+                = pg_f32_4x4_mul(cj->clip_from_world, world_from_mesh);
+            batch->range_count += meshlet_cull(cj->ms,
+                                               p,
+                                               i,
+                                               &world_from_mesh,
+                                               &clip_from_mesh,
+                                               cj->camera_position,
+                                               ranges,
+                                               ms);
+        }
+        else
+        {
+            *ranges = (meshlet_draw_range){.drawable_id = i,
+                                           .index_offset = d->index_offset,
+                                           .index_count = d->index_count};
+            batch->range_count += 1;
+            ms->range_count += 1;
+            ms->triangle_count += d->index_count / 3;
+            ms->drawn_triangle_count += d->index_count / 3;
+        }
+    }
+}
+
+// Skins vertices `begin` to `end`.
+FUNCTION void
+skin_job(job_worker* worker, void* data, u32 begin, u32 end)
+{
+    (void)worker;
+    skin_job_data* sj = data;
+    sj->skinned_counts[begin / SKIN_BATCH_SIZE]
+        = skinning_skin_vertices(sj->kernel,
+                                 &sj->vertices[begin],
+                                 end - begin,
+                                 sj->joint_transforms,
+                                 sj->joint_count,
+                                 &sj->skinned_vertices[begin]);
+}
+
+// Sets the constants and draw data of draw ranges `begin` to `end`.
+FUNCTION void
+draw_data_job(job_worker* worker, void* data, u32 begin, u32 end)
+{
+    (void)worker;
+    draw_data_job_data* dj = data;
+
+    for (u32 i = begin; i < end; i += 1)
+    {
+        meshlet_draw_range* r = &dj->draw_ranges[i];
+        pg_graphics_drawable* d = &dj->drawables[r->drawable_id];
+#if defined(APP_PAGED_ASSETS)
+        // NOTE: Drawables are generated from a single-model page, so their
+        // art id is page-local.
+        u32 art_id = app_state.model_id;
+#else
+        u32 art_id = d->art_id;
+#endif
+        constants_cb* constants = &dj->constants[i];
+        *constants = (constants_cb){
+            .vertex_offset = dj->vertex_base + d->vertex_offset,
+            .index_offset = dj->index_base + r->index_offset,
+            .material_id = dj->material_base + d->material_id,
+            .texture_id = (u32)pg_3d_to_1d_index(0,
+                                                 d->material_id,
+                                                 art_id,
+                                                 PG_TEXTURE_TYPE_COUNT,
+                                                 dj->max_material_count),
+            .global_transform = d->global_transform};
+
+#if defined(APP_COMPACT_VERTICES)
+        pg_error* err = dj->err;
+        compact_vertices* cvs = &model_compact_vertices[app_state.model_id];
+        compact_vertex_range* range
+            = compact_vertex_find_range(cvs->ranges,
+                                        cvs->range_count,
+                                        d->vertex_offset);
+        if (!range)
+        {
+            PG_ERROR_MAJOR("drawable has no compact vertex range");
+        }
+        else
+        {
+            constants->position_min = range->position_min;
+            constants->position_extent = range->position_extent;
+            constants->vertex_flags = cvs->stream_flags;
+        }
+#endif
+
+        dj->draw_data[i] = (pg_graphics_draw_data){
+            .opaque = r->drawable_id < dj->opaque_drawable_count ? true
+                                                                 : false,
+            .vertex_count = r->index_count,
+            .instance_count = dj->instance_count,
+            .start_texture_id = constants->texture_id,
+            .texture_count = PG_TEXTURE_TYPE_COUNT,
+            .constants = constants};
+    }
+}
+
+FUNCTION void
+update_app(pg_assets* assets,
+           pg_input_queue* iq,
+           models_metadata* metadata,
+           pg_f32_2x render_res,
+           pg_scratch_allocator* transient_mem,
+           pg_graphics_renderer_data* renderer_data,
+           u32 snapshot_id,
+           pg_error* err)
+{
+    f32 frame_time = app_state.metrics->cpu_last_frame_time;
+    job_worker* worker = &jobs.workers[0];
+    snapshot_buffers* sb = &snapshot_buffer_sets[snapshot_id];
+
+    FRAME_STAGE_BEGIN();
+
+    // Process input.
+    {
+        // Process inputs in event queue.
+        for (; iq->read_idx != iq->write_idx;
+             iq->read_idx = (iq->read_idx + 1) % iq->event_count)
+        {
+            pg_input_event ie = iq->events[iq->read_idx];
+            input_action* ia = &app_state.input_action_map[ie.event_type];
+
+            // Skip any input event that does not have a mapped input action.
+            if (!ia->type)
+            {
+                continue;
+            }
 
             pg_f32_2x event_value = ie.value;
             {
@@ -644,10 +2471,59 @@ update_app(pg_assets* assets,
             }
         }
     }
+    FRAME_STAGE_END(FRAME_STAGE_INPUT);
+
+#if defined(APP_PAGED_ASSETS)
+    (void)assets;
+    model_pager_update(&pager, MODEL_PAGER_FRAME_COMPLETION_BUDGET, err);
+#endif
+
+    // NOTE: The rest of the frame is built from these, read once, so that it
+    // never mixes state from before and after frames are flushed.
+    u32 model_id = app_state.model_id;
+    b8 model_switched = model_id != metadata->model_id_last_frame;
+    u32 instance_count = app_state.instance_count;
+    skinning_kernel kernel = app_state.skinning_kernel;
+    b8 drawable_culling = app_state.drawable_culling;
+    b8 meshlet_culling = app_state.meshlet_culling;
+    b8 lod_selection = app_state.lod_selection;
+    b8 pre_skinning = app_state.pre_skinning;
+    b8 animation_sampling = app_state.animation_sampling;
+    b8 wireframe_mode = app_state.wireframe_mode;
+
+#if defined(APP_PIPELINED_FRAMES)
+    // NOTE: Switching models binds geometry and declares textures again (and
+    // so does loading a page), which rewrites memory that the frames in flight
+    // may still be rendered from, so those are rendered first.
+    b8 flush_frames = model_switched;
+#if defined(APP_PAGED_ASSETS)
+    flush_frames = flush_frames || pager.loaded_this_frame;
+#endif
+    if (flush_frames)
+    {
+        frame_pipeline_flush(&pipeline);
+    }
+#endif
 
-    pg_asset_model* model = &assets->models[app_state.model_id];
+#if defined(APP_PAGED_ASSETS)
+    // NOTE: A page holds its model at index 0.
+    pg_assets* model_assets
+        = model_pager_acquire(&pager, model_id, err);
+    u32 model_assets_id = 0;
+    model_pager_prefetch(&pager,
+                         model_id,
+                         MODEL_PAGER_PREFETCH_RADIUS,
+                         err);
+    u32 model_count = pager.model_count;
+#else
+    pg_assets* model_assets = assets;
+    u32 model_assets_id = model_id;
+#endif
+    pg_asset_model* model = &model_assets->models[model_assets_id];
 
     // Animate.
+    pg_f32_4x4* sampled_joint_transforms = 0;
+    u32 crowd_joint_stride = 0; // Crowd instances have their own joints.
     {
         app_state.model_animation_count = model->animation_count;
 
@@ -665,30 +2541,221 @@ update_app(pg_assets* assets,
                             &app_state.camera);
         }
 
-        if (app_state.model_id != metadata->model_id_last_frame)
+        animations* as = &model_animations[model_id];
+        animation_cursors* cursors = app_state.animation_cursors;
+        if (model_switched)
+        {
+            app_state.animation.time = 0.0f;
+            app_state.fade_animation.id = ANIMATION_NO_CLIP;
+            app_state.additive_animation.id = ANIMATION_NO_CLIP;
+            for (u32 l = 0; l < ANIMATION_LAYER_COUNT; l += 1)
+            {
+                cursors[l].clip_id = ANIMATION_NO_CLIP;
+            }
+            for (u32 i = 0; crowd_cursors && i < CROWD_MAX_INSTANCE_COUNT;
+                 i += 1)
+            {
+                crowd_cursors[i].clip_id = ANIMATION_NO_CLIP;
+            }
+        }
+
+        // NOTE: Crossfades and additive layers reach the nodes the viewer
+        // places from its pose, which needs a scene the drawables can be built
+        // from. Otherwise the asset library places them from the base clip, so
+        // that is all that is sampled.
+        scene* sc = &model_scenes[model_id];
+        scene_hierarchy* sh = &model_hierarchies[model_id];
+        b8 layering = sc->node_count && !sh->bind_failed;
+        app_state.animation_layering = layering;
+
+        // Crossfade from the clip sampled last frame if the clip changed.
+        // NOTE: The new clip starts from its beginning, and the old clip keeps
+        // its time and cursors while it fades out.
+        u32 last_clip_id = cursors[ANIMATION_LAYER_BASE].clip_id;
+        if (animation_sampling && layering && last_clip_id < as->clip_count
+            && app_state.animation.id < as->clip_count
+            && app_state.animation.id != last_clip_id)
         {
+            app_state.fade_animation
+                = (pg_animation){.id = last_clip_id,
+                                 .time = app_state.animation.time};
+            app_state.fade_time = 0.0f;
             app_state.animation.time = 0.0f;
+
+            animation_cursors fade_cursors = cursors[ANIMATION_LAYER_FADE];
+            cursors[ANIMATION_LAYER_FADE] = cursors[ANIMATION_LAYER_BASE];
+            cursors[ANIMATION_LAYER_BASE] = fade_cursors;
+        }
+
+        advance_animation(model, &app_state.animation, frame_time);
+        advance_animation(model, &app_state.fade_animation, frame_time);
+        advance_animation(model, &app_state.additive_animation, frame_time);
+        app_state.fade_time += frame_time;
+        if (app_state.fade_time >= ANIMATION_CROSSFADE_TIME)
+        {
+            app_state.fade_animation.id = ANIMATION_NO_CLIP;
+        }
+
+        // Sample the skeleton.
+        // NOTE: The additive clip is added relative to its first key.
+        u32 fade_clip_id
+            = layering ? app_state.fade_animation.id : ANIMATION_NO_CLIP;
+        u32 additive_clip_id
+            = layering ? app_state.additive_animation.id : ANIMATION_NO_CLIP;
+        b8 posed = false;
+        app_state.animation_stats = (animation_sample_stats){0};
+        if (animation_sampling && app_state.animation.id < as->clip_count)
+        {
+            animation_layers layers = {
+                .clip_ids = {app_state.animation.id,
+                             fade_clip_id,
+                             additive_clip_id,
+                             additive_clip_id},
+                .times = {get_clip_time(as, model, &app_state.animation),
+                          get_clip_time(as, model, &app_state.fade_animation),
+                          get_clip_time(as,
+                                        model,
+                                        &app_state.additive_animation),
+                          0.0f},
+                .fade_weight = app_state.fade_time / ANIMATION_CROSSFADE_TIME,
+                .additive_weight = app_state.additive_weight};
+
+            pg_scratch_alloc(transient_mem,
+                             as->joint_count * sizeof(pg_f32_4x4),
+                             alignof(pg_f32_4x4),
+                             &sampled_joint_transforms,
+                             err);
+            animation_pose* pose = animation_blend_layers(
+                as,
+                &layers,
+                cursors,
+                &keyframe_sampler,
+                &pose_pool,
+                &app_state.animation_stats);
+            if (!pose)
+            {
+                sampled_joint_transforms = 0;
+            }
+            else if (sc->node_count)
+            {
+                scene_set_pose(sh, sc, pose);
+                posed = true;
+            }
+            else
+            {
+                animation_build_joint_transforms(as,
+                                                 pose,
+                                                 node_globals,
+                                                 sampled_joint_transforms);
+            }
+            if (pose)
+            {
+                animation_pose_release(&pose_pool, pose);
+            }
+        }
+
+        // Update the scene hierarchy.
+        // NOTE: With a pose, the joint transforms come from the hierarchy's
+        // global transforms, so the nodes are only walked once.
+        app_state.scene_stats = (scene_update_stats){0};
+        if (sc->node_count)
+        {
+            scene_update(sh, sc, posed, &app_state.scene_stats);
+            if (posed)
+            {
+                animation_joint_transforms(as,
+                                           sh->globals,
+                                           sampled_joint_transforms);
+            }
         }
 
-        if (app_state.animation.id < model->animation_count)
+        // Sample the rest of the crowd.
+        // NOTE: Instances only play the base clip, each from its own offset
+        // with its own cursors. Without sampled joints (e.g. node animation),
+        // every instance shares the asset library's.
+        if (instance_count > 1 && sampled_joint_transforms
+            && sb->crowd_joint_transforms && crowd_workers)
         {
-            app_state.animation.time += frame_time;
+            crowd_joint_stride = as->joint_count;
+            pg_copy(sampled_joint_transforms,
+                    as->joint_count * sizeof(pg_f32_4x4),
+                    sb->crowd_joint_transforms,
+                    as->joint_count * sizeof(pg_f32_4x4),
+                    err);
+
+            crowd_job_data crowd_data = {
+                .as = as,
+                .clip_id = app_state.animation.id,
+                .time = get_clip_time(as, model, &app_state.animation),
+                .joint_transforms = sb->crowd_joint_transforms};
+            u32 batch_count = ((instance_count - 1) + CROWD_BATCH_SIZE - 1)
+                              / CROWD_BATCH_SIZE;
+            pg_scratch_alloc(transient_mem,
+                             batch_count * sizeof(animation_sample_stats),
+                             alignof(animation_sample_stats),
+                             &crowd_data.stats,
+                             err);
+            if (crowd_data.stats)
+            {
+                for (u32 b = 0; b < batch_count; b += 1)
+                {
+                    crowd_data.stats[b] = (animation_sample_stats){0};
+                }
+
+                job_counter crowd_counter = {0};
+                job_parallel_for(worker,
+                                 &crowd_animation_job,
+                                 &crowd_data,
+                                 instance_count - 1,
+                                 CROWD_BATCH_SIZE,
+                                 &crowd_counter);
+                job_wait(worker, &crowd_counter);
 
-            // Loop the animation.
-            if (app_state.animation.time
-                > model->animations[app_state.animation.id].duration)
+                animation_sample_stats* st = &app_state.animation_stats;
+                for (u32 b = 0; b < batch_count; b += 1)
+                {
+                    st->channel_count += crowd_data.stats[b].channel_count;
+                    st->search_count += crowd_data.stats[b].search_count;
+                    st->advance_count += crowd_data.stats[b].advance_count;
+                }
+            }
+            else
             {
-                app_state.animation.time
-                    -= model->animations[app_state.animation.id].duration;
+                crowd_joint_stride = 0;
             }
         }
     }
+    FRAME_STAGE_END(FRAME_STAGE_ANIMATE);
 
     // Generate matrices.
-    pg_f32_4x4 world_from_model = pg_f32_4x4_world_from_model(
-        app_state.scaling,
-        pg_f32_4x_euler_to_quaternion(app_state.rotation),
-        app_state.translation);
+    // NOTE: The model's transform only changes when the view is reset, and
+    // the crowd is only laid out again when it or the transform changes.
+    if (app_state.world_from_model_dirty)
+    {
+        app_state.world_from_model = pg_f32_4x4_world_from_model(
+            app_state.scaling,
+            pg_f32_4x_euler_to_quaternion(app_state.rotation),
+            app_state.translation);
+        app_state.world_from_model_dirty = false;
+        for (u32 i = 0; i < APP_FRAME_BUFFER_COUNT; i += 1)
+        {
+            snapshot_buffer_sets[i].crowd_layout_stale = true;
+        }
+    }
+    b8 crowd_dirty = sb->crowd_layout_stale
+                     || instance_count != sb->crowd_layout_instance_count
+                     || crowd_joint_stride != sb->crowd_layout_joint_stride;
+    if (crowd_dirty && sb->crowd_instances)
+    {
+        crowd_layout(&app_state.world_from_model,
+                     instance_count,
+                     crowd_joint_stride,
+                     sb->crowd_instances);
+        sb->crowd_layout_instance_count = instance_count;
+        sb->crowd_layout_joint_stride = crowd_joint_stride;
+        sb->crowd_layout_stale = false;
+    }
+    pg_f32_4x4 world_from_model = app_state.world_from_model;
     pg_f32_3x camera_position
         = pg_camera_get_cartesian_position(&app_state.camera);
     pg_f32_4x4 view_from_world
@@ -701,231 +2768,812 @@ update_app(pg_assets* assets,
         27.0f,
         render_res.width / render_res.height,
         0.01f,
-        16.0f);
+        16.0f + (CROWD_SPACING * lod_sqrt((f32)instance_count)));
+    pg_f32_4x4 clip_from_world = pg_f32_4x4_mul(clip_from_view, view_from_world);
+    FRAME_STAGE_END(FRAME_STAGE_MATRICES);
 
     // Get drawables.
-    pg_f32_4x4* joint_transforms = 0;
+    // NOTE: Once a model's instances are bound, the drawables are built from
+    // the hierarchy, and the asset library is only asked for them (and their
+    // transforms) while it animates the model.
+    pg_f32_4x4* joint_transforms = sampled_joint_transforms;
     pg_graphics_drawables drawables = {0};
     {
         pg_asset_model models[] = {*model};
-        u32 model_ids[] = {app_state.model_id};
+        u32 model_ids[] = {model_assets_id};
         pg_animation animations[] = {app_state.animation};
-        pg_assets_get_3d_drawables(assets,
-                                   model_ids,
-                                   animations,
-                                   CAP(models),
-                                   &view_from_model,
-                                   transient_mem,
-                                   &joint_transforms,
-                                   &drawables,
-                                   err);
-    }
+        scene* sc = &model_scenes[model_id];
+        scene_hierarchy* sh = &model_hierarchies[model_id];
+#if defined(APP_BENCHMARK)
+        benchmark.drawable_assets = model_assets;
+        benchmark.drawable_model_id = model_assets_id;
+        benchmark.drawable_animation = app_state.animation;
+        benchmark.drawable_view_from_model = view_from_model;
+        benchmark.sampled_joint_transforms = sampled_joint_transforms;
+        benchmark.sampled_joint_count = model_animations[model_id].joint_count;
+#endif
 
-    // Update renderer data.
-    {
-        // Update buffers.
-        for (graphics_buffer gb = 0; gb < GRAPHICS_BUFFER_COUNT; gb += 1)
+        // NOTE: Binding only uses the drawables' primitives and materials, so
+        // the asset library is given no clip to sample.
+        if (sc->node_count && !sh->bound && !sh->bind_failed)
         {
-            if (gb == GRAPHICS_BUFFER_PER_FRAME_CB)
-            {
-                pg_f32_4x4 clip_from_world
-                    = pg_f32_4x4_mul(clip_from_view, view_from_world);
-
-                per_frame_cb* per_frame;
-                pg_scratch_alloc(transient_mem,
-                                 sizeof(per_frame_cb),
-                                 alignof(per_frame_cb),
-                                 &per_frame,
-                                 err);
-                *per_frame
-                    = (per_frame_cb){.world_from_model = world_from_model,
-                                     .clip_from_world = clip_from_world,
-                                     .camera_pos = camera_position};
+            pg_animation no_clip[] = {{.id = ANIMATION_NO_CLIP}};
+            pg_f32_4x4* library_joint_transforms = 0;
+            pg_assets_get_3d_drawables(model_assets,
+                                       model_ids,
+                                       no_clip,
+                                       CAP(models),
+                                       &view_from_model,
+                                       transient_mem,
+                                       &library_joint_transforms,
+                                       &drawables,
+                                       err);
+            sh->bind_failed
+                = !scene_bind_drawables(sh,
+                                        sc,
+                                        drawables.drawables,
+                                        drawables.drawable_count,
+                                        drawables.opaque_drawable_count);
+        }
 
-                renderer_data->buffer_data[gb].elem_count = 1;
-                renderer_data->buffer_data[gb].buffer = per_frame;
-            }
-            else if (gb == GRAPHICS_BUFFER_VERTICES_SB)
-            {
-                if (app_state.model_id != metadata->model_id_last_frame)
-                {
-                    renderer_data->buffer_data[gb].elem_count
-                        = model->vertex_count;
-                    renderer_data->buffer_data[gb].buffer = model->vertices;
-                }
-            }
-            else if (gb == GRAPHICS_BUFFER_INDICES_SB)
-            {
-                if (app_state.model_id != metadata->model_id_last_frame)
-                {
-                    renderer_data->buffer_data[gb].elem_count
-                        = model->index_count;
-                    renderer_data->buffer_data[gb].buffer = model->indices;
-                }
-            }
-            else if (gb == GRAPHICS_BUFFER_JOINT_TRANSFORMS_SB)
+        if (scene_can_build_drawables(sh, sc)
+            && (sampled_joint_transforms || !model->joint_count))
+        {
+            scene_get_drawables(sh,
+                                sc,
+                                &view_from_model,
+                                transient_mem,
+                                &drawables,
+                                err);
+        }
+        else
+        {
+            // NOTE: Without a bound scene (e.g. a stale one), the asset
+            // library still samples the animation to place the drawables, but
+            // its joint transforms are replaced by the sampled ones.
+            sh->drawable_count = 0;
+            pg_assets_get_3d_drawables(model_assets,
+                                       model_ids,
+                                       animations,
+                                       CAP(models),
+                                       &view_from_model,
+                                       transient_mem,
+                                       &joint_transforms,
+                                       &drawables,
+                                       err);
+            if (sampled_joint_transforms)
             {
-                renderer_data->buffer_data[gb].elem_count = model->joint_count;
-                renderer_data->buffer_data[gb].buffer = joint_transforms;
+                joint_transforms = sampled_joint_transforms;
             }
-            else if (gb == GRAPHICS_BUFFER_MATERIAL_PROPERTIES_SB)
-            {
-                pg_asset_material_properties* material_properties;
-                pg_scratch_alloc(transient_mem,
-                                 model->material_count
-                                     * sizeof(pg_asset_material_properties),
-                                 alignof(pg_asset_material_properties),
-                                 &material_properties,
-                                 err);
+        }
+    }
+    FRAME_STAGE_END(FRAME_STAGE_DRAWABLES);
 
-                for (u32 i = 0; i < model->material_count; i += 1)
-                {
-                    material_properties[i] = model->materials[i].properties;
-                }
+    // Skin vertices in the background.
+    // NOTE: Weighted vertices are skinned once here instead of once per index
+    // in `vs`. Skinning only needs the joint transforms, so other workers skin
+    // while this one culls, and the Skin stage only waits for the rest.
+    // NOTE: Crowd instances with their own joints are skinned in `vs`.
+    b8 pre_skinned = pre_skinning && model->joint_count
+                     && sb->skinned_vertices && !crowd_joint_stride
+                     && !model_remapped_vertices[model_id];
+    skin_job_data skin_data = {0};
+    job_counter skin_counter = {0};
+    u32 skin_batch_count = 0;
+    if (pre_skinned)
+    {
+        skin_batch_count
+            = (model->vertex_count + SKIN_BATCH_SIZE - 1) / SKIN_BATCH_SIZE;
+        skin_data = (skin_job_data){.kernel = kernel,
+                                    .vertices = model->vertices,
+                                    .joint_transforms = joint_transforms,
+                                    .joint_count = model->joint_count,
+                                    .skinned_vertices = sb->skinned_vertices};
+        pg_scratch_alloc(transient_mem,
+                         skin_batch_count * sizeof(u32),
+                         alignof(u32),
+                         &skin_data.skinned_counts,
+                         err);
+        job_parallel_for(worker,
+                         &skin_job,
+                         &skin_data,
+                         model->vertex_count,
+                         SKIN_BATCH_SIZE,
+                         &skin_counter);
+    }
 
-                renderer_data->buffer_data[gb].elem_count
-                    = model->material_count;
-                renderer_data->buffer_data[gb].buffer = material_properties;
+    // Cull drawables and meshlets, and select LODs.
+    // NOTE: Drawables without bounds are never culled, and drawables without
+    // meshlets (or drawn at a coarser level) are drawn whole, as one range.
+    // NOTE: Drawables are culled in batches of CULL_BATCH_SIZE, and the ranges
+    // of every batch are gathered in order afterwards.
+    // NOTE: Culling and LODs only see instance 0, so crowds draw everything
+    // at full detail.
+    meshlet_draw_range* draw_ranges;
+    u32 draw_range_count = 0;
+    {
+        if (model_switched)
+        {
+            for (u32 i = 0; i < drawables.drawable_count
+                            && i < drawable_lod_level_count;
+                 i += 1)
+            {
+                drawable_lod_levels[i] = 0;
             }
+        }
 
-            if (renderer_data->buffer_data[gb].elem_count
-                > renderer_data->buffer_data[gb].max_elem_count)
+        frustum_aabbs aabbs = {.count = drawables.drawable_count};
+        u32 padded_count = ((drawables.drawable_count + FRUSTUM_BATCH_SIZE - 1)
+                            / FRUSTUM_BATCH_SIZE)
+                           * FRUSTUM_BATCH_SIZE;
+        f32** components[] = {&aabbs.center_x,
+                              &aabbs.center_y,
+                              &aabbs.center_z,
+                              &aabbs.extent_x,
+                              &aabbs.extent_y,
+                              &aabbs.extent_z};
+        for (u32 i = 0; i < CAP(components); i += 1)
+        {
+            pg_scratch_alloc(transient_mem,
+                             padded_count * sizeof(f32),
+                             alignof(f32),
+                             components[i],
+                             err);
+        }
+        b8* visible;
+        pg_scratch_alloc(transient_mem,
+                         padded_count * sizeof(b8),
+                         alignof(b8),
+                         &visible,
+                         err);
+
+        u32 batch_count = (drawables.drawable_count + CULL_BATCH_SIZE - 1)
+                          / CULL_BATCH_SIZE;
+        cull_batch* batches;
+        pg_scratch_alloc(transient_mem,
+                         batch_count * sizeof(cull_batch),
+                         alignof(cull_batch),
+                         &batches,
+                         err);
+        for (u32 b = 0; b < batch_count; b += 1)
+        {
+            batches[b] = (cull_batch){0};
+        }
+
+        cull_job_data cull_data = {
+            .drawables = drawables.drawables,
+            .bs = &model_bounds[model_id],
+            .ms = &model_meshlets[model_id],
+            .ls = &model_lods[model_id],
+            .sc = &model_scenes[model_id],
+            .sh = &model_hierarchies[model_id],
+            .joint_transforms = joint_transforms,
+            .joint_count = model->joint_count,
+            .aabbs = &aabbs,
+            .visible = visible,
+            .world_from_model = world_from_model,
+            .clip_from_world = clip_from_world,
+            .camera_position = camera_position,
+            .world_from_model_scale = lod_matrix_scale(&world_from_model),
+            .projection_scale = frustum_matrix_get(&clip_from_view, 1, 1),
+            .render_height = render_res.height,
+            .lod_selection = lod_selection && instance_count == 1,
+            .meshlet_culling = meshlet_culling && instance_count == 1,
+            .batches = batches,
+            .err = err};
+        job_counter cull_counter = {0};
+        job_parallel_for(worker,
+                         &cull_boxes_job,
+                         &cull_data,
+                         drawables.drawable_count,
+                         CULL_BATCH_SIZE,
+                         &cull_counter);
+        job_wait(worker, &cull_counter);
+
+        // NOTE: Boxes are in model space, so the frustum is too.
+        frustum f = {0};
+        pg_f32_4x4 clip_from_model
+            = pg_f32_4x4_mul(clip_from_view, view_from_model);
+        frustum_from_matrix(&clip_from_model, &f);
+        u32 visible_count = drawables.drawable_count;
+        if (drawable_culling && instance_count == 1)
+        {
+            visible_count = frustum_test_aabbs(&f, &aabbs, visible);
+        }
+        else
+        {
+            for (u32 i = 0; i < drawables.drawable_count; i += 1)
             {
-                PG_ERROR_MAJOR(
-                    "renderer buffer element count exceeds max element count");
+                visible[i] = true;
             }
         }
+        app_state.drawable_stats = (bounds_cull_stats){
+            .drawable_count = drawables.drawable_count,
+            .culled_drawable_count = drawables.drawable_count - visible_count};
 
-        // Declare (required and optional) textures for upcoming frame.
+        job_parallel_for(worker,
+                         &cull_ranges_job,
+                         &cull_data,
+                         drawables.drawable_count,
+                         CULL_BATCH_SIZE,
+                         &cull_counter);
+        job_wait(worker, &cull_counter);
+
+        // Gather the ranges and counts of every batch.
+        for (u32 b = 0; b < batch_count; b += 1)
         {
-            pg_scratch_alloc(transient_mem,
-                             metadata->total_texture_count
-                                 * sizeof(pg_graphics_texture_data),
-                             alignof(pg_graphics_texture_data),
-                             &renderer_data->texture_data,
-                             err);
+            draw_range_count += batches[b].range_count;
+        }
+        pg_scratch_alloc(transient_mem,
+                         draw_range_count * sizeof(meshlet_draw_range),
+                         alignof(meshlet_draw_range),
+                         &draw_ranges,
+                         err);
 
-            // Consider textures for the current model required and textures
-            // for all other models in priority order (i.e. +/-1, +/-2, etc)
-            // optional.
-            u32 required_texture_count = 0;
-            u32 optional_texture_count = 0;
-            if (app_state.model_id != metadata->model_id_last_frame)
+        u32 range_offset = 0;
+        meshlet_cull_stats* ms = &app_state.meshlet_stats;
+        *ms = (meshlet_cull_stats){0};
+        app_state.lod_stats = (lod_select_stats){0};
+        for (u32 b = 0; b < batch_count; b += 1)
+        {
+            cull_batch* cb = &batches[b];
+            for (u32 i = 0; i < cb->range_count; i += 1)
             {
-                s32 offset = 0;
-                b8 positive = true;
-                for (u32 i = 0; i < assets->model_count; i += 1)
-                {
-                    s32 model_id = 0;
-                    if (i == 0)
-                    {
-                        model_id = (s32)app_state.model_id;
-                    }
-                    else if (positive)
-                    {
-                        model_id = ((s32)app_state.model_id + offset)
-                                   % (s32)assets->model_count;
-                    }
-                    else
-                    {
-                        model_id = ((s32)app_state.model_id - offset)
-                                   % (s32)assets->model_count;
-                        if (model_id < 0)
-                        {
-                            model_id += assets->model_count;
-                        }
-                    }
+                draw_ranges[range_offset + i] = cb->ranges[i];
+            }
+            range_offset += cb->range_count;
 
-                    pg_asset_model* m = &assets->models[model_id];
-                    for (u32 j = 0; j < m->material_count; j += 1)
-                    {
-                        for (u32 k = 0; k < m->materials[j].texture_count;
-                             k += 1)
-                        {
-                            renderer_data
-                                ->texture_data[required_texture_count
-                                               + optional_texture_count]
-                                = (pg_graphics_texture_data){
-                                    .id = (u32)pg_3d_to_1d_index(
-                                        m->materials[j].textures[k].type,
-                                        j,
-                                        model_id,
-                                        PG_TEXTURE_TYPE_COUNT,
-                                        metadata->max_material_count),
-                                    .texture = &(m->materials[j].textures[k])};
-
-                            if (i == 0)
-                            {
-                                required_texture_count += 1;
-                            }
-                            else
-                            {
-                                optional_texture_count += 1;
-                            }
-                        }
-                    }
+            app_state.scene_stats.cached_drawable_count
+                += cb->cached_drawable_count;
+            ms->meshlet_count += cb->meshlet_stats.meshlet_count;
+            ms->frustum_culled_count += cb->meshlet_stats.frustum_culled_count;
+            ms->cone_culled_count += cb->meshlet_stats.cone_culled_count;
+            ms->range_count += cb->meshlet_stats.range_count;
+            ms->triangle_count += cb->meshlet_stats.triangle_count;
+            ms->drawn_triangle_count += cb->meshlet_stats.drawn_triangle_count;
+            for (u32 l = 0; l <= LOD_MAX_LEVEL_COUNT; l += 1)
+            {
+                app_state.lod_stats.drawable_counts[l]
+                    += cb->lod_stats.drawable_counts[l];
+            }
+        }
+    }
+    FRAME_STAGE_END(FRAME_STAGE_CULL);
 
-                    if (i != 0)
-                    {
-                        positive = !positive;
-                    }
+    // Finish skinning.
+    {
+        // NOTE: Optimized indices and LODs reorder and drop triangles, but the
+        // .pga indices give the count for every drawable drawn whole.
+        if (model_switched)
+        {
+            shader_blend_count = 0;
+            for (u32 i = 0; model->joint_count && i < drawables.drawable_count;
+                 i += 1)
+            {
+                pg_graphics_drawable* d = &drawables.drawables[i];
+                shader_blend_count += skinning_count_shader_blends(
+                    &model->vertices[d->vertex_offset],
+                    &model->indices[d->index_offset],
+                    d->index_count);
+            }
+        }
+
+        job_wait(worker, &skin_counter);
+        app_state.skinning_stats
+            = (skinning_stats){.shader_blend_count = shader_blend_count};
+        for (u32 b = 0; b < skin_batch_count; b += 1)
+        {
+            app_state.skinning_stats.skinned_vertex_count
+                += skin_data.skinned_counts[b];
+        }
+#if defined(APP_BENCHMARK)
+        benchmark.skin_vertices = model->vertices;
+        benchmark.skin_vertex_count = model->vertex_count;
+        benchmark.skin_joint_transforms = joint_transforms;
+        benchmark.skin_joint_count = model->joint_count;
+#endif
+    }
+    FRAME_STAGE_END(FRAME_STAGE_SKIN);
+
+    // Update renderer data.
+    {
+        // Update buffers.
+        // NOTE: Geometry and materials are resident in the arena, except in
+        // paged mode, where they are bound again when the model changes.
+#if defined(APP_PAGED_ASSETS)
+        b8 bind_geometry = model_switched;
+#else
+        b8 bind_geometry = false;
+#endif
+        for (graphics_buffer gb = 0; gb < GRAPHICS_BUFFER_COUNT; gb += 1)
+        {
+            if (gb == GRAPHICS_BUFFER_PER_FRAME_CB)
+            {
+                per_frame_cb* per_frame;
+                pg_scratch_alloc(transient_mem,
+                                 sizeof(per_frame_cb),
+                                 alignof(per_frame_cb),
+                                 &per_frame,
+                                 err);
+                *per_frame = (per_frame_cb){
+                    .clip_from_world = clip_from_world,
+                    .camera_pos = camera_position,
+                    .pre_skinned = pre_skinned,
+                    .skinned_vertex_base
+                    = geometry.vertex_bases[model_id]};
 
-                    if (positive)
+                renderer_data->buffer_data[gb].elem_count = 1;
+                renderer_data->buffer_data[gb].buffer = per_frame;
+            }
+            else if (gb == GRAPHICS_BUFFER_VERTICES_SB)
+            {
+                if (bind_geometry)
+                {
+                    renderer_data->buffer_data[gb].elem_count
+                        = model->vertex_count;
+#if defined(APP_COMPACT_VERTICES)
+                    renderer_data->buffer_data[gb].buffer
+                        = model_compact_vertices[model_id].vertices;
+#else
+                    renderer_data->buffer_data[gb].buffer = model->vertices;
+#endif
+                }
+            }
+            else if (gb == GRAPHICS_BUFFER_INDICES_SB)
+            {
+                if (bind_geometry)
+                {
+                    PG_GRAPHICS_INDEX_TYPE* indices
+                        = model_ext_indices[model_id];
+                    renderer_data->buffer_data[gb].elem_count
+                        = indices ? model_ext_index_counts[model_id]
+                                  : model->index_count;
+                    renderer_data->buffer_data[gb].buffer
+                        = indices ? indices : model->indices;
+                }
+            }
+            else if (gb == GRAPHICS_BUFFER_JOINT_TRANSFORMS_SB)
+            {
+                if (crowd_joint_stride)
+                {
+                    renderer_data->buffer_data[gb].elem_count
+                        = instance_count * crowd_joint_stride;
+                    renderer_data->buffer_data[gb].buffer
+                        = sb->crowd_joint_transforms;
+                }
+                else
+                {
+                    renderer_data->buffer_data[gb].elem_count
+                        = model->joint_count;
+                    renderer_data->buffer_data[gb].buffer = joint_transforms;
+                }
+            }
+            else if (gb == GRAPHICS_BUFFER_MATERIAL_PROPERTIES_SB)
+            {
+                if (bind_geometry)
+                {
+                    pg_asset_material_properties* material_properties
+                        = geometry.material_properties;
+                    for (u32 i = 0; i < model->material_count; i += 1)
                     {
-                        offset += 1;
+                        material_properties[i]
+                            = model->materials[i].properties;
                     }
+
+                    renderer_data->buffer_data[gb].elem_count
+                        = model->material_count;
+                    renderer_data->buffer_data[gb].buffer
+                        = material_properties;
+                }
+            }
+#if defined(APP_COMPACT_VERTICES)
+            else if (gb == GRAPHICS_BUFFER_VERTEX_COLORS_SB)
+            {
+                // NOTE: Models without a stream bind an empty buffer.
+                if (bind_geometry)
+                {
+                    compact_vertices* cvs
+                        = &model_compact_vertices[model_id];
+                    renderer_data->buffer_data[gb].elem_count
+                        = cvs->colors ? cvs->vertex_count : 0;
+                    renderer_data->buffer_data[gb].buffer = cvs->colors;
+                }
+            }
+            else if (gb == GRAPHICS_BUFFER_VERTEX_SKINS_SB)
+            {
+                if (bind_geometry)
+                {
+                    compact_vertices* cvs
+                        = &model_compact_vertices[model_id];
+                    renderer_data->buffer_data[gb].elem_count
+                        = cvs->skins ? cvs->vertex_count : 0;
+                    renderer_data->buffer_data[gb].buffer = cvs->skins;
                 }
             }
+#endif
+            else if (gb == GRAPHICS_BUFFER_SKINNED_VERTICES_SB)
+            {
+                renderer_data->buffer_data[gb].elem_count
+                    = pre_skinned ? model->vertex_count : 0;
+                renderer_data->buffer_data[gb].buffer = sb->skinned_vertices;
+            }
+            else if (gb == GRAPHICS_BUFFER_INSTANCES_SB)
+            {
+                renderer_data->buffer_data[gb].elem_count = instance_count;
+                renderer_data->buffer_data[gb].buffer = sb->crowd_instances;
+            }
+
+            if (renderer_data->buffer_data[gb].elem_count
+                > renderer_data->buffer_data[gb].max_elem_count)
+            {
+                PG_ERROR_MAJOR(
+                    "renderer buffer element count exceeds max element count");
+            }
+        }
+        FRAME_STAGE_END(FRAME_STAGE_BUFFERS);
+
+        // Declare (required and optional) textures for upcoming frame.
+        // NOTE: Unless assets are paged, the declarations are a view of
+        // `texture_decls` (see texture_declarations). Frames that declare no
+        // textures neither allocate nor visit any.
+        {
+            u32 required_texture_count = 0;
+            u32 optional_texture_count = 0;
+#if defined(APP_PAGED_ASSETS)
+            // NOTE: In paged mode, textures are also redeclared when a page
+            // is prefetched so that its textures become optional.
+            if (model_switched || pager.loaded_this_frame)
+            {
+                order_texture_declarations(model_id,
+                                           model_count,
+                                           metadata->max_material_count,
+                                           texture_decls.declarations,
+                                           &required_texture_count,
+                                           &optional_texture_count,
+                                           err);
+            }
+#else
+            if (model_switched)
+            {
+                texture_decls.declarations
+                    = &texture_decls.table[texture_decls.offsets[model_id]];
+                required_texture_count = texture_decls.counts[model_id];
+                optional_texture_count
+                    = metadata->total_texture_count - required_texture_count;
+            }
+#endif
 
+            renderer_data->texture_data = texture_decls.declarations;
             renderer_data->required_texture_count = required_texture_count;
             renderer_data->optional_texture_count = optional_texture_count;
         }
+        FRAME_STAGE_END(FRAME_STAGE_TEXTURES);
 
         // Set draw data.
+        // NOTE: Opaque draws are sorted by texture set and mesh, and draws
+        // that can be drawn together are merged, before their constants are
+        // set in one block.
         {
+            meshlet_draw_range* draws;
+            pg_scratch_alloc(transient_mem,
+                             draw_range_count * sizeof(meshlet_draw_range),
+                             alignof(meshlet_draw_range),
+                             &draws,
+                             err);
+            u32 draw_count = draw_list_build(draw_ranges,
+                                             draw_range_count,
+                                             drawables.drawables,
+                                             drawables.opaque_drawable_count,
+                                             transient_mem,
+                                             draws,
+                                             &app_state.draw_list_stats,
+                                             err);
+
             pg_scratch_alloc(transient_mem,
-                             drawables.drawable_count
-                                 * sizeof(pg_graphics_draw_data),
+                             draw_count * sizeof(pg_graphics_draw_data),
                              alignof(pg_graphics_draw_data),
                              &renderer_data->draw_data,
                              err);
+            constants_cb* constants;
+            pg_scratch_alloc(transient_mem,
+                             draw_count * sizeof(constants_cb),
+                             alignof(constants_cb),
+                             &constants,
+                             err);
 
-            for (u32 i = 0; i < drawables.drawable_count; i += 1)
+            draw_data_job_data draw_data = {
+                .draw_ranges = draws,
+                .drawables = drawables.drawables,
+                .opaque_drawable_count = drawables.opaque_drawable_count,
+                .max_material_count = metadata->max_material_count,
+                .instance_count = instance_count,
+                .vertex_base = geometry.vertex_bases[model_id],
+                .index_base = geometry.index_bases[model_id],
+                .material_base = geometry.material_bases[model_id],
+                .constants = constants,
+                .draw_data = renderer_data->draw_data,
+                .err = err};
+            job_counter draw_data_counter = {0};
+            job_parallel_for(worker,
+                             &draw_data_job,
+                             &draw_data,
+                             draw_count,
+                             DRAW_DATA_BATCH_SIZE,
+                             &draw_data_counter);
+            job_wait(worker, &draw_data_counter);
+
+            renderer_data->wireframe = wireframe_mode;
+            renderer_data->draw_count = draw_count;
+        }
+        FRAME_STAGE_END(FRAME_STAGE_DRAW_DATA);
+    }
+
+    // NOTE: Every job of the frame has finished, so the workers' memory can be
+    // reused.
+    job_system_end_frame(&jobs, &app_state.job_stats);
+
+    metadata->model_id_last_frame = model_id;
+}
+
+#if defined(APP_PIPELINED_FRAMES)
+FUNCTION b8
+app_state_field_equal(application_state* a,
+                      application_state* b,
+                      app_state_field* field)
+{
+    u8* a_bytes = (u8*)a + field->offset;
+    u8* b_bytes = (u8*)b + field->offset;
+    for (usize i = 0; i < field->size; i += 1)
+    {
+        if (a_bytes[i] != b_bytes[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+FUNCTION void
+app_state_field_copy(application_state* src,
+                     application_state* dst,
+                     app_state_field* field,
+                     pg_error* err)
+{
+    pg_copy((u8*)src + field->offset,
+            field->size,
+            (u8*)dst + field->offset,
+            field->size,
+            err);
+}
+
+// Starts handing what the render thread changes over to the update thread,
+// from the render thread's input queue `iq`.
+// NOTE: Must be called before the update thread starts, which reads the
+// metrics of the last frame rendered from its own copy.
+FUNCTION void
+app_state_delta_init(pg_input_queue* iq, pg_f32_2x render_res)
+{
+    app_delta = (app_state_delta){.render_res = render_res,
+                                  .metrics = *app_state.metrics};
+
+    update_input_queue
+        = (pg_input_queue){.events = update_input_events,
+                           .event_count = CAP(update_input_events)};
+    for (u32 et = 0; et < PG_INPUT_EVENT_TYPE_COUNT; et += 1)
+    {
+        update_input_queue.duration_held[et] = iq->duration_held[et];
+        posted_held_durations[et] = iq->duration_held[et];
+    }
+    update_metrics = *app_state.metrics;
+    update_render_res = render_res;
+    update_edit_count = 0;
+    app_state.metrics = &update_metrics;
+
+    ui_state = app_state;
+    ui_edits = (app_state_edits){0};
+    ui_edit_count = 0;
+}
+
+// Posts the input that the render thread read since the last post, and the
+// render resolution.
+FUNCTION void
+app_state_post_input(pg_input_queue* iq, pg_f32_2x render_res)
+{
+    frame_pipeline_lock(&pipeline);
+    for (; iq->read_idx != iq->write_idx;
+         iq->read_idx = (iq->read_idx + 1) % iq->event_count)
+    {
+        // NOTE: As in the input queue, the oldest event is dropped when there
+        // is no room for another.
+        if (app_delta.event_count == CAP(app_delta.events))
+        {
+            for (u32 i = 1; i < app_delta.event_count; i += 1)
             {
-                pg_graphics_drawable* d = &drawables.drawables[i];
-                constants_cb* constants;
-                pg_scratch_alloc(transient_mem,
-                                 sizeof(constants_cb),
-                                 alignof(constants_cb),
-                                 &constants,
-                                 err);
-                *constants
-                    = (constants_cb){.vertex_offset = d->vertex_offset,
-                                     .index_offset = d->index_offset,
-                                     .material_id = d->material_id,
-                                     .texture_id = (u32)pg_3d_to_1d_index(
-                                         0,
-                                         d->material_id,
-                                         d->art_id,
-                                         PG_TEXTURE_TYPE_COUNT,
-                                         metadata->max_material_count),
-                                     .global_transform = d->global_transform};
-
-                renderer_data->draw_data[i] = (pg_graphics_draw_data){
-                    .opaque
-                    = i < drawables.opaque_drawable_count ? true : false,
-                    .vertex_count = d->index_count,
-                    .instance_count = 1,
-                    .start_texture_id = constants->texture_id,
-                    .texture_count = PG_TEXTURE_TYPE_COUNT,
-                    .constants = constants};
+                app_delta.events[i - 1] = app_delta.events[i];
+            }
+            app_delta.event_count -= 1;
+        }
+        app_delta.events[app_delta.event_count] = iq->events[iq->read_idx];
+        app_delta.event_count += 1;
+    }
+
+    // NOTE: Held durations only grow until their input is released, so the
+    // update thread is handed what they grew by, and can keep subtracting
+    // repeats from its own.
+    for (u32 et = 0; et < PG_INPUT_EVENT_TYPE_COUNT; et += 1)
+    {
+        f32 duration = iq->duration_held[et];
+        if (duration < posted_held_durations[et])
+        {
+            app_delta.released[et] = true;
+            app_delta.held_durations[et] = duration;
+        }
+        else
+        {
+            app_delta.held_durations[et]
+                += duration - posted_held_durations[et];
+        }
+        posted_held_durations[et] = duration;
+    }
+    app_delta.render_res = render_res;
+    frame_pipeline_unlock(&pipeline);
+}
+
+// Posts the fields of `ui_state` that the UI edited, the metrics of the frame
+// just rendered, and whether graphics were reloaded.
+FUNCTION void
+app_state_post_edits(pg_graphics_metrics* metrics,
+                     b8 graphics_reloaded,
+                     pg_error* err)
+{
+    b8 edited = false;
+    for (u32 i = 0; i < CAP(app_state_ui_fields); i += 1)
+    {
+        app_state_field* field = &app_state_ui_fields[i];
+        if (!app_state_field_equal(&ui_state, &ui_state_last, field))
+        {
+            if (!edited)
+            {
+                ui_edit_count += 1;
+                edited = true;
             }
+            app_state_field_copy(&ui_state, &ui_edits.values, field, err);
+            ui_edits.edit_ids[i] = ui_edit_count;
+        }
+    }
+
+    frame_pipeline_lock(&pipeline);
+    for (u32 i = 0; edited && i < CAP(app_state_ui_fields); i += 1)
+    {
+        if (ui_edits.edit_ids[i] == ui_edit_count)
+        {
+            app_state_field_copy(&ui_edits.values,
+                                 &app_delta.edits.values,
+                                 &app_state_ui_fields[i],
+                                 err);
+            app_delta.edits.edit_ids[i] = ui_edit_count;
+        }
+    }
+    app_delta.edit_count = ui_edit_count;
+    app_delta.metrics = *metrics;
+    app_delta.graphics_reloaded
+        = app_delta.graphics_reloaded || graphics_reloaded;
+    frame_pipeline_unlock(&pipeline);
+}
+
+// Takes what the render thread posted since the last frame, on the update
+// thread.
+FUNCTION void
+app_state_take_delta(models_metadata* metadata, pg_error* err)
+{
+    u32 model_id = app_state.model_id;
+
+    frame_pipeline_lock(&pipeline);
+    for (u32 i = 0; i < CAP(app_state_ui_fields); i += 1)
+    {
+        if (app_delta.edits.edit_ids[i])
+        {
+            app_state_field_copy(&app_delta.edits.values,
+                                 &app_state,
+                                 &app_state_ui_fields[i],
+                                 err);
+            app_delta.edits.edit_ids[i] = 0;
+        }
+    }
+    update_edit_count = app_delta.edit_count;
+
+    pg_input_queue* iq = &update_input_queue;
+    for (u32 i = 0; i < app_delta.event_count; i += 1)
+    {
+        iq->events[iq->write_idx] = app_delta.events[i];
+        iq->write_idx = (iq->write_idx + 1) % iq->event_count;
+        if (iq->write_idx == iq->read_idx)
+        {
+            iq->read_idx = (iq->read_idx + 1) % iq->event_count;
+        }
+    }
+    app_delta.event_count = 0;
+    for (u32 et = 0; et < PG_INPUT_EVENT_TYPE_COUNT; et += 1)
+    {
+        if (app_delta.released[et])
+        {
+            iq->duration_held[et] = 0.0f;
+        }
+        iq->duration_held[et] += app_delta.held_durations[et];
+        app_delta.held_durations[et] = 0.0f;
+        app_delta.released[et] = false;
+    }
+
+    update_render_res = app_delta.render_res;
+    update_metrics = app_delta.metrics;
+    if (app_delta.graphics_reloaded)
+    {
+        // NOTE: Reloaded graphics need geometry bound and textures declared
+        // again, as on a model switch.
+        metadata->model_id_last_frame = 0;
+        app_delta.graphics_reloaded = false;
+    }
+    frame_pipeline_unlock(&pipeline);
+
+    // NOTE: Switching models in the UI resets the view, as when frames are
+    // not pipelined.
+    if (app_state.model_id != model_id)
+    {
+        reset_view();
+    }
+}
 
-            renderer_data->wireframe = app_state.wireframe_mode;
-            renderer_data->draw_count = drawables.drawable_count;
+// Hands the UI the state that the snapshot was updated with, and on top of it
+// the edits posted after the snapshot was updated.
+FUNCTION void
+app_state_take_snapshot_state(u32 snapshot_id, pg_error* err)
+{
+    ui_state = snapshot_states[snapshot_id];
+    for (u32 i = 0; i < CAP(app_state_ui_fields); i += 1)
+    {
+        if (ui_edits.edit_ids[i] > snapshot_edit_counts[snapshot_id])
+        {
+            app_state_field_copy(&ui_edits.values,
+                                 &ui_state,
+                                 &app_state_ui_fields[i],
+                                 err);
         }
     }
+    ui_state_last = ui_state;
+}
+
+typedef struct
+{
+    pg_assets* assets;
+    models_metadata* metadata;
+} frame_update_data;
+
+// Updates a frame into a snapshot, on the pipeline's update thread.
+FUNCTION void
+update_frame(frame_snapshot* snapshot, void* data, pg_error* err)
+{
+    frame_update_data* fud = data;
+    app_state_take_delta(fud->metadata, err);
+    update_app(fud->assets,
+               &update_input_queue,
+               fud->metadata,
+               update_render_res,
+               &snapshot->transient_mem,
+               &snapshot->renderer_data,
+               snapshot->id,
+               err);
+    snapshot_states[snapshot->id] = app_state;
+    snapshot_edit_counts[snapshot->id] = update_edit_count;
+}
+
+// NOTE: The UI edits the render thread's copy of the app's state, which is
+// posted once the frame has been rendered.
+FUNCTION void
+imgui_ui_pipelined(void)
+{
+    imgui_state_ui(&ui_state);
 }
+#endif
 
 #if defined(WINDOWS)
 s32 WINAPI
@@ -946,7 +3594,7 @@ wWinMain(HINSTANCE inst, HINSTANCE prev_inst, WCHAR* cmd_args, s32 show_code)
                            inst,
                            config.fixed_aspect_ratio_width,
                            config.fixed_aspect_ratio_height,
-                           &app_state.fullscreen,
+                           &gfx_state.fullscreen,
                            err);
     pg_windows_init_memory(&windows,
                            config.permanent_mem_size,
@@ -964,12 +3612,31 @@ wWinMain(HINSTANCE inst, HINSTANCE prev_inst, WCHAR* cmd_args, s32 show_code)
     pg_windows_init_graphics(&windows,
                              config.min_gpu_mem_size,
                              windows.gfx.renderer_data,
-                             app_state.vsync,
-                             &app_state.gfx_api,
-                             &app_state.supported_gfx_apis,
+                             gfx_state.vsync,
+                             &gfx_state.gfx_api,
+                             &gfx_state.supported_gfx_apis,
                              err);
     pg_windows_init_metrics(&windows.metrics, err);
-    app_state.metrics = &windows.metrics.gfx_metrics;
+    gfx_state.metrics = &windows.metrics.gfx_metrics;
+    app_state.metrics = gfx_state.metrics;
+
+#if defined(APP_PIPELINED_FRAMES)
+    // NOTE: Frames are updated on the pipeline's update thread, and this
+    // thread renders them. The window, input, the UI and metrics stay on this
+    // thread, which posts what they change to the update thread (see
+    // `app_delta`). If the update thread fails to start, frames are updated
+    // here.
+    app_state_delta_init(&windows.input_queue, windows.window.render_res);
+    frame_update_data update_data = {.assets = assets, .metadata = &metadata};
+    if (!frame_pipeline_start(&pipeline,
+                              &windows.gfx.renderer_data,
+                              &update_frame,
+                              &update_data,
+                              err))
+    {
+        app_state.metrics = gfx_state.metrics;
+    }
+#endif
 
     while (windows.msg.message != WM_QUIT)
     {
@@ -980,53 +3647,1184 @@ wWinMain(HINSTANCE inst, HINSTANCE prev_inst, WCHAR* cmd_args, s32 show_code)
             continue;
         }
 
-        pg_graphics_api gfx_api = app_state.gfx_api;
+        pg_graphics_api gfx_api = gfx_state.gfx_api;
 
         pg_windows_update_input(&windows,
                                 config.gamepad_deadzone,
                                 config.gamepad_count,
                                 err);
 
-        update_app(assets,
-                   &windows.input_queue,
-                   &metadata,
-                   windows.window.render_res,
-                   &windows.transient_mem,
-                   &windows.gfx.renderer_data,
-                   err);
-        metadata.model_id_last_frame = app_state.model_id;
+        pg_graphics_renderer_data* renderer_data = &windows.gfx.renderer_data;
+        void (*ui)(void) = &imgui_ui;
+        b8 pipelined = false;
+#if defined(APP_PIPELINED_FRAMES)
+        pipelined = pipeline.running;
+        if (pipelined)
+        {
+            app_state_post_input(&windows.input_queue,
+                                 windows.window.render_res);
+            frame_snapshot* snapshot = frame_pipeline_take(&pipeline);
+            app_state_take_snapshot_state(snapshot->id, err);
+            renderer_data = &snapshot->renderer_data;
+            ui = &imgui_ui_pipelined;
+        }
+        else
+#endif
+        {
+            update_app(assets,
+                       &windows.input_queue,
+                       &metadata,
+                       windows.window.render_res,
+                       &windows.transient_mem,
+                       renderer_data,
+                       0,
+                       err);
+        }
 
         pg_windows_update_graphics(&windows,
-                                   app_state.gfx_api,
-                                   windows.gfx.renderer_data,
-                                   app_state.fullscreen,
-                                   app_state.vsync,
-                                   &imgui_ui,
+                                   gfx_state.gfx_api,
+                                   *renderer_data,
+                                   gfx_state.fullscreen,
+                                   gfx_state.vsync,
+                                   ui,
                                    err);
 
         pg_windows_update_metrics(&windows.metrics, err);
-
-        if (app_state.gfx_api != gfx_api)
+        b8 reload_graphics = gfx_state.gfx_api != gfx_api;
+#if defined(APP_PIPELINED_FRAMES)
+        if (pipelined)
+        {
+            app_state_post_edits(&windows.metrics.gfx_metrics,
+                                 reload_graphics,
+                                 err);
+        }
+#endif
+        if (reload_graphics && !pipelined)
         {
             metadata.model_id_last_frame = 0;
+        }
+
+        if (reload_graphics)
+        {
             pg_windows_reload_graphics(&windows,
                                        inst,
                                        config.min_gpu_mem_size,
-                                       windows.gfx.renderer_data,
+                                       *renderer_data,
                                        config.fixed_aspect_ratio_width,
                                        config.fixed_aspect_ratio_height,
-                                       &app_state.fullscreen,
-                                       app_state.vsync,
-                                       &app_state.gfx_api,
-                                       &app_state.supported_gfx_apis,
+                                       &gfx_state.fullscreen,
+                                       gfx_state.vsync,
+                                       &gfx_state.gfx_api,
+                                       &gfx_state.supported_gfx_apis,
                                        err);
         }
 
+#if defined(APP_PIPELINED_FRAMES)
+        if (pipelined)
+        {
+            frame_pipeline_release(&pipeline);
+            continue;
+        }
+#endif
         pg_scratch_free(&windows.transient_mem);
     }
 
+#if defined(APP_PIPELINED_FRAMES)
+    frame_pipeline_stop(&pipeline, &windows.gfx.renderer_data, err);
+    app_state.metrics = gfx_state.metrics;
+#endif
+#if defined(APP_PAGED_ASSETS)
+    asset_loader_release(&loader);
+#endif
+    job_system_release(&jobs);
     pg_windows_release(&windows);
 
     return 0;
 }
 #endif
+
+#if defined(LINUX)
+// NOTE: The stub renderer stands in for the GPU backends. It reads everything
+// the renderer would read from `pg_graphics_renderer_data` so that the frame
+// build cannot be optimized away and its counts are validated.
+FUNCTION u64
+stub_renderer_submit(pg_graphics_renderer_data* renderer_data, pg_error* err)
+{
+    u64 checksum = 0;
+
+    for (u32 i = 0; i < renderer_data->buffer_count; i += 1)
+    {
+        pg_graphics_buffer_data* bd = &renderer_data->buffer_data[i];
+        if (bd->elem_count > bd->max_elem_count)
+        {
+            PG_ERROR_MAJOR("stub renderer buffer exceeds max element count");
+        }
+
+        u8* bytes = (u8*)bd->buffer;
+        usize size = bd->elem_count * bd->elem_size;
+        for (usize j = 0; bytes && j < size; j += 64)
+        {
+            checksum += bytes[j];
+        }
+    }
+
+    u32 texture_count = renderer_data->required_texture_count
+                        + renderer_data->optional_texture_count;
+    for (u32 i = 0; i < texture_count; i += 1)
+    {
+        pg_graphics_texture_data* td = &renderer_data->texture_data[i];
+        if (td->id >= renderer_data->max_texture_count)
+        {
+            PG_ERROR_MAJOR("stub renderer texture id exceeds max texture count");
+        }
+        checksum += td->id;
+    }
+
+    for (u32 i = 0; i < renderer_data->draw_count; i += 1)
+    {
+        pg_graphics_draw_data* dd = &renderer_data->draw_data[i];
+        u32* constants = (u32*)dd->constants;
+        for (u32 j = 0; j < renderer_data->constant_count; j += 1)
+        {
+            checksum += constants[j];
+        }
+        checksum += dd->vertex_count * dd->instance_count;
+    }
+
+    return checksum;
+}
+
+FUNCTION void
+benchmark_sort(f64* samples, u32 sample_count)
+{
+    // Shellsort (Ciura gap sequence)
+    u32 gaps[] = {701, 301, 132, 57, 23, 10, 4, 1};
+    for (u32 g = 0; g < CAP(gaps); g += 1)
+    {
+        u32 gap = gaps[g];
+        for (u32 i = gap; i < sample_count; i += 1)
+        {
+            f64 sample = samples[i];
+            u32 j = i;
+            for (; j >= gap && samples[j - gap] > sample; j -= gap)
+            {
+                samples[j] = samples[j - gap];
+            }
+            samples[j] = sample;
+        }
+    }
+}
+
+// NOTE: Samples must be sorted. Uses the nearest-rank method.
+FUNCTION f64
+benchmark_percentile(f64* samples, u32 sample_count, f64 percentile)
+{
+    u32 rank = (u32)((percentile / 100.0) * (f64)sample_count + 0.5);
+    rank = rank < 1 ? 1 : (rank > sample_count ? sample_count : rank);
+    return samples[rank - 1];
+}
+
+typedef struct
+{
+    f64 vertices_per_second;
+    f32 max_error;
+} benchmark_skinning_result;
+
+// Skins the vertices of the last Skin stage with every supported kernel,
+// checks each against the scalar reference and times it. Returns whether every
+// kernel is within SKINNING_MAX_ERROR.
+// NOTE: Results of unsupported kernels (and of every kernel for models without
+// joints) are left zeroed.
+FUNCTION b8
+benchmark_skinning(benchmark_skinning_result* results,
+                   pg_scratch_allocator* mem,
+                   pg_error* err)
+{
+    if (!benchmark.skin_joint_count)
+    {
+        return true;
+    }
+
+    pg_vertex* vertices = benchmark.skin_vertices;
+    u32 vertex_count = benchmark.skin_vertex_count;
+    skinned_vertex* reference;
+    skinned_vertex* result;
+    pg_scratch_alloc(mem,
+                     vertex_count * sizeof(skinned_vertex),
+                     alignof(skinned_vertex),
+                     &reference,
+                     err);
+    pg_scratch_alloc(mem,
+                     vertex_count * sizeof(skinned_vertex),
+                     alignof(skinned_vertex),
+                     &result,
+                     err);
+    skinning_skin_vertices(SKINNING_KERNEL_SCALAR,
+                           vertices,
+                           vertex_count,
+                           benchmark.skin_joint_transforms,
+                           benchmark.skin_joint_count,
+                           reference);
+
+    b8 passed = true;
+    for (skinning_kernel k = 0; k < SKINNING_KERNEL_COUNT; k += 1)
+    {
+        if (!skinning_kernels_supported[k])
+        {
+            continue;
+        }
+
+        u32 skinned_count = 0;
+        f64 start = benchmark_get_time();
+        for (u32 i = 0; i < BENCHMARK_SKINNING_ITERATION_COUNT; i += 1)
+        {
+            skinned_count
+                = skinning_skin_vertices(k,
+                                         vertices,
+                                         vertex_count,
+                                         benchmark.skin_joint_transforms,
+                                         benchmark.skin_joint_count,
+                                         result);
+        }
+        f64 time = benchmark_get_time() - start;
+
+        f64 total_count
+            = (f64)skinned_count * BENCHMARK_SKINNING_ITERATION_COUNT;
+        results[k].vertices_per_second
+            = time > 0.0 ? total_count / (time / 1000.0) : 0.0;
+        results[k].max_error
+            = skinning_max_error(vertices, vertex_count, result, reference);
+        passed = passed && results[k].max_error <= SKINNING_MAX_ERROR;
+    }
+
+    return passed;
+}
+
+typedef struct
+{
+    f64 clip_time;    // us per call
+    f64 no_clip_time; // us per call
+    f32 max_joint_error;
+} benchmark_library_result;
+
+// Times asking the asset library for the drawables of the last Drawables stage
+// with its clip (as when the asset library animates the model) and with no clip
+// (as when the viewer has sampled it), and records the largest difference
+// between the asset library's joint transforms and the viewer's sampled ones.
+// Models the viewer did not sample are left zeroed.
+FUNCTION void
+benchmark_library(benchmark_library_result* result,
+                  pg_scratch_allocator* mem,
+                  pg_error* err)
+{
+    if (!benchmark.sampled_joint_transforms)
+    {
+        return;
+    }
+
+    u32 model_ids[] = {benchmark.drawable_model_id};
+    pg_animation animations[2][1] = {{benchmark.drawable_animation},
+                                     {{.id = ANIMATION_NO_CLIP}}};
+    f64* times[] = {&result->clip_time, &result->no_clip_time};
+    for (u32 a = 0; a < CAP(animations); a += 1)
+    {
+        f64 start = benchmark_get_time();
+        for (u32 i = 0; i < BENCHMARK_LIBRARY_ITERATION_COUNT; i += 1)
+        {
+            // NOTE: Each call's drawables are freed before the next.
+            pg_scratch_allocator call_mem = *mem;
+            pg_f32_4x4* joint_transforms = 0;
+            pg_graphics_drawables drawables = {0};
+            pg_assets_get_3d_drawables(benchmark.drawable_assets,
+                                       model_ids,
+                                       animations[a],
+                                       CAP(model_ids),
+                                       &benchmark.drawable_view_from_model,
+                                       &call_mem,
+                                       &joint_transforms,
+                                       &drawables,
+                                       err);
+            if (a == 0 && i == 0 && joint_transforms)
+            {
+                result->max_joint_error = animation_max_joint_error(
+                    benchmark.sampled_joint_transforms,
+                    joint_transforms,
+                    benchmark.sampled_joint_count);
+            }
+        }
+        f64 time = benchmark_get_time() - start;
+
+        *times[a] = (time * 1000.0) / BENCHMARK_LIBRARY_ITERATION_COUNT;
+    }
+}
+
+// NOTE: Layer counts timed by `benchmark_animation`: the base clip, plus a clip
+// fading out, plus an additive clip and its reference.
+GLOBAL u32 benchmark_animation_layer_counts[] = {1, 2, 4};
+
+typedef struct
+{
+    u32 joint_count;
+    f64 times[CAP(benchmark_animation_layer_counts)]; // us per evaluation
+} benchmark_animation_result;
+
+// Times evaluating the current model's animation layers (sampling, blending
+// and building the joint transforms) with 1, 2 and 4 layers, stepping time
+// by 1/60 seconds per evaluation. Models without clips are left zeroed.
+FUNCTION void
+benchmark_animation(benchmark_animation_result* result,
+                    pg_scratch_allocator* mem,
+                    pg_error* err)
+{
+    animations* as = &model_animations[app_state.model_id];
+    if (!as->clip_count)
+    {
+        return;
+    }
+
+    animation_cursors cursors[ANIMATION_LAYER_COUNT];
+    for (u32 l = 0; l < ANIMATION_LAYER_COUNT; l += 1)
+    {
+        cursors[l] = (animation_cursors){.clip_id = ANIMATION_NO_CLIP};
+        pg_scratch_alloc(mem,
+                         as->max_clip_channel_count * sizeof(u32),
+                         alignof(u32),
+                         &cursors[l].keys,
+                         err);
+    }
+    pg_f32_4x4* joint_transforms;
+    pg_scratch_alloc(mem,
+                     as->joint_count * sizeof(pg_f32_4x4),
+                     alignof(pg_f32_4x4),
+                     &joint_transforms,
+                     err);
+
+    result->joint_count = as->joint_count;
+    for (u32 c = 0; c < CAP(benchmark_animation_layer_counts); c += 1)
+    {
+        u32 layer_count = benchmark_animation_layer_counts[c];
+        u32 other_clip_id = (as->clip_count > 1) ? 1 : 0;
+        animation_layers layers = {.fade_weight = 0.5f,
+                                   .additive_weight = 0.5f};
+        for (u32 l = 0; l < ANIMATION_LAYER_COUNT; l += 1)
+        {
+            layers.clip_ids[l] = l < layer_count
+                                     ? (l == ANIMATION_LAYER_BASE
+                                            ? 0
+                                            : other_clip_id)
+                                     : ANIMATION_NO_CLIP;
+        }
+
+        animation_sample_stats stats = {0};
+        f64 start = benchmark_get_time();
+        for (u32 i = 0; i < BENCHMARK_ANIMATION_ITERATION_COUNT; i += 1)
+        {
+            f32 time = (f32)i * (1.0f / 60.0f);
+            for (u32 l = 0; l < ANIMATION_LAYER_REFERENCE; l += 1)
+            {
+                if (layers.clip_ids[l] >= as->clip_count)
+                {
+                    continue;
+                }
+                f32 duration = as->clips[layers.clip_ids[l]].duration;
+                s32 loop_count = duration > 0.0f ? (s32)(time / duration) : 0;
+                layers.times[l] = time - (f32)loop_count * duration;
+            }
+            animation_evaluate(as,
+                               &layers,
+                               cursors,
+                               &keyframe_sampler,
+                               &pose_pool,
+                               node_globals,
+                               joint_transforms,
+                               &stats);
+        }
+        f64 time = benchmark_get_time() - start;
+
+        result->times[c]
+            = (time * 1000.0) / BENCHMARK_ANIMATION_ITERATION_COUNT;
+    }
+}
+
+typedef struct
+{
+    f64 animate_time;   // p50, ms
+    f64 draw_data_time; // p50, ms
+    f64 frame_time;     // p50, ms
+    u32 draw_count;
+    u32 joint_transform_count; // Uploaded per frame
+} benchmark_crowd_result;
+
+// Times BENCHMARK_CROWD_FRAME_COUNT frames of the current model with each
+// crowd size, after one frame to lay the crowd out. The crowd size is
+// restored afterwards.
+FUNCTION u64
+benchmark_crowd(benchmark_crowd_result* results,
+                pg_assets* assets,
+                pg_input_queue* iq,
+                models_metadata* metadata,
+                pg_scratch_allocator* transient_mem,
+                pg_graphics_renderer_data* renderer_data,
+                pg_error* err)
+{
+    u64 checksum = 0;
+    u32 instance_count = app_state.instance_count;
+    for (u32 c = 0; c < CAP(crowd_instance_counts); c += 1)
+    {
+        app_state.instance_count = crowd_instance_counts[c];
+
+        f64 samples[3][BENCHMARK_CROWD_FRAME_COUNT];
+        for (u32 i = 0; i < BENCHMARK_CROWD_FRAME_COUNT + 1; i += 1)
+        {
+            f64 frame_start = benchmark_get_time();
+            update_app(assets,
+                       iq,
+                       metadata,
+                       (pg_f32_2x){.width = 1920.0f, .height = 1080.0f},
+                       transient_mem,
+                       renderer_data,
+                       0,
+                       err);
+            f64 frame_time = benchmark_get_time() - frame_start;
+
+            checksum += stub_renderer_submit(renderer_data, err);
+
+            if (i)
+            {
+                samples[0][i - 1] = benchmark.stage_times[FRAME_STAGE_ANIMATE];
+                samples[1][i - 1]
+                    = benchmark.stage_times[FRAME_STAGE_DRAW_DATA];
+                samples[2][i - 1] = frame_time;
+            }
+            results[c].draw_count = renderer_data->draw_count;
+            results[c].joint_transform_count
+                = renderer_data
+                      ->buffer_data[GRAPHICS_BUFFER_JOINT_TRANSFORMS_SB]
+                      .elem_count;
+
+            pg_scratch_free(transient_mem);
+        }
+
+        f64* times[] = {&results[c].animate_time,
+                        &results[c].draw_data_time,
+                        &results[c].frame_time};
+        for (u32 t = 0; t < CAP(times); t += 1)
+        {
+            benchmark_sort(samples[t], BENCHMARK_CROWD_FRAME_COUNT);
+            *times[t] = benchmark_percentile(samples[t],
+                                             BENCHMARK_CROWD_FRAME_COUNT,
+                                             50.0);
+        }
+    }
+    app_state.instance_count = instance_count;
+
+    return checksum;
+}
+
+#if defined(APP_PIPELINED_FRAMES)
+#define BENCHMARK_PIPELINE_FRAME_COUNT 60
+
+typedef struct
+{
+    f64 serial_time;    // ms per frame
+    f64 pipelined_time; // ms per frame
+} benchmark_pipeline_result;
+
+// Runs the current model with the largest crowd for
+// BENCHMARK_PIPELINE_FRAME_COUNT frames serially, then as many pipelined,
+// after one frame each to lay the crowd out and fill the pipeline.
+// NOTE: Frames are submitted to the stub renderer, so pipelining only hides
+// as much of the update as the stub's submission takes.
+FUNCTION u64
+benchmark_pipeline(benchmark_pipeline_result* result,
+                   pg_assets* assets,
+                   pg_input_queue* iq,
+                   models_metadata* metadata,
+                   pg_scratch_allocator* transient_mem,
+                   pg_graphics_renderer_data* renderer_data,
+                   pg_error* err)
+{
+    u64 checksum = 0;
+    u32 instance_count = app_state.instance_count;
+    app_state.instance_count = CROWD_MAX_INSTANCE_COUNT;
+    pg_f32_2x render_res = {.width = 1920.0f, .height = 1080.0f};
+
+    f64 start = 0.0;
+    for (u32 i = 0; i < BENCHMARK_PIPELINE_FRAME_COUNT + 1; i += 1)
+    {
+        if (i == 1)
+        {
+            start = benchmark_get_time();
+        }
+        update_app(assets,
+                   iq,
+                   metadata,
+                   render_res,
+                   transient_mem,
+                   renderer_data,
+                   0,
+                   err);
+        checksum += stub_renderer_submit(renderer_data, err);
+        pg_scratch_free(transient_mem);
+    }
+    result->serial_time
+        = (benchmark_get_time() - start) / BENCHMARK_PIPELINE_FRAME_COUNT;
+
+    pg_graphics_metrics* metrics = app_state.metrics;
+    app_state_delta_init(iq, render_res);
+    frame_update_data update_data = {.assets = assets, .metadata = metadata};
+    if (frame_pipeline_start(&pipeline,
+                             renderer_data,
+                             &update_frame,
+                             &update_data,
+                             err))
+    {
+        for (u32 i = 0; i < BENCHMARK_PIPELINE_FRAME_COUNT + 1; i += 1)
+        {
+            if (i == 1)
+            {
+                start = benchmark_get_time();
+            }
+            frame_snapshot* snapshot = frame_pipeline_take(&pipeline);
+            checksum += stub_renderer_submit(&snapshot->renderer_data, err);
+            frame_pipeline_release(&pipeline);
+        }
+        result->pipelined_time
+            = (benchmark_get_time() - start) / BENCHMARK_PIPELINE_FRAME_COUNT;
+        frame_pipeline_stop(&pipeline, renderer_data, err);
+    }
+    app_state.metrics = metrics;
+    app_state.instance_count = instance_count;
+
+    return checksum;
+}
+#endif
+
+FUNCTION s32
+benchmark_glb(c8** paths,
+              u32 path_count,
+              pg_scratch_allocator* mem,
+              pg_error* err)
+{
+    printf("%-40s %10s %10s %10s %10s %10s %12s %12s\n",
+           "file",
+           "map (ms)",
+           "json (ms)",
+           "load (ms)",
+           "vertices",
+           "indices",
+           "mapped (B)",
+           "copied (B)");
+
+    for (u32 i = 0; i < path_count; i += 1)
+    {
+        file_view view = {0};
+        glb_file glb = {0};
+        glb_model model = {0};
+
+        f64 map_start = benchmark_get_time();
+        if (!file_map(paths[i], &view, err))
+        {
+            fprintf(stderr, "failed to open %s\n", paths[i]);
+            return 1;
+        }
+        f64 json_start = benchmark_get_time();
+        if (!glb_open(view, mem, &glb, err))
+        {
+            return 1;
+        }
+        f64 load_start = benchmark_get_time();
+        if (!glb_load_model(&glb, mem, &model, err))
+        {
+            return 1;
+        }
+        f64 load_end = benchmark_get_time();
+
+        printf("%-40s %10.3f %10.3f %10.3f %10u %10u %12zu %12zu\n",
+               paths[i],
+               json_start - map_start,
+               load_start - json_start,
+               load_end - load_start,
+               model.vertex_count,
+               model.index_count,
+               model.mapped_index_size,
+               model.converted_index_size
+                   + (model.vertex_count * sizeof(pg_vertex)));
+
+        file_unmap(&view);
+        pg_scratch_free(mem);
+    }
+
+    struct rusage usage = {0};
+    getrusage(RUSAGE_SELF, &usage);
+    printf("\npeak rss: %ld KiB\n", usage.ru_maxrss);
+
+    return 0;
+}
+
+s32
+main(s32 argc, c8** argv)
+{
+    linux_platform platform = {0};
+    pg_error error = {.log = &linux_platform_error_log};
+    pg_error* err = &error;
+
+    // Parse command-line arguments.
+    u32 frame_count = 1000;
+    u32 warmup_frame_count = 60;
+    c8** glb_paths = 0;
+    u32 glb_path_count = 0;
+    for (s32 i = 1; i < argc; i += 1)
+    {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+        {
+            frame_count = (u32)strtoul(argv[++i], 0, 10);
+        }
+        else if (!strcmp(argv[i], "--warmup") && i + 1 < argc)
+        {
+            warmup_frame_count = (u32)strtoul(argv[++i], 0, 10);
+        }
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+        {
+            job_thread_count = (u32)strtoul(argv[++i], 0, 10);
+        }
+        else if (!strcmp(argv[i], "--instances") && i + 1 < argc)
+        {
+            app_state.instance_count = (u32)strtoul(argv[++i], 0, 10);
+        }
+        else if (!strcmp(argv[i], "--glb") && i + 1 < argc)
+        {
+            // NOTE: All remaining arguments are glb file paths.
+            glb_paths = &argv[i + 1];
+            glb_path_count = (u32)(argc - (i + 1));
+            break;
+        }
+        else
+        {
+            fprintf(stderr,
+                    "usage: %s [--frames N] [--warmup N] [--threads N] "
+                    "[--instances N] [--glb FILE...]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (!frame_count)
+    {
+        fprintf(stderr, "frame count must be non-zero\n");
+        return 1;
+    }
+    if (!app_state.instance_count
+        || app_state.instance_count > CROWD_MAX_INSTANCE_COUNT)
+    {
+        fprintf(stderr,
+                "instance count must be 1 to %u\n",
+                CROWD_MAX_INSTANCE_COUNT);
+        return 1;
+    }
+
+    pg_assets* assets = 0;
+    models_metadata metadata = {0};
+    pg_graphics_renderer_data renderer_data = {0};
+
+    // NOTE: A fixed frame time keeps animation and auto-rotation deterministic
+    // across runs.
+    pg_graphics_metrics metrics
+        = {.cpu_last_frame_time = PG_MILLISECOND(1.0f / 60.0f)};
+    app_state.metrics = &metrics;
+
+    linux_platform_init_memory(&platform,
+                         config.permanent_mem_size,
+                         config.transient_mem_size,
+                         err);
+
+    if (glb_path_count)
+    {
+        s32 result = benchmark_glb(glb_paths,
+                                   glb_path_count,
+                                   &platform.permanent_mem,
+                                   err);
+        linux_platform_release(&platform);
+        return result;
+    }
+
+    // NOTE: Starting on the first benchmarked model lets init_app page it in.
+    app_state.model_id = 1;
+    f64 init_start = benchmark_get_time();
+    init_app(&linux_platform_file_read,
+             &platform.permanent_mem,
+             &assets,
+             &metadata,
+             &platform.input_queue,
+             &renderer_data,
+             err);
+    f64 init_time = benchmark_get_time() - init_start;
+
+    // NOTE: One row of samples per stage plus one for the whole frame.
+    static_assert(CAP(frame_stage_names) == FRAME_STAGE_COUNT,
+                  "unexpected frame stage names count");
+    f64* samples;
+    pg_scratch_alloc(&platform.permanent_mem,
+                     (FRAME_STAGE_COUNT + 1) * frame_count * sizeof(f64),
+                     alignof(f64),
+                     &samples,
+                     err);
+
+    printf("init_app: %.3f ms\n", init_time);
+#if !defined(APP_PAGED_ASSETS)
+    printf("geometry arena: %u vertices, %u indices, %u materials\n",
+           geometry.vertex_count,
+           geometry.index_count,
+           geometry.material_count);
+#endif
+    printf("frames: %u (warmup: %u)\n", frame_count, warmup_frame_count);
+    printf("workers: %u\n", (u32)jobs.worker_count);
+    printf("instances: %u\n\n", app_state.instance_count);
+    printf("%-38s %-10s %10s %10s %10s\n",
+           "model",
+           "stage",
+           "p50 (ms)",
+           "p95 (ms)",
+           "p99 (ms)");
+
+    u64 checksum = 0;
+    bounds_cull_stats drawable_totals[MODEL_COUNT] = {0};
+    meshlet_cull_stats meshlet_totals[MODEL_COUNT] = {0};
+    lod_select_stats lod_totals[MODEL_COUNT] = {0};
+    skinning_stats skinning_totals[MODEL_COUNT] = {0};
+    animation_sample_stats animation_totals[MODEL_COUNT] = {0};
+    scene_update_stats scene_totals[MODEL_COUNT] = {0};
+    job_stats job_totals[MODEL_COUNT] = {0};
+    draw_list_stats draw_list_totals[MODEL_COUNT] = {0};
+    f64 switch_frame_times[MODEL_COUNT] = {0}; // ms
+    benchmark_skinning_result
+        skinning_results[MODEL_COUNT][SKINNING_KERNEL_COUNT] = {0};
+    benchmark_animation_result animation_results[MODEL_COUNT] = {0};
+    benchmark_library_result library_results[MODEL_COUNT] = {0};
+    benchmark_crowd_result crowd_results[MODEL_COUNT]
+                                        [CAP(crowd_instance_counts)]
+        = {0};
+#if defined(APP_PIPELINED_FRAMES)
+    benchmark_pipeline_result pipeline_results[MODEL_COUNT] = {0};
+#endif
+    b8 skinning_passed = true;
+    for (asset_type_model m = 1; m < MODEL_COUNT; m += 1)
+    {
+        app_state.model_id = m;
+        reset_view();
+        metadata.model_id_last_frame = 0;
+
+        for (u32 i = 0; i < warmup_frame_count + frame_count; i += 1)
+        {
+            f64 frame_start = benchmark_get_time();
+            update_app(assets,
+                       &platform.input_queue,
+                       &metadata,
+                       (pg_f32_2x){.width = 1920.0f, .height = 1080.0f},
+                       &platform.transient_mem,
+                       &renderer_data,
+                       0,
+                       err);
+            f64 frame_time = benchmark_get_time() - frame_start;
+            if (i == 0)
+            {
+                switch_frame_times[m] = frame_time;
+            }
+
+            checksum += stub_renderer_submit(&renderer_data, err);
+
+            if (i >= warmup_frame_count)
+            {
+                u32 frame = i - warmup_frame_count;
+                for (frame_stage fs = 0; fs < FRAME_STAGE_COUNT; fs += 1)
+                {
+                    samples[(fs * frame_count) + frame]
+                        = benchmark.stage_times[fs];
+                }
+                samples[(FRAME_STAGE_COUNT * frame_count) + frame] = frame_time;
+
+                bounds_cull_stats* ds = &app_state.drawable_stats;
+                drawable_totals[m].drawable_count += ds->drawable_count;
+                drawable_totals[m].culled_drawable_count
+                    += ds->culled_drawable_count;
+
+                meshlet_cull_stats* ms = &app_state.meshlet_stats;
+                meshlet_cull_stats* total = &meshlet_totals[m];
+                total->meshlet_count += ms->meshlet_count;
+                total->frustum_culled_count += ms->frustum_culled_count;
+                total->cone_culled_count += ms->cone_culled_count;
+                total->range_count += ms->range_count;
+                total->triangle_count += ms->triangle_count;
+                total->drawn_triangle_count += ms->drawn_triangle_count;
+
+                for (u32 l = 0; l <= LOD_MAX_LEVEL_COUNT; l += 1)
+                {
+                    lod_totals[m].drawable_counts[l]
+                        += app_state.lod_stats.drawable_counts[l];
+                }
+
+                skinning_totals[m].skinned_vertex_count
+                    += app_state.skinning_stats.skinned_vertex_count;
+                skinning_totals[m].shader_blend_count
+                    += app_state.skinning_stats.shader_blend_count;
+
+                animation_sample_stats* as = &app_state.animation_stats;
+                animation_sample_stats* at = &animation_totals[m];
+                at->channel_count += as->channel_count;
+                at->search_count += as->search_count;
+                at->advance_count += as->advance_count;
+
+                scene_update_stats* ss = &app_state.scene_stats;
+                scene_totals[m].node_count = ss->node_count;
+                scene_totals[m].updated_count += ss->updated_count;
+                scene_totals[m].cached_drawable_count
+                    += ss->cached_drawable_count;
+
+                job_totals[m].job_count += app_state.job_stats.job_count;
+                job_totals[m].steal_count += app_state.job_stats.steal_count;
+
+                draw_list_stats* dls = &app_state.draw_list_stats;
+                draw_list_stats* dlt = &draw_list_totals[m];
+                dlt->range_count += dls->range_count;
+                dlt->draw_count += dls->draw_count;
+                dlt->material_change_count += dls->material_change_count;
+                dlt->sorted_material_change_count
+                    += dls->sorted_material_change_count;
+            }
+
+            // NOTE: The kernels, animation layers and the asset library's
+            // sampling are checked and timed on the last frame.
+            if (i + 1 == warmup_frame_count + frame_count)
+            {
+                skinning_passed = benchmark_skinning(skinning_results[m],
+                                                     &platform.transient_mem,
+                                                     err)
+                                  && skinning_passed;
+                benchmark_animation(&animation_results[m],
+                                    &platform.transient_mem,
+                                    err);
+                benchmark_library(&library_results[m],
+                                  &platform.transient_mem,
+                                  err);
+            }
+
+            pg_scratch_free(&platform.transient_mem);
+        }
+
+        for (u32 fs = 0; fs <= FRAME_STAGE_COUNT; fs += 1)
+        {
+            f64* stage_samples = &samples[fs * frame_count];
+            benchmark_sort(stage_samples, frame_count);
+            printf("%-38s %-10s %10.4f %10.4f %10.4f\n",
+                   model_names[m],
+                   fs == FRAME_STAGE_COUNT ? "Frame" : frame_stage_names[fs],
+                   benchmark_percentile(stage_samples, frame_count, 50.0),
+                   benchmark_percentile(stage_samples, frame_count, 95.0),
+                   benchmark_percentile(stage_samples, frame_count, 99.0));
+        }
+
+        checksum += benchmark_crowd(crowd_results[m],
+                                    assets,
+                                    &platform.input_queue,
+                                    &metadata,
+                                    &platform.transient_mem,
+                                    &renderer_data,
+                                    err);
+#if defined(APP_PIPELINED_FRAMES)
+        checksum += benchmark_pipeline(&pipeline_results[m],
+                                       assets,
+                                       &platform.input_queue,
+                                       &metadata,
+                                       &platform.transient_mem,
+                                       &renderer_data,
+                                       err);
+#endif
+    }
+
+    // NOTE: Counts are per frame, averaged over the measured frames.
+    // NOTE: LODs are drawables per level, from full to coarsest.
+    printf("\n%-38s %10s %8s %10s %10s %10s %16s %12s %12s %8s\n",
+           "model",
+           "drawables",
+           "culled",
+           "meshlets",
+           "frustum",
+           "cone",
+           "lods",
+           "triangles",
+           "drawn",
+           "draws");
+    for (asset_type_model m = 1; m < MODEL_COUNT; m += 1)
+    {
+        meshlet_cull_stats* total = &meshlet_totals[m];
+        u32* lod_counts = lod_totals[m].drawable_counts;
+        static_assert(LOD_MAX_LEVEL_COUNT == 3, "unexpected level count");
+        c8 lods_text[64] = {0};
+        snprintf(lods_text,
+                 sizeof(lods_text),
+                 "%u/%u/%u/%u",
+                 lod_counts[0] / frame_count,
+                 lod_counts[1] / frame_count,
+                 lod_counts[2] / frame_count,
+                 lod_counts[3] / frame_count);
+        printf("%-38s %10u %8u %10u %10u %10u %16s %12llu %12llu %8u\n",
+               model_names[m],
+               drawable_totals[m].drawable_count / frame_count,
+               drawable_totals[m].culled_drawable_count / frame_count,
+               total->meshlet_count / frame_count,
+               total->frustum_culled_count / frame_count,
+               total->cone_culled_count / frame_count,
+               lods_text,
+               (unsigned long long)(total->triangle_count / frame_count),
+               (unsigned long long)(total->drawn_triangle_count / frame_count),
+               total->range_count / frame_count);
+    }
+
+    // NOTE: "vs blends" is the joint blends `vs` does per frame without
+    // pre-skinning (one per index of a weighted vertex), and "skinned" is the
+    // vertices skinned per frame on the CPU instead.
+    printf("\n%-38s %12s %12s %8s\n", "model", "vs blends", "skinned", "ratio");
+    for (asset_type_model m = 1; m < MODEL_COUNT; m += 1)
+    {
+        skinning_stats* total = &skinning_totals[m];
+        if (!total->shader_blend_count)
+        {
+            continue;
+        }
+        printf("%-38s %12llu %12llu %8.2f\n",
+               model_names[m],
+               (unsigned long long)(total->shader_blend_count / frame_count),
+               (unsigned long long)(total->skinned_vertex_count / frame_count),
+               total->skinned_vertex_count
+                   ? (f64)total->shader_blend_count
+                         / (f64)total->skinned_vertex_count
+                   : 0.0);
+    }
+
+    // NOTE: "error" is the largest error of any skinned component vs. the
+    // scalar kernel, which does the same math as `vs`.
+    printf("\n%-38s %-8s %14s %12s\n",
+           "model",
+           "kernel",
+           "vertices/s",
+           "error");
+    for (asset_type_model m = 1; m < MODEL_COUNT; m += 1)
+    {
+        for (skinning_kernel k = 0; k < SKINNING_KERNEL_COUNT; k += 1)
+        {
+            benchmark_skinning_result* r = &skinning_results[m][k];
+            if (!r->vertices_per_second)
+            {
+                continue;
+            }
+            printf("%-38s %-8s %14.0f %12.3g%s\n",
+                   model_names[m],
+                   skinning_kernel_names[k],
+                   r->vertices_per_second,
+                   r->max_error,
+                   r->max_error <= SKINNING_MAX_ERROR ? "" : " FAILED");
+        }
+    }
+
+    // NOTE: Channels, searches and advances are totals over the measured
+    // frames.
+    printf("\n%-38s %12s %10s %12s\n",
+           "model",
+           "channels",
+           "searches",
+           "advances");
+    for (asset_type_model m = 1; m < MODEL_COUNT; m += 1)
+    {
+        animation_sample_stats* total = &animation_totals[m];
+        if (!total->channel_count)
+        {
+            continue;
+        }
+        printf("%-38s %12u %10u %12u\n",
+               model_names[m],
+               total->channel_count,
+               total->search_count,
+               total->advance_count);
+    }
+
+    // NOTE: "clip" is a call to the asset library for the drawables with the
+    // clip, as when it animates the model, and "no clip" is one without, as
+    // when the viewer has sampled it. "error" is the largest difference of any
+    // joint transform element vs. the asset library's.
+    printf("\n%-38s %12s %14s %10s %12s\n",
+           "model",
+           "clip (us)",
+           "no clip (us)",
+           "saved",
+           "error");
+    for (asset_type_model m = 1; m < MODEL_COUNT; m += 1)
+    {
+        benchmark_library_result* r = &library_results[m];
+        if (!r->clip_time)
+        {
+            continue;
+        }
+        printf("%-38s %12.3f %14.3f %9.1f%% %12.3g\n",
+               model_names[m],
+               r->clip_time,
+               r->no_clip_time,
+               (100.0 * (r->clip_time - r->no_clip_time)) / r->clip_time,
+               (f64)r->max_joint_error);
+    }
+
+    // NOTE: "updated" is the nodes whose global transforms were recomputed per
+    // frame (or taken from the asset library), and "boxes reused" is the
+    // drawables per frame whose bounds were not recomputed.
+    printf("\n%-38s %8s %10s %14s\n",
+           "model",
+           "nodes",
+           "updated",
+           "boxes reused");
+    for (asset_type_model m = 1; m < MODEL_COUNT; m += 1)
+    {
+        scene_update_stats* total = &scene_totals[m];
+        if (!total->node_count)
+        {
+            continue;
+        }
+        printf("%-38s %8u %10u %14u\n",
+               model_names[m],
+               total->node_count,
+               total->updated_count / frame_count,
+               total->cached_drawable_count / frame_count);
+    }
+
+    // NOTE: Jobs are per frame, and "stolen" is the jobs run by another worker
+    // than the one that kicked them. Loops that fit in one batch run without a
+    // job.
+    printf("\n%-38s %8s %8s\n", "model", "jobs", "stolen");
+    for (asset_type_model m = 1; m < MODEL_COUNT; m += 1)
+    {
+        printf("%-38s %8.1f %8.1f\n",
+               model_names[m],
+               (f64)job_totals[m].job_count / frame_count,
+               (f64)job_totals[m].steal_count / frame_count);
+    }
+
+    // NOTE: Counts are per frame. "ranges" is the draws before sorting and
+    // merging, and "changes" is the material changes between consecutive
+    // draws before and after sorting.
+    printf("\n%-38s %8s %8s %10s %10s\n",
+           "model",
+           "ranges",
+           "draws",
+           "changes",
+           "sorted");
+    for (asset_type_model m = 1; m < MODEL_COUNT; m += 1)
+    {
+        draw_list_stats* total = &draw_list_totals[m];
+        printf("%-38s %8u %8u %10u %10u\n",
+               model_names[m],
+               total->range_count / frame_count,
+               total->draw_count / frame_count,
+               total->material_change_count / frame_count,
+               total->sorted_material_change_count / frame_count);
+    }
+
+    // NOTE: Times are per evaluation of every layer, from sampling to joint
+    // transforms, and per joint of the model.
+    printf("\n%-38s %8s %8s %12s %12s\n",
+           "model",
+           "joints",
+           "layers",
+           "time (us)",
+           "ns/joint");
+    for (asset_type_model m = 1; m < MODEL_COUNT; m += 1)
+    {
+        benchmark_animation_result* r = &animation_results[m];
+        if (!r->joint_count)
+        {
+            continue;
+        }
+        for (u32 c = 0; c < CAP(benchmark_animation_layer_counts); c += 1)
+        {
+            printf("%-38s %8u %8u %12.3f %12.1f\n",
+                   model_names[m],
+                   r->joint_count,
+                   benchmark_animation_layer_counts[c],
+                   r->times[c],
+                   (r->times[c] * 1000.0) / r->joint_count);
+        }
+    }
+
+    // NOTE: Times are p50 over BENCHMARK_CROWD_FRAME_COUNT frames, with every
+    // instance drawn at full detail. "joints" is the joint transforms uploaded
+    // per frame.
+    printf("\n%-38s %10s %12s %14s %10s %8s %10s\n",
+           "model",
+           "instances",
+           "animate (ms)",
+           "draw data (ms)",
+           "frame (ms)",
+           "draws",
+           "joints");
+    for (asset_type_model m = 1; m < MODEL_COUNT; m += 1)
+    {
+        for (u32 c = 0; c < CAP(crowd_instance_counts); c += 1)
+        {
+            benchmark_crowd_result* r = &crowd_results[m][c];
+            printf("%-38s %10u %12.4f %14.4f %10.4f %8u %10u\n",
+                   model_names[m],
+                   crowd_instance_counts[c],
+                   r->animate_time,
+                   r->draw_data_time,
+                   r->frame_time,
+                   r->draw_count,
+                   r->joint_transform_count);
+        }
+    }
+
+#if defined(APP_PIPELINED_FRAMES)
+    // NOTE: Times are the mean over BENCHMARK_PIPELINE_FRAME_COUNT frames with
+    // the largest crowd.
+    printf("\n%-38s %12s %15s\n", "model", "serial (ms)", "pipelined (ms)");
+    for (asset_type_model m = 1; m < MODEL_COUNT; m += 1)
+    {
+        benchmark_pipeline_result* r = &pipeline_results[m];
+        printf("%-38s %12.4f %15.4f\n",
+               model_names[m],
+               r->serial_time,
+               r->pipelined_time);
+    }
+#endif
+
+    // NOTE: The first frame after switching to each model (a warmup frame)
+    // includes paging it in if it was not prefetched.
+    printf("\n%-38s %12s\n", "model", "switch (ms)");
+    for (asset_type_model m = 1; m < MODEL_COUNT; m += 1)
+    {
+        printf("%-38s %12.3f\n", model_names[m], switch_frame_times[m]);
+    }
+    printf("first frame: %.3f ms after startup\n",
+           init_time + switch_frame_times[1]);
+
+    printf("\nchecksum: %llu\n", (unsigned long long)checksum);
+#if defined(APP_PAGED_ASSETS)
+    printf("model pages: %u loads, %u stalls, %u evictions, %llu/%llu bytes "
+           "resident\n",
+           pager.load_count,
+           pager.stall_count,
+           pager.eviction_count,
+           (unsigned long long)pager.resident_size,
+           (unsigned long long)pager.budget);
+#endif
+
+#if defined(APP_PAGED_ASSETS)
+    asset_loader_release(&loader);
+#endif
+    job_system_release(&jobs);
+    linux_platform_release(&platform);
+
+    if (!skinning_passed)
+    {
+        fprintf(stderr, "skinning kernel error exceeds tolerance\n");
+        return 1;
+    }
+
+    return 0;
+}
+#endif
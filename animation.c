@@ -0,0 +1,1442 @@
+// Animation
+//
+// Pack-time copies of a skinned model's node hierarchy, skin and animation
+// clips, so the viewer can sample skeletal animation itself. Each channel of
+// the playing clip keeps a cursor to the key it last sampled. Playback time
+// moves forward by less than a key interval on most frames, so sampling
+// usually steps a cursor by zero or one keys, and only searches the channel's
+// keys when time wraps around or the clip changes. Channels are then
+// interpolated 4 at a time with SSE, one register per component (lerp for
+// translations and scales, slerp for rotations), straight into a pose that
+// stores each component of every node's transform in its own array.
+//
+// Several clips can be layered: a clip crossfading out is sampled alongside
+// the one fading in and blended with it, and a clip can be added on top of
+// both as its difference from a reference pose. Blending works on whole poses
+// 4 nodes at a time with SSE (lerp, or nlerp for rotations), and the hierarchy
+// is then walked once, parents first, to build the joint transforms. Poses come
+// from a pool and batches from a sampler, both allocated up front.
+//
+// Clips can be compressed at pack time. Rotations are stored as smallest-three
+// quaternions and translations and scales are quantized to 16 bits against the
+// channel's range, each only if that stays within the channel's tolerance.
+// Keys that interpolation from their neighbors reproduces within tolerance are
+// dropped, and channels that never move are reduced to one key or, if they
+// hold the rest transform, dropped entirely. Keys are decoded as they are
+// gathered, so compressed clips are sampled in place.
+//
+// NOTE: A joint transform maps bind-pose model space to animated model space
+// (the joint's global transform times its inverse bind matrix), which is what
+// `vs` and the joint bounds (see bounds.c) expect.
+// NOTE: Matrices are column-major in memory (see frustum.c), and quaternions
+// are (x, y, z, w).
+
+#include <xmmintrin.h>
+
+#define ANIMATION_NO_PARENT 0xFFFFFFFF
+#define ANIMATION_NO_CLIP 0xFFFFFFFF
+#define ANIMATION_BATCH_SIZE 4
+
+// NOTE: Relative to the model's bounds diagonal. Each channel's rotations and
+// scales are held to it at the farthest vertex the channel's node moves.
+#define ANIMATION_MAX_POSITION_ERROR 1e-4f
+#define ANIMATION_QUATERNION_RANGE 0.70710678f // Of the three smallest
+#define ANIMATION_QUATERNION_MAX 0x7FFF        // 15 bits per component
+#define ANIMATION_VECTOR_MAX 0xFFFF
+#define ANIMATION_VALUE_ALIGNMENT 4
+
+typedef enum
+{
+    ANIMATION_PATH_TRANSLATION,
+    ANIMATION_PATH_ROTATION,
+    ANIMATION_PATH_SCALE,
+    ANIMATION_PATH_COUNT
+} animation_path;
+
+// NOTE: Cubic spline channels are packed with their key values only and are
+// interpolated linearly.
+typedef enum
+{
+    ANIMATION_INTERPOLATION_LINEAR,
+    ANIMATION_INTERPOLATION_STEP
+} animation_interpolation;
+
+// NOTE: QUATERNION_48 keys are 3 u16s: the three smallest components in 15
+// bits each, with the index of the largest in their top bits. VECTOR_48 keys
+// are 3 u16s as well, after the channel's range (a pg_f32_3x minimum, then a
+// pg_f32_3x extent).
+typedef enum
+{
+    ANIMATION_FORMAT_F32,           // pg_f32_4x per key
+    ANIMATION_FORMAT_QUATERNION_48, // Rotations only
+    ANIMATION_FORMAT_VECTOR_48,     // Translations and scales only
+    ANIMATION_FORMAT_COUNT
+} animation_format;
+
+// NOTE: Layout of an ASSET_EXT_SECTION_ANIMATIONS section: this header, the
+// nodes (parents before children), the joints, the clips, the channels
+// (grouped by clip), the key times of every channel, then the key values of
+// every channel in its format (F32 keys have w = 0 for translations and
+// scales).
+typedef struct
+{
+    u32 node_count;
+    u32 joint_count;
+    u32 clip_count;
+    u32 channel_count;
+    u32 key_count;
+    u32 value_size;
+    u32 padding0;
+    u32 padding1;
+} animations_header;
+
+typedef struct
+{
+    pg_f32_4x rotation;
+    pg_f32_3x translation;
+    f32 padding0;
+    pg_f32_3x scale;
+    f32 padding1;
+} animation_transform;
+
+typedef struct
+{
+    animation_transform rest; // Used where no channel targets the node
+    u32 parent;               // ANIMATION_NO_PARENT for roots
+    u32 padding0;
+    u32 padding1;
+    u32 padding2;
+} animation_node;
+
+typedef struct
+{
+    pg_f32_4x4 inverse_bind;
+    u32 node;
+    u32 padding0;
+    u32 padding1;
+    u32 padding2;
+} animation_joint;
+
+// NOTE: Key times are in seconds, and `duration` is the last key time of any
+// channel. `error` is the largest distance any vertex moved from where the
+// uncompressed clip puts it, measured at pack time.
+typedef struct
+{
+    f32 duration;
+    u32 channel_offset;
+    u32 channel_count;
+    f32 error;
+    u32 size;     // Bytes of channels, times and values
+    u32 raw_size; // `size` if uncompressed
+    u32 padding0;
+    u32 padding1;
+} animation_clip;
+
+// NOTE: Every channel has at least one key, and its key times increase.
+// `value_offset` is in bytes and is a multiple of ANIMATION_VALUE_ALIGNMENT.
+typedef struct
+{
+    u32 node;
+    u32 path;          // animation_path
+    u32 interpolation; // animation_interpolation
+    u32 format;        // animation_format
+    u32 key_offset;
+    u32 key_count;
+    u32 value_offset;
+    u32 padding0;
+} animation_channel;
+
+typedef struct
+{
+    animation_node* nodes;
+    animation_joint* joints;
+    animation_clip* clips;
+    animation_channel* channels;
+    f32* times;
+    u8* values;
+    u32 node_count;
+    u32 joint_count;
+    u32 clip_count;
+    u32 channel_count;
+    u32 key_count;
+    u32 value_size;
+    u32 max_clip_channel_count;
+} animations;
+
+// NOTE: Stored alongside the `pg_animation` it samples. `keys[i]` is the last
+// key at or before `time` of channel i of `clip_id`. Set `clip_id` to
+// ANIMATION_NO_CLIP to force a search, e.g. when the model changes.
+typedef struct
+{
+    u32 clip_id;
+    f32 time;
+    u32* keys; // One per channel, for the clip with the most channels
+} animation_cursors;
+
+typedef struct
+{
+    u32 channel_count; // Sampled
+    u32 search_count;  // Cursors found by binary search
+    u32 advance_count; // Keys the other cursors stepped forward
+    u32 blend_count;   // Poses blended or added onto another
+} animation_sample_stats;
+
+// NOTE: The local transform of every node, with one array per component so
+// poses are blended 4 nodes at a time. Arrays are padded to a multiple of
+// ANIMATION_BATCH_SIZE nodes, and padding nodes hold the identity.
+typedef struct
+{
+    f32* rotation[4];
+    f32* translation[3];
+    f32* scale[3];
+} animation_pose;
+
+// NOTE: Poses are allocated once, for the model with the most nodes, and then
+// reused, so evaluating layers allocates nothing.
+typedef struct
+{
+    animation_pose* poses;
+    u32* free_ids;
+    u32 free_count;
+    u32 pose_count;
+} animation_pose_pool;
+
+typedef enum
+{
+    ANIMATION_LAYER_BASE,
+    ANIMATION_LAYER_FADE,      // Faded out as BASE fades in
+    ANIMATION_LAYER_ADDITIVE,  // Added on top, relative to REFERENCE
+    ANIMATION_LAYER_REFERENCE, // e.g. the first key of ADDITIVE's clip
+    ANIMATION_LAYER_COUNT
+} animation_layer;
+
+// NOTE: Times are in seconds. Layers whose clip is ANIMATION_NO_CLIP are
+// skipped (ADDITIVE and REFERENCE are only used together).
+typedef struct
+{
+    u32 clip_ids[ANIMATION_LAYER_COUNT];
+    f32 times[ANIMATION_LAYER_COUNT];
+    f32 fade_weight;     // Of BASE over FADE, from 0 to 1
+    f32 additive_weight; // Of ADDITIVE, from 0 to 1
+} animation_layers;
+
+FUNCTION f32
+animation_sqrt(f32 x)
+{
+    return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(x)));
+}
+
+FUNCTION usize
+animation_values_size(animation_format format, u32 key_count)
+{
+    usize size = 0;
+    switch (format)
+    {
+        case ANIMATION_FORMAT_F32:
+        {
+            size = key_count * sizeof(pg_f32_4x);
+            break;
+        }
+        case ANIMATION_FORMAT_QUATERNION_48:
+        {
+            size = key_count * 3 * sizeof(u16);
+            break;
+        }
+        case ANIMATION_FORMAT_VECTOR_48:
+        {
+            size = (2 * sizeof(pg_f32_3x)) + (key_count * 3 * sizeof(u16));
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    return (size + ANIMATION_VALUE_ALIGNMENT - 1)
+           & ~(usize)(ANIMATION_VALUE_ALIGNMENT - 1);
+}
+
+FUNCTION usize
+animations_section_size(u32 node_count,
+                        u32 joint_count,
+                        u32 clip_count,
+                        u32 channel_count,
+                        u32 key_count,
+                        u32 value_size)
+{
+    return sizeof(animations_header) + (node_count * sizeof(animation_node))
+           + (joint_count * sizeof(animation_joint))
+           + (clip_count * sizeof(animation_clip))
+           + (channel_count * sizeof(animation_channel))
+           + (key_count * sizeof(f32)) + value_size;
+}
+
+FUNCTION b8
+animations_read(u8* section, u64 section_size, animations* as)
+{
+    *as = (animations){0};
+
+    if (!section || section_size < sizeof(animations_header))
+    {
+        return false;
+    }
+
+    animations_header* header = (animations_header*)section;
+    if (section_size < animations_section_size(header->node_count,
+                                               header->joint_count,
+                                               header->clip_count,
+                                               header->channel_count,
+                                               header->key_count,
+                                               header->value_size))
+    {
+        return false;
+    }
+
+    u8* p = section + sizeof(animations_header);
+    as->nodes = (animation_node*)p;
+    p += header->node_count * sizeof(animation_node);
+    as->joints = (animation_joint*)p;
+    p += header->joint_count * sizeof(animation_joint);
+    as->clips = (animation_clip*)p;
+    p += header->clip_count * sizeof(animation_clip);
+    as->channels = (animation_channel*)p;
+    p += header->channel_count * sizeof(animation_channel);
+    as->times = (f32*)p;
+    p += header->key_count * sizeof(f32);
+    as->values = p;
+    as->node_count = header->node_count;
+    as->joint_count = header->joint_count;
+    as->clip_count = header->clip_count;
+    as->channel_count = header->channel_count;
+    as->key_count = header->key_count;
+    as->value_size = header->value_size;
+
+    b8 valid = true;
+    for (u32 i = 0; valid && i < as->node_count; i += 1)
+    {
+        valid = as->nodes[i].parent == ANIMATION_NO_PARENT
+                || as->nodes[i].parent < i;
+    }
+    for (u32 i = 0; valid && i < as->joint_count; i += 1)
+    {
+        valid = as->joints[i].node < as->node_count;
+    }
+    for (u32 i = 0; valid && i < as->clip_count; i += 1)
+    {
+        animation_clip* c = &as->clips[i];
+        valid = c->channel_offset + c->channel_count <= as->channel_count;
+        if (c->channel_count > as->max_clip_channel_count)
+        {
+            as->max_clip_channel_count = c->channel_count;
+        }
+    }
+    for (u32 i = 0; valid && i < as->channel_count; i += 1)
+    {
+        animation_channel* c = &as->channels[i];
+        b8 rotation = c->path == ANIMATION_PATH_ROTATION;
+        valid = c->node < as->node_count && c->path < ANIMATION_PATH_COUNT
+                && c->key_count
+                && c->key_offset + c->key_count <= as->key_count
+                && (c->format == ANIMATION_FORMAT_F32
+                    || (c->format == ANIMATION_FORMAT_QUATERNION_48
+                        && rotation)
+                    || (c->format == ANIMATION_FORMAT_VECTOR_48 && !rotation))
+                && c->value_offset % ANIMATION_VALUE_ALIGNMENT == 0
+                && c->value_offset
+                           + animation_values_size(c->format, c->key_count)
+                       <= as->value_size;
+    }
+    if (!valid)
+    {
+        *as = (animations){0};
+        return false;
+    }
+
+    return true;
+}
+
+// Stores the smallest three components of unit quaternion `q` in `out`.
+// NOTE: q and -q are the same rotation, so the largest component is made
+// positive and restored from the other three.
+FUNCTION void
+animation_encode_quaternion(pg_f32_4x q, u16* out)
+{
+    f32 c[] = {q.x, q.y, q.z, q.w};
+    u32 largest = 0;
+    for (u32 i = 1; i < 4; i += 1)
+    {
+        f32 a = c[i] < 0.0f ? -c[i] : c[i];
+        f32 b = c[largest] < 0.0f ? -c[largest] : c[largest];
+        largest = a > b ? i : largest;
+    }
+
+    f32 sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+    u32 k = 0;
+    for (u32 i = 0; i < 4; i += 1)
+    {
+        if (i == largest)
+        {
+            continue;
+        }
+        f32 n = ((sign * c[i] / ANIMATION_QUATERNION_RANGE) * 0.5f) + 0.5f;
+        n = n < 0.0f ? 0.0f : (n > 1.0f ? 1.0f : n);
+        out[k] = (u16)((n * ANIMATION_QUATERNION_MAX) + 0.5f);
+        k += 1;
+    }
+    out[0] |= (u16)((largest & 1) << 15);
+    out[1] |= (u16)((largest >> 1) << 15);
+}
+
+FUNCTION pg_f32_4x
+animation_decode_quaternion(u16* in)
+{
+    u32 largest = (u32)(in[0] >> 15) | ((u32)(in[1] >> 15) << 1);
+    f32 c[4];
+    f32 sum = 0.0f;
+    u32 k = 0;
+    for (u32 i = 0; i < 4; i += 1)
+    {
+        if (i == largest)
+        {
+            continue;
+        }
+        f32 n = (f32)(in[k] & ANIMATION_QUATERNION_MAX)
+                / ANIMATION_QUATERNION_MAX;
+        c[i] = ((n * 2.0f) - 1.0f) * ANIMATION_QUATERNION_RANGE;
+        sum += c[i] * c[i];
+        k += 1;
+    }
+    c[largest] = animation_sqrt(sum < 1.0f ? 1.0f - sum : 0.0f);
+
+    return (pg_f32_4x){c[0], c[1], c[2], c[3]};
+}
+
+FUNCTION void
+animation_encode_vector(pg_f32_4x v, f32* range, u16* out)
+{
+    f32 c[] = {v.x, v.y, v.z};
+    for (u32 i = 0; i < 3; i += 1)
+    {
+        f32 n = range[3 + i] > 0.0f ? (c[i] - range[i]) / range[3 + i] : 0.0f;
+        n = n < 0.0f ? 0.0f : (n > 1.0f ? 1.0f : n);
+        out[i] = (u16)((n * ANIMATION_VECTOR_MAX) + 0.5f);
+    }
+}
+
+FUNCTION pg_f32_4x
+animation_decode_vector(f32* range, u16* in)
+{
+    f32 c[3];
+    for (u32 i = 0; i < 3; i += 1)
+    {
+        c[i] = range[i]
+               + (range[3 + i] * ((f32)in[i] / ANIMATION_VECTOR_MAX));
+    }
+
+    return (pg_f32_4x){c[0], c[1], c[2], 0.0f};
+}
+
+FUNCTION pg_f32_4x
+animation_decode_key(animations* as, animation_channel* c, u32 key)
+{
+    u8* values = as->values + c->value_offset;
+    switch (c->format)
+    {
+        case ANIMATION_FORMAT_QUATERNION_48:
+        {
+            return animation_decode_quaternion(&((u16*)values)[key * 3]);
+        }
+        case ANIMATION_FORMAT_VECTOR_48:
+        {
+            u16* keys = (u16*)(values + (2 * sizeof(pg_f32_3x)));
+            return animation_decode_vector((f32*)values, &keys[key * 3]);
+        }
+        default:
+        {
+            return ((pg_f32_4x*)values)[key];
+        }
+    }
+}
+
+// Returns the last key at or before `time`, or the first key if there is
+// none.
+FUNCTION u32
+animation_find_key(f32* times, u32 key_count, f32 time)
+{
+    u32 low = 0;
+    u32 high = key_count;
+    while (low < high)
+    {
+        u32 mid = low + ((high - low) / 2);
+        if (times[mid] <= time)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low ? low - 1 : 0;
+}
+
+// NOTE: The slerp weights sin((1 - t)θ) / sin(θ) and sin(tθ) / sin(θ) are
+// evaluated as a polynomial in cos(θ) (Eberly, "A Fast and Accurate
+// Algorithm for Computing SLERP"), which needs no trigonometry. They are
+// within 2e-5 of the exact weights for keys up to 90 degrees apart (after the
+// sign flip), and far closer for keys as close as animation keys usually are.
+#define ANIMATION_SLERP_MU 1.85298109240830f
+GLOBAL f32 animation_slerp_u[] = {1.0f / (1 * 3),
+                                  1.0f / (2 * 5),
+                                  1.0f / (3 * 7),
+                                  1.0f / (4 * 9),
+                                  1.0f / (5 * 11),
+                                  1.0f / (6 * 13),
+                                  1.0f / (7 * 15),
+                                  ANIMATION_SLERP_MU / (8 * 17)};
+GLOBAL f32 animation_slerp_v[] = {1.0f / 3,
+                                  2.0f / 5,
+                                  3.0f / 7,
+                                  4.0f / 9,
+                                  5.0f / 11,
+                                  6.0f / 13,
+                                  7.0f / 15,
+                                  ANIMATION_SLERP_MU * 8 / 17};
+
+// Interpolates one key pair like the batches below do, for pack-time error
+// checks.
+FUNCTION pg_f32_4x
+animation_interpolate(pg_f32_4x a, pg_f32_4x b, f32 t, b8 rotation)
+{
+    f32* av = &a.x;
+    f32* bv = &b.x;
+    f32 r[4];
+    if (!rotation)
+    {
+        for (u32 k = 0; k < 4; k += 1)
+        {
+            r[k] = av[k] + ((bv[k] - av[k]) * t);
+        }
+        return (pg_f32_4x){r[0], r[1], r[2], r[3]};
+    }
+
+    f32 x = (av[0] * bv[0]) + (av[1] * bv[1]) + (av[2] * bv[2])
+            + (av[3] * bv[3]);
+    f32 sign = x < 0.0f ? -1.0f : 1.0f;
+    x *= sign;
+    f32 d = 1.0f - t;
+    f32 ct = 1.0f;
+    f32 cd = 1.0f;
+    for (s32 j = CAP(animation_slerp_u) - 1; j >= 0; j -= 1)
+    {
+        f32 u = animation_slerp_u[j];
+        f32 v = animation_slerp_v[j];
+        ct = 1.0f + (((u * t * t) - v) * (x - 1.0f) * ct);
+        cd = 1.0f + (((u * d * d) - v) * (x - 1.0f) * cd);
+    }
+    ct *= t;
+    cd *= d;
+    for (u32 k = 0; k < 4; k += 1)
+    {
+        r[k] = (av[k] * cd) + (sign * bv[k] * ct);
+    }
+
+    return (pg_f32_4x){r[0], r[1], r[2], r[3]};
+}
+
+FUNCTION void
+animation_pose_init(animation_pose* pose,
+                    u32 node_capacity,
+                    pg_scratch_allocator* mem,
+                    pg_error* err)
+{
+    u32 capacity = (node_capacity + ANIMATION_BATCH_SIZE - 1)
+                   & ~(u32)(ANIMATION_BATCH_SIZE - 1);
+    for (u32 k = 0; k < CAP(pose->rotation); k += 1)
+    {
+        pg_scratch_alloc(mem,
+                         capacity * sizeof(f32),
+                         16,
+                         &pose->rotation[k],
+                         err);
+    }
+    for (u32 k = 0; k < CAP(pose->translation); k += 1)
+    {
+        pg_scratch_alloc(mem,
+                         capacity * sizeof(f32),
+                         16,
+                         &pose->translation[k],
+                         err);
+        pg_scratch_alloc(mem, capacity * sizeof(f32), 16, &pose->scale[k], err);
+    }
+}
+
+FUNCTION void
+animation_pose_pool_init(animation_pose_pool* pool,
+                         u32 pose_count,
+                         u32 node_capacity,
+                         pg_scratch_allocator* mem,
+                         pg_error* err)
+{
+    *pool = (animation_pose_pool){.pose_count = pose_count};
+    pg_scratch_alloc(mem,
+                     pose_count * sizeof(animation_pose),
+                     alignof(animation_pose),
+                     &pool->poses,
+                     err);
+    pg_scratch_alloc(mem,
+                     pose_count * sizeof(u32),
+                     alignof(u32),
+                     &pool->free_ids,
+                     err);
+    if (!pool->poses || !pool->free_ids)
+    {
+        *pool = (animation_pose_pool){0};
+        return;
+    }
+
+    for (u32 i = 0; i < pose_count; i += 1)
+    {
+        animation_pose_init(&pool->poses[i], node_capacity, mem, err);
+        pool->free_ids[pool->free_count] = pose_count - 1 - i;
+        pool->free_count += 1;
+    }
+}
+
+// Returns a pose from `pool`, or 0 if every pose is in use.
+FUNCTION animation_pose*
+animation_pose_acquire(animation_pose_pool* pool)
+{
+    if (!pool->free_count)
+    {
+        return 0;
+    }
+
+    pool->free_count -= 1;
+    return &pool->poses[pool->free_ids[pool->free_count]];
+}
+
+FUNCTION void
+animation_pose_release(animation_pose_pool* pool, animation_pose* pose)
+{
+    pool->free_ids[pool->free_count] = (u32)(pose - pool->poses);
+    pool->free_count += 1;
+}
+
+// NOTE: Lanes past `count` are padding and are never stored.
+typedef struct
+{
+    f32* a[4];
+    f32* b[4];
+    f32* t;
+    u32* nodes; // Whose pose each lane's result is stored in
+    u32 count;
+} animation_batch;
+
+// NOTE: Holds the batches `animation_sample` queues channels in, so sampling
+// allocates nothing. Initialize it once for the clip with the most channels.
+typedef struct
+{
+    animation_batch translations;
+    animation_batch rotations;
+    animation_batch scales;
+} animation_sampler;
+
+FUNCTION void
+animation_batch_init(animation_batch* batch,
+                     u32 capacity,
+                     pg_scratch_allocator* mem,
+                     pg_error* err)
+{
+    *batch = (animation_batch){0};
+
+    capacity = (capacity + ANIMATION_BATCH_SIZE - 1)
+               & ~(u32)(ANIMATION_BATCH_SIZE - 1);
+    for (u32 k = 0; k < 4; k += 1)
+    {
+        pg_scratch_alloc(mem, capacity * sizeof(f32), 16, &batch->a[k], err);
+        pg_scratch_alloc(mem, capacity * sizeof(f32), 16, &batch->b[k], err);
+    }
+    pg_scratch_alloc(mem, capacity * sizeof(f32), 16, &batch->t, err);
+    pg_scratch_alloc(mem,
+                     capacity * sizeof(u32),
+                     alignof(u32),
+                     &batch->nodes,
+                     err);
+}
+
+FUNCTION void
+animation_sampler_init(animation_sampler* sampler,
+                       u32 channel_capacity,
+                       pg_scratch_allocator* mem,
+                       pg_error* err)
+{
+    animation_batch_init(&sampler->translations, channel_capacity, mem, err);
+    animation_batch_init(&sampler->rotations, channel_capacity, mem, err);
+    animation_batch_init(&sampler->scales, channel_capacity, mem, err);
+}
+
+FUNCTION void
+animation_batch_push(animation_batch* batch,
+                     pg_f32_4x* a,
+                     pg_f32_4x* b,
+                     f32 t,
+                     u32 node)
+{
+    u32 i = batch->count;
+    f32* av = &a->x;
+    f32* bv = &b->x;
+    for (u32 k = 0; k < 4; k += 1)
+    {
+        batch->a[k][i] = av[k];
+        batch->b[k][i] = bv[k];
+    }
+    batch->t[i] = t;
+    batch->nodes[i] = node;
+    batch->count += 1;
+}
+
+// Interpolates 4 lanes from `batch` into `r` (lerp), with one register per
+// component.
+FUNCTION void
+animation_lerp4(animation_batch* batch, u32 i, __m128* r)
+{
+    __m128 t = _mm_loadu_ps(&batch->t[i]);
+    for (u32 k = 0; k < 4; k += 1)
+    {
+        __m128 a = _mm_loadu_ps(&batch->a[k][i]);
+        __m128 b = _mm_loadu_ps(&batch->b[k][i]);
+        r[k] = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+    }
+}
+
+// Interpolates 4 lanes of unit quaternions from `batch` into `r` along the
+// shortest arc.
+FUNCTION void
+animation_slerp4(animation_batch* batch, u32 i, __m128* r)
+{
+    __m128 a[4];
+    __m128 b[4];
+    for (u32 k = 0; k < 4; k += 1)
+    {
+        a[k] = _mm_loadu_ps(&batch->a[k][i]);
+        b[k] = _mm_loadu_ps(&batch->b[k][i]);
+    }
+    __m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]),
+                                     _mm_mul_ps(a[1], b[1])),
+                          _mm_add_ps(_mm_mul_ps(a[2], b[2]),
+                                     _mm_mul_ps(a[3], b[3])));
+
+    // Flip b onto the same hemisphere as a, so the arc is the shorter one.
+    __m128 sign = _mm_and_ps(x, _mm_set1_ps(-0.0f));
+    x = _mm_xor_ps(x, sign);
+    for (u32 k = 0; k < 4; k += 1)
+    {
+        b[k] = _mm_xor_ps(b[k], sign);
+    }
+
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 t = _mm_loadu_ps(&batch->t[i]);
+    __m128 d = _mm_sub_ps(one, t);
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 d2 = _mm_mul_ps(d, d);
+    __m128 xm1 = _mm_sub_ps(x, one);
+    __m128 ct = one;
+    __m128 cd = one;
+    for (s32 j = CAP(animation_slerp_u) - 1; j >= 0; j -= 1)
+    {
+        __m128 uj = _mm_set1_ps(animation_slerp_u[j]);
+        __m128 vj = _mm_set1_ps(animation_slerp_v[j]);
+        __m128 bt = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(uj, t2), vj), xm1);
+        __m128 bd = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(uj, d2), vj), xm1);
+        ct = _mm_add_ps(one, _mm_mul_ps(bt, ct));
+        cd = _mm_add_ps(one, _mm_mul_ps(bd, cd));
+    }
+    ct = _mm_mul_ps(t, ct);
+    cd = _mm_mul_ps(d, cd);
+
+    for (u32 k = 0; k < 4; k += 1)
+    {
+        r[k] = _mm_add_ps(_mm_mul_ps(a[k], cd), _mm_mul_ps(b[k], ct));
+    }
+}
+
+// Interpolates every lane of `batch`, stores the first `component_count`
+// components of each result in `components` at the lane's node, and empties
+// the batch.
+// NOTE: The results are already one register per component, which is the
+// pose's layout, so they are scattered without a transpose.
+FUNCTION void
+animation_batch_interpolate(animation_batch* batch,
+                            b8 rotations,
+                            f32** components,
+                            u32 component_count)
+{
+    // NOTE: Padding lanes interpolate zeros, which is harmless.
+    for (u32 i = batch->count; i % ANIMATION_BATCH_SIZE; i += 1)
+    {
+        for (u32 k = 0; k < 4; k += 1)
+        {
+            batch->a[k][i] = 0.0f;
+            batch->b[k][i] = 0.0f;
+        }
+        batch->t[i] = 0.0f;
+    }
+
+    for (u32 i = 0; i < batch->count; i += ANIMATION_BATCH_SIZE)
+    {
+        __m128 r[4];
+        if (rotations)
+        {
+            animation_slerp4(batch, i, r);
+        }
+        else
+        {
+            animation_lerp4(batch, i, r);
+        }
+
+        u32 lane_count = batch->count - i < ANIMATION_BATCH_SIZE
+                             ? batch->count - i
+                             : ANIMATION_BATCH_SIZE;
+        for (u32 k = 0; k < component_count; k += 1)
+        {
+            f32 lanes[ANIMATION_BATCH_SIZE];
+            _mm_storeu_ps(lanes, r[k]);
+            for (u32 l = 0; l < lane_count; l += 1)
+            {
+                components[k][batch->nodes[i + l]] = lanes[l];
+            }
+        }
+    }
+    batch->count = 0;
+}
+
+// Sets every node of `pose` (and its padding) to its rest transform.
+FUNCTION void
+animation_rest_pose(animations* as, animation_pose* pose)
+{
+    u32 padded_count = (as->node_count + ANIMATION_BATCH_SIZE - 1)
+                       & ~(u32)(ANIMATION_BATCH_SIZE - 1);
+    animation_transform identity
+        = {.rotation = {.w = 1.0f}, .scale = {1.0f, 1.0f, 1.0f}};
+    for (u32 i = 0; i < padded_count; i += 1)
+    {
+        animation_transform* t
+            = i < as->node_count ? &as->nodes[i].rest : &identity;
+        f32* rotation = &t->rotation.x;
+        f32* translation = &t->translation.x;
+        f32* scale = &t->scale.x;
+        for (u32 k = 0; k < 4; k += 1)
+        {
+            pose->rotation[k][i] = rotation[k];
+        }
+        for (u32 k = 0; k < 3; k += 1)
+        {
+            pose->translation[k][i] = translation[k];
+            pose->scale[k][i] = scale[k];
+        }
+    }
+}
+
+// Samples `clip_id` at `time` (in seconds) into `pose`, the local transform of
+// every node. Nodes without a channel keep their rest transform.
+// NOTE: Times before the first key or after the last key hold that key.
+FUNCTION void
+animation_sample(animations* as,
+                 u32 clip_id,
+                 f32 time,
+                 animation_cursors* cursors,
+                 animation_sampler* sampler,
+                 animation_pose* pose,
+                 animation_sample_stats* stats)
+{
+    animation_clip* clip = &as->clips[clip_id];
+
+    animation_rest_pose(as, pose);
+
+    // Step each channel's cursor to `time` and queue its two keys.
+    // NOTE: A search is only needed when the cursors belong to another clip
+    // or time went backwards (e.g. the clip looped).
+    b8 search = cursors->clip_id != clip_id || time < cursors->time;
+    for (u32 i = 0; i < clip->channel_count; i += 1)
+    {
+        animation_channel* c = &as->channels[clip->channel_offset + i];
+        f32* times = &as->times[c->key_offset];
+        u32 key = cursors->keys[i];
+        if (search || key >= c->key_count)
+        {
+            key = animation_find_key(times, c->key_count, time);
+            stats->search_count += 1;
+        }
+        else
+        {
+            while (key + 1 < c->key_count && times[key + 1] <= time)
+            {
+                key += 1;
+                stats->advance_count += 1;
+            }
+        }
+        cursors->keys[i] = key;
+
+        u32 next_key = key;
+        f32 t = 0.0f;
+        if (c->interpolation == ANIMATION_INTERPOLATION_LINEAR
+            && key + 1 < c->key_count && time > times[key])
+        {
+            next_key = key + 1;
+            t = (time - times[key]) / (times[next_key] - times[key]);
+        }
+
+        animation_batch* batch = &sampler->scales;
+        if (c->path == ANIMATION_PATH_ROTATION)
+        {
+            batch = &sampler->rotations;
+        }
+        else if (c->path == ANIMATION_PATH_TRANSLATION)
+        {
+            batch = &sampler->translations;
+        }
+        pg_f32_4x a = animation_decode_key(as, c, key);
+        pg_f32_4x b = animation_decode_key(as, c, next_key);
+        animation_batch_push(batch, &a, &b, t, c->node);
+    }
+    cursors->clip_id = clip_id;
+    cursors->time = time;
+    stats->channel_count += clip->channel_count;
+
+    animation_batch_interpolate(&sampler->translations,
+                                false,
+                                pose->translation,
+                                CAP(pose->translation));
+    animation_batch_interpolate(&sampler->rotations,
+                                true,
+                                pose->rotation,
+                                CAP(pose->rotation));
+    animation_batch_interpolate(&sampler->scales,
+                                false,
+                                pose->scale,
+                                CAP(pose->scale));
+}
+
+// Normalized lerp of 4 lanes of quaternions along the shorter arc, one
+// register per component. Unlike slerp, its speed is not constant, but it is
+// close for the small angles between poses being blended and needs no
+// polynomial.
+FUNCTION void
+animation_nlerp4(__m128* a, __m128* b, __m128 t, __m128* r)
+{
+    __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]),
+                                     _mm_mul_ps(a[1], b[1])),
+                          _mm_add_ps(_mm_mul_ps(a[2], b[2]),
+                                     _mm_mul_ps(a[3], b[3])));
+    __m128 sign = _mm_and_ps(d, _mm_set1_ps(-0.0f));
+    for (u32 k = 0; k < 4; k += 1)
+    {
+        __m128 bk = _mm_xor_ps(b[k], sign);
+        r[k] = _mm_add_ps(a[k], _mm_mul_ps(_mm_sub_ps(bk, a[k]), t));
+    }
+
+    __m128 length = _mm_sqrt_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[0], r[0]), _mm_mul_ps(r[1], r[1])),
+                   _mm_add_ps(_mm_mul_ps(r[2], r[2]), _mm_mul_ps(r[3], r[3]))));
+    __m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), length);
+    for (u32 k = 0; k < 4; k += 1)
+    {
+        r[k] = _mm_mul_ps(r[k], scale);
+    }
+}
+
+// Sets `r` to the quaternion products a * b of 4 lanes.
+FUNCTION void
+animation_quaternion_mul4(__m128* a, __m128* b, __m128* r)
+{
+    __m128 x = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(a[3], b[0]),
+                                     _mm_mul_ps(a[0], b[3])),
+                          _mm_sub_ps(_mm_mul_ps(a[2], b[1]),
+                                     _mm_mul_ps(a[1], b[2])));
+    __m128 y = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(a[3], b[1]),
+                                     _mm_mul_ps(a[1], b[3])),
+                          _mm_sub_ps(_mm_mul_ps(a[0], b[2]),
+                                     _mm_mul_ps(a[2], b[0])));
+    __m128 z = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(a[3], b[2]),
+                                     _mm_mul_ps(a[2], b[3])),
+                          _mm_sub_ps(_mm_mul_ps(a[1], b[0]),
+                                     _mm_mul_ps(a[0], b[1])));
+    __m128 w = _mm_sub_ps(_mm_mul_ps(a[3], b[3]),
+                          _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]),
+                                                _mm_mul_ps(a[1], b[1])),
+                                     _mm_mul_ps(a[2], b[2])));
+    r[0] = x;
+    r[1] = y;
+    r[2] = z;
+    r[3] = w;
+}
+
+// Blends `a` into `b` by `weight` (0 is `a`, 1 is `b`) for the first
+// `node_count` nodes, 4 nodes at a time: lerp for translations and scales and
+// nlerp for rotations. `out` may be `a` or `b`.
+FUNCTION void
+animation_blend_poses(animation_pose* a,
+                      animation_pose* b,
+                      f32 weight,
+                      u32 node_count,
+                      animation_pose* out)
+{
+    __m128 w = _mm_set1_ps(weight);
+    for (u32 i = 0; i < node_count; i += ANIMATION_BATCH_SIZE)
+    {
+        for (u32 k = 0; k < 3; k += 1)
+        {
+            __m128 ta = _mm_load_ps(&a->translation[k][i]);
+            __m128 tb = _mm_load_ps(&b->translation[k][i]);
+            __m128 sa = _mm_load_ps(&a->scale[k][i]);
+            __m128 sb = _mm_load_ps(&b->scale[k][i]);
+            _mm_store_ps(&out->translation[k][i],
+                         _mm_add_ps(ta, _mm_mul_ps(_mm_sub_ps(tb, ta), w)));
+            _mm_store_ps(&out->scale[k][i],
+                         _mm_add_ps(sa, _mm_mul_ps(_mm_sub_ps(sb, sa), w)));
+        }
+
+        __m128 qa[4];
+        __m128 qb[4];
+        __m128 r[4];
+        for (u32 k = 0; k < 4; k += 1)
+        {
+            qa[k] = _mm_load_ps(&a->rotation[k][i]);
+            qb[k] = _mm_load_ps(&b->rotation[k][i]);
+        }
+        animation_nlerp4(qa, qb, w, r);
+        for (u32 k = 0; k < 4; k += 1)
+        {
+            _mm_store_ps(&out->rotation[k][i], r[k]);
+        }
+    }
+}
+
+// Adds the difference of `additive` from `reference` to `base`, scaled by
+// `weight`, for the first `node_count` nodes, 4 nodes at a time. Rotations
+// are applied on top (nlerp from identity toward additive * reference^-1,
+// then times base), and translations and scales are offset. `out` may be any
+// of the inputs.
+FUNCTION void
+animation_add_pose(animation_pose* base,
+                   animation_pose* additive,
+                   animation_pose* reference,
+                   f32 weight,
+                   u32 node_count,
+                   animation_pose* out)
+{
+    __m128 w = _mm_set1_ps(weight);
+    __m128 zero = _mm_setzero_ps();
+    __m128 identity[4] = {zero, zero, zero, _mm_set1_ps(1.0f)};
+    for (u32 i = 0; i < node_count; i += ANIMATION_BATCH_SIZE)
+    {
+        for (u32 k = 0; k < 3; k += 1)
+        {
+            __m128 dt = _mm_sub_ps(_mm_load_ps(&additive->translation[k][i]),
+                                   _mm_load_ps(&reference->translation[k][i]));
+            __m128 ds = _mm_sub_ps(_mm_load_ps(&additive->scale[k][i]),
+                                   _mm_load_ps(&reference->scale[k][i]));
+            _mm_store_ps(&out->translation[k][i],
+                         _mm_add_ps(_mm_load_ps(&base->translation[k][i]),
+                                    _mm_mul_ps(dt, w)));
+            _mm_store_ps(&out->scale[k][i],
+                         _mm_add_ps(_mm_load_ps(&base->scale[k][i]),
+                                    _mm_mul_ps(ds, w)));
+        }
+
+        __m128 qa[4];
+        __m128 qr[4];
+        __m128 qb[4];
+        for (u32 k = 0; k < 4; k += 1)
+        {
+            qa[k] = _mm_load_ps(&additive->rotation[k][i]);
+            qr[k] = _mm_load_ps(&reference->rotation[k][i]);
+            qb[k] = _mm_load_ps(&base->rotation[k][i]);
+        }
+        // NOTE: The inverse of a unit quaternion is its conjugate.
+        for (u32 k = 0; k < 3; k += 1)
+        {
+            qr[k] = _mm_xor_ps(qr[k], _mm_set1_ps(-0.0f));
+        }
+        __m128 delta[4];
+        __m128 scaled[4];
+        __m128 r[4];
+        animation_quaternion_mul4(qa, qr, delta);
+        animation_nlerp4(identity, delta, w, scaled);
+        animation_quaternion_mul4(scaled, qb, r);
+        for (u32 k = 0; k < 4; k += 1)
+        {
+            _mm_store_ps(&out->rotation[k][i], r[k]);
+        }
+    }
+}
+
+// Sets `m` to translation * rotation * scale.
+FUNCTION void
+animation_transform_to_matrix(animation_transform* t, pg_f32_4x4* m)
+{
+    f32 x = t->rotation.x;
+    f32 y = t->rotation.y;
+    f32 z = t->rotation.z;
+    f32 w = t->rotation.w;
+    f32* out = (f32*)m;
+
+    // Column 0
+    out[0] = (1.0f - 2.0f * (y * y + z * z)) * t->scale.x;
+    out[1] = (2.0f * (x * y + z * w)) * t->scale.x;
+    out[2] = (2.0f * (x * z - y * w)) * t->scale.x;
+    out[3] = 0.0f;
+    // Column 1
+    out[4] = (2.0f * (x * y - z * w)) * t->scale.y;
+    out[5] = (1.0f - 2.0f * (x * x + z * z)) * t->scale.y;
+    out[6] = (2.0f * (y * z + x * w)) * t->scale.y;
+    out[7] = 0.0f;
+    // Column 2
+    out[8] = (2.0f * (x * z + y * w)) * t->scale.z;
+    out[9] = (2.0f * (y * z - x * w)) * t->scale.z;
+    out[10] = (1.0f - 2.0f * (x * x + y * y)) * t->scale.z;
+    out[11] = 0.0f;
+    // Column 3
+    out[12] = t->translation.x;
+    out[13] = t->translation.y;
+    out[14] = t->translation.z;
+    out[15] = 1.0f;
+}
+
+// Sets `t` to the translation, rotation and scale of `m`.
+// NOTE: `m` must be an affine transform without shear.
+FUNCTION void
+animation_transform_from_matrix(pg_f32_4x4* m, animation_transform* t)
+{
+    f32* in = (f32*)m;
+    *t = (animation_transform){0};
+    t->translation = (pg_f32_3x){in[12], in[13], in[14]};
+
+    f32 scale[3];
+    f32 r[9]; // Rotation, column-major
+    for (u32 c = 0; c < 3; c += 1)
+    {
+        f32* column = &in[c * 4];
+        scale[c] = animation_sqrt(column[0] * column[0]
+                                  + column[1] * column[1]
+                                  + column[2] * column[2]);
+        for (u32 k = 0; k < 3; k += 1)
+        {
+            r[(c * 3) + k] = scale[c] > 0.0f ? column[k] / scale[c] : 0.0f;
+        }
+    }
+    t->scale = (pg_f32_3x){scale[0], scale[1], scale[2]};
+
+    // NOTE: Element (row, col) of the rotation is r[col * 3 + row]. The
+    // largest of w, x, y and z is solved for first, for precision.
+    f32 trace = r[0] + r[4] + r[8];
+    if (trace > 0.0f)
+    {
+        f32 s = 2.0f * animation_sqrt(trace + 1.0f);
+        t->rotation = (pg_f32_4x){(r[5] - r[7]) / s,
+                                  (r[6] - r[2]) / s,
+                                  (r[1] - r[3]) / s,
+                                  0.25f * s};
+    }
+    else if (r[0] > r[4] && r[0] > r[8])
+    {
+        f32 s = 2.0f * animation_sqrt(1.0f + r[0] - r[4] - r[8]);
+        t->rotation = (pg_f32_4x){0.25f * s,
+                                  (r[3] + r[1]) / s,
+                                  (r[6] + r[2]) / s,
+                                  (r[5] - r[7]) / s};
+    }
+    else if (r[4] > r[8])
+    {
+        f32 s = 2.0f * animation_sqrt(1.0f + r[4] - r[0] - r[8]);
+        t->rotation = (pg_f32_4x){(r[3] + r[1]) / s,
+                                  0.25f * s,
+                                  (r[7] + r[5]) / s,
+                                  (r[6] - r[2]) / s};
+    }
+    else
+    {
+        f32 s = 2.0f * animation_sqrt(1.0f + r[8] - r[0] - r[4]);
+        t->rotation = (pg_f32_4x){(r[6] + r[2]) / s,
+                                  (r[7] + r[5]) / s,
+                                  0.25f * s,
+                                  (r[1] - r[3]) / s};
+    }
+}
+
+// Sets `out` to a * b.
+FUNCTION void
+animation_matrix_mul(pg_f32_4x4* a, pg_f32_4x4* b, pg_f32_4x4* out)
+{
+    f32* am = (f32*)a;
+    f32* bm = (f32*)b;
+    f32* om = (f32*)out;
+    __m128 columns[4] = {_mm_loadu_ps(&am[0]),
+                         _mm_loadu_ps(&am[4]),
+                         _mm_loadu_ps(&am[8]),
+                         _mm_loadu_ps(&am[12])};
+    for (u32 c = 0; c < 4; c += 1)
+    {
+        f32* bc = &bm[c * 4];
+        __m128 result = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(columns[0], _mm_set1_ps(bc[0])),
+                       _mm_mul_ps(columns[1], _mm_set1_ps(bc[1]))),
+            _mm_add_ps(_mm_mul_ps(columns[2], _mm_set1_ps(bc[2])),
+                       _mm_mul_ps(columns[3], _mm_set1_ps(bc[3]))));
+        _mm_storeu_ps(&om[c * 4], result);
+    }
+}
+
+// Writes each joint's transform to `joint_transforms`, from the global
+// transforms of the nodes in `globals`.
+FUNCTION void
+animation_joint_transforms(animations* as,
+                           pg_f32_4x4* globals,
+                           pg_f32_4x4* joint_transforms)
+{
+    for (u32 i = 0; i < as->joint_count; i += 1)
+    {
+        animation_joint* j = &as->joints[i];
+        animation_matrix_mul(&globals[j->node],
+                             &j->inverse_bind,
+                             &joint_transforms[i]);
+    }
+}
+
+// Builds the global transform of every node from `pose` into `globals`, then
+// writes each joint's transform to `joint_transforms`.
+FUNCTION void
+animation_build_joint_transforms(animations* as,
+                                 animation_pose* pose,
+                                 pg_f32_4x4* globals,
+                                 pg_f32_4x4* joint_transforms)
+{
+    for (u32 i = 0; i < as->node_count; i += 1)
+    {
+        animation_transform t = {
+            .rotation = {pose->rotation[0][i],
+                         pose->rotation[1][i],
+                         pose->rotation[2][i],
+                         pose->rotation[3][i]},
+            .translation = {pose->translation[0][i],
+                            pose->translation[1][i],
+                            pose->translation[2][i]},
+            .scale = {pose->scale[0][i], pose->scale[1][i], pose->scale[2][i]}};
+
+        u32 parent = as->nodes[i].parent;
+        if (parent == ANIMATION_NO_PARENT)
+        {
+            animation_transform_to_matrix(&t, &globals[i]);
+        }
+        else
+        {
+            pg_f32_4x4 local;
+            animation_transform_to_matrix(&t, &local);
+            animation_matrix_mul(&globals[parent], &local, &globals[i]);
+        }
+    }
+
+    animation_joint_transforms(as, globals, joint_transforms);
+}
+
+// Samples every layer of `layers` with its cursors and blends and adds the
+// layers into one pose, which the caller releases to `pool`. Returns 0 if BASE
+// has no clip or `pool` ran out of poses.
+// NOTE: `pool` needs a pose per layer, for at least `as->node_count` nodes.
+FUNCTION animation_pose*
+animation_blend_layers(animations* as,
+                       animation_layers* layers,
+                       animation_cursors* cursors,
+                       animation_sampler* sampler,
+                       animation_pose_pool* pool,
+                       animation_sample_stats* stats)
+{
+    if (layers->clip_ids[ANIMATION_LAYER_BASE] >= as->clip_count)
+    {
+        return 0;
+    }
+
+    b8 result = true;
+    animation_pose* poses[ANIMATION_LAYER_COUNT] = {0};
+    for (u32 l = 0; l < ANIMATION_LAYER_COUNT; l += 1)
+    {
+        u32 clip_id = layers->clip_ids[l];
+        if (clip_id >= as->clip_count)
+        {
+            continue;
+        }
+
+        poses[l] = animation_pose_acquire(pool);
+        if (!poses[l])
+        {
+            result = false;
+            break;
+        }
+        animation_sample(as,
+                         clip_id,
+                         layers->times[l],
+                         &cursors[l],
+                         sampler,
+                         poses[l],
+                         stats);
+    }
+
+    animation_pose* pose = poses[ANIMATION_LAYER_BASE];
+    if (result)
+    {
+        if (poses[ANIMATION_LAYER_FADE])
+        {
+            animation_blend_poses(poses[ANIMATION_LAYER_FADE],
+                                  pose,
+                                  layers->fade_weight,
+                                  as->node_count,
+                                  pose);
+            stats->blend_count += 1;
+        }
+        if (poses[ANIMATION_LAYER_ADDITIVE] && poses[ANIMATION_LAYER_REFERENCE])
+        {
+            animation_add_pose(pose,
+                               poses[ANIMATION_LAYER_ADDITIVE],
+                               poses[ANIMATION_LAYER_REFERENCE],
+                               layers->additive_weight,
+                               as->node_count,
+                               pose);
+            stats->blend_count += 1;
+        }
+    }
+
+    for (u32 l = 0; l < ANIMATION_LAYER_COUNT; l += 1)
+    {
+        if (poses[l] && (!result || l != ANIMATION_LAYER_BASE))
+        {
+            animation_pose_release(pool, poses[l]);
+        }
+    }
+
+    return result ? pose : 0;
+}
+
+// Blends the layers of `layers` (see `animation_blend_layers`), then builds the
+// joint transforms from the result in one pass over the hierarchy. Returns
+// false if no pose was blended.
+FUNCTION b8
+animation_evaluate(animations* as,
+                   animation_layers* layers,
+                   animation_cursors* cursors,
+                   animation_sampler* sampler,
+                   animation_pose_pool* pool,
+                   pg_f32_4x4* globals,
+                   pg_f32_4x4* joint_transforms,
+                   animation_sample_stats* stats)
+{
+    animation_pose* pose
+        = animation_blend_layers(as, layers, cursors, sampler, pool, stats);
+    if (!pose)
+    {
+        return false;
+    }
+
+    animation_build_joint_transforms(as, pose, globals, joint_transforms);
+    animation_pose_release(pool, pose);
+
+    return true;
+}
+
+// Returns the largest difference between matching elements of `a` and `b`,
+// relative to the magnitude of the element in `b` (or absolute below 1).
+FUNCTION f32
+animation_max_joint_error(pg_f32_4x4* a, pg_f32_4x4* b, u32 joint_count)
+{
+    f32 max_error = 0.0f;
+    f32* am = (f32*)a;
+    f32* bm = (f32*)b;
+    for (u32 i = 0; i < joint_count * 16; i += 1)
+    {
+        f32 difference = am[i] - bm[i];
+        f32 magnitude = bm[i] < 0.0f ? -bm[i] : bm[i];
+        f32 error = (difference < 0.0f ? -difference : difference)
+                    / (magnitude > 1.0f ? magnitude : 1.0f);
+        max_error = error > max_error ? error : max_error;
+    }
+
+    return max_error;
+}
+
+// Returns how far apart `a` and `b` are: the distance between vectors, or
+// about the angle in radians between rotations.
+// NOTE: For unit quaternions, |a - b| is 2 sin(θ / 4) for a rotation of θ
+// between them, which unlike the dot product keeps its precision for small
+// angles.
+FUNCTION f32
+animation_key_error(pg_f32_4x a, pg_f32_4x b, b8 rotation)
+{
+    f32* av = &a.x;
+    f32* bv = &b.x;
+    f32 sign = 1.0f;
+    if (rotation)
+    {
+        f32 x = (av[0] * bv[0]) + (av[1] * bv[1]) + (av[2] * bv[2])
+                + (av[3] * bv[3]);
+        sign = x < 0.0f ? -1.0f : 1.0f;
+    }
+
+    f32 sum = 0.0f;
+    for (u32 k = 0; k < (rotation ? 4u : 3u); k += 1)
+    {
+        f32 d = av[k] - (sign * bv[k]);
+        sum += d * d;
+    }
+
+    return (rotation ? 2.0f : 1.0f) * animation_sqrt(sum);
+}
+
+// Picks the keys of a channel to keep, writing their ids to `kept` and
+// returning how many there are. Every dropped key of `raw` is within
+// `tolerance` of the kept keys of `decoded` (the keys as they will be
+// stored) interpolated at its time. The first and last keys are always kept.
+// NOTE: Keys are dropped greedily, extending the span from the last kept key
+// for as long as every key inside it still fits.
+FUNCTION u32
+animation_reduce_keys(f32* times,
+                      pg_f32_4x* raw,
+                      pg_f32_4x* decoded,
+                      u32 key_count,
+                      b8 rotation,
+                      b8 step,
+                      f32 tolerance,
+                      u32* kept)
+{
+    kept[0] = 0;
+    u32 kept_count = 1;
+    u32 anchor = 0;
+    for (u32 end = 2; end < key_count; end += 1)
+    {
+        b8 fits = true;
+        for (u32 i = anchor + 1; fits && i < end; i += 1)
+        {
+            f32 t = (times[i] - times[anchor]) / (times[end] - times[anchor]);
+            pg_f32_4x value = step ? decoded[anchor]
+                                   : animation_interpolate(decoded[anchor],
+                                                           decoded[end],
+                                                           t,
+                                                           rotation);
+            fits = animation_key_error(value, raw[i], rotation) <= tolerance;
+        }
+        if (!fits)
+        {
+            anchor = end - 1;
+            kept[kept_count] = anchor;
+            kept_count += 1;
+        }
+    }
+    if (key_count > 1)
+    {
+        kept[kept_count] = key_count - 1;
+        kept_count += 1;
+    }
+
+    return kept_count;
+}
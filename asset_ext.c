@@ -0,0 +1,122 @@
+// Asset extension file (.pgx)
+//
+// Pack-time data that has no place in the .pga format is written by the packer
+// to a separate file as typed sections, each belonging to one model. The file
+// is memory-mapped and sections are used in place, so e.g. a compact vertex
+// stream can be handed to the renderer without a copy.
+//
+// NOTE: Requires file_map.c.
+// NOTE: Sections are derived from the same .glb sources as the .pga, so each
+// section records the counts it was built against and the runtime ignores
+// sections that do not match the loaded model.
+
+#define ASSET_EXT_FILE_NAME "assets.pgx"
+#define ASSET_EXT_MAGIC 0x58414750 // "PGAX"
+#define ASSET_EXT_VERSION 2
+#define ASSET_EXT_ALIGNMENT 16
+
+typedef enum
+{
+    ASSET_EXT_SECTION_NONE,
+    ASSET_EXT_SECTION_COMPACT_VERTICES,
+    ASSET_EXT_SECTION_INDICES,
+    ASSET_EXT_SECTION_MESHLETS,
+    ASSET_EXT_SECTION_BOUNDS,
+    ASSET_EXT_SECTION_LODS,
+    ASSET_EXT_SECTION_ANIMATIONS,
+    ASSET_EXT_SECTION_SCENE,
+    ASSET_EXT_SECTION_TEXTURES,
+    ASSET_EXT_SECTION_COUNT
+} asset_ext_section_type;
+
+typedef struct
+{
+    u32 magic;
+    u32 version;
+    u32 section_count;
+    u32 padding0;
+} asset_ext_header;
+
+// NOTE: `offset` is from the start of the file and is a multiple of
+// ASSET_EXT_ALIGNMENT.
+typedef struct
+{
+    u32 type;
+    u32 model_id;
+    u64 offset;
+    u64 size;
+} asset_ext_section;
+
+typedef struct
+{
+    file_view view;
+    asset_ext_section* sections;
+    u32 section_count;
+} asset_ext;
+
+// NOTE: The extension file is optional. If it is missing, every lookup fails
+// and callers fall back to the .pga data.
+FUNCTION b8
+asset_ext_open(c8* path, asset_ext* ext, pg_error* err)
+{
+    *ext = (asset_ext){0};
+
+    if (!file_map(path, &ext->view, err))
+    {
+        return false;
+    }
+
+    asset_ext_header* header = (asset_ext_header*)ext->view.data;
+    if (ext->view.size < sizeof(asset_ext_header)
+        || header->magic != ASSET_EXT_MAGIC
+        || header->version != ASSET_EXT_VERSION
+        || ext->view.size < sizeof(asset_ext_header)
+                                + (header->section_count
+                                   * sizeof(asset_ext_section)))
+    {
+        PG_ERROR_MINOR("invalid asset extension file");
+        file_unmap(&ext->view);
+        return false;
+    }
+
+    ext->section_count = header->section_count;
+    ext->sections
+        = (asset_ext_section*)(ext->view.data + sizeof(asset_ext_header));
+
+    for (u32 i = 0; i < ext->section_count; i += 1)
+    {
+        asset_ext_section* s = &ext->sections[i];
+        if (s->offset % ASSET_EXT_ALIGNMENT
+            || s->offset + s->size > ext->view.size)
+        {
+            PG_ERROR_MINOR("invalid asset extension section");
+            file_unmap(&ext->view);
+            *ext = (asset_ext){0};
+            return false;
+        }
+    }
+
+    return true;
+}
+
+FUNCTION void*
+asset_ext_find(asset_ext* ext,
+               asset_ext_section_type type,
+               u32 model_id,
+               u64* size)
+{
+    for (u32 i = 0; i < ext->section_count; i += 1)
+    {
+        asset_ext_section* s = &ext->sections[i];
+        if (s->type == type && s->model_id == model_id)
+        {
+            if (size)
+            {
+                *size = s->size;
+            }
+            return ext->view.data + s->offset;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,343 @@
+// Asynchronous asset loading
+//
+// Loader threads that run asset loads (file reads and decoding) off the
+// frame. Loads are submitted to a bounded request queue, loader threads take
+// them in submission order, and each finished load is pushed to a completion
+// queue that the submitting thread drains, e.g. a few per frame. A load's
+// results are only handed over through its completion, so the thread that
+// takes it sees everything the load wrote.
+//
+// NOTE: Loads are submitted and their completions taken by one thread, which
+// alone tracks how many are in flight. At most ASSET_LOADER_QUEUE_CAPACITY
+// are, so neither queue can overflow.
+// NOTE: With no loader threads (or if none start), loads run as they are
+// submitted, and complete in the same order.
+
+#if defined(LINUX)
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+
+#define ASSET_LOADER_MAX_THREAD_COUNT 8
+#define ASSET_LOADER_QUEUE_CAPACITY 16
+
+typedef void (*asset_load_fp)(void* data, u32 id, pg_error* err);
+
+typedef struct
+{
+    asset_load_fp fp;
+    void* data;
+    u32 id;
+} asset_load;
+
+typedef struct
+{
+    asset_load loads[ASSET_LOADER_QUEUE_CAPACITY];
+    u32 first;
+    u32 count;
+} asset_load_queue;
+
+typedef struct asset_loader asset_loader;
+
+// NOTE: Each loader thread logs errors through its own copy of the error
+// passed to `asset_loader_init`.
+typedef struct
+{
+    asset_loader* loader;
+    pg_error error;
+} asset_loader_thread;
+
+struct asset_loader
+{
+    asset_load_queue requests;
+    asset_load_queue completions;
+    u32 in_flight_count; // Submitted and not yet taken
+    u32 thread_count;
+    b8 quit;
+    asset_loader_thread thread_data[ASSET_LOADER_MAX_THREAD_COUNT];
+#if defined(LINUX)
+    pthread_mutex_t mutex; // Of both queues and `quit`
+    sem_t requested;       // Posted per request and per thread on quit
+    sem_t completed;       // Posted per completion
+    pthread_t threads[ASSET_LOADER_MAX_THREAD_COUNT];
+#elif defined(WINDOWS)
+    SRWLOCK lock;
+    HANDLE requested;
+    HANDLE completed;
+    HANDLE threads[ASSET_LOADER_MAX_THREAD_COUNT];
+#endif
+};
+
+FUNCTION void
+asset_load_queue_push(asset_load_queue* q, asset_load* load)
+{
+    q->loads[(q->first + q->count) % ASSET_LOADER_QUEUE_CAPACITY] = *load;
+    q->count += 1;
+}
+
+FUNCTION void
+asset_load_queue_pop(asset_load_queue* q, asset_load* load)
+{
+    *load = q->loads[q->first];
+    q->first = (q->first + 1) % ASSET_LOADER_QUEUE_CAPACITY;
+    q->count -= 1;
+}
+
+FUNCTION void
+asset_loader_lock(asset_loader* loader)
+{
+#if defined(LINUX)
+    pthread_mutex_lock(&loader->mutex);
+#elif defined(WINDOWS)
+    AcquireSRWLockExclusive(&loader->lock);
+#endif
+}
+
+FUNCTION void
+asset_loader_unlock(asset_loader* loader)
+{
+#if defined(LINUX)
+    pthread_mutex_unlock(&loader->mutex);
+#elif defined(WINDOWS)
+    ReleaseSRWLockExclusive(&loader->lock);
+#endif
+}
+
+FUNCTION void
+asset_loader_post_completion(asset_loader* loader, asset_load* load)
+{
+    asset_loader_lock(loader);
+    asset_load_queue_push(&loader->completions, load);
+    asset_loader_unlock(loader);
+#if defined(LINUX)
+    sem_post(&loader->completed);
+#elif defined(WINDOWS)
+    ReleaseSemaphore(loader->completed, 1, 0);
+#endif
+}
+
+FUNCTION void
+asset_loader_loop(asset_loader_thread* thread)
+{
+    asset_loader* loader = thread->loader;
+    for (;;)
+    {
+#if defined(LINUX)
+        sem_wait(&loader->requested);
+#elif defined(WINDOWS)
+        WaitForSingleObject(loader->requested, INFINITE);
+#endif
+
+        asset_load load = {0};
+        asset_loader_lock(loader);
+        b8 quit = loader->quit && !loader->requests.count;
+        if (loader->requests.count)
+        {
+            asset_load_queue_pop(&loader->requests, &load);
+        }
+        asset_loader_unlock(loader);
+
+        if (quit)
+        {
+            break;
+        }
+        if (load.fp)
+        {
+            load.fp(load.data, load.id, &thread->error);
+            asset_loader_post_completion(loader, &load);
+        }
+    }
+}
+
+#if defined(LINUX)
+FUNCTION void*
+asset_loader_thread_main(void* data)
+{
+    asset_loader_loop(data);
+    return 0;
+}
+#elif defined(WINDOWS)
+FUNCTION DWORD WINAPI
+asset_loader_thread_main(LPVOID data)
+{
+    asset_loader_loop(data);
+    return 0;
+}
+#endif
+
+// NOTE: The loader must not move while its threads run, since they refer to
+// it.
+FUNCTION b8
+asset_loader_init(asset_loader* loader, u32 thread_count, pg_error* err)
+{
+    *loader = (asset_loader){0};
+
+    if (thread_count > ASSET_LOADER_MAX_THREAD_COUNT)
+    {
+        thread_count = ASSET_LOADER_MAX_THREAD_COUNT;
+    }
+
+#if defined(LINUX)
+    if (pthread_mutex_init(&loader->mutex, 0)
+        || sem_init(&loader->requested, 0, 0)
+        || sem_init(&loader->completed, 0, 0))
+    {
+        PG_ERROR_MAJOR("failed to create asset loader queues");
+        return false;
+    }
+#elif defined(WINDOWS)
+    InitializeSRWLock(&loader->lock);
+    loader->requested = CreateSemaphoreW(0,
+                                         0,
+                                         ASSET_LOADER_QUEUE_CAPACITY
+                                             + ASSET_LOADER_MAX_THREAD_COUNT,
+                                         0);
+    loader->completed
+        = CreateSemaphoreW(0, 0, ASSET_LOADER_QUEUE_CAPACITY, 0);
+    if (!loader->requested || !loader->completed)
+    {
+        PG_ERROR_MAJOR("failed to create asset loader queues");
+        return false;
+    }
+#endif
+
+    // NOTE: Threads that fail to start are left out, like job workers.
+    for (u32 i = 0; i < thread_count; i += 1)
+    {
+        asset_loader_thread* t = &loader->thread_data[i];
+        *t = (asset_loader_thread){.loader = loader, .error = *err};
+#if defined(LINUX)
+        if (pthread_create(&loader->threads[i],
+                           0,
+                           &asset_loader_thread_main,
+                           t))
+        {
+            break;
+        }
+#elif defined(WINDOWS)
+        loader->threads[i]
+            = CreateThread(0, 0, &asset_loader_thread_main, t, 0, 0);
+        if (!loader->threads[i])
+        {
+            break;
+        }
+#endif
+        loader->thread_count += 1;
+    }
+
+    return true;
+}
+
+// Waits for the loads in flight to finish, then stops the loader threads.
+FUNCTION void
+asset_loader_release(asset_loader* loader)
+{
+    asset_loader_lock(loader);
+    loader->quit = true;
+    asset_loader_unlock(loader);
+    for (u32 i = 0; i < loader->thread_count; i += 1)
+    {
+#if defined(LINUX)
+        sem_post(&loader->requested);
+#elif defined(WINDOWS)
+        ReleaseSemaphore(loader->requested, 1, 0);
+#endif
+    }
+    for (u32 i = 0; i < loader->thread_count; i += 1)
+    {
+#if defined(LINUX)
+        pthread_join(loader->threads[i], 0);
+#elif defined(WINDOWS)
+        WaitForSingleObject(loader->threads[i], INFINITE);
+        CloseHandle(loader->threads[i]);
+#endif
+    }
+
+#if defined(LINUX)
+    sem_destroy(&loader->completed);
+    sem_destroy(&loader->requested);
+    pthread_mutex_destroy(&loader->mutex);
+#elif defined(WINDOWS)
+    CloseHandle(loader->completed);
+    CloseHandle(loader->requested);
+#endif
+    *loader = (asset_loader){0};
+}
+
+FUNCTION b8
+asset_loader_full(asset_loader* loader)
+{
+    return loader->in_flight_count == ASSET_LOADER_QUEUE_CAPACITY;
+}
+
+// Returns false if the loader is full.
+FUNCTION b8
+asset_loader_submit(asset_loader* loader,
+                    asset_load_fp fp,
+                    void* data,
+                    u32 id,
+                    pg_error* err)
+{
+    if (asset_loader_full(loader))
+    {
+        return false;
+    }
+    loader->in_flight_count += 1;
+
+    asset_load load = {.fp = fp, .data = data, .id = id};
+    if (!loader->thread_count)
+    {
+        fp(data, id, err);
+        asset_loader_post_completion(loader, &load);
+        return true;
+    }
+
+    asset_loader_lock(loader);
+    asset_load_queue_push(&loader->requests, &load);
+    asset_loader_unlock(loader);
+#if defined(LINUX)
+    sem_post(&loader->requested);
+#elif defined(WINDOWS)
+    ReleaseSemaphore(loader->requested, 1, 0);
+#endif
+
+    return true;
+}
+
+// Takes the next completed load, waiting for one if `wait` is set. Returns
+// false if none has completed (or none is in flight to wait for).
+FUNCTION b8
+asset_loader_take(asset_loader* loader, b8 wait, asset_load* load)
+{
+    if (!loader->in_flight_count)
+    {
+        return false;
+    }
+
+#if defined(LINUX)
+    if (wait)
+    {
+        while (sem_wait(&loader->completed))
+        {
+            // NOTE: Retry if interrupted by a signal.
+        }
+    }
+    else if (sem_trywait(&loader->completed))
+    {
+        return false;
+    }
+#elif defined(WINDOWS)
+    if (WaitForSingleObject(loader->completed, wait ? INFINITE : 0)
+        != WAIT_OBJECT_0)
+    {
+        return false;
+    }
+#endif
+
+    asset_loader_lock(loader);
+    asset_load_queue_pop(&loader->completions, load);
+    asset_loader_unlock(loader);
+    loader->in_flight_count -= 1;
+
+    return true;
+}
@@ -0,0 +1,3054 @@
+#define APP_NAME "Asset Packer"
+
+#if defined(LINUX)
+#include "linux_platform.c"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#else
+static_assert(0, "no supported platform is defined");
+#endif
+
+#include "file_map.c"
+#include "asset_loader.c"
+#include "glb.c"
+#include "model_pager.c"
+#include "asset_ext.c"
+#include "compact_vertex.c"
+#include "mesh_optimize.c"
+#include "frustum.c"
+#include "meshlet.c"
+#include "bounds.c"
+#include "lod.c"
+#include "animation.c"
+#include "scene.c"
+#include "image.c"
+#include "texture_bake.c"
+
+// NOTE: Bump when the packer output changes so that stale cache entries are
+// never reused.
+#define PACKER_VERSION 15
+#define PACKER_CACHE_MAGIC 0x4D474350 // "PCGM"
+#define PACKER_MAX_PATH 1024
+#define PACKER_TEXTURE_MEM_SIZE PG_MEBIBYTE(512)
+#define PACKER_TEXTURE_ROW_BATCH_SIZE 4
+
+typedef enum
+{
+    PACKER_FLAG_COMPACT_VERTICES = 1 << 0,
+    PACKER_FLAG_OPTIMIZE_MESHES = 1 << 1,
+    PACKER_FLAG_MESHLETS = 1 << 2,
+    PACKER_FLAG_BOUNDS = 1 << 3,
+    PACKER_FLAG_LODS = 1 << 4,
+    PACKER_FLAG_ANIMATIONS = 1 << 5,
+    PACKER_FLAG_COMPRESS_ANIMATIONS = 1 << 6,
+    PACKER_FLAG_SCENE = 1 << 7,
+    PACKER_FLAG_TEXTURES = 1 << 8,
+} packer_flag;
+
+typedef struct
+{
+    u32 version;
+    u32 flags;
+} packer_settings;
+
+// NOTE: A cache entry is this header, then the extension sections in type
+// order.
+typedef struct
+{
+    u32 magic;
+    u32 version;
+    u64 key;
+    u64 ext_sizes[ASSET_EXT_SECTION_COUNT];
+    compact_vertex_error compact_error;
+    mesh_stats mesh_stats_before;
+    mesh_stats mesh_stats_after;
+} packer_cache_header;
+
+typedef enum
+{
+    PACKER_RESULT_NONE,
+    PACKER_RESULT_CACHED,
+    PACKER_RESULT_PACKED,
+    PACKER_RESULT_FAILED
+} packer_result;
+
+typedef struct
+{
+    c8* path;
+    u64 key;
+    u8* ext[ASSET_EXT_SECTION_COUNT];
+    usize ext_sizes[ASSET_EXT_SECTION_COUNT];
+    compact_vertex_error compact_error;
+    mesh_stats mesh_stats_before;
+    mesh_stats mesh_stats_after;
+    f64 time; // ms
+    packer_result result;
+} packer_model;
+
+typedef struct
+{
+    packer_settings settings;
+    c8* cache_dir;
+    packer_model* models;
+    u32 model_count;
+    u32 next_model;
+    usize worker_mem_size;
+    u32 texture_thread_count;
+    pthread_mutex_t mutex;
+} packer_state;
+
+typedef struct
+{
+    texture_bake* bake;
+    u32 next_row;
+    pthread_mutex_t mutex;
+} packer_texture_job;
+
+GLOBAL c8* packer_result_names[] = {"none", "cached", "packed", "FAILED"};
+
+FUNCTION f64
+packer_get_time(void)
+{
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((f64)ts.tv_sec * 1000.0) + ((f64)ts.tv_nsec / 1000000.0);
+}
+
+// 64-bit content hash, processed a word at a time so that hashing a
+// multi-hundred-MB source is cheap relative to packing it.
+FUNCTION u64
+packer_hash(u8* data, usize size, u64 seed)
+{
+    u64 m = 0xC6A4A7935BD1E995ull;
+    u64 h = seed ^ (size * m);
+
+    usize word_count = size / sizeof(u64);
+    for (usize i = 0; i < word_count; i += 1)
+    {
+        u64 k = 0;
+        for (u32 b = 0; b < sizeof(u64); b += 1)
+        {
+            k |= (u64)data[(i * sizeof(u64)) + b] << (b * 8);
+        }
+        k *= m;
+        k ^= k >> 47;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+
+    u64 tail = 0;
+    for (usize b = word_count * sizeof(u64); b < size; b += 1)
+    {
+        tail |= (u64)data[b] << ((b % sizeof(u64)) * 8);
+    }
+    h ^= tail;
+    h *= m;
+
+    h ^= h >> 47;
+    h *= m;
+    h ^= h >> 47;
+
+    return h;
+}
+
+FUNCTION void
+packer_cache_path(c8* cache_dir, u64 key, c8* path, usize path_size)
+{
+    snprintf(path,
+             path_size,
+             "%s/%016llx.pgm",
+             cache_dir,
+             (unsigned long long)key);
+}
+
+FUNCTION b8
+packer_write_file(c8* path,
+                  void** parts,
+                  usize* part_sizes,
+                  u32 part_count)
+{
+    // NOTE: Write to a temporary file and rename so that an interrupted pack
+    // never leaves a truncated file behind.
+    c8 tmp_path[PACKER_MAX_PATH] = {0};
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* file = fopen(tmp_path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    b8 ok = true;
+    for (u32 i = 0; ok && i < part_count; i += 1)
+    {
+        ok = !part_sizes[i]
+             || fwrite(parts[i], 1, part_sizes[i], file) == part_sizes[i];
+    }
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok || rename(tmp_path, path) != 0)
+    {
+        remove(tmp_path);
+        return false;
+    }
+
+    return true;
+}
+
+// NOTE: Sections are heap-allocated so that they outlive the worker arena until
+// the write step.
+FUNCTION b8
+packer_read_cache(c8* path, packer_model* pm)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    packer_cache_header header = {0};
+    b8 ok = fread(&header, sizeof(header), 1, file) == 1
+            && header.magic == PACKER_CACHE_MAGIC
+            && header.version == PACKER_VERSION && header.key == pm->key;
+    for (u32 i = 0; ok && i < ASSET_EXT_SECTION_COUNT; i += 1)
+    {
+        if (header.ext_sizes[i])
+        {
+            pm->ext[i] = malloc(header.ext_sizes[i]);
+            ok = pm->ext[i]
+                 && fread(pm->ext[i], 1, header.ext_sizes[i], file)
+                        == header.ext_sizes[i];
+            pm->ext_sizes[i] = header.ext_sizes[i];
+        }
+    }
+    pm->compact_error = header.compact_error;
+    pm->mesh_stats_before = header.mesh_stats_before;
+    pm->mesh_stats_after = header.mesh_stats_after;
+
+    fclose(file);
+
+    return ok;
+}
+
+// NOTE: Overdraw optimization is skipped for blended primitives (their
+// triangle order is visible), and its result is only kept if it measurably
+// reduces overdraw at a cost of at most 5% ACMR.
+// Vertices are only renumbered if they are also written as compact vertices,
+// because the .pga vertices keep their order.
+FUNCTION b8
+packer_optimize_meshes(glb_file* glb,
+                       glb_model* model,
+                       b8 remap_vertices,
+                       pg_scratch_allocator* mem,
+                       packer_model* pm,
+                       pg_error* err)
+{
+    u32 vertex_size = remap_vertices ? sizeof(compact_vertex) : sizeof(pg_vertex);
+
+    PG_GRAPHICS_INDEX_TYPE* indices;
+    pg_scratch_alloc(mem,
+                     model->index_count * sizeof(PG_GRAPHICS_INDEX_TYPE),
+                     alignof(PG_GRAPHICS_INDEX_TYPE),
+                     &indices,
+                     err);
+    pg_vertex* vertices = model->vertices;
+    if (remap_vertices)
+    {
+        pg_scratch_alloc(mem,
+                         model->vertex_count * sizeof(pg_vertex),
+                         alignof(pg_vertex),
+                         &vertices,
+                         err);
+    }
+    PG_GRAPHICS_INDEX_TYPE* cache_indices;
+    PG_GRAPHICS_INDEX_TYPE* overdraw_indices;
+    u32* remap;
+    pg_scratch_alloc(mem,
+                     model->index_count * sizeof(PG_GRAPHICS_INDEX_TYPE),
+                     alignof(PG_GRAPHICS_INDEX_TYPE),
+                     &cache_indices,
+                     err);
+    pg_scratch_alloc(mem,
+                     model->index_count * sizeof(PG_GRAPHICS_INDEX_TYPE),
+                     alignof(PG_GRAPHICS_INDEX_TYPE),
+                     &overdraw_indices,
+                     err);
+    pg_scratch_alloc(mem,
+                     model->vertex_count * sizeof(u32),
+                     alignof(u32),
+                     &remap,
+                     err);
+
+    pm->mesh_stats_before = (mesh_stats){0};
+    pm->mesh_stats_after = (mesh_stats){0};
+    for (u32 i = 0; i < model->primitive_count; i += 1)
+    {
+        glb_primitive* p = &model->primitives[i];
+        PG_GRAPHICS_INDEX_TYPE* in = &model->indices[p->index_offset];
+        PG_GRAPHICS_INDEX_TYPE* out = &indices[p->index_offset];
+        pg_vertex* in_vertices = &model->vertices[p->vertex_offset];
+
+        mesh_analyze(in_vertices,
+                     in,
+                     p->index_count,
+                     p->vertex_count,
+                     vertex_size,
+                     mem,
+                     &pm->mesh_stats_before,
+                     err);
+
+        PG_GRAPHICS_INDEX_TYPE* best = in;
+        if (p->index_count % 3 == 0)
+        {
+            mesh_optimize_vertex_cache(in,
+                                       p->index_count,
+                                       p->vertex_count,
+                                       &cache_indices[p->index_offset],
+                                       mem,
+                                       err);
+            best = &cache_indices[p->index_offset];
+
+            if (!glb_material_is_blended(glb, p->material_id))
+            {
+                mesh_optimize_overdraw(in_vertices,
+                                       best,
+                                       p->index_count,
+                                       p->vertex_count,
+                                       &overdraw_indices[p->index_offset],
+                                       mem,
+                                       err);
+
+                mesh_stats cache_stats = {0};
+                mesh_stats overdraw_stats = {0};
+                mesh_analyze(in_vertices,
+                             best,
+                             p->index_count,
+                             p->vertex_count,
+                             vertex_size,
+                             mem,
+                             &cache_stats,
+                             err);
+                mesh_analyze(in_vertices,
+                             &overdraw_indices[p->index_offset],
+                             p->index_count,
+                             p->vertex_count,
+                             vertex_size,
+                             mem,
+                             &overdraw_stats,
+                             err);
+                if (mesh_stats_overdraw(&overdraw_stats)
+                        < mesh_stats_overdraw(&cache_stats)
+                    && mesh_stats_acmr(&overdraw_stats)
+                           <= mesh_stats_acmr(&cache_stats) * 1.05f)
+                {
+                    best = &overdraw_indices[p->index_offset];
+                }
+            }
+        }
+        for (u32 j = 0; j < p->index_count; j += 1)
+        {
+            out[j] = best[j];
+        }
+
+        pg_vertex* out_vertices = in_vertices;
+        if (remap_vertices)
+        {
+            mesh_optimize_vertex_fetch(out, p->index_count, p->vertex_count, remap);
+            out_vertices = &vertices[p->vertex_offset];
+            for (u32 j = 0; j < p->vertex_count; j += 1)
+            {
+                out_vertices[remap[j]] = in_vertices[j];
+            }
+        }
+
+        mesh_analyze(out_vertices,
+                     out,
+                     p->index_count,
+                     p->vertex_count,
+                     vertex_size,
+                     mem,
+                     &pm->mesh_stats_after,
+                     err);
+    }
+
+    model->indices = indices;
+    model->vertices = vertices;
+
+    usize size = sizeof(mesh_indices_header)
+                 + (model->index_count * sizeof(PG_GRAPHICS_INDEX_TYPE));
+    u8* section = malloc(size);
+    if (!section)
+    {
+        return false;
+    }
+    *(mesh_indices_header*)section = (mesh_indices_header){
+        .index_count = model->index_count,
+        .flags = remap_vertices ? MESH_INDICES_REMAPPED_VERTICES : 0};
+    pg_copy(indices,
+            model->index_count * sizeof(PG_GRAPHICS_INDEX_TYPE),
+            section + sizeof(mesh_indices_header),
+            model->index_count * sizeof(PG_GRAPHICS_INDEX_TYPE),
+            err);
+
+    pm->ext[ASSET_EXT_SECTION_INDICES] = section;
+    pm->ext_sizes[ASSET_EXT_SECTION_INDICES] = size;
+
+    return true;
+}
+
+// Returns the number of primitives drawn by every node (in any order), which
+// is the most drawables the model can have.
+FUNCTION u32
+packer_count_instances(glb_file* glb, glb_model* model)
+{
+    u32 nodes = json_object_get(glb, 0, "nodes");
+    u32 instance_count = 0;
+    for (u32 i = 0; i < json_array_count(glb, nodes); i += 1)
+    {
+        u32 mesh
+            = json_object_get(glb, json_array_get(glb, nodes, i), "mesh");
+        if (mesh == JSON_INVALID_TOKEN)
+        {
+            continue;
+        }
+        u32 mesh_id = json_u32(glb, mesh, 0);
+        for (u32 j = 0; j < model->primitive_count; j += 1)
+        {
+            instance_count += model->primitives[j].mesh_id == mesh_id ? 1 : 0;
+        }
+    }
+    return instance_count;
+}
+
+// NOTE: Levels are built from the final (possibly optimized) indices and
+// vertices. The INDICES section is rewritten with the levels appended, so it
+// is written even if meshes are not optimized.
+// Each level's indices are reordered for the vertex cache, and collapses are
+// capped at LOD_MAX_RELATIVE_ERROR of the primitive's bounds diagonal.
+FUNCTION b8
+packer_build_lods(glb_file* glb,
+                  glb_model* model,
+                  pg_scratch_allocator* mem,
+                  packer_model* pm,
+                  pg_error* err)
+{
+    lod_primitive* primitives;
+    lod_level* levels;
+    PG_GRAPHICS_INDEX_TYPE* lod_indices;
+    PG_GRAPHICS_INDEX_TYPE* work;
+    pg_scratch_alloc(mem,
+                     model->primitive_count * sizeof(lod_primitive),
+                     alignof(lod_primitive),
+                     &primitives,
+                     err);
+    pg_scratch_alloc(mem,
+                     model->primitive_count * LOD_MAX_LEVEL_COUNT
+                         * sizeof(lod_level),
+                     alignof(lod_level),
+                     &levels,
+                     err);
+    pg_scratch_alloc(mem,
+                     model->index_count * LOD_MAX_LEVEL_COUNT
+                         * sizeof(PG_GRAPHICS_INDEX_TYPE),
+                     alignof(PG_GRAPHICS_INDEX_TYPE),
+                     &lod_indices,
+                     err);
+    pg_scratch_alloc(mem,
+                     model->index_count * sizeof(PG_GRAPHICS_INDEX_TYPE),
+                     alignof(PG_GRAPHICS_INDEX_TYPE),
+                     &work,
+                     err);
+
+    u32 primitive_count = 0;
+    u32 level_count = 0;
+    u32 lod_index_count = 0;
+    for (u32 i = 0; i < model->primitive_count; i += 1)
+    {
+        glb_primitive* p = &model->primitives[i];
+        if (!p->index_count || p->index_count % 3 || !p->vertex_count)
+        {
+            continue;
+        }
+
+        pg_vertex* vertices = &model->vertices[p->vertex_offset];
+        pg_f32_3x min = vertices[0].position;
+        pg_f32_3x max = vertices[0].position;
+        for (u32 j = 1; j < p->vertex_count; j += 1)
+        {
+            bounds_expand(vertices[j].position, &min, &max);
+        }
+        pg_f32_3x size = {max.x - min.x, max.y - min.y, max.z - min.z};
+        f32 max_error = LOD_MAX_RELATIVE_ERROR
+                        * lod_sqrt((size.x * size.x) + (size.y * size.y)
+                                   + (size.z * size.z));
+
+        lod_simplifier s = {0};
+        lod_simplifier_init(vertices,
+                            &model->indices[p->index_offset],
+                            p->index_count,
+                            p->vertex_count,
+                            mem,
+                            &s,
+                            err);
+        for (u32 j = 0; j < p->index_count; j += 1)
+        {
+            work[j] = model->indices[p->index_offset + j];
+        }
+
+        lod_primitive lp = {.index_offset = p->index_offset,
+                            .index_count = p->index_count,
+                            .level_offset = level_count};
+        u32 index_count = p->index_count;
+        for (u32 j = 0; j < LOD_MAX_LEVEL_COUNT; j += 1)
+        {
+            u32 simplified_count = lod_simplify(&s,
+                                                work,
+                                                index_count,
+                                                (index_count / 6) * 3,
+                                                max_error);
+            if (!simplified_count
+                || (f32)simplified_count
+                       > (f32)index_count * (1.0f - LOD_MIN_REDUCTION))
+            {
+                break;
+            }
+
+            mesh_optimize_vertex_cache(work,
+                                       simplified_count,
+                                       p->vertex_count,
+                                       &lod_indices[lod_index_count],
+                                       mem,
+                                       err);
+            levels[level_count]
+                = (lod_level){.index_offset = model->index_count
+                                              + lod_index_count,
+                              .index_count = simplified_count,
+                              .error = s.error};
+            level_count += 1;
+            lod_index_count += simplified_count;
+            lp.level_count += 1;
+            index_count = simplified_count;
+        }
+        if (lp.level_count)
+        {
+            primitives[primitive_count] = lp;
+            primitive_count += 1;
+        }
+    }
+
+    // NOTE: Primitives are laid out in order, but sort in case a model's
+    // primitives are not.
+    for (u32 i = 1; i < primitive_count; i += 1)
+    {
+        lod_primitive lp = primitives[i];
+        u32 j = i;
+        for (; j > 0 && primitives[j - 1].index_offset > lp.index_offset; j -= 1)
+        {
+            primitives[j] = primitives[j - 1];
+        }
+        primitives[j] = lp;
+    }
+
+    usize size = lods_section_size(primitive_count, level_count);
+    u8* section = malloc(size);
+    if (!section)
+    {
+        return false;
+    }
+    *(lods_header*)section
+        = (lods_header){.primitive_count = primitive_count,
+                        .level_count = level_count,
+                        .instance_count = packer_count_instances(glb, model)};
+    u8* out = section + sizeof(lods_header);
+    pg_copy(primitives,
+            primitive_count * sizeof(lod_primitive),
+            out,
+            primitive_count * sizeof(lod_primitive),
+            err);
+    out += primitive_count * sizeof(lod_primitive);
+    pg_copy(levels,
+            level_count * sizeof(lod_level),
+            out,
+            level_count * sizeof(lod_level),
+            err);
+
+    pm->ext[ASSET_EXT_SECTION_LODS] = section;
+    pm->ext_sizes[ASSET_EXT_SECTION_LODS] = size;
+
+    // Rewrite the INDICES section with the levels appended.
+    u32 flags = 0;
+    if (pm->ext[ASSET_EXT_SECTION_INDICES])
+    {
+        flags = ((mesh_indices_header*)pm->ext[ASSET_EXT_SECTION_INDICES])->flags;
+        free(pm->ext[ASSET_EXT_SECTION_INDICES]);
+    }
+    usize indices_size
+        = sizeof(mesh_indices_header)
+          + ((model->index_count + lod_index_count)
+             * sizeof(PG_GRAPHICS_INDEX_TYPE));
+    u8* indices_section = malloc(indices_size);
+    pm->ext[ASSET_EXT_SECTION_INDICES] = indices_section;
+    pm->ext_sizes[ASSET_EXT_SECTION_INDICES] = indices_size;
+    if (!indices_section)
+    {
+        pm->ext_sizes[ASSET_EXT_SECTION_INDICES] = 0;
+        return false;
+    }
+    *(mesh_indices_header*)indices_section
+        = (mesh_indices_header){.index_count = model->index_count,
+                                .flags = flags,
+                                .lod_index_count = lod_index_count};
+    out = indices_section + sizeof(mesh_indices_header);
+    pg_copy(model->indices,
+            model->index_count * sizeof(PG_GRAPHICS_INDEX_TYPE),
+            out,
+            model->index_count * sizeof(PG_GRAPHICS_INDEX_TYPE),
+            err);
+    out += model->index_count * sizeof(PG_GRAPHICS_INDEX_TYPE);
+    pg_copy(lod_indices,
+            lod_index_count * sizeof(PG_GRAPHICS_INDEX_TYPE),
+            out,
+            lod_index_count * sizeof(PG_GRAPHICS_INDEX_TYPE),
+            err);
+
+    return true;
+}
+
+// NOTE: Meshlets are built from the final (possibly optimized) indices, and
+// are only valid at runtime if those indices are used as well.
+// Skinned primitives are skipped, and double-sided primitives get no cone.
+FUNCTION b8
+packer_build_meshlets(glb_file* glb,
+                      glb_model* model,
+                      b8 ext_indices,
+                      pg_scratch_allocator* mem,
+                      packer_model* pm,
+                      pg_error* err)
+{
+    u32 max_meshlet_count = 0;
+    for (u32 i = 0; i < model->primitive_count; i += 1)
+    {
+        max_meshlet_count += meshlet_count_max(model->primitives[i].index_count);
+    }
+
+    meshlet_primitive* primitives;
+    meshlet* ms;
+    u32* vertex_marks;
+    pg_scratch_alloc(mem,
+                     model->primitive_count * sizeof(meshlet_primitive),
+                     alignof(meshlet_primitive),
+                     &primitives,
+                     err);
+    pg_scratch_alloc(mem,
+                     max_meshlet_count * sizeof(meshlet),
+                     alignof(meshlet),
+                     &ms,
+                     err);
+    pg_scratch_alloc(mem,
+                     model->vertex_count * sizeof(u32),
+                     alignof(u32),
+                     &vertex_marks,
+                     err);
+
+    u32 primitive_count = 0;
+    u32 meshlet_count = 0;
+    for (u32 i = 0; i < model->primitive_count; i += 1)
+    {
+        glb_primitive* p = &model->primitives[i];
+        if (!p->index_count || p->index_count % 3)
+        {
+            continue;
+        }
+
+        b8 skinned = false;
+        for (u32 j = 0; j < p->vertex_count; j += 1)
+        {
+            pg_f32_4x w = model->vertices[p->vertex_offset + j].joint_weights;
+            skinned = skinned || w.x + w.y + w.z + w.w > 0.0f;
+        }
+        if (skinned)
+        {
+            continue;
+        }
+
+        meshlet_primitive* mp = &primitives[primitive_count];
+        primitive_count += 1;
+        *mp = (meshlet_primitive){.index_offset = p->index_offset,
+                                  .index_count = p->index_count,
+                                  .meshlet_offset = meshlet_count};
+        mp->meshlet_count
+            = meshlet_build(&model->vertices[p->vertex_offset],
+                            &model->indices[p->index_offset],
+                            p->index_count,
+                            p->vertex_count,
+                            p->index_offset,
+                            !glb_material_is_double_sided(glb, p->material_id),
+                            vertex_marks,
+                            &ms[meshlet_count]);
+        meshlet_count += mp->meshlet_count;
+    }
+
+    // NOTE: Primitives are laid out in order, but sort in case a model's
+    // primitives are not.
+    for (u32 i = 1; i < primitive_count; i += 1)
+    {
+        meshlet_primitive mp = primitives[i];
+        u32 j = i;
+        for (; j > 0 && primitives[j - 1].index_offset > mp.index_offset; j -= 1)
+        {
+            primitives[j] = primitives[j - 1];
+        }
+        primitives[j] = mp;
+    }
+
+    usize size = meshlets_section_size(primitive_count, meshlet_count);
+    u8* section = malloc(size);
+    if (!section)
+    {
+        return false;
+    }
+    *(meshlets_header*)section = (meshlets_header){
+        .primitive_count = primitive_count,
+        .meshlet_count = meshlet_count,
+        .flags = ext_indices ? MESHLETS_EXT_INDICES : 0};
+    u8* out = section + sizeof(meshlets_header);
+    pg_copy(primitives,
+            primitive_count * sizeof(meshlet_primitive),
+            out,
+            primitive_count * sizeof(meshlet_primitive),
+            err);
+    out += primitive_count * sizeof(meshlet_primitive);
+    pg_copy(ms,
+            meshlet_count * sizeof(meshlet),
+            out,
+            meshlet_count * sizeof(meshlet),
+            err);
+
+    pm->ext[ASSET_EXT_SECTION_MESHLETS] = section;
+    pm->ext_sizes[ASSET_EXT_SECTION_MESHLETS] = size;
+
+    return true;
+}
+
+FUNCTION b8
+packer_build_bounds(glb_model* model,
+                    pg_scratch_allocator* mem,
+                    packer_model* pm,
+                    pg_error* err)
+{
+    u32 joint_count = 0;
+    for (u32 i = 0; i < model->vertex_count; i += 1)
+    {
+        pg_vertex* v = &model->vertices[i];
+        f32 weights[] = {v->joint_weights.x,
+                         v->joint_weights.y,
+                         v->joint_weights.z,
+                         v->joint_weights.w};
+        for (u32 j = 0; j < 4; j += 1)
+        {
+            if (weights[j] > 0.0f && v->joint_ids[j] >= joint_count)
+            {
+                joint_count = v->joint_ids[j] + 1;
+            }
+        }
+    }
+
+    primitive_bounds* primitives;
+    joint_bounds* joints;
+    joint_bounds* joint_scratch;
+    pg_scratch_alloc(mem,
+                     model->primitive_count * sizeof(primitive_bounds),
+                     alignof(primitive_bounds),
+                     &primitives,
+                     err);
+    pg_scratch_alloc(mem,
+                     model->primitive_count * joint_count * sizeof(joint_bounds),
+                     alignof(joint_bounds),
+                     &joints,
+                     err);
+    pg_scratch_alloc(mem,
+                     joint_count * sizeof(joint_bounds),
+                     alignof(joint_bounds),
+                     &joint_scratch,
+                     err);
+
+    u32 joint_bounds_count = 0;
+    for (u32 i = 0; i < model->primitive_count; i += 1)
+    {
+        glb_primitive* p = &model->primitives[i];
+        primitives[i] = (primitive_bounds){.index_offset = p->index_offset,
+                                           .index_count = p->index_count,
+                                           .joint_bounds_offset
+                                           = joint_bounds_count};
+        joint_bounds_count
+            += bounds_build_primitive(&model->vertices[p->vertex_offset],
+                                      p->vertex_count,
+                                      joint_count,
+                                      joint_scratch,
+                                      &primitives[i],
+                                      &joints[joint_bounds_count]);
+    }
+
+    // NOTE: Primitives are laid out in order, but sort in case a model's
+    // primitives are not.
+    for (u32 i = 1; i < model->primitive_count; i += 1)
+    {
+        primitive_bounds pb = primitives[i];
+        u32 j = i;
+        for (; j > 0 && primitives[j - 1].index_offset > pb.index_offset; j -= 1)
+        {
+            primitives[j] = primitives[j - 1];
+        }
+        primitives[j] = pb;
+    }
+
+    usize size = bounds_section_size(model->primitive_count, joint_bounds_count);
+    u8* section = malloc(size);
+    if (!section)
+    {
+        return false;
+    }
+    *(bounds_header*)section
+        = (bounds_header){.primitive_count = model->primitive_count,
+                          .joint_bounds_count = joint_bounds_count};
+    u8* out = section + sizeof(bounds_header);
+    pg_copy(primitives,
+            model->primitive_count * sizeof(primitive_bounds),
+            out,
+            model->primitive_count * sizeof(primitive_bounds),
+            err);
+    out += model->primitive_count * sizeof(primitive_bounds);
+    pg_copy(joints,
+            joint_bounds_count * sizeof(joint_bounds),
+            out,
+            joint_bounds_count * sizeof(joint_bounds),
+            err);
+
+    pm->ext[ASSET_EXT_SECTION_BOUNDS] = section;
+    pm->ext_sizes[ASSET_EXT_SECTION_BOUNDS] = size;
+
+    return true;
+}
+
+// Reads a node's rest transform, given either as a matrix or as TRS.
+FUNCTION void
+packer_read_node_transform(glb_file* glb, u32 node, animation_transform* t)
+{
+    u32 matrix = json_object_get(glb, node, "matrix");
+    if (json_array_count(glb, matrix) == 16)
+    {
+        pg_f32_4x4 m;
+        f32* elements = (f32*)&m;
+        for (u32 i = 0; i < 16; i += 1)
+        {
+            elements[i] = (f32)json_f64(glb, json_array_get(glb, matrix, i), 0);
+        }
+        animation_transform_from_matrix(&m, t);
+        return;
+    }
+
+    // NOTE: Missing properties default to the identity.
+    c8* keys[] = {"translation", "rotation", "scale"};
+    f32 defaults[][4] = {{0, 0, 0, 0}, {0, 0, 0, 1}, {1, 1, 1, 0}};
+    f32 values[3][4];
+    for (u32 i = 0; i < CAP(keys); i += 1)
+    {
+        u32 array = json_object_get(glb, node, keys[i]);
+        for (u32 j = 0; j < 4; j += 1)
+        {
+            u32 element = json_array_get(glb, array, j);
+            values[i][j] = (f32)json_f64(glb, element, defaults[i][j]);
+        }
+    }
+    *t = (animation_transform){
+        .translation = {values[0][0], values[0][1], values[0][2]},
+        .rotation = {values[1][0], values[1][1], values[1][2], values[1][3]},
+        .scale = {values[2][0], values[2][1], values[2][2]}};
+}
+
+// Returns the largest distance between where `raw` and `compressed` put any
+// skinned vertex of `model` while playing `clip_id`, sampled at 120 Hz.
+FUNCTION f32
+packer_measure_animation_error(glb_model* model,
+                               animations* raw,
+                               animations* compressed,
+                               u32 clip_id,
+                               pg_scratch_allocator* mem,
+                               pg_error* err)
+{
+    animations* as[] = {raw, compressed};
+    animation_pose poses[CAP(as)];
+    animation_sampler samplers[CAP(as)];
+    pg_f32_4x4* globals[CAP(as)];
+    pg_f32_4x4* joint_transforms[CAP(as)];
+    animation_cursors cursors[CAP(as)];
+    for (u32 i = 0; i < CAP(as); i += 1)
+    {
+        animation_pose_init(&poses[i], as[i]->node_count, mem, err);
+        animation_sampler_init(&samplers[i],
+                               as[i]->max_clip_channel_count,
+                               mem,
+                               err);
+        pg_scratch_alloc(mem,
+                         as[i]->node_count * sizeof(pg_f32_4x4),
+                         alignof(pg_f32_4x4),
+                         &globals[i],
+                         err);
+        pg_scratch_alloc(mem,
+                         as[i]->joint_count * sizeof(pg_f32_4x4),
+                         alignof(pg_f32_4x4),
+                         &joint_transforms[i],
+                         err);
+        cursors[i] = (animation_cursors){.clip_id = ANIMATION_NO_CLIP};
+        pg_scratch_alloc(mem,
+                         (as[i]->max_clip_channel_count + 1) * sizeof(u32),
+                         alignof(u32),
+                         &cursors[i].keys,
+                         err);
+    }
+
+    f32 max_error = 0.0f;
+    f32 duration = raw->clips[clip_id].duration;
+    u32 sample_count = (u32)(duration * 120.0f) + 1;
+    for (u32 s = 0; s <= sample_count; s += 1)
+    {
+        f32 time = (duration * (f32)s) / (f32)sample_count;
+        for (u32 i = 0; i < CAP(as); i += 1)
+        {
+            animation_sample_stats stats = {0};
+            animation_sample(as[i],
+                             clip_id,
+                             time,
+                             &cursors[i],
+                             &samplers[i],
+                             &poses[i],
+                             &stats);
+            animation_build_joint_transforms(as[i],
+                                             &poses[i],
+                                             globals[i],
+                                             joint_transforms[i]);
+        }
+
+        for (u32 v = 0; v < model->vertex_count; v += 1)
+        {
+            pg_vertex* vertex = &model->vertices[v];
+            f32 weights[] = {vertex->joint_weights.x,
+                             vertex->joint_weights.y,
+                             vertex->joint_weights.z,
+                             vertex->joint_weights.w};
+            f32 position[] = {vertex->position.x,
+                              vertex->position.y,
+                              vertex->position.z,
+                              1.0f};
+            f32 difference[3] = {0};
+            for (u32 j = 0; j < 4; j += 1)
+            {
+                u32 joint = vertex->joint_ids[j];
+                if (weights[j] <= 0.0f || joint >= raw->joint_count)
+                {
+                    continue;
+                }
+                f32* a = (f32*)&joint_transforms[0][joint];
+                f32* b = (f32*)&joint_transforms[1][joint];
+                for (u32 r = 0; r < 3; r += 1)
+                {
+                    for (u32 c = 0; c < 4; c += 1)
+                    {
+                        difference[r] += weights[j] * position[c]
+                                         * (b[(c * 4) + r] - a[(c * 4) + r]);
+                    }
+                }
+            }
+            f32 error = animation_sqrt((difference[0] * difference[0])
+                                       + (difference[1] * difference[1])
+                                       + (difference[2] * difference[2]));
+            max_error = error > max_error ? error : max_error;
+        }
+    }
+
+    return max_error;
+}
+
+// Sets `range` to the minimum and extent of `keys` (or of the keys `ids`
+// picks), for VECTOR_48 keys.
+FUNCTION void
+packer_animation_range(pg_f32_4x* keys, u32* ids, u32 count, f32* range)
+{
+    for (u32 i = 0; i < count; i += 1)
+    {
+        f32* v = &keys[ids ? ids[i] : i].x;
+        for (u32 k = 0; k < 3; k += 1)
+        {
+            range[k] = (!i || v[k] < range[k]) ? v[k] : range[k];
+            range[3 + k] = (!i || v[k] > range[3 + k]) ? v[k] : range[3 + k];
+        }
+    }
+    for (u32 k = 0; k < 3; k += 1)
+    {
+        range[3 + k] -= range[k];
+    }
+}
+
+// Compresses `raw` into a new section (see animation.c).
+// NOTE: A channel's rotations and scales are held to the position tolerance
+// at its reach: the farthest skinned vertex of its node or any node below it
+// (ignoring the scale of the nodes in between). Errors of nodes along a chain
+// can add up, so the measured error of each clip is stored with it.
+FUNCTION b8
+packer_compress_animations(glb_model* model,
+                           animations* raw,
+                           pg_scratch_allocator* mem,
+                           u8** out,
+                           usize* out_size,
+                           pg_error* err)
+{
+    f32* reaches;
+    pg_scratch_alloc(mem,
+                     raw->node_count * sizeof(f32),
+                     alignof(f32),
+                     &reaches,
+                     err);
+    for (u32 i = 0; i < raw->node_count; i += 1)
+    {
+        reaches[i] = 0.0f;
+    }
+
+    // Measure each joint's reach in its own space, and the model's size.
+    pg_f32_3x min = model->vertex_count ? model->vertices[0].position
+                                        : (pg_f32_3x){0};
+    pg_f32_3x max = min;
+    for (u32 i = 0; i < model->vertex_count; i += 1)
+    {
+        pg_vertex* v = &model->vertices[i];
+        pg_f32_3x p = v->position;
+        min.x = p.x < min.x ? p.x : min.x;
+        min.y = p.y < min.y ? p.y : min.y;
+        min.z = p.z < min.z ? p.z : min.z;
+        max.x = p.x > max.x ? p.x : max.x;
+        max.y = p.y > max.y ? p.y : max.y;
+        max.z = p.z > max.z ? p.z : max.z;
+        f32 weights[] = {v->joint_weights.x,
+                         v->joint_weights.y,
+                         v->joint_weights.z,
+                         v->joint_weights.w};
+        for (u32 j = 0; j < 4; j += 1)
+        {
+            if (weights[j] <= 0.0f || v->joint_ids[j] >= raw->joint_count)
+            {
+                continue;
+            }
+            animation_joint* joint = &raw->joints[v->joint_ids[j]];
+            f32* m = (f32*)&joint->inverse_bind;
+            f32 p[3];
+            for (u32 r = 0; r < 3; r += 1)
+            {
+                p[r] = (m[r] * v->position.x) + (m[4 + r] * v->position.y)
+                       + (m[8 + r] * v->position.z) + m[12 + r];
+            }
+            f32 reach = animation_sqrt((p[0] * p[0]) + (p[1] * p[1])
+                                       + (p[2] * p[2]));
+            f32* node_reach = &reaches[joint->node];
+            *node_reach = reach > *node_reach ? reach : *node_reach;
+        }
+    }
+    pg_f32_3x diagonal = {max.x - min.x, max.y - min.y, max.z - min.z};
+    f32 tolerance = ANIMATION_MAX_POSITION_ERROR
+                    * animation_sqrt((diagonal.x * diagonal.x)
+                                     + (diagonal.y * diagonal.y)
+                                     + (diagonal.z * diagonal.z));
+
+    // NOTE: Children come after their parents, so walking backwards visits
+    // every child before its parent.
+    for (u32 i = raw->node_count; i-- > 0;)
+    {
+        u32 parent = raw->nodes[i].parent;
+        if (parent != ANIMATION_NO_PARENT)
+        {
+            pg_f32_3x t = raw->nodes[i].rest.translation;
+            f32 reach = animation_sqrt((t.x * t.x) + (t.y * t.y) + (t.z * t.z))
+                        + reaches[i];
+            reaches[parent] = reach > reaches[parent] ? reach : reaches[parent];
+        }
+    }
+
+    // Pick each channel's format and keys.
+    animation_channel* channels;
+    u32* kept;
+    pg_f32_4x* decoded;
+    pg_scratch_alloc(mem,
+                     raw->channel_count * sizeof(animation_channel),
+                     alignof(animation_channel),
+                     &channels,
+                     err);
+    pg_scratch_alloc(mem,
+                     raw->key_count * sizeof(u32),
+                     alignof(u32),
+                     &kept,
+                     err);
+    pg_scratch_alloc(mem,
+                     raw->key_count * sizeof(pg_f32_4x),
+                     alignof(pg_f32_4x),
+                     &decoded,
+                     err);
+    u32 key_count = 0;
+    u32 value_size = 0;
+    for (u32 i = 0; i < raw->channel_count; i += 1)
+    {
+        animation_channel* rc = &raw->channels[i];
+        animation_channel* c = &channels[i];
+        b8 rotation = rc->path == ANIMATION_PATH_ROTATION;
+        f32 reach = reaches[rc->node] > tolerance ? reaches[rc->node]
+                                                  : tolerance;
+        f32 channel_tolerance
+            = rc->path == ANIMATION_PATH_TRANSLATION ? tolerance
+                                                     : tolerance / reach;
+        pg_f32_4x* values = (pg_f32_4x*)(raw->values + rc->value_offset);
+        f32* times = &raw->times[rc->key_offset];
+        u32* channel_kept = &kept[rc->key_offset];
+        pg_f32_4x* channel_decoded = &decoded[rc->key_offset];
+
+        // Quantize, unless that alone exceeds the tolerance.
+        *c = *rc;
+        c->format = rotation ? ANIMATION_FORMAT_QUATERNION_48
+                             : ANIMATION_FORMAT_VECTOR_48;
+        f32 range[6];
+        packer_animation_range(values, 0, rc->key_count, range);
+        for (u32 j = 0; j < rc->key_count; j += 1)
+        {
+            u16 encoded[3];
+            pg_f32_4x v = values[j];
+            if (rotation)
+            {
+                animation_encode_quaternion(v, encoded);
+                channel_decoded[j] = animation_decode_quaternion(encoded);
+            }
+            else
+            {
+                animation_encode_vector(v, range, encoded);
+                channel_decoded[j] = animation_decode_vector(range, encoded);
+            }
+            if (animation_key_error(channel_decoded[j], values[j], rotation)
+                > channel_tolerance)
+            {
+                c->format = ANIMATION_FORMAT_F32;
+            }
+        }
+        if (c->format == ANIMATION_FORMAT_F32)
+        {
+            for (u32 j = 0; j < rc->key_count; j += 1)
+            {
+                channel_decoded[j] = values[j];
+            }
+        }
+
+        // Drop keys, and the channel if it always holds the rest transform.
+        b8 constant = true;
+        for (u32 j = 1; constant && j < rc->key_count; j += 1)
+        {
+            constant = animation_key_error(channel_decoded[0],
+                                           values[j],
+                                           rotation)
+                       <= channel_tolerance;
+        }
+        if (constant)
+        {
+            animation_transform* rest = &raw->nodes[rc->node].rest;
+            pg_f32_3x v = rc->path == ANIMATION_PATH_TRANSLATION
+                              ? rest->translation
+                              : rest->scale;
+            pg_f32_4x rest_value
+                = rotation ? rest->rotation : (pg_f32_4x){v.x, v.y, v.z, 0};
+            channel_kept[0] = 0;
+            c->key_count = animation_key_error(rest_value, values[0], rotation)
+                                   <= channel_tolerance
+                               ? 0
+                               : 1;
+        }
+        else
+        {
+            c->key_count
+                = animation_reduce_keys(times,
+                                        values,
+                                        channel_decoded,
+                                        rc->key_count,
+                                        rotation,
+                                        rc->interpolation
+                                            == ANIMATION_INTERPOLATION_STEP,
+                                        channel_tolerance,
+                                        channel_kept);
+        }
+        c->key_offset = key_count;
+        c->value_offset = value_size;
+        key_count += c->key_count;
+        value_size += c->key_count
+                          ? (u32)animation_values_size(c->format, c->key_count)
+                          : 0;
+    }
+
+    // Write the section, without the dropped channels.
+    u32 channel_count = 0;
+    for (u32 i = 0; i < raw->channel_count; i += 1)
+    {
+        channel_count += channels[i].key_count ? 1 : 0;
+    }
+    usize size = animations_section_size(raw->node_count,
+                                         raw->joint_count,
+                                         raw->clip_count,
+                                         channel_count,
+                                         key_count,
+                                         value_size);
+    u8* section = calloc(1, size);
+    if (!section)
+    {
+        return false;
+    }
+    *(animations_header*)section
+        = (animations_header){.node_count = raw->node_count,
+                              .joint_count = raw->joint_count,
+                              .clip_count = raw->clip_count,
+                              .channel_count = channel_count,
+                              .key_count = key_count,
+                              .value_size = value_size};
+    u8* p = section + sizeof(animations_header);
+    pg_copy(raw->nodes,
+            raw->node_count * sizeof(animation_node),
+            p,
+            raw->node_count * sizeof(animation_node),
+            err);
+    p += raw->node_count * sizeof(animation_node);
+    pg_copy(raw->joints,
+            raw->joint_count * sizeof(animation_joint),
+            p,
+            raw->joint_count * sizeof(animation_joint),
+            err);
+    p += raw->joint_count * sizeof(animation_joint);
+    animation_clip* clips = (animation_clip*)p;
+    p += raw->clip_count * sizeof(animation_clip);
+    animation_channel* out_channels = (animation_channel*)p;
+    p += channel_count * sizeof(animation_channel);
+    f32* out_times = (f32*)p;
+    p += key_count * sizeof(f32);
+    u8* out_values = p;
+
+    u32 channel_id = 0;
+    for (u32 i = 0; i < raw->clip_count; i += 1)
+    {
+        animation_clip* rclip = &raw->clips[i];
+        animation_clip* clip = &clips[i];
+        *clip = *rclip;
+        clip->channel_offset = channel_id;
+        clip->size = 0;
+        for (u32 j = 0; j < rclip->channel_count; j += 1)
+        {
+            u32 raw_channel_id = rclip->channel_offset + j;
+            animation_channel* rc = &raw->channels[raw_channel_id];
+            animation_channel* c = &channels[raw_channel_id];
+            if (!c->key_count)
+            {
+                continue;
+            }
+
+            pg_f32_4x* values = (pg_f32_4x*)(raw->values + rc->value_offset);
+            u32* channel_kept = &kept[rc->key_offset];
+            u8* channel_values = out_values + c->value_offset;
+            u16* encoded = (u16*)channel_values;
+            f32* range = (f32*)channel_values;
+            if (c->format == ANIMATION_FORMAT_VECTOR_48)
+            {
+                // NOTE: The range covers the kept keys only, which are
+                // requantized against it.
+                packer_animation_range(values,
+                                       channel_kept,
+                                       c->key_count,
+                                       range);
+                encoded = (u16*)(channel_values + (2 * sizeof(pg_f32_3x)));
+            }
+            for (u32 l = 0; l < c->key_count; l += 1)
+            {
+                u32 key = channel_kept[l];
+                out_times[c->key_offset + l] = raw->times[rc->key_offset + key];
+                pg_f32_4x v = values[key];
+                if (c->format == ANIMATION_FORMAT_QUATERNION_48)
+                {
+                    animation_encode_quaternion(v, &encoded[l * 3]);
+                }
+                else if (c->format == ANIMATION_FORMAT_VECTOR_48)
+                {
+                    animation_encode_vector(v, range, &encoded[l * 3]);
+                }
+                else
+                {
+                    ((pg_f32_4x*)channel_values)[l] = v;
+                }
+            }
+
+            out_channels[channel_id] = *c;
+            channel_id += 1;
+            clip->size += sizeof(animation_channel)
+                          + (c->key_count * sizeof(f32))
+                          + animation_values_size(c->format, c->key_count);
+        }
+        clip->channel_count = channel_id - clip->channel_offset;
+    }
+
+    animations compressed = {0};
+    if (!animations_read(section, size, &compressed))
+    {
+        PG_ERROR_MAJOR("invalid compressed animations section");
+        free(section);
+        return false;
+    }
+    for (u32 i = 0; i < compressed.clip_count; i += 1)
+    {
+        compressed.clips[i].error = packer_measure_animation_error(model,
+                                                                   raw,
+                                                                   &compressed,
+                                                                   i,
+                                                                   mem,
+                                                                   err);
+    }
+
+    *out = section;
+    *out_size = size;
+
+    return true;
+}
+
+// Orders the nodes of `glb` parents first (roots, then each level of
+// children in turn), so hierarchies can be walked in one pass. Sets `parents`
+// to each glTF node's parent (ANIMATION_NO_PARENT for roots) and `order` and
+// `node_ids` to map new ids to glTF ids and back.
+// NOTE: Every section with nodes uses this order, so node ids match across
+// sections of the same model.
+FUNCTION b8
+packer_order_nodes(glb_file* glb,
+                   pg_scratch_allocator* mem,
+                   u32** parents_out,
+                   u32** order_out,
+                   u32** node_ids_out,
+                   pg_error* err)
+{
+    u32 nodes = json_object_get(glb, 0, "nodes");
+    u32 node_count = json_array_count(glb, nodes);
+
+    usize node_ids_size = node_count * sizeof(u32);
+    u32* parents;
+    u32* order;    // New id -> glTF id
+    u32* node_ids; // glTF id -> new id
+    pg_scratch_alloc(mem, node_ids_size, alignof(u32), &parents, err);
+    pg_scratch_alloc(mem, node_ids_size, alignof(u32), &order, err);
+    pg_scratch_alloc(mem, node_ids_size, alignof(u32), &node_ids, err);
+    for (u32 i = 0; i < node_count; i += 1)
+    {
+        parents[i] = ANIMATION_NO_PARENT;
+    }
+    for (u32 i = 0; i < node_count; i += 1)
+    {
+        u32 children
+            = json_object_get(glb, json_array_get(glb, nodes, i), "children");
+        for (u32 j = 0; j < json_array_count(glb, children); j += 1)
+        {
+            u32 child = json_u32(glb, json_array_get(glb, children, j), 0);
+            if (child >= node_count || parents[child] != ANIMATION_NO_PARENT)
+            {
+                PG_ERROR_MAJOR("invalid glb node hierarchy");
+                return false;
+            }
+            parents[child] = i;
+        }
+    }
+    u32 ordered_count = 0;
+    for (u32 i = 0; i < node_count; i += 1)
+    {
+        if (parents[i] == ANIMATION_NO_PARENT)
+        {
+            order[ordered_count] = i;
+            ordered_count += 1;
+        }
+    }
+    for (u32 i = 0; i < ordered_count; i += 1)
+    {
+        u32 children = json_object_get(glb,
+                                       json_array_get(glb, nodes, order[i]),
+                                       "children");
+        for (u32 j = 0; j < json_array_count(glb, children); j += 1)
+        {
+            order[ordered_count]
+                = json_u32(glb, json_array_get(glb, children, j), 0);
+            ordered_count += 1;
+        }
+    }
+    if (ordered_count != node_count)
+    {
+        PG_ERROR_MAJOR("invalid glb node hierarchy");
+        return false;
+    }
+    for (u32 i = 0; i < node_count; i += 1)
+    {
+        node_ids[order[i]] = i;
+    }
+
+    *parents_out = parents;
+    *order_out = order;
+    *node_ids_out = node_ids;
+
+    return true;
+}
+
+// NOTE: Only models with exactly one skin get a section, since the joint
+// transforms the viewer replaces are that skin's. Nodes are stored parents
+// first, so the hierarchy can be walked in one pass. "weights" (morph target)
+// channels are skipped.
+FUNCTION b8
+packer_build_animations(glb_file* glb,
+                        glb_model* model,
+                        b8 compress,
+                        pg_scratch_allocator* mem,
+                        packer_model* pm,
+                        pg_error* err)
+{
+    u32 skins = json_object_get(glb, 0, "skins");
+    u32 clips = json_object_get(glb, 0, "animations");
+    u32 clip_count = json_array_count(glb, clips);
+    if (json_array_count(glb, skins) != 1 || !clip_count)
+    {
+        return true;
+    }
+
+    u32 nodes = json_object_get(glb, 0, "nodes");
+    u32 node_count = json_array_count(glb, nodes);
+    u32 skin = json_array_get(glb, skins, 0);
+    u32 skin_joints = json_object_get(glb, skin, "joints");
+    u32 joint_count = json_array_count(glb, skin_joints);
+
+    u32* parents;
+    u32* order;    // New id -> glTF id
+    u32* node_ids; // glTF id -> new id
+    if (!packer_order_nodes(glb, mem, &parents, &order, &node_ids, err))
+    {
+        return false;
+    }
+
+    // Count channels and keys.
+    u32 channel_count = 0;
+    u32 key_count = 0;
+    for (u32 i = 0; i < clip_count; i += 1)
+    {
+        u32 clip = json_array_get(glb, clips, i);
+        u32 channels = json_object_get(glb, clip, "channels");
+        u32 samplers = json_object_get(glb, clip, "samplers");
+        for (u32 j = 0; j < json_array_count(glb, channels); j += 1)
+        {
+            u32 channel = json_array_get(glb, channels, j);
+            u32 target = json_object_get(glb, channel, "target");
+            u32 path = json_object_get(glb, target, "path");
+            if (json_token_equals(glb, path, "weights"))
+            {
+                continue;
+            }
+            u32 sampler = json_array_get(
+                glb,
+                samplers,
+                json_u32(glb, json_object_get(glb, channel, "sampler"), 0));
+            glb_accessor times;
+            if (!glb_get_accessor(
+                    glb,
+                    json_u32(glb, json_object_get(glb, sampler, "input"), 0),
+                    &times,
+                    err))
+            {
+                return false;
+            }
+            channel_count += 1;
+            key_count += times.count;
+        }
+    }
+
+    u32 value_size = key_count * sizeof(pg_f32_4x);
+    usize size = animations_section_size(node_count,
+                                         joint_count,
+                                         clip_count,
+                                         channel_count,
+                                         key_count,
+                                         value_size);
+    u8* section = calloc(1, size);
+    if (!section)
+    {
+        return false;
+    }
+    *(animations_header*)section
+        = (animations_header){.node_count = node_count,
+                              .joint_count = joint_count,
+                              .clip_count = clip_count,
+                              .channel_count = channel_count,
+                              .key_count = key_count,
+                              .value_size = value_size};
+    // NOTE: Offsets are filled in below, so the section is read without
+    // validation first.
+    animations as = {0};
+    {
+        u8* p = section + sizeof(animations_header);
+        as.nodes = (animation_node*)p;
+        p += node_count * sizeof(animation_node);
+        as.joints = (animation_joint*)p;
+        p += joint_count * sizeof(animation_joint);
+        as.clips = (animation_clip*)p;
+        p += clip_count * sizeof(animation_clip);
+        as.channels = (animation_channel*)p;
+        p += channel_count * sizeof(animation_channel);
+        as.times = (f32*)p;
+        p += key_count * sizeof(f32);
+        as.values = p;
+    }
+
+    for (u32 i = 0; i < node_count; i += 1)
+    {
+        animation_node* n = &as.nodes[i];
+        u32 node = json_array_get(glb, nodes, order[i]);
+        packer_read_node_transform(glb, node, &n->rest);
+        n->parent = parents[order[i]] == ANIMATION_NO_PARENT
+                        ? ANIMATION_NO_PARENT
+                        : node_ids[parents[order[i]]];
+    }
+
+    // NOTE: Missing inverse bind matrices are identity.
+    u32 inverse_binds_id = json_object_get(glb, skin, "inverseBindMatrices");
+    glb_accessor inverse_binds = {0};
+    if (inverse_binds_id != JSON_INVALID_TOKEN
+        && !glb_get_accessor(glb,
+                             json_u32(glb, inverse_binds_id, 0),
+                             &inverse_binds,
+                             err))
+    {
+        free(section);
+        return false;
+    }
+    for (u32 i = 0; i < joint_count; i += 1)
+    {
+        animation_joint* j = &as.joints[i];
+        u32 node = json_u32(glb, json_array_get(glb, skin_joints, i), 0);
+        if (node >= node_count)
+        {
+            PG_ERROR_MAJOR("invalid glb skin joint");
+            free(section);
+            return false;
+        }
+        j->node = node_ids[node];
+        f32* m = (f32*)&j->inverse_bind;
+        for (u32 k = 0; k < 16; k += 1)
+        {
+            m[k] = i < inverse_binds.count
+                       ? glb_accessor_read_f32(&inverse_binds, i, k)
+                       : (k % 5 == 0 ? 1.0f : 0.0f);
+        }
+    }
+
+    u32 channel_id = 0;
+    u32 key_offset = 0;
+    for (u32 i = 0; i < clip_count; i += 1)
+    {
+        u32 clip = json_array_get(glb, clips, i);
+        u32 channels = json_object_get(glb, clip, "channels");
+        u32 samplers = json_object_get(glb, clip, "samplers");
+        animation_clip* ac = &as.clips[i];
+        ac->channel_offset = channel_id;
+        u32 clip_key_offset = key_offset;
+        for (u32 j = 0; j < json_array_count(glb, channels); j += 1)
+        {
+            u32 channel = json_array_get(glb, channels, j);
+            u32 target = json_object_get(glb, channel, "target");
+            u32 path = json_object_get(glb, target, "path");
+            if (json_token_equals(glb, path, "weights"))
+            {
+                continue;
+            }
+            u32 sampler = json_array_get(
+                glb,
+                samplers,
+                json_u32(glb, json_object_get(glb, channel, "sampler"), 0));
+            u32 interpolation = json_object_get(glb, sampler, "interpolation");
+            u32 node = json_u32(glb, json_object_get(glb, target, "node"), 0);
+            glb_accessor times;
+            glb_accessor values;
+            if (node >= node_count
+                || !glb_get_accessor(
+                    glb,
+                    json_u32(glb, json_object_get(glb, sampler, "input"), 0),
+                    &times,
+                    err)
+                || !glb_get_accessor(
+                    glb,
+                    json_u32(glb, json_object_get(glb, sampler, "output"), 0),
+                    &values,
+                    err))
+            {
+                PG_ERROR_MAJOR("invalid glb animation channel");
+                free(section);
+                return false;
+            }
+
+            // NOTE: Cubic spline keys are (in-tangent, value, out-tangent).
+            b8 cubic = json_token_equals(glb, interpolation, "CUBICSPLINE");
+            u32 stride = cubic ? 3 : 1;
+            animation_channel* c = &as.channels[channel_id];
+            *c = (animation_channel){
+                .node = node_ids[node],
+                .path = json_token_equals(glb, path, "rotation")
+                            ? ANIMATION_PATH_ROTATION
+                        : json_token_equals(glb, path, "scale")
+                            ? ANIMATION_PATH_SCALE
+                            : ANIMATION_PATH_TRANSLATION,
+                .interpolation = json_token_equals(glb, interpolation, "STEP")
+                                     ? ANIMATION_INTERPOLATION_STEP
+                                     : ANIMATION_INTERPOLATION_LINEAR,
+                .format = ANIMATION_FORMAT_F32,
+                .key_offset = key_offset,
+                .key_count = times.count,
+                .value_offset = key_offset * sizeof(pg_f32_4x)};
+            u32 component_count = c->path == ANIMATION_PATH_ROTATION ? 4 : 3;
+            if (!times.count || values.count < times.count * stride
+                || values.component_count != component_count)
+            {
+                PG_ERROR_MAJOR("invalid glb animation sampler");
+                free(section);
+                return false;
+            }
+            for (u32 k = 0; k < times.count; k += 1)
+            {
+                f32 time = glb_accessor_read_f32(&times, k, 0);
+                u32 value_id = (k * stride) + (cubic ? 1 : 0);
+                f32* value = (f32*)(as.values + c->value_offset
+                                    + (k * sizeof(pg_f32_4x)));
+                f32 length_squared = 0.0f;
+                for (u32 l = 0; l < component_count; l += 1)
+                {
+                    value[l] = glb_accessor_read_f32(&values, value_id, l);
+                    length_squared += value[l] * value[l];
+                }
+
+                // NOTE: Rotations are renormalized, since normalized integer
+                // components (and some exporters) are not exactly unit.
+                if (c->path == ANIMATION_PATH_ROTATION && length_squared > 0.0f)
+                {
+                    f32 length = animation_sqrt(length_squared);
+                    for (u32 l = 0; l < component_count; l += 1)
+                    {
+                        value[l] /= length;
+                    }
+                }
+                as.times[key_offset + k] = time;
+                ac->duration = time > ac->duration ? time : ac->duration;
+            }
+            channel_id += 1;
+            key_offset += times.count;
+        }
+        ac->channel_count = channel_id - ac->channel_offset;
+        ac->size = (ac->channel_count * sizeof(animation_channel))
+                   + ((key_offset - clip_key_offset)
+                      * (sizeof(f32) + sizeof(pg_f32_4x)));
+        ac->raw_size = ac->size;
+    }
+
+    if (!animations_read(section, size, &as))
+    {
+        PG_ERROR_MAJOR("invalid animations section");
+        free(section);
+        return false;
+    }
+
+    if (compress)
+    {
+        u8* compressed = 0;
+        usize compressed_size = 0;
+        b8 compressed_valid = packer_compress_animations(model,
+                                                         &as,
+                                                         mem,
+                                                         &compressed,
+                                                         &compressed_size,
+                                                         err);
+        free(section);
+        if (!compressed_valid)
+        {
+            return false;
+        }
+        section = compressed;
+        size = compressed_size;
+    }
+
+    pm->ext[ASSET_EXT_SECTION_ANIMATIONS] = section;
+    pm->ext_sizes[ASSET_EXT_SECTION_ANIMATIONS] = size;
+
+    return true;
+}
+
+// NOTE: Each primitive's vertices are quantized against their own bounds, so
+// ranges are the primitives with vertices, which are laid out in order.
+// NOTE: The color and skin streams are dropped when every vertex would store
+// the default (white, unweighted), which is the case for most static models.
+// NOTE: Nodes are stored parents first, in the same order as in the
+// animations section. A node is animated if any channel other than "weights"
+// targets it, and moving if it or any node above it is animated.
+FUNCTION b8
+packer_build_scene(glb_file* glb,
+                   glb_model* model,
+                   pg_scratch_allocator* mem,
+                   packer_model* pm,
+                   pg_error* err)
+{
+    u32 nodes = json_object_get(glb, 0, "nodes");
+    u32 node_count = json_array_count(glb, nodes);
+    if (!node_count)
+    {
+        return true;
+    }
+
+    u32* parents;
+    u32* order;
+    u32* node_ids;
+    if (!packer_order_nodes(glb, mem, &parents, &order, &node_ids, err))
+    {
+        return false;
+    }
+
+    // Mark animated nodes.
+    b8* animated;
+    pg_scratch_alloc(mem, node_count * sizeof(b8), alignof(b8), &animated, err);
+    for (u32 i = 0; i < node_count; i += 1)
+    {
+        animated[i] = false;
+    }
+    u32 clips = json_object_get(glb, 0, "animations");
+    for (u32 i = 0; i < json_array_count(glb, clips); i += 1)
+    {
+        u32 channels = json_object_get(glb,
+                                       json_array_get(glb, clips, i),
+                                       "channels");
+        for (u32 j = 0; j < json_array_count(glb, channels); j += 1)
+        {
+            u32 target = json_object_get(glb,
+                                         json_array_get(glb, channels, j),
+                                         "target");
+            u32 path = json_object_get(glb, target, "path");
+            u32 node = json_u32(glb,
+                                json_object_get(glb, target, "node"),
+                                node_count);
+            if (node < node_count && !json_token_equals(glb, path, "weights"))
+            {
+                animated[node_ids[node]] = true;
+            }
+        }
+    }
+
+    u32 instance_count = packer_count_instances(glb, model);
+    usize size = scene_section_size(node_count, instance_count);
+    u8* section = calloc(1, size);
+    if (!section)
+    {
+        return false;
+    }
+    scene_header* header = (scene_header*)section;
+    *header = (scene_header){.node_count = node_count,
+                             .instance_count = instance_count};
+    scene_node* scene_nodes = (scene_node*)(section + sizeof(scene_header));
+    scene_instance* instances
+        = (scene_instance*)(section + sizeof(scene_header)
+                            + (node_count * sizeof(scene_node)));
+
+    u32 instance_id = 0;
+    for (u32 i = 0; i < node_count; i += 1)
+    {
+        scene_node* n = &scene_nodes[i];
+        u32 node = json_array_get(glb, nodes, order[i]);
+        packer_read_node_transform(glb, node, &n->local);
+        n->parent = parents[order[i]] == ANIMATION_NO_PARENT
+                        ? ANIMATION_NO_PARENT
+                        : node_ids[parents[order[i]]];
+        b8 moving = animated[i]
+                    || (n->parent != ANIMATION_NO_PARENT
+                        && (scene_nodes[n->parent].flags & SCENE_NODE_MOVING));
+        n->flags = (animated[i] ? SCENE_NODE_ANIMATED : 0)
+                   | (moving ? SCENE_NODE_MOVING : 0);
+        header->animated_count += animated[i] ? 1 : 0;
+
+        u32 mesh = json_object_get(glb, node, "mesh");
+        if (mesh == JSON_INVALID_TOKEN)
+        {
+            continue;
+        }
+        u32 mesh_id = json_u32(glb, mesh, 0);
+        for (u32 j = 0; j < model->primitive_count; j += 1)
+        {
+            glb_primitive* p = &model->primitives[j];
+            if (p->mesh_id == mesh_id)
+            {
+                instances[instance_id]
+                    = (scene_instance){.node = i,
+                                       .index_offset = p->index_offset,
+                                       .index_count = p->index_count};
+                instance_id += 1;
+            }
+        }
+    }
+
+    pm->ext[ASSET_EXT_SECTION_SCENE] = section;
+    pm->ext_sizes[ASSET_EXT_SECTION_SCENE] = size;
+
+    return true;
+}
+
+FUNCTION b8
+packer_build_compact_vertices(glb_model* model, packer_model* pm)
+{
+    u32 range_count = 0;
+    for (u32 i = 0; i < model->primitive_count; i += 1)
+    {
+        range_count += model->primitives[i].vertex_count ? 1 : 0;
+    }
+
+    u32 stream_flags = 0;
+    for (u32 i = 0; i < model->vertex_count; i += 1)
+    {
+        pg_vertex* v = &model->vertices[i];
+        if (compact_vertex_encode_color(v) != COMPACT_VERTEX_WHITE)
+        {
+            stream_flags |= COMPACT_VERTEX_STREAM_COLOR;
+        }
+        if (compact_vertex_encode_skin(v).joint_weights)
+        {
+            stream_flags |= COMPACT_VERTEX_STREAM_SKIN;
+        }
+    }
+
+    usize size = compact_vertices_section_size(model->vertex_count,
+                                               range_count,
+                                               stream_flags);
+    u8* section = calloc(1, size);
+    if (!section)
+    {
+        return false;
+    }
+
+    compact_vertices_header* header = (compact_vertices_header*)section;
+    *header = (compact_vertices_header){.vertex_count = model->vertex_count,
+                                        .range_count = range_count,
+                                        .stream_flags = stream_flags};
+    compact_vertices cvs = {0};
+    compact_vertices_read(section, size, &cvs);
+
+    pm->compact_error = (compact_vertex_error){0};
+    u32 range_id = 0;
+    for (u32 i = 0; i < model->primitive_count; i += 1)
+    {
+        glb_primitive* p = &model->primitives[i];
+        if (!p->vertex_count)
+        {
+            continue;
+        }
+
+        compact_vertex_range* range = &cvs.ranges[range_id];
+        range_id += 1;
+        *range = (compact_vertex_range){.vertex_offset = p->vertex_offset,
+                                        .vertex_count = p->vertex_count};
+        compact_vertex_range_bounds(model->vertices, range);
+
+        for (u32 j = 0; j < p->vertex_count; j += 1)
+        {
+            u32 vertex_id = p->vertex_offset + j;
+            pg_vertex* v = &model->vertices[vertex_id];
+            compact_vertex* cv = &cvs.vertices[vertex_id];
+            u32* color = cvs.colors ? &cvs.colors[vertex_id] : 0;
+            compact_vertex_skin* skin = cvs.skins ? &cvs.skins[vertex_id] : 0;
+
+            *cv = compact_vertex_encode(v, range);
+            if (color)
+            {
+                *color = compact_vertex_encode_color(v);
+            }
+            if (skin)
+            {
+                *skin = compact_vertex_encode_skin(v);
+            }
+
+            pg_vertex decoded = compact_vertex_decode(cv, color, skin, range);
+            compact_vertex_measure_error(v, &decoded, range, &pm->compact_error);
+        }
+    }
+
+    pm->ext[ASSET_EXT_SECTION_COMPACT_VERTICES] = section;
+    pm->ext_sizes[ASSET_EXT_SECTION_COMPACT_VERTICES] = size;
+
+    return true;
+}
+
+FUNCTION void*
+packer_texture_worker(void* arg)
+{
+    packer_texture_job* job = arg;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&job->mutex);
+        u32 first_row = job->next_row;
+        job->next_row += PACKER_TEXTURE_ROW_BATCH_SIZE;
+        pthread_mutex_unlock(&job->mutex);
+
+        if (first_row >= job->bake->row_count)
+        {
+            break;
+        }
+
+        texture_bake_encode_rows(job->bake,
+                                 first_row,
+                                 PACKER_TEXTURE_ROW_BATCH_SIZE);
+    }
+
+    return 0;
+}
+
+// NOTE: Each image is baked once per role it is used with. Images are decoded
+// one at a time into their own arena, which is reset after each image, and
+// each image's block rows are encoded by `thread_count` threads (including
+// this one).
+FUNCTION b8
+packer_build_textures(glb_file* glb,
+                      u32 thread_count,
+                      pg_scratch_allocator* mem,
+                      packer_model* pm,
+                      pg_error* err)
+{
+    c8* names[TEXTURE_ROLE_COUNT] = {"baseColorTexture",
+                                     "metallicRoughnessTexture",
+                                     "normalTexture",
+                                     "emissiveTexture"};
+
+    u32 material_count = glb_material_count(glb);
+    u32 slot_count = material_count * TEXTURE_ROLE_COUNT;
+    u32* image_ids;
+    texture_image* images;
+    pg_scratch_alloc(mem,
+                     slot_count * sizeof(u32),
+                     alignof(u32),
+                     &image_ids,
+                     err);
+    pg_scratch_alloc(mem,
+                     slot_count * sizeof(texture_image),
+                     alignof(texture_image),
+                     &images,
+                     err);
+
+    u32 image_count = 0;
+    for (u32 i = 0; i < slot_count; i += 1)
+    {
+        u32 role = i % TEXTURE_ROLE_COUNT;
+        u32 source_id = glb_material_image(glb,
+                                           i / TEXTURE_ROLE_COUNT,
+                                           names[role]);
+        image_ids[i] = TEXTURE_NONE;
+        if (source_id == JSON_INVALID_TOKEN)
+        {
+            continue;
+        }
+        for (u32 j = 0; j < image_count; j += 1)
+        {
+            if (images[j].source_image_id == source_id
+                && images[j].role == role)
+            {
+                image_ids[i] = j;
+            }
+        }
+        if (image_ids[i] == TEXTURE_NONE)
+        {
+            images[image_count] = (texture_image){.role = role,
+                                                  .source_image_id = source_id};
+            image_ids[i] = image_count;
+            image_count += 1;
+        }
+    }
+    if (!image_count)
+    {
+        return true;
+    }
+
+    void* image_memory = malloc(PACKER_TEXTURE_MEM_SIZE);
+    pthread_t* threads = calloc(thread_count, sizeof(pthread_t));
+    if (!image_memory || !threads)
+    {
+        free(image_memory);
+        free(threads);
+        return false;
+    }
+    pg_scratch_allocator image_mem = {0};
+    pg_scratch_init(&image_mem, image_memory, PACKER_TEXTURE_MEM_SIZE);
+
+    // NOTE: Blocks are appended to one buffer as each image is baked, then
+    // copied after the tables.
+    usize header_size = textures_section_size(material_count, image_count);
+    usize data_offset = header_size + ((TEXTURE_ALIGNMENT
+                                        - (header_size % TEXTURE_ALIGNMENT))
+                                       % TEXTURE_ALIGNMENT);
+    usize data_size = 0;
+    u8* data = 0;
+    b8 ok = true;
+    for (u32 i = 0; ok && i < image_count; i += 1)
+    {
+        texture_image* ti = &images[i];
+        u8* source = 0;
+        u32 source_size = 0;
+        rgba_image img = {0};
+        texture_bake tb = {0};
+        ok = glb_get_image(glb, ti->source_image_id, &source, &source_size, err)
+             && image_decode(source, source_size, &image_mem, &img, err)
+             && texture_bake_init(&img, ti->role, &image_mem, &tb, err);
+        if (!ok)
+        {
+            break;
+        }
+
+        packer_texture_job job = {.bake = &tb};
+        pthread_mutex_init(&job.mutex, 0);
+        for (u32 t = 1; t < thread_count; t += 1)
+        {
+            pthread_create(&threads[t], 0, &packer_texture_worker, &job);
+        }
+        packer_texture_worker(&job);
+        for (u32 t = 1; t < thread_count; t += 1)
+        {
+            pthread_join(threads[t], 0);
+        }
+        pthread_mutex_destroy(&job.mutex);
+
+        ti->width = img.width;
+        ti->height = img.height;
+        ti->format = tb.format;
+        ti->mip_count = tb.mip_count;
+        ti->metallic = tb.metallic;
+        ti->psnr = texture_bake_psnr(&tb);
+        ti->offset = data_offset + data_size;
+        ti->size = tb.size;
+        ti->source_size = (u64)img.width * img.height * 4;
+
+        usize padded_size
+            = tb.size
+              + ((TEXTURE_ALIGNMENT - (tb.size % TEXTURE_ALIGNMENT))
+                 % TEXTURE_ALIGNMENT);
+        u8* grown = realloc(data, data_size + padded_size);
+        ok = grown != 0;
+        if (ok)
+        {
+            data = grown;
+            pg_copy(tb.data, tb.size, &data[data_size], tb.size, err);
+            data_size += padded_size;
+        }
+
+        pg_scratch_free(&image_mem);
+    }
+    free(threads);
+    free(image_memory);
+
+    usize size = data_offset + data_size;
+    u8* section = ok ? calloc(1, size) : 0;
+    if (!section)
+    {
+        free(data);
+        return false;
+    }
+    *(textures_header*)section
+        = (textures_header){.material_count = material_count,
+                            .image_count = image_count};
+    u8* out = section + sizeof(textures_header);
+    pg_copy(image_ids,
+            slot_count * sizeof(u32),
+            out,
+            slot_count * sizeof(u32),
+            err);
+    out += slot_count * sizeof(u32);
+    pg_copy(images,
+            image_count * sizeof(texture_image),
+            out,
+            image_count * sizeof(texture_image),
+            err);
+    pg_copy(data, data_size, &section[data_offset], data_size, err);
+    free(data);
+
+    pm->ext[ASSET_EXT_SECTION_TEXTURES] = section;
+    pm->ext_sizes[ASSET_EXT_SECTION_TEXTURES] = size;
+
+    return true;
+}
+
+FUNCTION void
+packer_pack_model(packer_state* state,
+                  packer_model* pm,
+                  pg_scratch_allocator* worker_mem,
+                  pg_error* err)
+{
+    f64 start = packer_get_time();
+
+    file_view view = {0};
+    if (!file_map(pm->path, &view, err))
+    {
+        PG_ERROR_MAJOR("failed to open model file");
+        pm->result = PACKER_RESULT_FAILED;
+        return;
+    }
+
+    // NOTE: The cache key covers the source contents and every setting that
+    // affects the output, so an entry is only reused if it is bit-identical
+    // to what a full repack would produce.
+    u64 settings_hash = packer_hash((u8*)&state->settings,
+                                    sizeof(state->settings),
+                                    PACKER_VERSION);
+    pm->key = packer_hash(view.data, view.size, settings_hash);
+
+    c8 cache_path[PACKER_MAX_PATH] = {0};
+    packer_cache_path(state->cache_dir, pm->key, cache_path, sizeof(cache_path));
+
+    if (packer_read_cache(cache_path, pm))
+    {
+        pm->result = PACKER_RESULT_CACHED;
+    }
+    else
+    {
+        glb_file glb = {0};
+        if (!glb_open(view, worker_mem, &glb, err))
+        {
+            pm->result = PACKER_RESULT_FAILED;
+        }
+        else
+        {
+            // NOTE: The .pga itself is compiled from the same sources by the
+            // asset library's compiler. The packer only writes what has no
+            // place in it.
+            pm->result = PACKER_RESULT_PACKED;
+
+            // Build extension sections.
+            u32 flags = state->settings.flags;
+            glb_model model = {0};
+            if ((flags
+                 & (PACKER_FLAG_COMPACT_VERTICES | PACKER_FLAG_OPTIMIZE_MESHES
+                    | PACKER_FLAG_MESHLETS | PACKER_FLAG_BOUNDS
+                    | PACKER_FLAG_LODS | PACKER_FLAG_ANIMATIONS
+                    | PACKER_FLAG_SCENE))
+                && !glb_load_model(&glb, worker_mem, &model, err))
+            {
+                pm->result = PACKER_RESULT_FAILED;
+            }
+            if (pm->result == PACKER_RESULT_PACKED
+                && (flags & PACKER_FLAG_OPTIMIZE_MESHES)
+                && !packer_optimize_meshes(&glb,
+                                           &model,
+                                           flags & PACKER_FLAG_COMPACT_VERTICES,
+                                           worker_mem,
+                                           pm,
+                                           err))
+            {
+                PG_ERROR_MAJOR("failed to optimize meshes");
+                pm->result = PACKER_RESULT_FAILED;
+            }
+            if (pm->result == PACKER_RESULT_PACKED
+                && (flags & PACKER_FLAG_LODS)
+                && !packer_build_lods(&glb, &model, worker_mem, pm, err))
+            {
+                PG_ERROR_MAJOR("failed to build LODs");
+                pm->result = PACKER_RESULT_FAILED;
+            }
+            if (pm->result == PACKER_RESULT_PACKED
+                && (flags & PACKER_FLAG_MESHLETS)
+                && !packer_build_meshlets(&glb,
+                                          &model,
+                                          pm->ext[ASSET_EXT_SECTION_INDICES]
+                                              != 0,
+                                          worker_mem,
+                                          pm,
+                                          err))
+            {
+                PG_ERROR_MAJOR("failed to build meshlets");
+                pm->result = PACKER_RESULT_FAILED;
+            }
+            if (pm->result == PACKER_RESULT_PACKED
+                && (flags & PACKER_FLAG_BOUNDS)
+                && !packer_build_bounds(&model, worker_mem, pm, err))
+            {
+                PG_ERROR_MAJOR("failed to build bounds");
+                pm->result = PACKER_RESULT_FAILED;
+            }
+            b8 compress_animations
+                = (flags & PACKER_FLAG_COMPRESS_ANIMATIONS) != 0;
+            if (pm->result == PACKER_RESULT_PACKED
+                && (flags & PACKER_FLAG_ANIMATIONS)
+                && !packer_build_animations(&glb,
+                                            &model,
+                                            compress_animations,
+                                            worker_mem,
+                                            pm,
+                                            err))
+            {
+                PG_ERROR_MAJOR("failed to build animations");
+                pm->result = PACKER_RESULT_FAILED;
+            }
+            if (pm->result == PACKER_RESULT_PACKED
+                && (flags & PACKER_FLAG_SCENE)
+                && !packer_build_scene(&glb, &model, worker_mem, pm, err))
+            {
+                PG_ERROR_MAJOR("failed to build scene");
+                pm->result = PACKER_RESULT_FAILED;
+            }
+            if (pm->result == PACKER_RESULT_PACKED
+                && (flags & PACKER_FLAG_COMPACT_VERTICES)
+                && !packer_build_compact_vertices(&model, pm))
+            {
+                PG_ERROR_MAJOR("failed to build compact vertices");
+                pm->result = PACKER_RESULT_FAILED;
+            }
+            if (pm->result == PACKER_RESULT_PACKED
+                && (flags & PACKER_FLAG_TEXTURES)
+                && !packer_build_textures(&glb,
+                                          state->texture_thread_count,
+                                          worker_mem,
+                                          pm,
+                                          err))
+            {
+                PG_ERROR_MAJOR("failed to build textures");
+                pm->result = PACKER_RESULT_FAILED;
+            }
+
+            if (pm->result == PACKER_RESULT_PACKED)
+            {
+                packer_cache_header header
+                    = {.magic = PACKER_CACHE_MAGIC,
+                       .version = PACKER_VERSION,
+                       .key = pm->key,
+                       .compact_error = pm->compact_error,
+                       .mesh_stats_before = pm->mesh_stats_before,
+                       .mesh_stats_after = pm->mesh_stats_after};
+                void* parts[1 + ASSET_EXT_SECTION_COUNT] = {&header};
+                usize part_sizes[CAP(parts)] = {sizeof(header)};
+                for (u32 i = 0; i < ASSET_EXT_SECTION_COUNT; i += 1)
+                {
+                    header.ext_sizes[i] = pm->ext_sizes[i];
+                    parts[1 + i] = pm->ext[i];
+                    part_sizes[1 + i] = pm->ext_sizes[i];
+                }
+                if (!packer_write_file(cache_path,
+                                       parts,
+                                       part_sizes,
+                                       CAP(parts)))
+                {
+                    PG_ERROR_MINOR("failed to write packer cache entry");
+                }
+            }
+        }
+    }
+
+    file_unmap(&view);
+    pg_scratch_free(worker_mem);
+
+    pm->time = packer_get_time() - start;
+}
+
+FUNCTION void*
+packer_worker(void* arg)
+{
+    packer_state* state = arg;
+    pg_error error = {.log = &linux_platform_error_log};
+    pg_error* err = &error;
+
+    // NOTE: Workers never share arenas. The worker arena is reset after each
+    // model.
+    pg_scratch_allocator worker_mem = {0};
+    void* worker_memory = malloc(state->worker_mem_size);
+    if (!worker_memory)
+    {
+        PG_ERROR_MAJOR("failed to allocate packer worker memory");
+        return 0;
+    }
+    pg_scratch_init(&worker_mem, worker_memory, state->worker_mem_size);
+
+    for (;;)
+    {
+        pthread_mutex_lock(&state->mutex);
+        u32 model_id = state->next_model;
+        state->next_model += 1;
+        pthread_mutex_unlock(&state->mutex);
+
+        if (model_id >= state->model_count)
+        {
+            break;
+        }
+
+        packer_pack_model(state, &state->models[model_id], &worker_mem, err);
+    }
+
+    free(worker_memory);
+
+    return 0;
+}
+
+s32
+main(s32 argc, c8** argv)
+{
+    pg_error error = {.log = &linux_platform_error_log};
+    pg_error* err = &error;
+
+    packer_state state = {.settings = {.version = PACKER_VERSION},
+                          .cache_dir = "build/pga_cache",
+                          .worker_mem_size = PG_GIBIBYTE(1)};
+    c8* output_dir = "build";
+    u32 thread_count = 0;
+
+    // Parse command-line arguments.
+    s32 first_input = argc;
+    for (s32 i = 1; i < argc; i += 1)
+    {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc)
+        {
+            output_dir = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+        {
+            thread_count = (u32)strtoul(argv[++i], 0, 10);
+        }
+        else if (!strcmp(argv[i], "--cache") && i + 1 < argc)
+        {
+            state.cache_dir = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--compact-vertices"))
+        {
+            state.settings.flags |= PACKER_FLAG_COMPACT_VERTICES;
+        }
+        else if (!strcmp(argv[i], "--optimize-meshes"))
+        {
+            state.settings.flags |= PACKER_FLAG_OPTIMIZE_MESHES;
+        }
+        else if (!strcmp(argv[i], "--meshlets"))
+        {
+            state.settings.flags |= PACKER_FLAG_MESHLETS;
+        }
+        else if (!strcmp(argv[i], "--bounds"))
+        {
+            state.settings.flags |= PACKER_FLAG_BOUNDS;
+        }
+        else if (!strcmp(argv[i], "--lods"))
+        {
+            state.settings.flags |= PACKER_FLAG_LODS;
+        }
+        else if (!strcmp(argv[i], "--animations"))
+        {
+            // NOTE: The viewer places the drawables of the models it samples
+            // through the scene hierarchy, so clips are packed with it.
+            state.settings.flags |= PACKER_FLAG_ANIMATIONS | PACKER_FLAG_SCENE;
+        }
+        else if (!strcmp(argv[i], "--compress-animations"))
+        {
+            state.settings.flags |= PACKER_FLAG_ANIMATIONS
+                                    | PACKER_FLAG_COMPRESS_ANIMATIONS
+                                    | PACKER_FLAG_SCENE;
+        }
+        else if (!strcmp(argv[i], "--scene"))
+        {
+            state.settings.flags |= PACKER_FLAG_SCENE;
+        }
+        else if (!strcmp(argv[i], "--textures"))
+        {
+            state.settings.flags |= PACKER_FLAG_TEXTURES;
+        }
+        else if (argv[i][0] != '-')
+        {
+            first_input = i;
+            break;
+        }
+        else
+        {
+            first_input = argc;
+            break;
+        }
+    }
+    if (first_input >= argc)
+    {
+        fprintf(stderr,
+                "usage: %s [-o OUT_DIR] [-j THREADS] [--cache DIR] "
+                "[--compact-vertices] [--optimize-meshes] [--meshlets] "
+                "[--bounds] [--lods] [--animations] [--compress-animations] "
+                "[--scene] [--textures] MODEL.glb...\n"
+                "NOTE: Models are assigned ids in the order given.\n",
+                argv[0]);
+        return 1;
+    }
+
+    if (mkdir(state.cache_dir, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "failed to create cache dir: %s\n", state.cache_dir);
+        return 1;
+    }
+
+    state.model_count = (u32)(argc - first_input);
+    state.models = calloc(state.model_count, sizeof(packer_model));
+    for (u32 i = 0; i < state.model_count; i += 1)
+    {
+        state.models[i].path = argv[first_input + (s32)i];
+    }
+
+    // NOTE: Models are packed by worker threads, each with its own arena that
+    // is reused for every model it packs. By default there is one thread per
+    // core (and never more than one per model).
+    s64 core_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (!thread_count)
+    {
+        thread_count = core_count > 0 ? (u32)core_count : 1;
+    }
+    if (thread_count > state.model_count)
+    {
+        thread_count = state.model_count;
+    }
+
+    // NOTE: Each texture's blocks are encoded by one thread per core.
+    state.texture_thread_count = core_count > 0 ? (u32)core_count : 1;
+
+    f64 start = packer_get_time();
+
+    pthread_mutex_init(&state.mutex, 0);
+    pthread_t* threads = calloc(thread_count, sizeof(pthread_t));
+    for (u32 i = 0; i < thread_count; i += 1)
+    {
+        pthread_create(&threads[i], 0, &packer_worker, &state);
+    }
+    for (u32 i = 0; i < thread_count; i += 1)
+    {
+        pthread_join(threads[i], 0);
+    }
+    pthread_mutex_destroy(&state.mutex);
+
+    f64 pack_time = packer_get_time() - start;
+
+    // Report.
+    b8 failed = false;
+    u32 packed_count = 0;
+    printf("%-4s %-56s %-8s %10s %12s %18s\n",
+           "id",
+           "model",
+           "result",
+           "time (ms)",
+           "size (B)",
+           "key");
+    for (u32 i = 0; i < state.model_count; i += 1)
+    {
+        packer_model* pm = &state.models[i];
+        usize size = 0;
+        for (u32 t = 0; t < ASSET_EXT_SECTION_COUNT; t += 1)
+        {
+            size += pm->ext_sizes[t];
+        }
+        printf("%-4u %-56s %-8s %10.2f %12zu %016llx\n",
+               i,
+               pm->path,
+               packer_result_names[pm->result],
+               pm->time,
+               size,
+               (unsigned long long)pm->key);
+        failed = failed
+                 || (pm->result != PACKER_RESULT_CACHED
+                     && pm->result != PACKER_RESULT_PACKED);
+        packed_count += pm->result == PACKER_RESULT_PACKED;
+    }
+    if (failed)
+    {
+        fprintf(stderr, "packing failed\n");
+        return 1;
+    }
+
+    if (state.settings.flags & PACKER_FLAG_COMPACT_VERTICES)
+    {
+        // NOTE: Errors are the max over all vertices of the model. Angles are
+        // in degrees and positions are relative to the range bounds diagonal.
+        printf("\n%-4s %-8s %12s %12s %10s %8s %8s %8s %8s %8s %8s\n",
+               "id",
+               "streams",
+               "before (B)",
+               "after (B)",
+               "position",
+               "normal",
+               "tangent",
+               "uv",
+               "color",
+               "weight",
+               "joint");
+        for (u32 i = 0; i < state.model_count; i += 1)
+        {
+            packer_model* pm = &state.models[i];
+            compact_vertex_error* e = &pm->compact_error;
+            compact_vertices cvs = {0};
+            compact_vertices_read(pm->ext[ASSET_EXT_SECTION_COMPACT_VERTICES],
+                                  pm->ext_sizes[ASSET_EXT_SECTION_COMPACT_VERTICES],
+                                  &cvs);
+            c8* stream_names[] = {"base", "+color", "+skin", "+both"};
+            printf("%-4u %-8s %12zu %12zu %10.2e %8.4f %8.4f %8.5f %8.5f %8.5f "
+                   "%8u\n",
+                   i,
+                   stream_names[cvs.stream_flags
+                                & (COMPACT_VERTEX_STREAM_COLOR
+                                   | COMPACT_VERTEX_STREAM_SKIN)],
+                   cvs.vertex_count * sizeof(pg_vertex),
+                   pm->ext_sizes[ASSET_EXT_SECTION_COMPACT_VERTICES],
+                   (f64)e->max_relative_position_error,
+                   (f64)e->max_normal_error,
+                   (f64)e->max_tangent_error,
+                   (f64)e->max_tex_coord_error,
+                   (f64)e->max_color_error,
+                   (f64)e->max_joint_weight_error,
+                   e->joint_id_mismatch_count);
+        }
+    }
+
+    if (state.settings.flags & PACKER_FLAG_OPTIMIZE_MESHES)
+    {
+        // NOTE: Simulated with a 16-entry FIFO vertex cache, 64-byte vertex
+        // fetch lines, and 6 axis-aligned views for overdraw.
+        printf("\n%-4s %15s %15s %15s %15s\n",
+               "id",
+               "acmr",
+               "atvr",
+               "overdraw",
+               "overfetch");
+        for (u32 i = 0; i < state.model_count; i += 1)
+        {
+            mesh_stats* before = &state.models[i].mesh_stats_before;
+            mesh_stats* after = &state.models[i].mesh_stats_after;
+            printf("%-4u %6.3f -> %5.3f %6.3f -> %5.3f %6.3f -> %5.3f "
+                   "%6.3f -> %5.3f\n",
+                   i,
+                   (f64)mesh_stats_acmr(before),
+                   (f64)mesh_stats_acmr(after),
+                   (f64)mesh_stats_atvr(before),
+                   (f64)mesh_stats_atvr(after),
+                   (f64)mesh_stats_overdraw(before),
+                   (f64)mesh_stats_overdraw(after),
+                   (f64)mesh_stats_overfetch(before),
+                   (f64)mesh_stats_overfetch(after));
+        }
+    }
+
+    if (state.settings.flags & PACKER_FLAG_MESHLETS)
+    {
+        // NOTE: Cone culling is disabled for double-sided primitives and for
+        // meshlets whose triangles face too many directions. The culled ratio
+        // is averaged over 6 axis-aligned views from a distant camera.
+        printf("\n%-4s %10s %10s %12s %12s\n",
+               "id",
+               "primitives",
+               "meshlets",
+               "tris/meshlet",
+               "cone culled");
+        pg_f32_3x view_dirs[] = {{1.0f, 0.0f, 0.0f},
+                                 {-1.0f, 0.0f, 0.0f},
+                                 {0.0f, 1.0f, 0.0f},
+                                 {0.0f, -1.0f, 0.0f},
+                                 {0.0f, 0.0f, 1.0f},
+                                 {0.0f, 0.0f, -1.0f}};
+        for (u32 i = 0; i < state.model_count; i += 1)
+        {
+            packer_model* pm = &state.models[i];
+            meshlets ms = {0};
+            meshlets_read(pm->ext[ASSET_EXT_SECTION_MESHLETS],
+                          pm->ext_sizes[ASSET_EXT_SECTION_MESHLETS],
+                          &ms);
+            u64 triangle_count = 0;
+            u64 culled_triangle_count = 0;
+            for (u32 j = 0; j < ms.meshlet_count; j += 1)
+            {
+                meshlet* m = &ms.meshlets[j];
+                triangle_count += m->index_count / 3;
+                for (u32 k = 0; k < CAP(view_dirs); k += 1)
+                {
+                    if (meshlet_dot(view_dirs[k], m->cone_axis)
+                        >= m->cone_cutoff)
+                    {
+                        culled_triangle_count += m->index_count / 3;
+                    }
+                }
+            }
+            printf("%-4u %10u %10u %12.1f %11.1f%%\n",
+                   i,
+                   ms.primitive_count,
+                   ms.meshlet_count,
+                   ms.meshlet_count
+                       ? (f64)triangle_count / (f64)ms.meshlet_count
+                       : 0.0,
+                   triangle_count
+                       ? (100.0 * (f64)culled_triangle_count)
+                             / (f64)(triangle_count * CAP(view_dirs))
+                       : 0.0);
+        }
+    }
+
+    if (state.settings.flags & PACKER_FLAG_BOUNDS)
+    {
+        printf("\n%-4s %10s %10s %12s\n",
+               "id",
+               "primitives",
+               "skinned",
+               "joint boxes");
+        for (u32 i = 0; i < state.model_count; i += 1)
+        {
+            packer_model* pm = &state.models[i];
+            bounds bs = {0};
+            bounds_read(pm->ext[ASSET_EXT_SECTION_BOUNDS],
+                        pm->ext_sizes[ASSET_EXT_SECTION_BOUNDS],
+                        &bs);
+            u32 skinned_count = 0;
+            for (u32 j = 0; j < bs.primitive_count; j += 1)
+            {
+                skinned_count += bs.primitives[j].joint_bounds_count ? 1 : 0;
+            }
+            printf("%-4u %10u %10u %12u\n",
+                   i,
+                   bs.primitive_count,
+                   skinned_count,
+                   bs.joint_bounds_count);
+        }
+    }
+
+    if (state.settings.flags & PACKER_FLAG_LODS)
+    {
+        // NOTE: Level triangles are relative to the full triangles of the
+        // primitives that have that level. Errors are in mesh space.
+        printf("\n%-4s %10s %10s %10s %10s %10s %12s\n",
+               "id",
+               "primitives",
+               "levels",
+               "lod1 tris",
+               "lod2 tris",
+               "lod3 tris",
+               "max error");
+        for (u32 i = 0; i < state.model_count; i += 1)
+        {
+            packer_model* pm = &state.models[i];
+            lods ls = {0};
+            lods_read(pm->ext[ASSET_EXT_SECTION_LODS],
+                      pm->ext_sizes[ASSET_EXT_SECTION_LODS],
+                      &ls);
+            u64 full_counts[LOD_MAX_LEVEL_COUNT] = {0};
+            u64 level_counts[LOD_MAX_LEVEL_COUNT] = {0};
+            f32 max_error = 0.0f;
+            for (u32 j = 0; j < ls.primitive_count; j += 1)
+            {
+                lod_primitive* lp = &ls.primitives[j];
+                for (u32 k = 0; k < lp->level_count; k += 1)
+                {
+                    lod_level* l = &ls.levels[lp->level_offset + k];
+                    full_counts[k] += lp->index_count / 3;
+                    level_counts[k] += l->index_count / 3;
+                    max_error = l->error > max_error ? l->error : max_error;
+                }
+            }
+            static_assert(LOD_MAX_LEVEL_COUNT == 3, "unexpected level count");
+            f64 ratios[LOD_MAX_LEVEL_COUNT] = {0};
+            for (u32 k = 0; k < LOD_MAX_LEVEL_COUNT; k += 1)
+            {
+                ratios[k] = full_counts[k] ? (100.0 * (f64)level_counts[k])
+                                                 / (f64)full_counts[k]
+                                           : 0.0;
+            }
+            printf("%-4u %10u %10u %9.1f%% %9.1f%% %9.1f%% %12.3e\n",
+                   i,
+                   ls.primitive_count,
+                   ls.level_count,
+                   ratios[0],
+                   ratios[1],
+                   ratios[2],
+                   (f64)max_error);
+        }
+    }
+
+    if (state.settings.flags & PACKER_FLAG_ANIMATIONS)
+    {
+        // NOTE: Models without exactly one skin and an animation are skipped.
+        printf("\n%-4s %8s %8s %8s %10s %10s %12s\n",
+               "id",
+               "nodes",
+               "joints",
+               "clips",
+               "channels",
+               "keys",
+               "size (B)");
+        for (u32 i = 0; i < state.model_count; i += 1)
+        {
+            packer_model* pm = &state.models[i];
+            animations as = {0};
+            if (!animations_read(pm->ext[ASSET_EXT_SECTION_ANIMATIONS],
+                                 pm->ext_sizes[ASSET_EXT_SECTION_ANIMATIONS],
+                                 &as))
+            {
+                continue;
+            }
+            printf("%-4u %8u %8u %8u %10u %10u %12zu\n",
+                   i,
+                   as.node_count,
+                   as.joint_count,
+                   as.clip_count,
+                   as.channel_count,
+                   as.key_count,
+                   pm->ext_sizes[ASSET_EXT_SECTION_ANIMATIONS]);
+        }
+    }
+
+    if (state.settings.flags & PACKER_FLAG_COMPRESS_ANIMATIONS)
+    {
+        // NOTE: Sizes cover each clip's channels, key times and values. The
+        // error is the largest distance any skinned vertex moved vs. the
+        // uncompressed clip, in model units.
+        printf("\n%-4s %6s %10s %10s %12s %12s %8s %12s\n",
+               "id",
+               "clip",
+               "channels",
+               "keys",
+               "before (B)",
+               "after (B)",
+               "ratio",
+               "max error");
+        for (u32 i = 0; i < state.model_count; i += 1)
+        {
+            packer_model* pm = &state.models[i];
+            animations as = {0};
+            animations_read(pm->ext[ASSET_EXT_SECTION_ANIMATIONS],
+                            pm->ext_sizes[ASSET_EXT_SECTION_ANIMATIONS],
+                            &as);
+            for (u32 j = 0; j < as.clip_count; j += 1)
+            {
+                animation_clip* c = &as.clips[j];
+                u32 key_count = 0;
+                for (u32 k = 0; k < c->channel_count; k += 1)
+                {
+                    key_count += as.channels[c->channel_offset + k].key_count;
+                }
+                printf("%-4u %6u %10u %10u %12u %12u %7.2fx %12.3e\n",
+                       i,
+                       j,
+                       c->channel_count,
+                       key_count,
+                       c->raw_size,
+                       c->size,
+                       c->size ? (f64)c->raw_size / (f64)c->size : 0.0,
+                       (f64)c->error);
+            }
+        }
+    }
+
+    if (state.settings.flags & PACKER_FLAG_SCENE)
+    {
+        printf("\n%-4s %8s %10s %10s %12s\n",
+               "id",
+               "nodes",
+               "animated",
+               "instances",
+               "size (B)");
+        for (u32 i = 0; i < state.model_count; i += 1)
+        {
+            packer_model* pm = &state.models[i];
+            scene sc = {0};
+            if (!scene_read(pm->ext[ASSET_EXT_SECTION_SCENE],
+                            pm->ext_sizes[ASSET_EXT_SECTION_SCENE],
+                            &sc))
+            {
+                continue;
+            }
+            printf("%-4u %8u %10u %10u %12zu\n",
+                   i,
+                   sc.node_count,
+                   sc.animated_count,
+                   sc.instance_count,
+                   pm->ext_sizes[ASSET_EXT_SECTION_SCENE]);
+        }
+    }
+
+    if (state.settings.flags & PACKER_FLAG_TEXTURES)
+    {
+        // NOTE: Before is 8-bit RGBA without mips and after is the BC blocks
+        // of every mip. PSNR is of the largest mip over the stored channels.
+        c8* role_names[TEXTURE_ROLE_COUNT] = {"base", "metal-rough", "normal",
+                                              "emissive"};
+        c8* format_names[] = {"none", "BC4", "BC5", "BC7"};
+        printf("\n%-4s %6s %-12s %11s %-6s %5s %12s %12s %10s\n",
+               "id",
+               "image",
+               "role",
+               "size",
+               "format",
+               "mips",
+               "before (B)",
+               "after (B)",
+               "psnr (dB)");
+        u64 total_before = 0;
+        u64 total_after = 0;
+        for (u32 i = 0; i < state.model_count; i += 1)
+        {
+            packer_model* pm = &state.models[i];
+            textures ts = {0};
+            textures_read(pm->ext[ASSET_EXT_SECTION_TEXTURES],
+                          pm->ext_sizes[ASSET_EXT_SECTION_TEXTURES],
+                          &ts);
+            for (u32 j = 0; j < ts.image_count; j += 1)
+            {
+                texture_image* ti = &ts.images[j];
+                c8 size[32] = {0};
+                snprintf(size, sizeof(size), "%ux%u", ti->width, ti->height);
+                printf("%-4u %6u %-12s %11s %-6s %5u %12llu %12llu %10.2f\n",
+                       i,
+                       ti->source_image_id,
+                       role_names[ti->role % TEXTURE_ROLE_COUNT],
+                       size,
+                       format_names[ti->format % CAP(format_names)],
+                       ti->mip_count,
+                       (unsigned long long)ti->source_size,
+                       (unsigned long long)ti->size,
+                       (f64)ti->psnr);
+                total_before += ti->source_size;
+                total_after += ti->size;
+            }
+        }
+        printf("textures: %llu -> %llu bytes (%.2fx smaller)\n",
+               (unsigned long long)total_before,
+               (unsigned long long)total_after,
+               total_after ? (f64)total_before / (f64)total_after : 0.0);
+    }
+
+    // Write extension file.
+    // NOTE: It is always written (possibly with no sections) so that it never
+    // holds sections from an older pack.
+    f64 write_start = packer_get_time();
+    {
+        u32 section_count = 0;
+        for (u32 i = 0; i < state.model_count; i += 1)
+        {
+            for (u32 t = 0; t < ASSET_EXT_SECTION_COUNT; t += 1)
+            {
+                section_count += state.models[i].ext_sizes[t] ? 1 : 0;
+            }
+        }
+
+        asset_ext_header ext_header = {.magic = ASSET_EXT_MAGIC,
+                                       .version = ASSET_EXT_VERSION,
+                                       .section_count = section_count};
+        usize table_size = section_count * sizeof(asset_ext_section);
+        asset_ext_section* sections
+            = calloc(section_count + 1, sizeof(asset_ext_section));
+
+        // NOTE: One part for the header, one for the section table, and two
+        // per section (padding, then data).
+        u32 part_count = 0;
+        void** parts = calloc(2 + (2 * section_count), sizeof(void*));
+        usize* part_sizes = calloc(2 + (2 * section_count), sizeof(usize));
+        u8 padding[ASSET_EXT_ALIGNMENT] = {0};
+        parts[part_count] = &ext_header;
+        part_sizes[part_count++] = sizeof(ext_header);
+        parts[part_count] = sections;
+        part_sizes[part_count++] = table_size;
+
+        u64 offset = sizeof(ext_header) + table_size;
+        u32 section_id = 0;
+        for (u32 i = 0; i < state.model_count; i += 1)
+        {
+            packer_model* pm = &state.models[i];
+            for (u32 t = 0; t < ASSET_EXT_SECTION_COUNT; t += 1)
+            {
+                if (!pm->ext_sizes[t])
+                {
+                    continue;
+                }
+
+                u64 padding_size
+                    = (ASSET_EXT_ALIGNMENT - (offset % ASSET_EXT_ALIGNMENT))
+                      % ASSET_EXT_ALIGNMENT;
+                offset += padding_size;
+                sections[section_id++]
+                    = (asset_ext_section){.type = t,
+                                          .model_id = i,
+                                          .offset = offset,
+                                          .size = pm->ext_sizes[t]};
+                parts[part_count] = padding;
+                part_sizes[part_count++] = padding_size;
+                parts[part_count] = pm->ext[t];
+                part_sizes[part_count++] = pm->ext_sizes[t];
+                offset += pm->ext_sizes[t];
+            }
+        }
+
+        c8 ext_path[PACKER_MAX_PATH] = {0};
+        snprintf(ext_path,
+                 sizeof(ext_path),
+                 "%s/%s",
+                 output_dir,
+                 ASSET_EXT_FILE_NAME);
+        if (!packer_write_file(ext_path, parts, part_sizes, part_count))
+        {
+            fprintf(stderr, "failed to write %s\n", ext_path);
+            return 1;
+        }
+
+        // NOTE: The file is read back with the runtime reader and every
+        // section is compared with what was written, so a mismatch between
+        // the two fails the pack instead of the viewer.
+        asset_ext ext = {0};
+        b8 ok = asset_ext_open(ext_path, &ext, err)
+                && ext.section_count == section_count;
+        for (u32 i = 0; ok && i < state.model_count; i += 1)
+        {
+            packer_model* pm = &state.models[i];
+            for (u32 t = 0; ok && t < ASSET_EXT_SECTION_COUNT; t += 1)
+            {
+                u64 size = 0;
+                u8* section = asset_ext_find(&ext, t, i, &size);
+                ok = pm->ext_sizes[t]
+                         ? section && size == pm->ext_sizes[t]
+                               && !memcmp(section, pm->ext[t], size)
+                         : !section;
+            }
+        }
+        file_unmap(&ext.view);
+        if (!ok)
+        {
+            fprintf(stderr, "failed to read back %s\n", ext_path);
+            return 1;
+        }
+
+        printf("\n%s: %u sections, %llu bytes\n",
+               ext_path,
+               section_count,
+               (unsigned long long)offset);
+    }
+
+    // Write table of contents for paged mode.
+    // NOTE: Pages are single-model .pga files compiled by the asset library,
+    // like the .pga itself, so the table of contents is only written once
+    // every model has a page under OUT_DIR/pages/. Each page is read back
+    // with the runtime reader to measure its resident size, bracketed by two
+    // marker allocations.
+    {
+        usize max_page_size = 0;
+        b8 pages_found = true;
+        for (u32 i = 0; pages_found && i < state.model_count; i += 1)
+        {
+            c8 page_name[MODEL_PAGE_MAX_PATH] = {0};
+            model_page_path(i, page_name, sizeof(page_name));
+            c8 page_path[PACKER_MAX_PATH] = {0};
+            snprintf(page_path,
+                     sizeof(page_path),
+                     "%s/%s",
+                     output_dir,
+                     page_name);
+
+            struct stat st = {0};
+            pages_found = stat(page_path, &st) == 0;
+            if (pages_found && (usize)st.st_size > max_page_size)
+            {
+                max_page_size = (usize)st.st_size;
+            }
+        }
+
+        c8 toc_path[PACKER_MAX_PATH] = {0};
+        snprintf(toc_path,
+                 sizeof(toc_path),
+                 "%s/%s",
+                 output_dir,
+                 MODEL_TOC_FILE_NAME);
+
+        if (!pages_found)
+        {
+            // NOTE: Never leave a table of contents that does not match the
+            // models just packed.
+            remove(toc_path);
+            printf("%s: skipped (no pages under %s/%s)\n",
+                   toc_path,
+                   output_dir,
+                   MODEL_PAGE_DIR_NAME);
+        }
+        else
+        {
+            pg_scratch_allocator page_mem = {0};
+            usize page_mem_size = (2 * max_page_size) + PG_MEBIBYTE(64);
+            void* page_memory = malloc(page_mem_size);
+            if (!page_memory)
+            {
+                fprintf(stderr, "failed to allocate page memory\n");
+                return 1;
+            }
+            pg_scratch_init(&page_mem, page_memory, page_mem_size);
+
+            model_toc_header header = {.magic = MODEL_TOC_MAGIC,
+                                       .version = MODEL_TOC_VERSION,
+                                       .model_count = state.model_count};
+            model_toc_entry* toc
+                = calloc(state.model_count, sizeof(model_toc_entry));
+            for (u32 i = 0; i < state.model_count; i += 1)
+            {
+                c8 page_name[MODEL_PAGE_MAX_PATH] = {0};
+                model_page_path(i, page_name, sizeof(page_name));
+                c8 page_path[PACKER_MAX_PATH] = {0};
+                snprintf(page_path,
+                         sizeof(page_path),
+                         "%s/%s",
+                         output_dir,
+                         page_name);
+
+                pg_scratch_free(&page_mem);
+                u8* mem_start;
+                u8* mem_end;
+                pg_scratch_alloc(&page_mem, 1, 1, &mem_start, err);
+                pg_assets* page_assets
+                    = pg_assets_read_pga(pg_string_create(page_path, 0, err),
+                                         &linux_platform_file_read,
+                                         &page_mem,
+                                         err);
+                pg_scratch_alloc(&page_mem, 1, 1, &mem_end, err);
+                if (!page_assets)
+                {
+                    fprintf(stderr, "failed to read %s\n", page_path);
+                    return 1;
+                }
+                pg_asset_model* model = &page_assets->models[0];
+
+                toc[i] = (model_toc_entry){
+                    .key = state.models[i].key,
+                    .resident_size = (u64)(mem_end - mem_start),
+                    .vertex_count = model->vertex_count,
+                    .index_count = model->index_count,
+                    .joint_count = model->joint_count,
+                    .material_count = model->material_count,
+                    .animation_count = model->animation_count};
+                for (u32 j = 0; j < model->material_count; j += 1)
+                {
+                    toc[i].texture_count += model->materials[j].texture_count;
+                }
+            }
+            free(page_memory);
+
+            void* toc_parts[] = {&header, toc};
+            usize toc_part_sizes[]
+                = {sizeof(header), state.model_count * sizeof(model_toc_entry)};
+            if (!packer_write_file(toc_path,
+                                   toc_parts,
+                                   toc_part_sizes,
+                                   CAP(toc_parts)))
+            {
+                fprintf(stderr, "failed to write %s\n", toc_path);
+                return 1;
+            }
+
+            printf("%s: %u model pages\n", toc_path, state.model_count);
+        }
+    }
+    f64 write_time = packer_get_time() - write_start;
+    printf("packed: %u/%u (threads: %u)\n",
+           packed_count,
+           state.model_count,
+           thread_count);
+    printf("pack: %.2f ms, write: %.2f ms\n", pack_time, write_time);
+
+    return 0;
+}
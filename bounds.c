@@ -0,0 +1,272 @@
+// Primitive bounds
+//
+// Pack-time bounding boxes for each primitive, used to frustum cull whole
+// drawables before their draw data is built. Skinned primitives also store a
+// box per joint around the vertices that joint influences. A skinned vertex
+// is a weighted average of its joint transforms applied to it, so it stays
+// inside the box around that joint's transformed boxes.
+//
+// NOTE: Requires frustum.c.
+// NOTE: Boxes are in mesh space (before the drawable's global transform or the
+// joint transforms).
+
+// NOTE: Drawables without bounds are given this half extent, so they are never
+// culled.
+#define BOUNDS_UNBOUNDED_EXTENT 1e30f
+
+// NOTE: Layout of an ASSET_EXT_SECTION_BOUNDS section: this header, the
+// primitives (in index order), then the joint boxes of every primitive in
+// order.
+typedef struct
+{
+    u32 primitive_count;
+    u32 joint_bounds_count;
+    u32 padding0;
+    u32 padding1;
+} bounds_header;
+
+// NOTE: `min` and `max` bound the vertices without joint weights, which are
+// moved by the global transform. They are only valid if
+// `static_vertex_count` is non-zero.
+typedef struct
+{
+    pg_f32_3x min;
+    u32 index_offset;
+    pg_f32_3x max;
+    u32 index_count;
+    u32 static_vertex_count;
+    u32 joint_bounds_offset;
+    u32 joint_bounds_count;
+    u32 padding0;
+} primitive_bounds;
+
+typedef struct
+{
+    pg_f32_3x min;
+    u32 joint_id;
+    pg_f32_3x max;
+    u32 padding0;
+} joint_bounds;
+
+typedef struct
+{
+    primitive_bounds* primitives;
+    joint_bounds* joints;
+    u32 primitive_count;
+    u32 joint_bounds_count;
+} bounds;
+
+typedef struct
+{
+    u32 drawable_count; // tested
+    u32 culled_drawable_count;
+} bounds_cull_stats;
+
+FUNCTION usize
+bounds_section_size(u32 primitive_count, u32 joint_bounds_count)
+{
+    return sizeof(bounds_header) + (primitive_count * sizeof(primitive_bounds))
+           + (joint_bounds_count * sizeof(joint_bounds));
+}
+
+FUNCTION b8
+bounds_read(u8* section, u64 section_size, bounds* bs)
+{
+    *bs = (bounds){0};
+
+    if (!section || section_size < sizeof(bounds_header))
+    {
+        return false;
+    }
+
+    bounds_header* header = (bounds_header*)section;
+    if (section_size < bounds_section_size(header->primitive_count,
+                                           header->joint_bounds_count))
+    {
+        return false;
+    }
+
+    bs->primitive_count = header->primitive_count;
+    bs->joint_bounds_count = header->joint_bounds_count;
+    bs->primitives = (primitive_bounds*)(section + sizeof(bounds_header));
+    bs->joints = (joint_bounds*)(section + sizeof(bounds_header)
+                                 + (header->primitive_count
+                                    * sizeof(primitive_bounds)));
+
+    for (u32 i = 0; i < bs->primitive_count; i += 1)
+    {
+        primitive_bounds* pb = &bs->primitives[i];
+        if (pb->joint_bounds_offset + pb->joint_bounds_count
+            > bs->joint_bounds_count)
+        {
+            *bs = (bounds){0};
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// NOTE: Binary search, so primitives must be sorted by `index_offset`.
+FUNCTION primitive_bounds*
+bounds_find_primitive(bounds* bs, u32 index_offset)
+{
+    u32 low = 0;
+    u32 high = bs->primitive_count;
+    while (low < high)
+    {
+        u32 mid = low + ((high - low) / 2);
+        if (bs->primitives[mid].index_offset < index_offset)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low < bs->primitive_count
+                   && bs->primitives[low].index_offset == index_offset
+               ? &bs->primitives[low]
+               : 0;
+}
+
+FUNCTION void
+bounds_expand(pg_f32_3x p, pg_f32_3x* min, pg_f32_3x* max)
+{
+    *min = (pg_f32_3x){p.x < min->x ? p.x : min->x,
+                       p.y < min->y ? p.y : min->y,
+                       p.z < min->z ? p.z : min->z};
+    *max = (pg_f32_3x){p.x > max->x ? p.x : max->x,
+                       p.y > max->y ? p.y : max->y,
+                       p.z > max->z ? p.z : max->z};
+}
+
+// Builds the bounds of one primitive. Returns the number of joint boxes
+// written to `result_joints`, which must have room for `joint_count` boxes.
+// `joint_scratch` must also have room for `joint_count` boxes, where
+// `joint_count` is one more than the highest joint id of the vertices.
+FUNCTION u32
+bounds_build_primitive(pg_vertex* vertices,
+                       u32 vertex_count,
+                       u32 joint_count,
+                       joint_bounds* joint_scratch,
+                       primitive_bounds* result,
+                       joint_bounds* result_joints)
+{
+    pg_f32_3x empty_min = pg_f32_3x_pack(BOUNDS_UNBOUNDED_EXTENT);
+    pg_f32_3x empty_max = pg_f32_3x_pack(-BOUNDS_UNBOUNDED_EXTENT);
+    for (u32 i = 0; i < joint_count; i += 1)
+    {
+        joint_scratch[i]
+            = (joint_bounds){.min = empty_min, .joint_id = i, .max = empty_max};
+    }
+    result->min = empty_min;
+    result->max = empty_max;
+    result->static_vertex_count = 0;
+
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        pg_vertex* v = &vertices[i];
+        f32 weights[] = {v->joint_weights.x,
+                         v->joint_weights.y,
+                         v->joint_weights.z,
+                         v->joint_weights.w};
+        b8 weighted = false;
+        for (u32 j = 0; j < 4; j += 1)
+        {
+            if (weights[j] > 0.0f && v->joint_ids[j] < joint_count)
+            {
+                joint_bounds* jb = &joint_scratch[v->joint_ids[j]];
+                bounds_expand(v->position, &jb->min, &jb->max);
+                weighted = true;
+            }
+        }
+        if (!weighted)
+        {
+            bounds_expand(v->position, &result->min, &result->max);
+            result->static_vertex_count += 1;
+        }
+    }
+
+    u32 joint_bounds_count = 0;
+    for (u32 i = 0; i < joint_count; i += 1)
+    {
+        if (joint_scratch[i].min.x <= joint_scratch[i].max.x)
+        {
+            result_joints[joint_bounds_count] = joint_scratch[i];
+            joint_bounds_count += 1;
+        }
+    }
+    result->joint_bounds_count = joint_bounds_count;
+
+    return joint_bounds_count;
+}
+
+// Returns the model space box of a drawable as a center and half extent.
+FUNCTION void
+bounds_get_drawable_aabb(bounds* bs,
+                         primitive_bounds* pb,
+                         pg_f32_4x4* global_transform,
+                         pg_f32_4x4* joint_transforms,
+                         u32 joint_count,
+                         pg_f32_3x* center,
+                         pg_f32_3x* extent)
+{
+    pg_f32_3x min = pg_f32_3x_pack(BOUNDS_UNBOUNDED_EXTENT);
+    pg_f32_3x max = pg_f32_3x_pack(-BOUNDS_UNBOUNDED_EXTENT);
+
+    for (u32 i = 0; i <= pb->joint_bounds_count; i += 1)
+    {
+        pg_f32_3x box_min = pb->min;
+        pg_f32_3x box_max = pb->max;
+        pg_f32_4x4* transform = global_transform;
+        if (i < pb->joint_bounds_count)
+        {
+            joint_bounds* jb = &bs->joints[pb->joint_bounds_offset + i];
+            if (jb->joint_id >= joint_count)
+            {
+                // NOTE: The joint transforms do not match, so the drawable
+                // can not be bounded.
+                *center = (pg_f32_3x){0};
+                *extent = pg_f32_3x_pack(BOUNDS_UNBOUNDED_EXTENT);
+                return;
+            }
+            box_min = jb->min;
+            box_max = jb->max;
+            transform = &joint_transforms[jb->joint_id];
+        }
+        else if (!pb->static_vertex_count)
+        {
+            continue;
+        }
+
+        pg_f32_3x c = {0};
+        pg_f32_3x e = {0};
+        frustum_transform_aabb(transform,
+                               (pg_f32_3x){(box_min.x + box_max.x) * 0.5f,
+                                           (box_min.y + box_max.y) * 0.5f,
+                                           (box_min.z + box_max.z) * 0.5f},
+                               (pg_f32_3x){(box_max.x - box_min.x) * 0.5f,
+                                           (box_max.y - box_min.y) * 0.5f,
+                                           (box_max.z - box_min.z) * 0.5f},
+                               &c,
+                               &e);
+        bounds_expand((pg_f32_3x){c.x - e.x, c.y - e.y, c.z - e.z}, &min, &max);
+        bounds_expand((pg_f32_3x){c.x + e.x, c.y + e.y, c.z + e.z}, &min, &max);
+    }
+
+    if (min.x > max.x)
+    {
+        // NOTE: A primitive without vertices.
+        min = (pg_f32_3x){0};
+        max = (pg_f32_3x){0};
+    }
+    *center = (pg_f32_3x){(min.x + max.x) * 0.5f,
+                          (min.y + max.y) * 0.5f,
+                          (min.z + max.z) * 0.5f};
+    *extent = (pg_f32_3x){(max.x - min.x) * 0.5f,
+                          (max.y - min.y) * 0.5f,
+                          (max.z - min.z) * 0.5f};
+}
@@ -4,6 +4,78 @@ set -euo pipefail
 
 mkdir -p "$project_dir/build"
 
+if [[ "${compact_vertices:-0}" -eq 1 ]]; then
+    # NOTE: The shaders and the app must agree on the vertex format. Requires
+    # assets packed with --compact-vertices.
+    fxc_flags+=("-DCOMPACT_VERTICES")
+    vulkan_dxc_flags+=("-DCOMPACT_VERTICES")
+    cl_flags+=("-DAPP_COMPACT_VERTICES")
+    cc_flags+=("-DAPP_COMPACT_VERTICES")
+fi
+
+if [[ "${crowds:-0}" -eq 1 ]]; then
+    # NOTE: Sizes the instance and joint buffers for the largest crowd.
+    cl_flags+=("-DAPP_CROWDS")
+    cc_flags+=("-DAPP_CROWDS")
+fi
+
+if [[ "${pipelined_frames:-0}" -eq 1 ]]; then
+    # NOTE: Updates frames on their own thread. Not yet run on Windows.
+    cl_flags+=("-DAPP_PIPELINED_FRAMES")
+    cc_flags+=("-DAPP_PIPELINED_FRAMES")
+fi
+
+if [[ "${platform:-windows}" == "linux" ]]; then
+    # Headless Benchmark and Asset Packer Compilation
+    # NOTE: The Linux target has no window or GPU, so shader and resource
+    # compilation are skipped.
+    # -D: Set preprocessor macro
+    # -I: Set include dir path
+    # -o: Set output file path
+    # NOTE: The Linux targets only use the common library's platform-independent
+    # core header, which releases that only ship the Windows platform layer
+    # do not have.
+    if [[ ! -f "$common_library_dir/pg.h" ]]; then
+        echo "error: $common_library_dir/pg.h not found (the Linux targets need the common library's platform-independent core header)" >&2
+        exit 1
+    fi
+    cc_flags+=(
+        "-DLINUX"
+        "-I$common_library_dir"
+    )
+    compile_linux=(
+        "${cc:-cc}"
+        "$project_dir/$project_name.c"
+        "${cc_flags[@]}"
+        "-o" "$project_dir/build/$project_name"
+        "-lm"
+        "-pthread"
+    )
+    compile_asset_packer=(
+        "${cc:-cc}"
+        "$project_dir/asset_packer.c"
+        "${cc_flags[@]}"
+        "-o" "$project_dir/build/asset_packer"
+        "-lm"
+        "-pthread"
+    )
+    compile_skinning_test=(
+        "${cc:-cc}"
+        "$project_dir/skinning_test.c"
+        "${cc_flags[@]}"
+        "-o" "$project_dir/build/skinning_test"
+        "-lm"
+    )
+    "${compile_linux[@]}"
+    "${compile_asset_packer[@]}"
+    "${compile_skinning_test[@]}"
+    if [[ "${test:-0}" -eq 1 ]]; then
+        # NOTE: Fails the build if a skinning kernel disagrees with `vs`.
+        "$project_dir/build/skinning_test"
+    fi
+    exit 0
+fi
+
 if [[ "$all" -eq 1 ]]; then
     # Shader Compilation
     # -D: Set preprocessor macro
@@ -61,7 +133,11 @@ if [[ "$all" -eq 1 ]]; then
         "-vkbr" "t3" "0" "3" "0"
         "-vkbr" "t4" "0" "4" "0"
         "-vkbr" "t5" "0" "5" "0"
-        "-vkbr" "t6" "1" "6" "0"
+        "-vkbr" "t6" "0" "6" "0"
+        "-vkbr" "t7" "0" "7" "0"
+        "-vkbr" "t8" "0" "8" "0"
+        "-vkbr" "t9" "0" "9" "0"
+        "-vkbr" "t10" "1" "10" "0"
     )
     compile_vulkan_ps=(
         "$vulkan_dxc"
@@ -77,7 +153,11 @@ if [[ "$all" -eq 1 ]]; then
         "-vkbr" "t3" "0" "3" "0"
         "-vkbr" "t4" "0" "4" "0"
         "-vkbr" "t5" "0" "5" "0"
-        "-vkbr" "t6" "1" "6" "0"
+        "-vkbr" "t6" "0" "6" "0"
+        "-vkbr" "t7" "0" "7" "0"
+        "-vkbr" "t8" "0" "8" "0"
+        "-vkbr" "t9" "0" "9" "0"
+        "-vkbr" "t10" "1" "10" "0"
     )
     "${compile_d3d11_vs[@]}" > /dev/null
     "${compile_d3d11_ps[@]}" > /dev/null
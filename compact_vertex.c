@@ -0,0 +1,605 @@
+// Compact vertex format
+//
+// An opt-in alternative to the 96-byte `pg_vertex`, produced at pack time and
+// decoded in the vertex shader (`decode_vertex` in shaders.hlsl). Attributes
+// are split into streams so that models only pay for what they use:
+// - base (20 bytes, always present):
+//   - position: unorm16x3, relative to the bounds of its vertex range
+//   - normal/tangent: octahedral snorm16x2, tangent sign in a spare bit
+//   - texture coordinates: float16x2
+// - color (4 bytes, only if any vertex is not white): unorm8x4
+// - skin (12 bytes, only if any vertex is weighted): joint ids: u16x4, joint
+//   weights: unorm8x4 (renormalized to sum to 1)
+//
+// The CPU decoder below mirrors the shader exactly and is used to measure
+// quantization error at pack time.
+
+#include <xmmintrin.h>
+
+#define COMPACT_VERTEX_TANGENT_SIGN_BIT (1u << 16)
+
+#define COMPACT_VERTEX_WHITE 0xFFFFFFFF
+
+// NOTE: These are also the `vertex_flags` bits in `constants_cb`.
+typedef enum
+{
+    COMPACT_VERTEX_STREAM_COLOR = 1 << 0,
+    COMPACT_VERTEX_STREAM_SKIN = 1 << 1,
+} compact_vertex_stream;
+
+typedef struct
+{
+    u32 position_xy;
+    u32 position_z_tangent_sign;
+    u32 normal;
+    u32 tangent;
+    u32 tex_coord;
+} compact_vertex;
+static_assert(sizeof(compact_vertex) == 20, "unexpected compact vertex size");
+
+typedef struct
+{
+    u32 joint_ids[2];
+    u32 joint_weights;
+} compact_vertex_skin;
+static_assert(sizeof(compact_vertex_skin) == 12,
+              "unexpected compact vertex skin size");
+
+// NOTE: A vertex range is a primitive's vertices (see `vertex_offset` in
+// `pg_graphics_drawable`). Positions are quantized relative to its bounds.
+typedef struct
+{
+    u32 vertex_offset;
+    u32 vertex_count;
+    u32 padding0;
+    u32 padding1;
+    pg_f32_3x position_min;
+    f32 padding2;
+    pg_f32_3x position_extent;
+    f32 padding3;
+} compact_vertex_range;
+
+// NOTE: Layout of an ASSET_EXT_SECTION_COMPACT_VERTICES section: this header,
+// `range_count` ranges sorted by vertex offset, `vertex_count` base vertices,
+// then `vertex_count` colors and skins if their stream flags are set.
+typedef struct
+{
+    u32 vertex_count;
+    u32 range_count;
+    u32 stream_flags;
+    u32 padding0;
+} compact_vertices_header;
+
+typedef struct
+{
+    f32 max_position_error; // model units
+    f32 max_relative_position_error; // fraction of range bounds diagonal
+    f32 max_normal_error; // degrees
+    f32 max_tangent_error; // degrees
+    f32 max_tex_coord_error;
+    f32 max_color_error;
+    f32 max_joint_weight_error;
+    u32 joint_id_mismatch_count;
+} compact_vertex_error;
+
+FUNCTION f32
+compact_abs(f32 x)
+{
+    return x < 0.0f ? -x : x;
+}
+
+FUNCTION f32
+compact_clamp(f32 x, f32 min, f32 max)
+{
+    return x < min ? min : (x > max ? max : x);
+}
+
+FUNCTION f32
+compact_sqrt(f32 x)
+{
+    return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(x)));
+}
+
+FUNCTION u32
+compact_round(f32 x)
+{
+    return (u32)(x + 0.5f);
+}
+
+FUNCTION u16
+compact_f32_to_f16(f32 value)
+{
+    union
+    {
+        f32 f;
+        u32 u;
+    } bits = {.f = value};
+
+    u32 sign = (bits.u >> 16) & 0x8000;
+    s32 exponent = (s32)((bits.u >> 23) & 0xFF) - 127 + 15;
+    u32 mantissa = bits.u & 0x7FFFFF;
+
+    if (exponent <= 0)
+    {
+        // Denormal or zero
+        if (exponent < -10)
+        {
+            return (u16)sign;
+        }
+        mantissa |= 0x800000;
+        u32 shift = (u32)(14 - exponent);
+        u32 half_mantissa = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1)
+        {
+            half_mantissa += 1;
+        }
+        return (u16)(sign | half_mantissa);
+    }
+
+    if (exponent >= 31)
+    {
+        // NOTE: Out-of-range values saturate to the largest finite half.
+        return (u16)(sign | 0x7BFF);
+    }
+
+    u32 half = sign | ((u32)exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000)
+    {
+        half += 1; // round to nearest (may carry into the exponent)
+    }
+
+    return (u16)half;
+}
+
+FUNCTION f32
+compact_f16_to_f32(u32 half)
+{
+    u32 sign = (half >> 15) & 1;
+    u32 exponent = (half >> 10) & 0x1F;
+    u32 mantissa = half & 0x3FF;
+
+    f32 value = 0.0f;
+    if (exponent == 0)
+    {
+        value = (f32)mantissa * (1.0f / 16777216.0f); // 2^-24
+    }
+    else
+    {
+        f32 scale = 1.0f;
+        for (u32 i = 15; i < exponent; i += 1)
+        {
+            scale *= 2.0f;
+        }
+        for (u32 i = exponent; i < 15; i += 1)
+        {
+            scale *= 0.5f;
+        }
+        value = (1.0f + ((f32)mantissa / 1024.0f)) * scale;
+    }
+
+    return sign ? -value : value;
+}
+
+FUNCTION u32
+compact_snorm16x2(f32 x, f32 y)
+{
+    s32 qx = (s32)(compact_clamp(x, -1.0f, 1.0f) * 32767.0f
+                   + (x < 0.0f ? -0.5f : 0.5f));
+    s32 qy = (s32)(compact_clamp(y, -1.0f, 1.0f) * 32767.0f
+                   + (y < 0.0f ? -0.5f : 0.5f));
+    return ((u32)qx & 0xFFFF) | (((u32)qy & 0xFFFF) << 16);
+}
+
+FUNCTION f32
+compact_snorm16_to_f32(u32 q)
+{
+    f32 value = (f32)(s16)(q & 0xFFFF) / 32767.0f;
+    return value < -1.0f ? -1.0f : value;
+}
+
+FUNCTION u32
+compact_oct_encode(pg_f32_3x n)
+{
+    f32 l1 = compact_abs(n.x) + compact_abs(n.y) + compact_abs(n.z);
+    if (l1 == 0.0f)
+    {
+        return compact_snorm16x2(0.0f, 0.0f);
+    }
+
+    f32 x = n.x / l1;
+    f32 y = n.y / l1;
+    if (n.z < 0.0f)
+    {
+        f32 ox = (1.0f - compact_abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        f32 oy = (1.0f - compact_abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = ox;
+        y = oy;
+    }
+
+    return compact_snorm16x2(x, y);
+}
+
+FUNCTION pg_f32_3x
+compact_oct_decode(u32 q)
+{
+    f32 x = compact_snorm16_to_f32(q);
+    f32 y = compact_snorm16_to_f32(q >> 16);
+    pg_f32_3x n = {.x = x,
+                   .y = y,
+                   .z = 1.0f - compact_abs(x) - compact_abs(y)};
+    f32 t = n.z < 0.0f ? -n.z : 0.0f;
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+
+    f32 len = compact_sqrt((n.x * n.x) + (n.y * n.y) + (n.z * n.z));
+    if (len > 0.0f)
+    {
+        n.x /= len;
+        n.y /= len;
+        n.z /= len;
+    }
+
+    return n;
+}
+
+FUNCTION u32
+compact_quantize_position(f32 p, f32 min, f32 extent)
+{
+    if (extent <= 0.0f)
+    {
+        return 0;
+    }
+    return compact_round(compact_clamp((p - min) / extent, 0.0f, 1.0f)
+                         * 65535.0f);
+}
+
+FUNCTION void
+compact_vertex_range_bounds(pg_vertex* vertices, compact_vertex_range* range)
+{
+    pg_f32_3x min = vertices[range->vertex_offset].position;
+    pg_f32_3x max = min;
+    for (u32 i = 1; i < range->vertex_count; i += 1)
+    {
+        pg_f32_3x p = vertices[range->vertex_offset + i].position;
+        min.x = p.x < min.x ? p.x : min.x;
+        min.y = p.y < min.y ? p.y : min.y;
+        min.z = p.z < min.z ? p.z : min.z;
+        max.x = p.x > max.x ? p.x : max.x;
+        max.y = p.y > max.y ? p.y : max.y;
+        max.z = p.z > max.z ? p.z : max.z;
+    }
+
+    range->position_min = min;
+    range->position_extent
+        = (pg_f32_3x){max.x - min.x, max.y - min.y, max.z - min.z};
+}
+
+FUNCTION compact_vertex
+compact_vertex_encode(pg_vertex* v, compact_vertex_range* range)
+{
+    compact_vertex cv = {0};
+
+    pg_f32_3x min = range->position_min;
+    pg_f32_3x extent = range->position_extent;
+    cv.position_xy
+        = compact_quantize_position(v->position.x, min.x, extent.x)
+          | (compact_quantize_position(v->position.y, min.y, extent.y) << 16);
+    cv.position_z_tangent_sign
+        = compact_quantize_position(v->position.z, min.z, extent.z)
+          | (v->tangent.w < 0.0f ? COMPACT_VERTEX_TANGENT_SIGN_BIT : 0);
+
+    cv.normal = compact_oct_encode(v->normal);
+    cv.tangent = compact_oct_encode(
+        (pg_f32_3x){v->tangent.x, v->tangent.y, v->tangent.z});
+
+    cv.tex_coord = (u32)compact_f32_to_f16(v->tex_coord.x)
+                   | ((u32)compact_f32_to_f16(v->tex_coord.y) << 16);
+
+    return cv;
+}
+
+FUNCTION u32
+compact_vertex_encode_color(pg_vertex* v)
+{
+    u32 color = 0;
+    f32 channels[] = {v->color.x, v->color.y, v->color.z, v->color.w};
+    for (u32 i = 0; i < CAP(channels); i += 1)
+    {
+        color |= compact_round(compact_clamp(channels[i], 0.0f, 1.0f) * 255.0f)
+                 << (i * 8);
+    }
+
+    return color;
+}
+
+FUNCTION compact_vertex_skin
+compact_vertex_encode_skin(pg_vertex* v)
+{
+    compact_vertex_skin cs = {0};
+
+    cs.joint_ids[0] = (v->joint_ids[0] & 0xFFFF) | (v->joint_ids[1] << 16);
+    cs.joint_ids[1] = (v->joint_ids[2] & 0xFFFF) | (v->joint_ids[3] << 16);
+
+    // NOTE: Weights are renormalized so that the quantized weights still sum
+    // to exactly 1. Any rounding remainder goes to the largest weight.
+    f32 weights[] = {v->joint_weights.x,
+                     v->joint_weights.y,
+                     v->joint_weights.z,
+                     v->joint_weights.w};
+    f32 weight_sum = weights[0] + weights[1] + weights[2] + weights[3];
+    if (weight_sum > 0.0f)
+    {
+        u32 qw[4] = {0};
+        u32 q_sum = 0;
+        u32 largest = 0;
+        for (u32 i = 0; i < 4; i += 1)
+        {
+            qw[i] = compact_round(compact_clamp(weights[i] / weight_sum,
+                                                0.0f,
+                                                1.0f)
+                                  * 255.0f);
+            q_sum += qw[i];
+            largest = qw[i] > qw[largest] ? i : largest;
+        }
+        qw[largest] = (u32)((s32)qw[largest] + (255 - (s32)q_sum));
+        cs.joint_weights
+            = qw[0] | (qw[1] << 8) | (qw[2] << 16) | (qw[3] << 24);
+    }
+
+    return cs;
+}
+
+// NOTE: `color` and `skin` are null if the model has no such stream.
+FUNCTION pg_vertex
+compact_vertex_decode(compact_vertex* cv,
+                      u32* color,
+                      compact_vertex_skin* skin,
+                      compact_vertex_range* range)
+{
+    pg_vertex v = {0};
+
+    pg_f32_3x min = range->position_min;
+    pg_f32_3x extent = range->position_extent;
+    v.position = (pg_f32_3x){
+        min.x + ((f32)(cv->position_xy & 0xFFFF) / 65535.0f) * extent.x,
+        min.y + ((f32)(cv->position_xy >> 16) / 65535.0f) * extent.y,
+        min.z
+            + ((f32)(cv->position_z_tangent_sign & 0xFFFF) / 65535.0f)
+                  * extent.z};
+
+    v.normal = compact_oct_decode(cv->normal);
+    pg_f32_3x tangent = compact_oct_decode(cv->tangent);
+    v.tangent = (pg_f32_4x){
+        tangent.x,
+        tangent.y,
+        tangent.z,
+        (cv->position_z_tangent_sign & COMPACT_VERTEX_TANGENT_SIGN_BIT) ? -1.0f
+                                                                         : 1.0f};
+
+    v.tex_coord = (pg_f32_2x){.x = compact_f16_to_f32(cv->tex_coord & 0xFFFF),
+                              .y = compact_f16_to_f32(cv->tex_coord >> 16)};
+
+    u32 c = color ? *color : COMPACT_VERTEX_WHITE;
+    v.color = (pg_f32_4x){(f32)(c & 0xFF) / 255.0f,
+                          (f32)((c >> 8) & 0xFF) / 255.0f,
+                          (f32)((c >> 16) & 0xFF) / 255.0f,
+                          (f32)(c >> 24) / 255.0f};
+
+    if (skin)
+    {
+        v.joint_ids[0] = skin->joint_ids[0] & 0xFFFF;
+        v.joint_ids[1] = skin->joint_ids[0] >> 16;
+        v.joint_ids[2] = skin->joint_ids[1] & 0xFFFF;
+        v.joint_ids[3] = skin->joint_ids[1] >> 16;
+        v.joint_weights
+            = (pg_f32_4x){(f32)(skin->joint_weights & 0xFF) / 255.0f,
+                          (f32)((skin->joint_weights >> 8) & 0xFF) / 255.0f,
+                          (f32)((skin->joint_weights >> 16) & 0xFF) / 255.0f,
+                          (f32)(skin->joint_weights >> 24) / 255.0f};
+    }
+
+    return v;
+}
+
+FUNCTION f32
+compact_angle_between(pg_f32_3x a, pg_f32_3x b)
+{
+    f32 len_a = (a.x * a.x) + (a.y * a.y) + (a.z * a.z);
+    f32 len_b = (b.x * b.x) + (b.y * b.y) + (b.z * b.z);
+    if (len_a == 0.0f || len_b == 0.0f)
+    {
+        return 0.0f;
+    }
+
+    // NOTE: The chord length between the unit vectors approximates the angle
+    // (in radians) to within 1% below 15 degrees, which is the range of
+    // interest, and avoids acos losing precision for tiny angles.
+    f32 inv_a = 1.0f / compact_sqrt(len_a);
+    f32 inv_b = 1.0f / compact_sqrt(len_b);
+    pg_f32_3x d = {(a.x * inv_a) - (b.x * inv_b),
+                   (a.y * inv_a) - (b.y * inv_b),
+                   (a.z * inv_a) - (b.z * inv_b)};
+    f32 chord = compact_sqrt((d.x * d.x) + (d.y * d.y) + (d.z * d.z));
+
+    return chord * (180.0f / PG_PI);
+}
+
+FUNCTION void
+compact_vertex_measure_error(pg_vertex* original,
+                             pg_vertex* decoded,
+                             compact_vertex_range* range,
+                             compact_vertex_error* error)
+{
+    pg_f32_3x e = range->position_extent;
+    f32 diagonal_sq = (e.x * e.x) + (e.y * e.y) + (e.z * e.z);
+
+    pg_f32_3x dp = {original->position.x - decoded->position.x,
+                    original->position.y - decoded->position.y,
+                    original->position.z - decoded->position.z};
+    f32 position_error = compact_abs(dp.x);
+    position_error = compact_abs(dp.y) > position_error ? compact_abs(dp.y)
+                                                        : position_error;
+    position_error = compact_abs(dp.z) > position_error ? compact_abs(dp.z)
+                                                        : position_error;
+    if (position_error > error->max_position_error)
+    {
+        error->max_position_error = position_error;
+    }
+    if (diagonal_sq > 0.0f)
+    {
+        f32 relative = position_error / compact_sqrt(diagonal_sq);
+        if (relative > error->max_relative_position_error)
+        {
+            error->max_relative_position_error = relative;
+        }
+    }
+
+    f32 normal_error = compact_angle_between(original->normal, decoded->normal);
+    if (normal_error > error->max_normal_error)
+    {
+        error->max_normal_error = normal_error;
+    }
+
+    f32 tangent_error = compact_angle_between(
+        (pg_f32_3x){original->tangent.x, original->tangent.y, original->tangent.z},
+        (pg_f32_3x){decoded->tangent.x, decoded->tangent.y, decoded->tangent.z});
+    if (tangent_error > error->max_tangent_error)
+    {
+        error->max_tangent_error = tangent_error;
+    }
+
+    f32 uv_error = compact_abs(original->tex_coord.x - decoded->tex_coord.x);
+    f32 uv_error_y = compact_abs(original->tex_coord.y - decoded->tex_coord.y);
+    uv_error = uv_error_y > uv_error ? uv_error_y : uv_error;
+    if (uv_error > error->max_tex_coord_error)
+    {
+        error->max_tex_coord_error = uv_error;
+    }
+
+    f32 oc[] = {original->color.x,
+                original->color.y,
+                original->color.z,
+                original->color.w};
+    f32 dc[] = {decoded->color.x,
+                decoded->color.y,
+                decoded->color.z,
+                decoded->color.w};
+    f32 ow[] = {original->joint_weights.x,
+                original->joint_weights.y,
+                original->joint_weights.z,
+                original->joint_weights.w};
+    f32 dw[] = {decoded->joint_weights.x,
+                decoded->joint_weights.y,
+                decoded->joint_weights.z,
+                decoded->joint_weights.w};
+    for (u32 i = 0; i < 4; i += 1)
+    {
+        f32 color_error = compact_abs(compact_clamp(oc[i], 0.0f, 1.0f) - dc[i]);
+        if (color_error > error->max_color_error)
+        {
+            error->max_color_error = color_error;
+        }
+
+        f32 weight_error = compact_abs(ow[i] - dw[i]);
+        if (weight_error > error->max_joint_weight_error)
+        {
+            error->max_joint_weight_error = weight_error;
+        }
+
+        if (ow[i] > 0.0f && original->joint_ids[i] != decoded->joint_ids[i])
+        {
+            error->joint_id_mismatch_count += 1;
+        }
+    }
+}
+
+// NOTE: Binary search for the range containing `vertex_offset`.
+FUNCTION compact_vertex_range*
+compact_vertex_find_range(compact_vertex_range* ranges,
+                          u32 range_count,
+                          u32 vertex_offset)
+{
+    u32 lo = 0;
+    u32 hi = range_count;
+    while (lo < hi)
+    {
+        u32 mid = lo + ((hi - lo) / 2);
+        compact_vertex_range* r = &ranges[mid];
+        if (vertex_offset < r->vertex_offset)
+        {
+            hi = mid;
+        }
+        else if (vertex_offset >= r->vertex_offset + r->vertex_count)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            return r;
+        }
+    }
+
+    return 0;
+}
+
+typedef struct
+{
+    compact_vertex_range* ranges;
+    compact_vertex* vertices;
+    u32* colors;                // NOTE: Null without a color stream.
+    compact_vertex_skin* skins; // NOTE: Null without a skin stream.
+    u32 range_count;
+    u32 vertex_count;
+    u32 stream_flags;
+} compact_vertices;
+
+FUNCTION usize
+compact_vertices_section_size(u32 vertex_count,
+                              u32 range_count,
+                              u32 stream_flags)
+{
+    usize vertex_size
+        = sizeof(compact_vertex)
+          + ((stream_flags & COMPACT_VERTEX_STREAM_COLOR) ? sizeof(u32) : 0)
+          + ((stream_flags & COMPACT_VERTEX_STREAM_SKIN)
+                 ? sizeof(compact_vertex_skin)
+                 : 0);
+    return sizeof(compact_vertices_header)
+           + (range_count * sizeof(compact_vertex_range))
+           + (vertex_count * vertex_size);
+}
+
+FUNCTION b8
+compact_vertices_read(u8* section, u64 section_size, compact_vertices* cvs)
+{
+    *cvs = (compact_vertices){0};
+
+    compact_vertices_header* header = (compact_vertices_header*)section;
+    if (!section || section_size < sizeof(compact_vertices_header)
+        || section_size < compact_vertices_section_size(header->vertex_count,
+                                                        header->range_count,
+                                                        header->stream_flags))
+    {
+        return false;
+    }
+
+    cvs->range_count = header->range_count;
+    cvs->vertex_count = header->vertex_count;
+    cvs->stream_flags = header->stream_flags;
+    cvs->ranges
+        = (compact_vertex_range*)(section + sizeof(compact_vertices_header));
+    cvs->vertices = (compact_vertex*)(cvs->ranges + cvs->range_count);
+
+    u8* stream = (u8*)(cvs->vertices + cvs->vertex_count);
+    if (cvs->stream_flags & COMPACT_VERTEX_STREAM_COLOR)
+    {
+        cvs->colors = (u32*)stream;
+        stream += cvs->vertex_count * sizeof(u32);
+    }
+    if (cvs->stream_flags & COMPACT_VERTEX_STREAM_SKIN)
+    {
+        cvs->skins = (compact_vertex_skin*)stream;
+    }
+
+    return true;
+}
@@ -0,0 +1,234 @@
+// Draw lists
+//
+// Each frame, the draw ranges left after culling are turned into the draws
+// submitted to the renderer. Opaque draws are sorted by a 64-bit key so that
+// draws of the same texture set (art and material) are submitted together,
+// and draws of the same mesh (vertex offset) within it, which keeps material
+// and texture changes to about one per material. Translucent draws keep their
+// (back-to-front) order.
+//
+// Keys are sorted with a least significant digit radix sort, one byte per
+// pass. The sort is stable, so draws of the same mesh stay in index order.
+// Passes whose byte is the same for every key are skipped, which usually
+// leaves three or four of them.
+//
+// After sorting, neighboring draws with the same constants (mesh, material
+// and transform) whose index ranges are contiguous are merged into one draw.
+//
+// NOTE: Requires meshlet.c.
+
+#define DRAW_LIST_RADIX_BITS 8
+#define DRAW_LIST_RADIX_SIZE (1 << DRAW_LIST_RADIX_BITS)
+#define DRAW_LIST_PASS_COUNT (64 / DRAW_LIST_RADIX_BITS)
+
+typedef struct
+{
+    u32 range_count;                  // Before sorting and merging
+    u32 draw_count;                   // After
+    u32 material_change_count;        // Between ranges, before sorting
+    u32 sorted_material_change_count; // Between draws, after
+} draw_list_stats;
+
+// NOTE: The key is, from the most significant bits, 8 bits of art id, 16 bits
+// of material id and 40 bits of mesh (the vertex offset).
+FUNCTION u64
+draw_list_key(pg_graphics_drawable* d)
+{
+    return ((u64)(d->art_id & 0xFF) << 56)
+           | ((u64)(d->material_id & 0xFFFF) << 40) | (u64)d->vertex_offset;
+}
+
+// Sorts `keys` and their `values` by key, using `temp_keys` and `temp_values`
+// (at least `count` each) as the other buffer of every pass. Returns true if
+// the results ended up in the temporary buffers.
+FUNCTION b8
+draw_list_radix_sort(u64* keys,
+                     u32* values,
+                     u64* temp_keys,
+                     u32* temp_values,
+                     u32 count)
+{
+    // NOTE: Every pass's histogram is built in one read of the keys.
+    u32 counts[DRAW_LIST_PASS_COUNT][DRAW_LIST_RADIX_SIZE] = {0};
+    for (u32 i = 0; i < count; i += 1)
+    {
+        u64 key = keys[i];
+        for (u32 p = 0; p < DRAW_LIST_PASS_COUNT; p += 1)
+        {
+            counts[p][(key >> (p * DRAW_LIST_RADIX_BITS))
+                      & (DRAW_LIST_RADIX_SIZE - 1)]
+                += 1;
+        }
+    }
+
+    b8 swapped = false;
+    for (u32 p = 0; p < DRAW_LIST_PASS_COUNT; p += 1)
+    {
+        u32 shift = p * DRAW_LIST_RADIX_BITS;
+        u32* pass_counts = counts[p];
+        u32 digit = count ? (keys[0] >> shift) & (DRAW_LIST_RADIX_SIZE - 1) : 0;
+        if (pass_counts[digit] == count)
+        {
+            continue;
+        }
+
+        u32 offset = 0;
+        for (u32 d = 0; d < DRAW_LIST_RADIX_SIZE; d += 1)
+        {
+            u32 digit_count = pass_counts[d];
+            pass_counts[d] = offset;
+            offset += digit_count;
+        }
+        for (u32 i = 0; i < count; i += 1)
+        {
+            u32 d = (keys[i] >> shift) & (DRAW_LIST_RADIX_SIZE - 1);
+            u32 j = pass_counts[d];
+            pass_counts[d] += 1;
+            temp_keys[j] = keys[i];
+            temp_values[j] = values[i];
+        }
+
+        u64* k = keys;
+        keys = temp_keys;
+        temp_keys = k;
+        u32* v = values;
+        values = temp_values;
+        temp_values = v;
+        swapped = !swapped;
+    }
+
+    return swapped;
+}
+
+// Returns true if `b` can be drawn as part of `a`.
+FUNCTION b8
+draw_list_can_merge(meshlet_draw_range* a,
+                    meshlet_draw_range* b,
+                    pg_graphics_drawable* drawables,
+                    u32 opaque_drawable_count)
+{
+    if (a->index_offset + a->index_count != b->index_offset)
+    {
+        return false;
+    }
+    if ((a->drawable_id < opaque_drawable_count)
+        != (b->drawable_id < opaque_drawable_count))
+    {
+        return false;
+    }
+    if (a->drawable_id == b->drawable_id)
+    {
+        return true;
+    }
+
+    pg_graphics_drawable* da = &drawables[a->drawable_id];
+    pg_graphics_drawable* db = &drawables[b->drawable_id];
+    if (da->art_id != db->art_id || da->material_id != db->material_id
+        || da->vertex_offset != db->vertex_offset)
+    {
+        return false;
+    }
+    f32* ta = (f32*)&da->global_transform;
+    f32* tb = (f32*)&db->global_transform;
+    for (u32 i = 0; i < 16; i += 1)
+    {
+        if (ta[i] != tb[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Sorts the opaque draw ranges of `ranges` (which come first) by key, merges
+// neighboring ranges that can be drawn together, and writes the resulting
+// draws to `draws` (at most `range_count`). Returns the number of draws.
+FUNCTION u32
+draw_list_build(meshlet_draw_range* ranges,
+                u32 range_count,
+                pg_graphics_drawable* drawables,
+                u32 opaque_drawable_count,
+                pg_scratch_allocator* mem,
+                meshlet_draw_range* draws,
+                draw_list_stats* stats,
+                pg_error* err)
+{
+    *stats = (draw_list_stats){.range_count = range_count};
+
+    u32 opaque_count = 0;
+    while (opaque_count < range_count
+           && ranges[opaque_count].drawable_id < opaque_drawable_count)
+    {
+        opaque_count += 1;
+    }
+
+    // NOTE: The second half of each array is the other buffer of the sort. If
+    // they cannot be allocated, the draws are only merged.
+    u64* keys = 0;
+    u32* order = 0;
+    pg_scratch_alloc(mem,
+                     2 * opaque_count * sizeof(u64),
+                     alignof(u64),
+                     &keys,
+                     err);
+    pg_scratch_alloc(mem,
+                     2 * opaque_count * sizeof(u32),
+                     alignof(u32),
+                     &order,
+                     err);
+    if (!keys || !order)
+    {
+        opaque_count = 0;
+    }
+
+    for (u32 i = 0; i < opaque_count; i += 1)
+    {
+        keys[i] = draw_list_key(&drawables[ranges[i].drawable_id]);
+        order[i] = i;
+    }
+    if (opaque_count
+        && draw_list_radix_sort(keys,
+                                order,
+                                &keys[opaque_count],
+                                &order[opaque_count],
+                                opaque_count))
+    {
+        order = &order[opaque_count];
+    }
+
+    u32 draw_count = 0;
+    u32 last_material_id = 0xFFFFFFFF;
+    for (u32 i = 0; i < range_count; i += 1)
+    {
+        meshlet_draw_range* r = &ranges[i < opaque_count ? order[i] : i];
+        meshlet_draw_range* last = draw_count ? &draws[draw_count - 1] : 0;
+        if (last
+            && draw_list_can_merge(last, r, drawables, opaque_drawable_count))
+        {
+            last->index_count += r->index_count;
+            continue;
+        }
+
+        u32 material_id = drawables[r->drawable_id].material_id;
+        if (draw_count && material_id != last_material_id)
+        {
+            stats->sorted_material_change_count += 1;
+        }
+        last_material_id = material_id;
+        draws[draw_count] = *r;
+        draw_count += 1;
+    }
+
+    for (u32 i = 1; i < range_count; i += 1)
+    {
+        if (drawables[ranges[i].drawable_id].material_id
+            != drawables[ranges[i - 1].drawable_id].material_id)
+        {
+            stats->material_change_count += 1;
+        }
+    }
+    stats->draw_count = draw_count;
+
+    return draw_count;
+}
@@ -0,0 +1,113 @@
+// Read-only file memory mapping
+//
+// NOTE: Pages are faulted in on first access, so mapping a large file costs
+// neither a full read nor a full copy up front.
+// NOTE: A missing file is not an error here (some files are optional), so
+// callers report it themselves.
+
+#if defined(LINUX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+typedef struct
+{
+    u8* data;
+    usize size;
+} file_view;
+
+FUNCTION b8
+file_map(c8* path, file_view* view, pg_error* err)
+{
+    *view = (file_view){0};
+
+#if defined(LINUX)
+    s32 fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st = {0};
+    if (fstat(fd, &st) < 0 || st.st_size <= 0)
+    {
+        close(fd);
+        PG_ERROR_MAJOR("failed to get file size");
+        return false;
+    }
+
+    void* data = mmap(0, (usize)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        PG_ERROR_MAJOR("failed to map file");
+        return false;
+    }
+
+    // NOTE: Mapped files are mostly read front to back.
+    madvise(data, (usize)st.st_size, MADV_SEQUENTIAL);
+
+    view->data = data;
+    view->size = (usize)st.st_size;
+#elif defined(WINDOWS)
+    HANDLE file = CreateFileA(path,
+                              GENERIC_READ,
+                              FILE_SHARE_READ,
+                              0,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL,
+                              0);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER file_size = {0};
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0)
+    {
+        CloseHandle(file);
+        PG_ERROR_MAJOR("failed to get file size");
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        PG_ERROR_MAJOR("failed to create file mapping");
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+    {
+        PG_ERROR_MAJOR("failed to map file");
+        return false;
+    }
+
+    view->data = data;
+    view->size = (usize)file_size.QuadPart;
+#endif
+
+    return true;
+}
+
+FUNCTION void
+file_unmap(file_view* view)
+{
+    if (!view->data)
+    {
+        return;
+    }
+
+#if defined(LINUX)
+    munmap(view->data, view->size);
+#elif defined(WINDOWS)
+    UnmapViewOfFile(view->data);
+#endif
+
+    *view = (file_view){0};
+}
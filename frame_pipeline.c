@@ -0,0 +1,439 @@
+// Frame pipeline
+//
+// Runs the frame's update on its own thread, while the thread that renders
+// submits the last frame. The update thread writes each frame into a
+// snapshot: renderer data with its own buffer bindings and transient arena, so
+// nothing a snapshot points at is freed or rewritten until the render thread
+// is done with it. There are three snapshots, as in a triple buffer: the
+// update thread owns the back one, the render thread owns the front one, and
+// the third is shared. Publishing swaps the back snapshot with the shared one
+// by an atomic index exchange, and taking swaps the shared one with the front
+// one if it was published since, so the render thread always takes the newest
+// frame and neither thread waits for the other to finish with a snapshot.
+//
+// NOTE: The update thread does not start a frame until the render thread has
+// taken the last one it published, since the app's update advances by the
+// time of the last frame rendered. So no frame is dropped, and a frame is at
+// most one frame old when it is rendered. A thread only sleeps (on a
+// semaphore) when it has nothing to do: the render thread when nothing new was
+// published, and the update thread when its last frame was not taken yet.
+// NOTE: The pipeline's lock is not held while a frame is updated. The app
+// uses it to hand over what the render thread changes (e.g. input), and only
+// holds it to copy that.
+// NOTE: A snapshot keeps the buffer bindings of the last one published, since
+// the update only rebinds the buffers that changed.
+// NOTE: Requires job.c (for its atomics).
+
+#if defined(LINUX)
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+
+#define FRAME_SNAPSHOT_COUNT 3
+#define FRAME_SNAPSHOT_INDEX_MASK 0x3
+#define FRAME_SNAPSHOT_NEW 0x4 // Set on the shared index until it is taken
+
+typedef struct
+{
+    pg_graphics_renderer_data renderer_data;
+    pg_scratch_allocator transient_mem; // Freed when the snapshot is reused
+    u32 id; // Of the snapshot, e.g. to pick its copy of other buffers
+} frame_snapshot;
+
+typedef void (*frame_update_fp)(frame_snapshot* snapshot,
+                                void* data,
+                                pg_error* err);
+
+// NOTE: The shared index and the render thread's counts are on their own
+// cache lines, since both threads access them every frame.
+typedef struct
+{
+    frame_snapshot snapshots[FRAME_SNAPSHOT_COUNT];
+    alignas(JOB_CACHE_LINE_SIZE) volatile s64 shared; // Index, and if new
+    alignas(JOB_CACHE_LINE_SIZE) volatile s64 taken_count; // By render thread
+    volatile s64 released_count;                          // By render thread
+    volatile s64 update_waiting; // Until woken by the render thread
+    volatile s64 render_waiting; // Until woken by the update thread
+    volatile s64 quit;
+    u32 back;  // Of the update thread
+    u32 front; // Of the render thread
+    u32 last;  // Published by the update thread
+    u64 published_count; // By the update thread
+    frame_update_fp update_fp;
+    void* update_data;
+    pg_error error; // Of the update thread
+    b8 running;
+#if defined(LINUX)
+    pthread_mutex_t mutex; // Of the app, see the note above
+    sem_t update_wake;
+    sem_t render_wake;
+    pthread_t thread;
+#elif defined(WINDOWS)
+    SRWLOCK lock;
+    HANDLE update_wake;
+    HANDLE render_wake;
+    HANDLE thread;
+#endif
+} frame_pipeline;
+
+typedef b8 (*frame_pipeline_ready_fp)(frame_pipeline* fp);
+
+FUNCTION void
+frame_pipeline_lock(frame_pipeline* fp)
+{
+#if defined(LINUX)
+    pthread_mutex_lock(&fp->mutex);
+#elif defined(WINDOWS)
+    AcquireSRWLockExclusive(&fp->lock);
+#endif
+}
+
+FUNCTION void
+frame_pipeline_unlock(frame_pipeline* fp)
+{
+#if defined(LINUX)
+    pthread_mutex_unlock(&fp->mutex);
+#elif defined(WINDOWS)
+    ReleaseSRWLockExclusive(&fp->lock);
+#endif
+}
+
+// Sleeps the render (or update) thread until `ready` returns true.
+// NOTE: The thread is counted as waiting before it checks again, and the
+// other thread checks that after changing what it waits on (see
+// `frame_pipeline_wake`), so either it sees the change or it is woken. Only
+// one of them clears the flag, so the semaphore is posted once per sleep.
+FUNCTION void
+frame_pipeline_wait(frame_pipeline* fp,
+                    b8 render,
+                    frame_pipeline_ready_fp ready)
+{
+    volatile s64* waiting = render ? &fp->render_waiting : &fp->update_waiting;
+    while (!ready(fp))
+    {
+        job_store_release(waiting, true);
+        job_fence();
+        if (ready(fp) && job_exchange(waiting, false))
+        {
+            break;
+        }
+
+#if defined(LINUX)
+        while (sem_wait(render ? &fp->render_wake : &fp->update_wake))
+        {
+            // NOTE: Retry if interrupted by a signal.
+        }
+#elif defined(WINDOWS)
+        WaitForSingleObject(render ? fp->render_wake : fp->update_wake,
+                            INFINITE);
+#endif
+    }
+}
+
+// Wakes the render (or update) thread if it is waiting.
+FUNCTION void
+frame_pipeline_wake(frame_pipeline* fp, b8 render)
+{
+    volatile s64* waiting = render ? &fp->render_waiting : &fp->update_waiting;
+    job_fence();
+    if (job_load_acquire(waiting) && job_exchange(waiting, false))
+    {
+#if defined(LINUX)
+        sem_post(render ? &fp->render_wake : &fp->update_wake);
+#elif defined(WINDOWS)
+        ReleaseSemaphore(render ? fp->render_wake : fp->update_wake, 1, 0);
+#endif
+    }
+}
+
+FUNCTION b8
+frame_pipeline_published(frame_pipeline* fp)
+{
+    return (job_load_acquire(&fp->shared) & FRAME_SNAPSHOT_NEW)
+           || job_load_acquire(&fp->quit);
+}
+
+FUNCTION b8
+frame_pipeline_taken(frame_pipeline* fp)
+{
+    return !(job_load_acquire(&fp->shared) & FRAME_SNAPSHOT_NEW)
+           || job_load_acquire(&fp->quit);
+}
+
+FUNCTION b8
+frame_pipeline_released(frame_pipeline* fp)
+{
+    return job_load_acquire(&fp->released_count)
+               == job_load_acquire(&fp->taken_count)
+           || job_load_acquire(&fp->quit);
+}
+
+// Copies the renderer data of `src` (but not the memory it points at, other
+// than its buffer bindings) to `dst`.
+FUNCTION void
+frame_renderer_data_copy(pg_graphics_renderer_data* src,
+                         pg_graphics_renderer_data* dst,
+                         pg_error* err)
+{
+    pg_graphics_buffer_data* buffer_data = dst->buffer_data;
+    pg_copy(src->buffer_data,
+            src->buffer_count * sizeof(pg_graphics_buffer_data),
+            buffer_data,
+            src->buffer_count * sizeof(pg_graphics_buffer_data),
+            err);
+    *dst = *src;
+    dst->buffer_data = buffer_data;
+}
+
+FUNCTION void
+frame_pipeline_init(frame_pipeline* fp,
+                    pg_graphics_renderer_data* renderer_data,
+                    usize transient_mem_size,
+                    pg_scratch_allocator* mem,
+                    pg_error* err)
+{
+    *fp = (frame_pipeline){0};
+
+    for (u32 i = 0; i < FRAME_SNAPSHOT_COUNT; i += 1)
+    {
+        frame_snapshot* s = &fp->snapshots[i];
+        s->id = i;
+        s->renderer_data = *renderer_data;
+
+        u8* transient_memory = 0;
+        pg_scratch_alloc(mem,
+                         renderer_data->buffer_count
+                             * sizeof(pg_graphics_buffer_data),
+                         alignof(pg_graphics_buffer_data),
+                         &s->renderer_data.buffer_data,
+                         err);
+        pg_scratch_alloc(mem,
+                         transient_mem_size,
+                         PG_KIBIBYTE(4),
+                         &transient_memory,
+                         err);
+        pg_scratch_init(&s->transient_mem,
+                        transient_memory,
+                        transient_memory ? transient_mem_size : 0);
+    }
+
+#if defined(WINDOWS)
+    InitializeSRWLock(&fp->lock);
+#elif defined(LINUX)
+    if (pthread_mutex_init(&fp->mutex, 0))
+    {
+        PG_ERROR_MAJOR("failed to create frame pipeline lock");
+    }
+#endif
+}
+
+// Waits for the render thread to take the last snapshot published, and
+// returns the back snapshot with the bindings of that one. Returns 0 if the
+// pipeline is stopping.
+FUNCTION frame_snapshot*
+frame_pipeline_acquire(frame_pipeline* fp, pg_error* err)
+{
+    frame_pipeline_wait(fp, false, &frame_pipeline_taken);
+    if (job_load_acquire(&fp->quit))
+    {
+        return 0;
+    }
+
+    // NOTE: The last snapshot published is only read by the render thread.
+    frame_snapshot* s = &fp->snapshots[fp->back];
+    if (fp->published_count)
+    {
+        frame_renderer_data_copy(&fp->snapshots[fp->last].renderer_data,
+                                 &s->renderer_data,
+                                 err);
+    }
+    pg_scratch_free(&s->transient_mem);
+
+    return s;
+}
+
+// Swaps the back snapshot with the shared one, marked as new.
+FUNCTION void
+frame_pipeline_publish(frame_pipeline* fp)
+{
+    fp->last = fp->back;
+    fp->back = (u32)(job_exchange(&fp->shared, fp->back | FRAME_SNAPSHOT_NEW)
+                     & FRAME_SNAPSHOT_INDEX_MASK);
+    fp->published_count += 1;
+    frame_pipeline_wake(fp, true);
+}
+
+// Waits for a snapshot to be published, and swaps the front snapshot with it.
+// Returns the new front snapshot.
+// NOTE: Only the render thread clears the new flag, so the shared snapshot is
+// still new when it is swapped, even if another was published in between.
+FUNCTION frame_snapshot*
+frame_pipeline_take(frame_pipeline* fp)
+{
+    frame_pipeline_wait(fp, true, &frame_pipeline_published);
+    fp->front = (u32)(job_exchange(&fp->shared, fp->front)
+                      & FRAME_SNAPSHOT_INDEX_MASK);
+    job_add(&fp->taken_count, 1);
+    frame_pipeline_wake(fp, false);
+
+    return &fp->snapshots[fp->front];
+}
+
+FUNCTION void
+frame_pipeline_release(frame_pipeline* fp)
+{
+    job_add(&fp->released_count, 1);
+    frame_pipeline_wake(fp, false);
+}
+
+// Waits until the render thread has released every snapshot but the one
+// being updated, e.g. before the update rewrites memory they point at.
+// NOTE: Called by the update thread while it updates a frame, so the last
+// snapshot published was already taken. It must not hold the lock, since the
+// render thread may need it to finish.
+FUNCTION void
+frame_pipeline_flush(frame_pipeline* fp)
+{
+    if (!fp->running)
+    {
+        return;
+    }
+
+    frame_pipeline_wait(fp, false, &frame_pipeline_released);
+}
+
+FUNCTION void
+frame_pipeline_loop(frame_pipeline* fp)
+{
+    for (;;)
+    {
+        frame_snapshot* s = frame_pipeline_acquire(fp, &fp->error);
+        if (!s)
+        {
+            break;
+        }
+
+        fp->update_fp(s, fp->update_data, &fp->error);
+
+        frame_pipeline_publish(fp);
+    }
+}
+
+#if defined(LINUX)
+FUNCTION void*
+frame_pipeline_thread_main(void* data)
+{
+    frame_pipeline_loop(data);
+    return 0;
+}
+#elif defined(WINDOWS)
+FUNCTION DWORD WINAPI
+frame_pipeline_thread_main(LPVOID data)
+{
+    frame_pipeline_loop(data);
+    return 0;
+}
+#endif
+
+// Starts updating frames on the update thread, from the bindings of
+// `renderer_data`. Returns false if the thread did not start, in which case
+// frames can still be updated serially.
+FUNCTION b8
+frame_pipeline_start(frame_pipeline* fp,
+                     pg_graphics_renderer_data* renderer_data,
+                     frame_update_fp update_fp,
+                     void* update_data,
+                     pg_error* err)
+{
+    for (u32 i = 0; i < FRAME_SNAPSHOT_COUNT; i += 1)
+    {
+        frame_renderer_data_copy(renderer_data,
+                                 &fp->snapshots[i].renderer_data,
+                                 err);
+    }
+    fp->update_fp = update_fp;
+    fp->update_data = update_data;
+    fp->error = *err;
+    fp->back = 0;
+    fp->front = 1;
+    fp->last = 0;
+    fp->published_count = 0;
+    job_store_release(&fp->shared, 2);
+    job_store_release(&fp->taken_count, 0);
+    job_store_release(&fp->released_count, 0);
+    job_store_release(&fp->update_waiting, false);
+    job_store_release(&fp->render_waiting, false);
+    job_store_release(&fp->quit, false);
+    fp->running = true; // NOTE: Before the update thread reads it.
+
+#if defined(LINUX)
+    if (sem_init(&fp->update_wake, 0, 0) || sem_init(&fp->render_wake, 0, 0))
+    {
+        PG_ERROR_MAJOR("failed to create frame pipeline semaphores");
+        fp->running = false;
+        return false;
+    }
+    if (pthread_create(&fp->thread, 0, &frame_pipeline_thread_main, fp))
+    {
+        sem_destroy(&fp->render_wake);
+        sem_destroy(&fp->update_wake);
+        fp->running = false;
+        return false;
+    }
+#elif defined(WINDOWS)
+    // NOTE: A waiting thread is only woken once per sleep.
+    fp->update_wake = CreateSemaphoreW(0, 0, 1, 0);
+    fp->render_wake = CreateSemaphoreW(0, 0, 1, 0);
+    if (!fp->update_wake || !fp->render_wake)
+    {
+        PG_ERROR_MAJOR("failed to create frame pipeline semaphores");
+        fp->running = false;
+        return false;
+    }
+    fp->thread = CreateThread(0, 0, &frame_pipeline_thread_main, fp, 0, 0);
+    if (!fp->thread)
+    {
+        CloseHandle(fp->render_wake);
+        CloseHandle(fp->update_wake);
+        fp->running = false;
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+// Stops the update thread, dropping any snapshot not yet taken, and copies
+// the bindings of the last snapshot it published back to `renderer_data`.
+// NOTE: Must not be called while the render thread holds a snapshot.
+FUNCTION void
+frame_pipeline_stop(frame_pipeline* fp,
+                    pg_graphics_renderer_data* renderer_data,
+                    pg_error* err)
+{
+    if (!fp->running)
+    {
+        return;
+    }
+
+    job_store_release(&fp->quit, true);
+    frame_pipeline_wake(fp, false);
+#if defined(LINUX)
+    pthread_join(fp->thread, 0);
+    sem_destroy(&fp->render_wake);
+    sem_destroy(&fp->update_wake);
+#elif defined(WINDOWS)
+    WaitForSingleObject(fp->thread, INFINITE);
+    CloseHandle(fp->thread);
+    CloseHandle(fp->render_wake);
+    CloseHandle(fp->update_wake);
+#endif
+    fp->running = false;
+
+    if (fp->published_count)
+    {
+        frame_renderer_data_copy(&fp->snapshots[fp->last].renderer_data,
+                                 renderer_data,
+                                 err);
+    }
+}
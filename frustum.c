@@ -0,0 +1,224 @@
+// Frustum culling
+//
+// Planes are extracted from a clip-from-space matrix (Gribb-Hartmann), so
+// bounds can be tested in the space they are stored in. Axis-aligned boxes are
+// tested in batches, 8 at a time with AVX and 4 at a time with SSE.
+//
+// NOTE: Matrices are column-major in memory, since the shaders read them with
+// HLSL's default packing and multiply them with column vectors.
+// NOTE: Depth is assumed to be in [0, 1].
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_BATCH_SIZE 8
+#else
+#include <xmmintrin.h>
+#define FRUSTUM_BATCH_SIZE 4
+#endif
+
+#define FRUSTUM_PLANE_COUNT 6
+
+// NOTE: Planes are normalized, and points inside have a positive distance.
+typedef struct
+{
+    pg_f32_4x planes[FRUSTUM_PLANE_COUNT];
+} frustum;
+
+// NOTE: Boxes are stored as centers and half extents, one array per component,
+// with room for a multiple of FRUSTUM_BATCH_SIZE boxes.
+typedef struct
+{
+    f32* center_x;
+    f32* center_y;
+    f32* center_z;
+    f32* extent_x;
+    f32* extent_y;
+    f32* extent_z;
+    u32 count;
+} frustum_aabbs;
+
+FUNCTION f32
+frustum_sqrt(f32 x)
+{
+    return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(x)));
+}
+
+FUNCTION f32
+frustum_matrix_get(pg_f32_4x4* m, u32 row, u32 column)
+{
+    return ((f32*)m)[(column * 4) + row];
+}
+
+// NOTE: `w` is 1.0f for points and 0.0f for directions.
+FUNCTION pg_f32_3x
+frustum_transform(pg_f32_4x4* m, pg_f32_3x v, f32 w)
+{
+    return (pg_f32_3x){(frustum_matrix_get(m, 0, 0) * v.x)
+                           + (frustum_matrix_get(m, 0, 1) * v.y)
+                           + (frustum_matrix_get(m, 0, 2) * v.z)
+                           + (frustum_matrix_get(m, 0, 3) * w),
+                       (frustum_matrix_get(m, 1, 0) * v.x)
+                           + (frustum_matrix_get(m, 1, 1) * v.y)
+                           + (frustum_matrix_get(m, 1, 2) * v.z)
+                           + (frustum_matrix_get(m, 1, 3) * w),
+                       (frustum_matrix_get(m, 2, 0) * v.x)
+                           + (frustum_matrix_get(m, 2, 1) * v.y)
+                           + (frustum_matrix_get(m, 2, 2) * v.z)
+                           + (frustum_matrix_get(m, 2, 3) * w)};
+}
+
+// Transforms a box given by its center and half extent, and returns the box
+// that bounds the result (Arvo).
+FUNCTION void
+frustum_transform_aabb(pg_f32_4x4* m,
+                       pg_f32_3x center,
+                       pg_f32_3x extent,
+                       pg_f32_3x* result_center,
+                       pg_f32_3x* result_extent)
+{
+    *result_center = frustum_transform(m, center, 1.0f);
+
+    f32 e[3] = {0};
+    for (u32 i = 0; i < 3; i += 1)
+    {
+        f32 x = frustum_matrix_get(m, i, 0);
+        f32 y = frustum_matrix_get(m, i, 1);
+        f32 z = frustum_matrix_get(m, i, 2);
+        e[i] = ((x < 0.0f ? -x : x) * extent.x)
+               + ((y < 0.0f ? -y : y) * extent.y)
+               + ((z < 0.0f ? -z : z) * extent.z);
+    }
+    *result_extent = (pg_f32_3x){e[0], e[1], e[2]};
+}
+
+// Returns the normalized plane a + (s * b).
+FUNCTION pg_f32_4x
+frustum_plane(pg_f32_4x a, f32 s, pg_f32_4x b)
+{
+    pg_f32_4x p = {a.x + (s * b.x),
+                   a.y + (s * b.y),
+                   a.z + (s * b.z),
+                   a.w + (s * b.w)};
+    f32 length = frustum_sqrt((p.x * p.x) + (p.y * p.y) + (p.z * p.z));
+    return length > 0.0f ? (pg_f32_4x){p.x / length,
+                                       p.y / length,
+                                       p.z / length,
+                                       p.w / length}
+                         : p;
+}
+
+FUNCTION void
+frustum_from_matrix(pg_f32_4x4* clip_from_space, frustum* f)
+{
+    pg_f32_4x rows[4] = {0};
+    for (u32 i = 0; i < 4; i += 1)
+    {
+        rows[i] = (pg_f32_4x){frustum_matrix_get(clip_from_space, i, 0),
+                              frustum_matrix_get(clip_from_space, i, 1),
+                              frustum_matrix_get(clip_from_space, i, 2),
+                              frustum_matrix_get(clip_from_space, i, 3)};
+    }
+
+    f->planes[0] = frustum_plane(rows[3], 1.0f, rows[0]);         // Left
+    f->planes[1] = frustum_plane(rows[3], -1.0f, rows[0]);        // Right
+    f->planes[2] = frustum_plane(rows[3], 1.0f, rows[1]);         // Bottom
+    f->planes[3] = frustum_plane(rows[3], -1.0f, rows[1]);        // Top
+    f->planes[4] = frustum_plane((pg_f32_4x){0}, 1.0f, rows[2]); // Near
+    f->planes[5] = frustum_plane(rows[3], -1.0f, rows[2]);        // Far
+}
+
+FUNCTION b8
+frustum_test_sphere(frustum* f, pg_f32_3x center, f32 radius)
+{
+    for (u32 i = 0; i < FRUSTUM_PLANE_COUNT; i += 1)
+    {
+        pg_f32_4x* p = &f->planes[i];
+        if ((p->x * center.x) + (p->y * center.y) + (p->z * center.z) + p->w
+            < -radius)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Tests every box and sets `visible[i]` to whether box i intersects the
+// frustum. Returns the number of visible boxes.
+// NOTE: A box is outside if it is entirely behind one plane, so boxes that
+// straddle two planes outside a corner are conservatively kept.
+FUNCTION u32
+frustum_test_aabbs(frustum* f, frustum_aabbs* aabbs, b8* visible)
+{
+    u32 visible_count = 0;
+    for (u32 i = 0; i < aabbs->count; i += FRUSTUM_BATCH_SIZE)
+    {
+#if defined(__AVX__)
+        __m256 cx = _mm256_loadu_ps(&aabbs->center_x[i]);
+        __m256 cy = _mm256_loadu_ps(&aabbs->center_y[i]);
+        __m256 cz = _mm256_loadu_ps(&aabbs->center_z[i]);
+        __m256 ex = _mm256_loadu_ps(&aabbs->extent_x[i]);
+        __m256 ey = _mm256_loadu_ps(&aabbs->extent_y[i]);
+        __m256 ez = _mm256_loadu_ps(&aabbs->extent_z[i]);
+        __m256 outside = _mm256_setzero_ps();
+        for (u32 j = 0; j < FRUSTUM_PLANE_COUNT; j += 1)
+        {
+            pg_f32_4x* p = &f->planes[j];
+            // distance = dot(n, c) + w, radius = dot(abs(n), e)
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p->x), cx),
+                              _mm256_mul_ps(_mm256_set1_ps(p->y), cy)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p->z), cz),
+                              _mm256_set1_ps(p->w)));
+            __m256 radius = _mm256_add_ps(
+                _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_set1_ps(p->x < 0.0f ? -p->x : p->x),
+                                  ex),
+                    _mm256_mul_ps(_mm256_set1_ps(p->y < 0.0f ? -p->y : p->y),
+                                  ey)),
+                _mm256_mul_ps(_mm256_set1_ps(p->z < 0.0f ? -p->z : p->z), ez));
+            outside = _mm256_or_ps(
+                outside,
+                _mm256_cmp_ps(_mm256_add_ps(distance, radius),
+                              _mm256_setzero_ps(),
+                              _CMP_LT_OQ));
+        }
+        u32 outside_mask = (u32)_mm256_movemask_ps(outside);
+#else
+        __m128 cx = _mm_loadu_ps(&aabbs->center_x[i]);
+        __m128 cy = _mm_loadu_ps(&aabbs->center_y[i]);
+        __m128 cz = _mm_loadu_ps(&aabbs->center_z[i]);
+        __m128 ex = _mm_loadu_ps(&aabbs->extent_x[i]);
+        __m128 ey = _mm_loadu_ps(&aabbs->extent_y[i]);
+        __m128 ez = _mm_loadu_ps(&aabbs->extent_z[i]);
+        __m128 outside = _mm_setzero_ps();
+        for (u32 j = 0; j < FRUSTUM_PLANE_COUNT; j += 1)
+        {
+            pg_f32_4x* p = &f->planes[j];
+            // distance = dot(n, c) + w, radius = dot(abs(n), e)
+            __m128 distance
+                = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p->x), cx),
+                                        _mm_mul_ps(_mm_set1_ps(p->y), cy)),
+                             _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p->z), cz),
+                                        _mm_set1_ps(p->w)));
+            __m128 radius = _mm_add_ps(
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_set1_ps(p->x < 0.0f ? -p->x : p->x), ex),
+                    _mm_mul_ps(_mm_set1_ps(p->y < 0.0f ? -p->y : p->y), ey)),
+                _mm_mul_ps(_mm_set1_ps(p->z < 0.0f ? -p->z : p->z), ez));
+            outside = _mm_or_ps(outside,
+                                _mm_cmplt_ps(_mm_add_ps(distance, radius),
+                                             _mm_setzero_ps()));
+        }
+        u32 outside_mask = (u32)_mm_movemask_ps(outside);
+#endif
+
+        for (u32 j = 0; j < FRUSTUM_BATCH_SIZE && i + j < aabbs->count; j += 1)
+        {
+            visible[i + j] = !(outside_mask & (1u << j));
+            visible_count += visible[i + j];
+        }
+    }
+
+    return visible_count;
+}
@@ -0,0 +1,1114 @@
+// glTF 2.0 binary (.glb) loader
+//
+// The file is memory-mapped and its JSON chunk is tokenized once into a flat
+// token array. The accessors, buffer views and meshes are indexed once, so
+// looking one up by id does not walk its array. Accessors into the BIN chunk
+// are exposed as zero-copy views (pointer + stride), and data is only
+// converted when the destination layout requires it (interleaving into
+// `pg_vertex`, widening indices).
+//
+// NOTE: Requires file_map.c (to map the file).
+// NOTE: The viewer renders from the .pga, whose layout belongs to the asset
+// compiler. This loader feeds the packer and the viewer's `--glb` open-time
+// measurement; it does not replace the .pga at runtime.
+// NOTE: Only what the viewer consumes is supported: triangle-list primitives,
+// non-sparse accessors (or zero-filled ones, without a buffer view), and
+// buffers embedded in the BIN chunk.
+
+#define GLB_MAGIC 0x46546C67 // "glTF"
+#define GLB_VERSION 2
+#define GLB_CHUNK_JSON 0x4E4F534A // "JSON"
+#define GLB_CHUNK_BIN 0x004E4942  // "BIN\0"
+#define GLB_HEADER_SIZE 12
+#define GLB_CHUNK_HEADER_SIZE 8
+
+#define JSON_MAX_DEPTH 64
+#define JSON_INVALID_TOKEN 0xFFFFFFFF
+
+typedef enum
+{
+    GLB_COMPONENT_TYPE_S8 = 5120,
+    GLB_COMPONENT_TYPE_U8 = 5121,
+    GLB_COMPONENT_TYPE_S16 = 5122,
+    GLB_COMPONENT_TYPE_U16 = 5123,
+    GLB_COMPONENT_TYPE_U32 = 5125,
+    GLB_COMPONENT_TYPE_F32 = 5126
+} glb_component_type;
+
+typedef enum
+{
+    GLB_PRIMITIVE_MODE_TRIANGLES = 4
+} glb_primitive_mode;
+
+typedef enum
+{
+    JSON_TOKEN_NONE,
+    JSON_TOKEN_OBJECT,
+    JSON_TOKEN_ARRAY,
+    JSON_TOKEN_STRING,
+    JSON_TOKEN_PRIMITIVE
+} json_token_type;
+
+// NOTE: `child_count` counts direct child tokens (an object's keys and values
+// are both children). `next` is the index of the first token after this
+// token's subtree, which makes skipping a subtree O(1).
+typedef struct
+{
+    json_token_type type;
+    u32 start;
+    u32 end;
+    u32 child_count;
+    u32 next;
+} json_token;
+
+typedef struct
+{
+    file_view view;
+    c8* json;
+    u32 json_size;
+    u8* bin;
+    u32 bin_size;
+    json_token* tokens;
+    u32 token_count;
+    u32* accessors;    // Token of each accessor
+    u32* buffer_views; // Token of each buffer view
+    u32* meshes;       // Token of each mesh
+    u32 accessor_count;
+    u32 buffer_view_count;
+    u32 mesh_count;
+} glb_file;
+
+// NOTE: A zero-copy view of an accessor's elements in the BIN chunk. Element
+// `i` starts at `data + (i * stride)`. The stride is 0 if the accessor is
+// zero-filled.
+typedef struct
+{
+    u8* data;
+    u32 count;
+    u32 stride;
+    glb_component_type component_type;
+    u32 component_count;
+    b8 normalized;
+} glb_accessor;
+
+// NOTE: Large enough for the largest element (a 4x4 matrix of 32-bit
+// components).
+GLOBAL u8 glb_zero_element[64];
+
+typedef struct
+{
+    u32 vertex_offset;
+    u32 vertex_count;
+    u32 index_offset;
+    u32 index_count;
+    u32 mesh_id;
+    u32 material_id;
+} glb_primitive;
+
+typedef struct
+{
+    u32 vertex_count;
+    u32 index_count;
+    u32 primitive_count;
+    pg_vertex* vertices;
+    PG_GRAPHICS_INDEX_TYPE* indices;
+    glb_primitive* primitives;
+    usize converted_index_size;
+    usize mapped_index_size;
+} glb_model;
+
+FUNCTION u32
+glb_read_u32(u8* data)
+{
+    return (u32)data[0] | ((u32)data[1] << 8) | ((u32)data[2] << 16)
+           | ((u32)data[3] << 24);
+}
+
+// NOTE: If `tokens` is null, tokens are only counted.
+FUNCTION u32
+json_parse(c8* json, u32 json_size, json_token* tokens, pg_error* err)
+{
+    u32 token_count = 0;
+    u32 stack[JSON_MAX_DEPTH] = {0};
+    u32 depth = 0;
+
+    for (u32 pos = 0; pos < json_size; pos += 1)
+    {
+        c8 c = json[pos];
+        switch (c)
+        {
+            case '{':
+            case '[':
+            {
+                if (depth == JSON_MAX_DEPTH)
+                {
+                    PG_ERROR_MAJOR("json nesting exceeds max depth");
+                    return 0;
+                }
+                if (tokens)
+                {
+                    if (depth)
+                    {
+                        tokens[stack[depth - 1]].child_count += 1;
+                    }
+                    tokens[token_count] = (json_token){
+                        .type = c == '{' ? JSON_TOKEN_OBJECT : JSON_TOKEN_ARRAY,
+                        .start = pos};
+                }
+                stack[depth] = token_count;
+                depth += 1;
+                token_count += 1;
+                break;
+            }
+            case '}':
+            case ']':
+            {
+                if (!depth)
+                {
+                    PG_ERROR_MAJOR("unbalanced json container");
+                    return 0;
+                }
+                depth -= 1;
+                if (tokens)
+                {
+                    tokens[stack[depth]].end = pos + 1;
+                    tokens[stack[depth]].next = token_count;
+                }
+                break;
+            }
+            case '"':
+            {
+                u32 start = pos + 1;
+                for (pos = start; pos < json_size && json[pos] != '"';
+                     pos += 1)
+                {
+                    if (json[pos] == '\\')
+                    {
+                        pos += 1;
+                    }
+                }
+                if (pos >= json_size)
+                {
+                    PG_ERROR_MAJOR("unterminated json string");
+                    return 0;
+                }
+                if (tokens)
+                {
+                    if (depth)
+                    {
+                        tokens[stack[depth - 1]].child_count += 1;
+                    }
+                    tokens[token_count]
+                        = (json_token){.type = JSON_TOKEN_STRING,
+                                       .start = start,
+                                       .end = pos,
+                                       .next = token_count + 1};
+                }
+                token_count += 1;
+                break;
+            }
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+            case ':':
+            case ',':
+            case '\0':
+            {
+                break;
+            }
+            default:
+            {
+                u32 start = pos;
+                for (; pos < json_size; pos += 1)
+                {
+                    c8 d = json[pos];
+                    if (d == ',' || d == ']' || d == '}' || d == ' '
+                        || d == '\t' || d == '\r' || d == '\n')
+                    {
+                        break;
+                    }
+                }
+                if (tokens)
+                {
+                    if (depth)
+                    {
+                        tokens[stack[depth - 1]].child_count += 1;
+                    }
+                    tokens[token_count]
+                        = (json_token){.type = JSON_TOKEN_PRIMITIVE,
+                                       .start = start,
+                                       .end = pos,
+                                       .next = token_count + 1};
+                }
+                token_count += 1;
+                pos -= 1;
+                break;
+            }
+        }
+    }
+
+    if (depth)
+    {
+        PG_ERROR_MAJOR("unbalanced json container");
+        return 0;
+    }
+
+    return token_count;
+}
+
+FUNCTION b8
+json_token_equals(glb_file* glb, u32 token, c8* str)
+{
+    json_token* t = &glb->tokens[token];
+    u32 i = 0;
+    for (; t->start + i < t->end; i += 1)
+    {
+        if (!str[i] || glb->json[t->start + i] != str[i])
+        {
+            return false;
+        }
+    }
+    return str[i] == '\0';
+}
+
+FUNCTION u32
+json_object_get(glb_file* glb, u32 object, c8* key)
+{
+    if (object == JSON_INVALID_TOKEN
+        || glb->tokens[object].type != JSON_TOKEN_OBJECT)
+    {
+        return JSON_INVALID_TOKEN;
+    }
+
+    u32 token = object + 1;
+    for (u32 i = 0; i < glb->tokens[object].child_count; i += 2)
+    {
+        if (json_token_equals(glb, token, key))
+        {
+            return token + 1;
+        }
+        token = glb->tokens[token + 1].next;
+    }
+
+    return JSON_INVALID_TOKEN;
+}
+
+FUNCTION u32
+json_array_get(glb_file* glb, u32 array, u32 index)
+{
+    if (array == JSON_INVALID_TOKEN
+        || glb->tokens[array].type != JSON_TOKEN_ARRAY
+        || index >= glb->tokens[array].child_count)
+    {
+        return JSON_INVALID_TOKEN;
+    }
+
+    u32 token = array + 1;
+    for (u32 i = 0; i < index; i += 1)
+    {
+        token = glb->tokens[token].next;
+    }
+
+    return token;
+}
+
+FUNCTION u32
+json_array_count(glb_file* glb, u32 array)
+{
+    if (array == JSON_INVALID_TOKEN
+        || glb->tokens[array].type != JSON_TOKEN_ARRAY)
+    {
+        return 0;
+    }
+
+    return glb->tokens[array].child_count;
+}
+
+// Returns the token of every element of `array`, in order (or 0 if it has
+// none).
+FUNCTION u32*
+json_array_index(glb_file* glb,
+                 u32 array,
+                 pg_scratch_allocator* mem,
+                 pg_error* err)
+{
+    u32 count = json_array_count(glb, array);
+    if (!count)
+    {
+        return 0;
+    }
+
+    u32* tokens;
+    pg_scratch_alloc(mem, count * sizeof(u32), alignof(u32), &tokens, err);
+    u32 token = array + 1;
+    for (u32 i = 0; i < count; i += 1)
+    {
+        tokens[i] = token;
+        token = glb->tokens[token].next;
+    }
+
+    return tokens;
+}
+
+FUNCTION u32
+json_index_get(u32* tokens, u32 count, u32 index)
+{
+    return index < count ? tokens[index] : JSON_INVALID_TOKEN;
+}
+
+FUNCTION f64
+json_f64(glb_file* glb, u32 token, f64 default_value)
+{
+    if (token == JSON_INVALID_TOKEN
+        || glb->tokens[token].type != JSON_TOKEN_PRIMITIVE)
+    {
+        return default_value;
+    }
+
+    c8* c = &glb->json[glb->tokens[token].start];
+    c8* end = &glb->json[glb->tokens[token].end];
+
+    f64 sign = 1.0;
+    if (c < end && (*c == '-' || *c == '+'))
+    {
+        sign = (*c == '-') ? -1.0 : 1.0;
+        c += 1;
+    }
+
+    f64 value = 0.0;
+    for (; c < end && *c >= '0' && *c <= '9'; c += 1)
+    {
+        value = (value * 10.0) + (f64)(*c - '0');
+    }
+
+    if (c < end && *c == '.')
+    {
+        f64 scale = 0.1;
+        for (c += 1; c < end && *c >= '0' && *c <= '9'; c += 1)
+        {
+            value += (f64)(*c - '0') * scale;
+            scale *= 0.1;
+        }
+    }
+
+    if (c < end && (*c == 'e' || *c == 'E'))
+    {
+        c += 1;
+        b8 negative_exponent = false;
+        if (c < end && (*c == '-' || *c == '+'))
+        {
+            negative_exponent = *c == '-';
+            c += 1;
+        }
+        s32 exponent = 0;
+        for (; c < end && *c >= '0' && *c <= '9'; c += 1)
+        {
+            exponent = (exponent * 10) + (*c - '0');
+        }
+        for (s32 i = 0; i < exponent; i += 1)
+        {
+            value = negative_exponent ? value / 10.0 : value * 10.0;
+        }
+    }
+
+    return sign * value;
+}
+
+FUNCTION u32
+json_u32(glb_file* glb, u32 token, u32 default_value)
+{
+    return (u32)json_f64(glb, token, (f64)default_value);
+}
+
+FUNCTION b8
+json_b8(glb_file* glb, u32 token)
+{
+    return token != JSON_INVALID_TOKEN && json_token_equals(glb, token, "true");
+}
+
+FUNCTION b8
+glb_open(file_view view,
+         pg_scratch_allocator* mem,
+         glb_file* glb,
+         pg_error* err)
+{
+    *glb = (glb_file){.view = view};
+
+    if (view.size < GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE
+        || glb_read_u32(view.data) != GLB_MAGIC
+        || glb_read_u32(view.data + 4) != GLB_VERSION
+        || glb_read_u32(view.data + 8) > view.size)
+    {
+        PG_ERROR_MAJOR("invalid glb header");
+        return false;
+    }
+
+    // Find chunks.
+    usize total_size = glb_read_u32(view.data + 8);
+    for (usize pos = GLB_HEADER_SIZE; pos + GLB_CHUNK_HEADER_SIZE <= total_size;)
+    {
+        u32 chunk_size = glb_read_u32(view.data + pos);
+        u32 chunk_type = glb_read_u32(view.data + pos + 4);
+        u8* chunk_data = view.data + pos + GLB_CHUNK_HEADER_SIZE;
+        if (pos + GLB_CHUNK_HEADER_SIZE + chunk_size > total_size)
+        {
+            PG_ERROR_MAJOR("glb chunk exceeds file size");
+            return false;
+        }
+
+        if (chunk_type == GLB_CHUNK_JSON && !glb->json)
+        {
+            glb->json = (c8*)chunk_data;
+            glb->json_size = chunk_size;
+        }
+        else if (chunk_type == GLB_CHUNK_BIN && !glb->bin)
+        {
+            glb->bin = chunk_data;
+            glb->bin_size = chunk_size;
+        }
+
+        pos += GLB_CHUNK_HEADER_SIZE + chunk_size;
+    }
+
+    if (!glb->json)
+    {
+        PG_ERROR_MAJOR("glb is missing json chunk");
+        return false;
+    }
+
+    // Tokenize JSON chunk.
+    glb->token_count = json_parse(glb->json, glb->json_size, 0, err);
+    if (!glb->token_count)
+    {
+        PG_ERROR_MAJOR("glb json chunk is empty");
+        return false;
+    }
+    pg_scratch_alloc(mem,
+                     glb->token_count * sizeof(json_token),
+                     alignof(json_token),
+                     &glb->tokens,
+                     err);
+    json_parse(glb->json, glb->json_size, glb->tokens, err);
+
+    u32 accessors = json_object_get(glb, 0, "accessors");
+    glb->accessor_count = json_array_count(glb, accessors);
+    glb->accessors = json_array_index(glb, accessors, mem, err);
+    u32 buffer_views = json_object_get(glb, 0, "bufferViews");
+    glb->buffer_view_count = json_array_count(glb, buffer_views);
+    glb->buffer_views = json_array_index(glb, buffer_views, mem, err);
+    u32 meshes = json_object_get(glb, 0, "meshes");
+    glb->mesh_count = json_array_count(glb, meshes);
+    glb->meshes = json_array_index(glb, meshes, mem, err);
+
+    return true;
+}
+
+FUNCTION u32
+glb_component_size(glb_component_type component_type)
+{
+    switch (component_type)
+    {
+        case GLB_COMPONENT_TYPE_S8:
+        case GLB_COMPONENT_TYPE_U8:
+        {
+            return 1;
+        }
+        case GLB_COMPONENT_TYPE_S16:
+        case GLB_COMPONENT_TYPE_U16:
+        {
+            return 2;
+        }
+        case GLB_COMPONENT_TYPE_U32:
+        case GLB_COMPONENT_TYPE_F32:
+        {
+            return 4;
+        }
+        default:
+        {
+            return 0;
+        }
+    }
+}
+
+FUNCTION u32
+glb_component_count(glb_file* glb, u32 type)
+{
+    c8* types[] = {"SCALAR", "VEC2", "VEC3", "VEC4", "MAT2", "MAT3", "MAT4"};
+    u32 counts[] = {1, 2, 3, 4, 4, 9, 16};
+    static_assert(CAP(types) == CAP(counts), "unexpected type count");
+
+    for (u32 i = 0; i < CAP(types); i += 1)
+    {
+        if (json_token_equals(glb, type, types[i]))
+        {
+            return counts[i];
+        }
+    }
+
+    return 0;
+}
+
+FUNCTION b8
+glb_get_accessor(glb_file* glb,
+                 u32 accessor_id,
+                 glb_accessor* accessor,
+                 pg_error* err)
+{
+    *accessor = (glb_accessor){0};
+
+    u32 a = json_index_get(glb->accessors, glb->accessor_count, accessor_id);
+    if (a == JSON_INVALID_TOKEN)
+    {
+        PG_ERROR_MAJOR("invalid glb accessor id");
+        return false;
+    }
+
+    if (json_object_get(glb, a, "sparse") != JSON_INVALID_TOKEN)
+    {
+        PG_ERROR_MAJOR("sparse glb accessors are not supported");
+        return false;
+    }
+
+    accessor->count = json_u32(glb, json_object_get(glb, a, "count"), 0);
+    accessor->component_type
+        = json_u32(glb, json_object_get(glb, a, "componentType"), 0);
+    accessor->component_count
+        = glb_component_count(glb, json_object_get(glb, a, "type"));
+    accessor->normalized = json_b8(glb, json_object_get(glb, a, "normalized"));
+
+    u32 element_size = glb_component_size(accessor->component_type)
+                       * accessor->component_count;
+    if (!element_size)
+    {
+        PG_ERROR_MAJOR("invalid glb accessor type");
+        return false;
+    }
+
+    // NOTE: An accessor without a buffer view is zero-filled, so all of its
+    // elements are one element of zeros.
+    u32 buffer_view = json_object_get(glb, a, "bufferView");
+    if (buffer_view == JSON_INVALID_TOKEN)
+    {
+        static_assert(sizeof(glb_zero_element) >= 16 * sizeof(f32),
+                      "unexpected glb zero element size");
+        accessor->data = glb_zero_element;
+        accessor->stride = 0;
+        return true;
+    }
+
+    u32 buffer_view_id = json_u32(glb, buffer_view, 0);
+    u32 bv = json_index_get(glb->buffer_views,
+                            glb->buffer_view_count,
+                            buffer_view_id);
+    if (bv == JSON_INVALID_TOKEN)
+    {
+        PG_ERROR_MAJOR("invalid glb buffer view id");
+        return false;
+    }
+
+    if (json_u32(glb, json_object_get(glb, bv, "buffer"), 0) != 0)
+    {
+        PG_ERROR_MAJOR("external glb buffers are not supported");
+        return false;
+    }
+
+    u32 stride = json_u32(glb, json_object_get(glb, bv, "byteStride"), 0);
+    accessor->stride = stride ? stride : element_size;
+
+    usize offset = (usize)json_u32(glb, json_object_get(glb, bv, "byteOffset"), 0)
+                   + json_u32(glb, json_object_get(glb, a, "byteOffset"), 0);
+    usize size = accessor->count
+                     ? ((usize)(accessor->count - 1) * accessor->stride)
+                           + element_size
+                     : 0;
+    if (!glb->bin || offset + size > glb->bin_size)
+    {
+        PG_ERROR_MAJOR("glb accessor exceeds bin chunk");
+        return false;
+    }
+
+    accessor->data = glb->bin + offset;
+
+    return true;
+}
+
+// NOTE: Integer components are normalized to [0, 1] or [-1, 1] if the accessor
+// is normalized.
+FUNCTION f32
+glb_accessor_read_f32(glb_accessor* accessor, u32 elem, u32 component)
+{
+    u8* p = accessor->data + ((usize)elem * accessor->stride)
+            + (component * glb_component_size(accessor->component_type));
+
+    switch (accessor->component_type)
+    {
+        case GLB_COMPONENT_TYPE_F32:
+        {
+            union
+            {
+                u32 u;
+                f32 f;
+            } value = {.u = glb_read_u32(p)};
+            return value.f;
+        }
+        case GLB_COMPONENT_TYPE_U8:
+        {
+            return accessor->normalized ? (f32)p[0] / 255.0f : (f32)p[0];
+        }
+        case GLB_COMPONENT_TYPE_S8:
+        {
+            f32 value = (f32)(s8)p[0];
+            return (accessor->normalized && value < -127.0f) ? -1.0f
+                   : accessor->normalized                   ? value / 127.0f
+                                                            : value;
+        }
+        case GLB_COMPONENT_TYPE_U16:
+        {
+            f32 value = (f32)((u16)p[0] | ((u16)p[1] << 8));
+            return accessor->normalized ? value / 65535.0f : value;
+        }
+        case GLB_COMPONENT_TYPE_S16:
+        {
+            f32 value = (f32)(s16)((u16)p[0] | ((u16)p[1] << 8));
+            return (accessor->normalized && value < -32767.0f) ? -1.0f
+                   : accessor->normalized                     ? value / 32767.0f
+                                                              : value;
+        }
+        case GLB_COMPONENT_TYPE_U32:
+        {
+            return (f32)glb_read_u32(p);
+        }
+        default:
+        {
+            return 0.0f;
+        }
+    }
+}
+
+FUNCTION u32
+glb_accessor_read_u32(glb_accessor* accessor, u32 elem, u32 component)
+{
+    u8* p = accessor->data + ((usize)elem * accessor->stride)
+            + (component * glb_component_size(accessor->component_type));
+
+    switch (accessor->component_type)
+    {
+        case GLB_COMPONENT_TYPE_U8:
+        {
+            return p[0];
+        }
+        case GLB_COMPONENT_TYPE_U16:
+        {
+            return (u32)p[0] | ((u32)p[1] << 8);
+        }
+        case GLB_COMPONENT_TYPE_U32:
+        {
+            return glb_read_u32(p);
+        }
+        default:
+        {
+            return (u32)glb_accessor_read_f32(accessor, elem, component);
+        }
+    }
+}
+
+FUNCTION b8
+glb_get_attribute(glb_file* glb,
+                  u32 primitive,
+                  c8* name,
+                  glb_accessor* accessor,
+                  pg_error* err)
+{
+    u32 attributes = json_object_get(glb, primitive, "attributes");
+    u32 accessor_id = json_object_get(glb, attributes, name);
+    if (accessor_id == JSON_INVALID_TOKEN)
+    {
+        *accessor = (glb_accessor){0};
+        return false;
+    }
+
+    return glb_get_accessor(glb, json_u32(glb, accessor_id, 0), accessor, err);
+}
+
+FUNCTION b8
+glb_material_is_blended(glb_file* glb, u32 material_id)
+{
+    u32 material = json_array_get(glb,
+                                  json_object_get(glb, 0, "materials"),
+                                  material_id);
+    u32 alpha_mode = json_object_get(glb, material, "alphaMode");
+    return alpha_mode != JSON_INVALID_TOKEN
+           && json_token_equals(glb, alpha_mode, "BLEND");
+}
+
+FUNCTION b8
+glb_material_is_double_sided(glb_file* glb, u32 material_id)
+{
+    u32 material = json_array_get(glb,
+                                  json_object_get(glb, 0, "materials"),
+                                  material_id);
+    return json_b8(glb, json_object_get(glb, material, "doubleSided"));
+}
+
+FUNCTION u32
+glb_material_count(glb_file* glb)
+{
+    return json_array_count(glb, json_object_get(glb, 0, "materials"));
+}
+
+// Returns the image id of one of a material's textures, or
+// JSON_INVALID_TOKEN if it has none. `name` is either a texture of the
+// material (e.g. "normalTexture") or of its metallic-roughness model (e.g.
+// "baseColorTexture").
+FUNCTION u32
+glb_material_image(glb_file* glb, u32 material_id, c8* name)
+{
+    u32 material = json_array_get(glb,
+                                  json_object_get(glb, 0, "materials"),
+                                  material_id);
+    u32 texture_info = json_object_get(glb, material, name);
+    if (texture_info == JSON_INVALID_TOKEN)
+    {
+        texture_info = json_object_get(glb,
+                                       json_object_get(glb,
+                                                       material,
+                                                       "pbrMetallicRoughness"),
+                                       name);
+    }
+    u32 texture = json_array_get(glb,
+                                 json_object_get(glb, 0, "textures"),
+                                 json_u32(glb,
+                                          json_object_get(glb,
+                                                          texture_info,
+                                                          "index"),
+                                          JSON_INVALID_TOKEN));
+    u32 source = json_object_get(glb, texture, "source");
+
+    return source == JSON_INVALID_TOKEN
+               ? JSON_INVALID_TOKEN
+               : json_u32(glb, source, JSON_INVALID_TOKEN);
+}
+
+// NOTE: Only images embedded in the BIN chunk (by buffer view) are supported.
+FUNCTION b8
+glb_get_image(glb_file* glb,
+              u32 image_id,
+              u8** data,
+              u32* size,
+              pg_error* err)
+{
+    *data = 0;
+    *size = 0;
+
+    u32 image = json_array_get(glb,
+                               json_object_get(glb, 0, "images"),
+                               image_id);
+    u32 bv = json_index_get(glb->buffer_views,
+                            glb->buffer_view_count,
+                            json_u32(glb,
+                                     json_object_get(glb, image, "bufferView"),
+                                     JSON_INVALID_TOKEN));
+    if (bv == JSON_INVALID_TOKEN
+        || json_u32(glb, json_object_get(glb, bv, "buffer"), 0) != 0)
+    {
+        PG_ERROR_MAJOR("glb image is not embedded");
+        return false;
+    }
+
+    usize offset = json_u32(glb, json_object_get(glb, bv, "byteOffset"), 0);
+    usize length = json_u32(glb, json_object_get(glb, bv, "byteLength"), 0);
+    if (!glb->bin || offset + length > glb->bin_size)
+    {
+        PG_ERROR_MAJOR("glb image exceeds bin chunk");
+        return false;
+    }
+
+    *data = glb->bin + offset;
+    *size = (u32)length;
+
+    return true;
+}
+
+FUNCTION void
+glb_convert_vertices(glb_file* glb,
+                     u32 primitive,
+                     u32 vertex_count,
+                     pg_vertex* vertices,
+                     pg_error* err)
+{
+    glb_accessor position, normal, tangent, tex_coord, color, joints, weights;
+    glb_get_attribute(glb, primitive, "POSITION", &position, err);
+    b8 has_normal = glb_get_attribute(glb, primitive, "NORMAL", &normal, err);
+    b8 has_tangent
+        = glb_get_attribute(glb, primitive, "TANGENT", &tangent, err);
+    b8 has_tex_coord
+        = glb_get_attribute(glb, primitive, "TEXCOORD_0", &tex_coord, err);
+    b8 has_color = glb_get_attribute(glb, primitive, "COLOR_0", &color, err);
+    b8 has_joints = glb_get_attribute(glb, primitive, "JOINTS_0", &joints, err);
+    b8 has_weights
+        = glb_get_attribute(glb, primitive, "WEIGHTS_0", &weights, err);
+
+    // NOTE: This is the one unavoidable conversion: glTF stores attributes as
+    // separate streams, while `pg_vertex` is interleaved.
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        pg_vertex* v = &vertices[i];
+        *v = (pg_vertex){.tangent = {.x = 1.0f, .w = 1.0f},
+                         .color = {1.0f, 1.0f, 1.0f, 1.0f}};
+
+        v->position = (pg_f32_3x){glb_accessor_read_f32(&position, i, 0),
+                                  glb_accessor_read_f32(&position, i, 1),
+                                  glb_accessor_read_f32(&position, i, 2)};
+        if (has_normal)
+        {
+            v->normal = (pg_f32_3x){glb_accessor_read_f32(&normal, i, 0),
+                                    glb_accessor_read_f32(&normal, i, 1),
+                                    glb_accessor_read_f32(&normal, i, 2)};
+        }
+        if (has_tangent)
+        {
+            v->tangent = (pg_f32_4x){glb_accessor_read_f32(&tangent, i, 0),
+                                     glb_accessor_read_f32(&tangent, i, 1),
+                                     glb_accessor_read_f32(&tangent, i, 2),
+                                     glb_accessor_read_f32(&tangent, i, 3)};
+        }
+        if (has_tex_coord)
+        {
+            v->tex_coord
+                = (pg_f32_2x){.x = glb_accessor_read_f32(&tex_coord, i, 0),
+                              .y = glb_accessor_read_f32(&tex_coord, i, 1)};
+        }
+        if (has_color)
+        {
+            v->color = (pg_f32_4x){
+                glb_accessor_read_f32(&color, i, 0),
+                glb_accessor_read_f32(&color, i, 1),
+                glb_accessor_read_f32(&color, i, 2),
+                color.component_count == 4 ? glb_accessor_read_f32(&color, i, 3)
+                                           : 1.0f};
+        }
+        if (has_joints && has_weights)
+        {
+            for (u32 j = 0; j < 4; j += 1)
+            {
+                v->joint_ids[j] = glb_accessor_read_u32(&joints, i, j);
+            }
+            v->joint_weights
+                = (pg_f32_4x){glb_accessor_read_f32(&weights, i, 0),
+                              glb_accessor_read_f32(&weights, i, 1),
+                              glb_accessor_read_f32(&weights, i, 2),
+                              glb_accessor_read_f32(&weights, i, 3)};
+        }
+    }
+}
+
+// Load the geometry of every triangle-list primitive, in mesh/primitive order,
+// into a single vertex buffer and a single index buffer. Indices are relative
+// to their primitive's `vertex_offset`, matching `pg_graphics_drawable`.
+//
+// NOTE: If every primitive's indices are already `PG_GRAPHICS_INDEX_TYPE`,
+// tightly packed, aligned, and laid out back to back in the BIN chunk, the
+// index buffer is a zero-copy view into the mapping. Otherwise they are
+// widened/copied.
+FUNCTION b8
+glb_load_model(glb_file* glb,
+               pg_scratch_allocator* mem,
+               glb_model* model,
+               pg_error* err)
+{
+    *model = (glb_model){0};
+
+    // Count primitives, vertices and indices, and check whether the index
+    // data can be mapped directly.
+    b8 indices_mappable = true;
+    u8* next_index_data = 0;
+    for (u32 i = 0; i < glb->mesh_count; i += 1)
+    {
+        u32 primitives = json_object_get(glb, glb->meshes[i], "primitives");
+        for (u32 j = 0; j < json_array_count(glb, primitives); j += 1)
+        {
+            u32 p = json_array_get(glb, primitives, j);
+            u32 mode = json_u32(glb,
+                                json_object_get(glb, p, "mode"),
+                                GLB_PRIMITIVE_MODE_TRIANGLES);
+            if (mode != GLB_PRIMITIVE_MODE_TRIANGLES)
+            {
+                continue;
+            }
+
+            glb_accessor position;
+            if (!glb_get_attribute(glb, p, "POSITION", &position, err))
+            {
+                PG_ERROR_MAJOR("glb primitive is missing positions");
+                return false;
+            }
+
+            u32 index_count = position.count;
+            u32 indices_id = json_object_get(glb, p, "indices");
+            if (indices_id != JSON_INVALID_TOKEN)
+            {
+                glb_accessor indices;
+                if (!glb_get_accessor(glb,
+                                      json_u32(glb, indices_id, 0),
+                                      &indices,
+                                      err))
+                {
+                    return false;
+                }
+                index_count = indices.count;
+
+                if (glb_component_size(indices.component_type)
+                        != sizeof(PG_GRAPHICS_INDEX_TYPE)
+                    || indices.stride != sizeof(PG_GRAPHICS_INDEX_TYPE)
+                    || (usize)indices.data % alignof(PG_GRAPHICS_INDEX_TYPE)
+                    || (next_index_data && indices.data != next_index_data))
+                {
+                    indices_mappable = false;
+                }
+                next_index_data
+                    = indices.data
+                      + (index_count * sizeof(PG_GRAPHICS_INDEX_TYPE));
+            }
+            else
+            {
+                indices_mappable = false;
+            }
+
+            model->primitive_count += 1;
+            model->vertex_count += position.count;
+            model->index_count += index_count;
+        }
+    }
+
+    if (!model->primitive_count)
+    {
+        PG_ERROR_MAJOR("glb has no triangle primitives");
+        return false;
+    }
+
+    pg_scratch_alloc(mem,
+                     model->primitive_count * sizeof(glb_primitive),
+                     alignof(glb_primitive),
+                     &model->primitives,
+                     err);
+    pg_scratch_alloc(mem,
+                     model->vertex_count * sizeof(pg_vertex),
+                     alignof(pg_vertex),
+                     &model->vertices,
+                     err);
+    if (!indices_mappable)
+    {
+        pg_scratch_alloc(mem,
+                         model->index_count * sizeof(PG_GRAPHICS_INDEX_TYPE),
+                         alignof(PG_GRAPHICS_INDEX_TYPE),
+                         &model->indices,
+                         err);
+    }
+
+    // Fill primitives, vertices and indices.
+    u32 primitive_id = 0;
+    u32 vertex_offset = 0;
+    u32 index_offset = 0;
+    for (u32 i = 0; i < glb->mesh_count; i += 1)
+    {
+        u32 primitives = json_object_get(glb, glb->meshes[i], "primitives");
+        for (u32 j = 0; j < json_array_count(glb, primitives); j += 1)
+        {
+            u32 p = json_array_get(glb, primitives, j);
+            u32 mode = json_u32(glb,
+                                json_object_get(glb, p, "mode"),
+                                GLB_PRIMITIVE_MODE_TRIANGLES);
+            if (mode != GLB_PRIMITIVE_MODE_TRIANGLES)
+            {
+                continue;
+            }
+
+            glb_accessor position;
+            glb_get_attribute(glb, p, "POSITION", &position, err);
+
+            glb_primitive* prim = &model->primitives[primitive_id];
+            *prim = (glb_primitive){
+                .vertex_offset = vertex_offset,
+                .vertex_count = position.count,
+                .index_offset = index_offset,
+                .index_count = position.count,
+                .mesh_id = i,
+                .material_id
+                = json_u32(glb, json_object_get(glb, p, "material"), 0)};
+
+            glb_convert_vertices(glb,
+                                 p,
+                                 position.count,
+                                 &model->vertices[vertex_offset],
+                                 err);
+
+            u32 indices_id = json_object_get(glb, p, "indices");
+            if (indices_id != JSON_INVALID_TOKEN)
+            {
+                glb_accessor indices;
+                glb_get_accessor(glb, json_u32(glb, indices_id, 0), &indices, err);
+                prim->index_count = indices.count;
+
+                if (indices_mappable)
+                {
+                    if (primitive_id == 0)
+                    {
+                        model->indices = (PG_GRAPHICS_INDEX_TYPE*)indices.data;
+                    }
+                    model->mapped_index_size
+                        += indices.count * sizeof(PG_GRAPHICS_INDEX_TYPE);
+                }
+                else
+                {
+                    for (u32 k = 0; k < indices.count; k += 1)
+                    {
+                        model->indices[index_offset + k]
+                            = (PG_GRAPHICS_INDEX_TYPE)glb_accessor_read_u32(
+                                &indices,
+                                k,
+                                0);
+                    }
+                    model->converted_index_size
+                        += indices.count * sizeof(PG_GRAPHICS_INDEX_TYPE);
+                }
+            }
+            else
+            {
+                // NOTE: Non-indexed primitives get sequential indices.
+                for (u32 k = 0; k < position.count; k += 1)
+                {
+                    model->indices[index_offset + k] = k;
+                }
+                model->converted_index_size
+                    += position.count * sizeof(PG_GRAPHICS_INDEX_TYPE);
+            }
+
+            for (u32 k = 0; k < prim->index_count; k += 1)
+            {
+                if (model->indices[index_offset + k] >= prim->vertex_count)
+                {
+                    PG_ERROR_MAJOR("glb index exceeds primitive vertex count");
+                    return false;
+                }
+            }
+
+            vertex_offset += prim->vertex_count;
+            index_offset += prim->index_count;
+            primitive_id += 1;
+        }
+    }
+
+    return true;
+}
+
+// NOTE: The model's index buffer may alias the glb mapping, so the mapping
+// must outlive the model.
+FUNCTION void
+glb_model_to_asset_model(glb_model* glb_model, pg_asset_model* model)
+{
+    model->vertex_count = glb_model->vertex_count;
+    model->vertices = glb_model->vertices;
+    model->index_count = glb_model->index_count;
+    model->indices = glb_model->indices;
+}
@@ -0,0 +1,1598 @@
+// Image decoding
+//
+// Decodes the PNG and JPEG images embedded in .glb files to 8-bit RGBA so that
+// textures can be baked at pack time. Only the packer needs this, so speed
+// matters less than covering what glTF exporters write: PNGs of every color
+// type and bit depth, and baseline and progressive Huffman-coded JPEGs with
+// any chroma subsampling.
+//
+// NOTE: Interlaced PNGs, and arithmetic-coded, lossless, 12-bit and CMYK
+// JPEGs are not supported.
+// NOTE: Chroma is upsampled by repeating samples, and 16-bit PNG samples are
+// truncated to 8 bits.
+
+#define IMAGE_PNG_SIGNATURE 0x0A1A0A0D474E5089ull
+#define IMAGE_PNG_CHUNK_IHDR 0x49484452 // "IHDR"
+#define IMAGE_PNG_CHUNK_PLTE 0x504C5445 // "PLTE"
+#define IMAGE_PNG_CHUNK_TRNS 0x74524E53 // "tRNS"
+#define IMAGE_PNG_CHUNK_IDAT 0x49444154 // "IDAT"
+#define IMAGE_PNG_CHUNK_IEND 0x49454E44 // "IEND"
+#define IMAGE_JPEG_ADOBE 0x41646F62 // "Adob"
+#define IMAGE_INFLATE_MAX_BITS 15
+#define IMAGE_JPEG_MAX_COMPONENT_COUNT 3
+
+typedef struct
+{
+    u32 width;
+    u32 height;
+    u8* pixels; // RGBA, rows top to bottom
+} rgba_image;
+
+// PNG
+
+// NOTE: Codes are stored bit-reversed (as they are read), so a table entry is
+// found by peeking IMAGE_INFLATE_MAX_BITS bits. Entries are `symbol << 4 |
+// length`, and an entry of 0 is an invalid code.
+typedef struct
+{
+    u16 entries[1 << IMAGE_INFLATE_MAX_BITS];
+} image_inflate_table;
+
+typedef struct
+{
+    u8* data;
+    usize size;
+    usize pos;
+    u64 bits;
+    u32 bit_count;
+    b8 overrun;
+} image_inflate_reader;
+
+GLOBAL u16 image_inflate_length_bases[] = {3,  4,  5,  6,   7,   8,   9,   10,
+                                           11, 13, 15, 17,  19,  23,  27,  31,
+                                           35, 43, 51, 59,  67,  83,  99,  115,
+                                           131, 163, 195, 227, 258};
+GLOBAL u8 image_inflate_length_extra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                          1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                          4, 4, 4, 4, 5, 5, 5, 5, 0};
+GLOBAL u16 image_inflate_distance_bases[]
+    = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+       33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+       1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+GLOBAL u8 image_inflate_distance_extra[] = {0, 0, 0,  0,  1,  1,  2,  2,
+                                            3, 3, 4,  4,  5,  5,  6,  6,
+                                            7, 7, 8,  8,  9,  9,  10, 10,
+                                            11, 11, 12, 12, 13, 13};
+GLOBAL u8 image_inflate_code_length_order[]
+    = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// NOTE: Reads past the end of the data return zeros and set `overrun`.
+FUNCTION u32
+image_inflate_bits(image_inflate_reader* r, u32 count)
+{
+    while (r->bit_count < count)
+    {
+        if (r->pos < r->size)
+        {
+            r->bits |= (u64)r->data[r->pos] << r->bit_count;
+            r->pos += 1;
+        }
+        else
+        {
+            r->overrun = true;
+        }
+        r->bit_count += 8;
+    }
+
+    u32 value = (u32)(r->bits & ((1ull << count) - 1));
+    r->bits >>= count;
+    r->bit_count -= count;
+
+    return value;
+}
+
+FUNCTION b8
+image_inflate_build_table(u8* lengths,
+                          u32 count,
+                          image_inflate_table* table)
+{
+    u32 length_counts[IMAGE_INFLATE_MAX_BITS + 1] = {0};
+    for (u32 i = 0; i < count; i += 1)
+    {
+        length_counts[lengths[i]] += 1;
+    }
+    length_counts[0] = 0;
+
+    u32 next_codes[IMAGE_INFLATE_MAX_BITS + 1] = {0};
+    u32 code = 0;
+    for (u32 l = 1; l <= IMAGE_INFLATE_MAX_BITS; l += 1)
+    {
+        code = (code + length_counts[l - 1]) << 1;
+        next_codes[l] = code;
+        if (code + length_counts[l] > (1u << l))
+        {
+            return false;
+        }
+    }
+
+    for (u32 i = 0; i < CAP(table->entries); i += 1)
+    {
+        table->entries[i] = 0;
+    }
+    for (u32 i = 0; i < count; i += 1)
+    {
+        u32 length = lengths[i];
+        if (!length)
+        {
+            continue;
+        }
+        u32 c = next_codes[length];
+        next_codes[length] += 1;
+
+        u32 reversed = 0;
+        for (u32 b = 0; b < length; b += 1)
+        {
+            reversed |= ((c >> b) & 1) << (length - 1 - b);
+        }
+        for (u32 e = reversed; e < CAP(table->entries); e += 1u << length)
+        {
+            table->entries[e] = (u16)((i << 4) | length);
+        }
+    }
+
+    return true;
+}
+
+// NOTE: Returns 0xFFFF for an invalid code.
+FUNCTION u32
+image_inflate_decode(image_inflate_reader* r, image_inflate_table* table)
+{
+    while (r->bit_count < IMAGE_INFLATE_MAX_BITS)
+    {
+        if (r->pos < r->size)
+        {
+            r->bits |= (u64)r->data[r->pos] << r->bit_count;
+            r->pos += 1;
+        }
+        // NOTE: Past the end, zeros are peeked, which a valid stream never
+        // consumes.
+        r->bit_count += 8;
+    }
+
+    u32 entry
+        = table->entries[r->bits & ((1u << IMAGE_INFLATE_MAX_BITS) - 1)];
+    u32 length = entry & 0xF;
+    if (!length)
+    {
+        return 0xFFFF;
+    }
+    r->bits >>= length;
+    r->bit_count -= length;
+
+    return entry >> 4;
+}
+
+// Inflates a zlib stream into `out`, which must be exactly the size of the
+// decompressed data.
+FUNCTION b8
+image_inflate(u8* data,
+              usize size,
+              u8* out,
+              usize out_size,
+              pg_scratch_allocator* mem,
+              pg_error* err)
+{
+    if (size < 2 || (data[0] & 0xF) != 8 || (data[1] & 0x20)
+        || (((u32)data[0] << 8) | data[1]) % 31)
+    {
+        PG_ERROR_MAJOR("invalid zlib header");
+        return false;
+    }
+
+    image_inflate_table* tables = 0;
+    pg_scratch_alloc(mem,
+                     3 * sizeof(image_inflate_table),
+                     alignof(image_inflate_table),
+                     &tables,
+                     err);
+    if (!tables)
+    {
+        return false;
+    }
+    image_inflate_table* literals = &tables[0];
+    image_inflate_table* distances = &tables[1];
+    image_inflate_table* code_lengths = &tables[2];
+
+    image_inflate_reader r = {.data = data, .size = size, .pos = 2};
+    usize out_pos = 0;
+    b8 final = false;
+    while (!final)
+    {
+        final = image_inflate_bits(&r, 1);
+        u32 type = image_inflate_bits(&r, 2);
+
+        if (type == 0)
+        {
+            // NOTE: Stored blocks start on a byte boundary.
+            image_inflate_bits(&r, r.bit_count % 8);
+            u32 length = image_inflate_bits(&r, 16);
+            u32 inverse = image_inflate_bits(&r, 16);
+            if ((length ^ 0xFFFF) != inverse || out_pos + length > out_size)
+            {
+                PG_ERROR_MAJOR("invalid deflate stored block");
+                return false;
+            }
+            for (u32 i = 0; i < length; i += 1)
+            {
+                out[out_pos] = (u8)image_inflate_bits(&r, 8);
+                out_pos += 1;
+            }
+            continue;
+        }
+
+        u8 lengths[288 + 32] = {0};
+        u32 literal_count = 288;
+        u32 distance_count = 32;
+        if (type == 1)
+        {
+            for (u32 i = 0; i < 288; i += 1)
+            {
+                lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+            }
+            for (u32 i = 0; i < 32; i += 1)
+            {
+                lengths[288 + i] = 5;
+            }
+        }
+        else if (type == 2)
+        {
+            literal_count = image_inflate_bits(&r, 5) + 257;
+            distance_count = image_inflate_bits(&r, 5) + 1;
+            u32 code_length_count = image_inflate_bits(&r, 4) + 4;
+
+            u8 code_length_lengths[19] = {0};
+            for (u32 i = 0; i < code_length_count; i += 1)
+            {
+                code_length_lengths[image_inflate_code_length_order[i]]
+                    = (u8)image_inflate_bits(&r, 3);
+            }
+            if (!image_inflate_build_table(code_length_lengths,
+                                           19,
+                                           code_lengths))
+            {
+                PG_ERROR_MAJOR("invalid deflate code lengths");
+                return false;
+            }
+
+            u8 dynamic_lengths[288 + 32] = {0};
+            u32 total_count = literal_count + distance_count;
+            for (u32 i = 0; i < total_count;)
+            {
+                u32 symbol = image_inflate_decode(&r, code_lengths);
+                u32 repeat = 1;
+                u8 value = 0;
+                if (symbol < 16)
+                {
+                    value = (u8)symbol;
+                }
+                else if (symbol == 16 && i > 0)
+                {
+                    value = dynamic_lengths[i - 1];
+                    repeat = 3 + image_inflate_bits(&r, 2);
+                }
+                else if (symbol == 17)
+                {
+                    repeat = 3 + image_inflate_bits(&r, 3);
+                }
+                else if (symbol == 18)
+                {
+                    repeat = 11 + image_inflate_bits(&r, 7);
+                }
+                else
+                {
+                    PG_ERROR_MAJOR("invalid deflate code length");
+                    return false;
+                }
+                if (i + repeat > total_count)
+                {
+                    PG_ERROR_MAJOR("invalid deflate code length repeat");
+                    return false;
+                }
+                for (u32 j = 0; j < repeat; j += 1)
+                {
+                    dynamic_lengths[i] = value;
+                    i += 1;
+                }
+            }
+            for (u32 i = 0; i < literal_count; i += 1)
+            {
+                lengths[i] = dynamic_lengths[i];
+            }
+            for (u32 i = 0; i < distance_count; i += 1)
+            {
+                lengths[288 + i] = dynamic_lengths[literal_count + i];
+            }
+        }
+        else
+        {
+            PG_ERROR_MAJOR("invalid deflate block type");
+            return false;
+        }
+
+        if (!image_inflate_build_table(lengths, literal_count, literals)
+            || !image_inflate_build_table(&lengths[288],
+                                          distance_count,
+                                          distances))
+        {
+            PG_ERROR_MAJOR("invalid deflate huffman code");
+            return false;
+        }
+
+        for (;;)
+        {
+            u32 symbol = image_inflate_decode(&r, literals);
+            if (symbol < 256)
+            {
+                if (out_pos == out_size)
+                {
+                    PG_ERROR_MAJOR("deflate data exceeds image size");
+                    return false;
+                }
+                out[out_pos] = (u8)symbol;
+                out_pos += 1;
+                continue;
+            }
+            if (symbol == 256)
+            {
+                break;
+            }
+
+            symbol -= 257;
+            if (symbol >= CAP(image_inflate_length_bases))
+            {
+                PG_ERROR_MAJOR("invalid deflate length");
+                return false;
+            }
+            u32 length
+                = image_inflate_length_bases[symbol]
+                  + image_inflate_bits(&r, image_inflate_length_extra[symbol]);
+
+            u32 d = image_inflate_decode(&r, distances);
+            if (d >= CAP(image_inflate_distance_bases))
+            {
+                PG_ERROR_MAJOR("invalid deflate distance");
+                return false;
+            }
+            u32 distance
+                = image_inflate_distance_bases[d]
+                  + image_inflate_bits(&r, image_inflate_distance_extra[d]);
+            if (distance > out_pos || out_pos + length > out_size)
+            {
+                PG_ERROR_MAJOR("invalid deflate back reference");
+                return false;
+            }
+
+            // NOTE: Copied a byte at a time since the ranges may overlap.
+            u8* src = &out[out_pos - distance];
+            for (u32 i = 0; i < length; i += 1)
+            {
+                out[out_pos + i] = src[i];
+            }
+            out_pos += length;
+        }
+
+        if (r.overrun)
+        {
+            PG_ERROR_MAJOR("truncated deflate data");
+            return false;
+        }
+    }
+
+    if (out_pos != out_size)
+    {
+        PG_ERROR_MAJOR("deflate data is smaller than image size");
+        return false;
+    }
+
+    return true;
+}
+
+FUNCTION u32
+image_read_u32_be(u8* data)
+{
+    return ((u32)data[0] << 24) | ((u32)data[1] << 16) | ((u32)data[2] << 8)
+           | (u32)data[3];
+}
+
+FUNCTION u32
+image_png_sample(u8* row, u32 index, u32 depth)
+{
+    if (depth == 8)
+    {
+        return row[index];
+    }
+    if (depth == 16)
+    {
+        return ((u32)row[index * 2] << 8) | row[(index * 2) + 1];
+    }
+
+    u32 bit = index * depth;
+    u32 shift = 8 - depth - (bit % 8);
+    return (row[bit / 8] >> shift) & ((1u << depth) - 1);
+}
+
+FUNCTION u8
+image_png_paeth(u8 a, u8 b, u8 c)
+{
+    s32 p = (s32)a + (s32)b - (s32)c;
+    s32 pa = p > a ? p - a : a - p;
+    s32 pb = p > b ? p - b : b - p;
+    s32 pc = p > c ? p - c : c - p;
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+}
+
+FUNCTION b8
+image_decode_png(u8* data,
+                 usize size,
+                 pg_scratch_allocator* mem,
+                 rgba_image* img,
+                 pg_error* err)
+{
+    u32 width = 0;
+    u32 height = 0;
+    u32 depth = 0;
+    u32 color_type = 0;
+    u8 palette[256 * 4] = {0};
+    u32 palette_count = 0;
+    u32 transparent[3] = {0};
+    b8 has_transparent = false;
+    usize idat_size = 0;
+
+    // NOTE: The first pass validates the chunks and sums the IDAT sizes, so
+    // the zlib stream can be gathered into one buffer.
+    usize pos = 8;
+    b8 has_header = false;
+    while (pos + 12 <= size)
+    {
+        u32 length = image_read_u32_be(&data[pos]);
+        u32 type = image_read_u32_be(&data[pos + 4]);
+        u8* chunk = &data[pos + 8];
+        if (length > size - pos - 12)
+        {
+            PG_ERROR_MAJOR("png chunk exceeds file");
+            return false;
+        }
+
+        if (type == IMAGE_PNG_CHUNK_IHDR && length >= 13)
+        {
+            width = image_read_u32_be(chunk);
+            height = image_read_u32_be(&chunk[4]);
+            depth = chunk[8];
+            color_type = chunk[9];
+            if (chunk[10] || chunk[11] || chunk[12])
+            {
+                PG_ERROR_MAJOR("unsupported png compression or interlacing");
+                return false;
+            }
+            has_header = true;
+        }
+        else if (type == IMAGE_PNG_CHUNK_PLTE)
+        {
+            palette_count = length / 3 < 256 ? length / 3 : 256;
+            for (u32 i = 0; i < palette_count; i += 1)
+            {
+                palette[(i * 4) + 0] = chunk[(i * 3) + 0];
+                palette[(i * 4) + 1] = chunk[(i * 3) + 1];
+                palette[(i * 4) + 2] = chunk[(i * 3) + 2];
+                palette[(i * 4) + 3] = 255;
+            }
+        }
+        else if (type == IMAGE_PNG_CHUNK_TRNS)
+        {
+            if (color_type == 3)
+            {
+                for (u32 i = 0; i < length && i < palette_count; i += 1)
+                {
+                    palette[(i * 4) + 3] = chunk[i];
+                }
+            }
+            else if ((color_type == 0 && length >= 2)
+                     || (color_type == 2 && length >= 6))
+            {
+                for (u32 i = 0; i < length / 2 && i < 3; i += 1)
+                {
+                    transparent[i] = ((u32)chunk[i * 2] << 8)
+                                     | chunk[(i * 2) + 1];
+                }
+                has_transparent = true;
+            }
+        }
+        else if (type == IMAGE_PNG_CHUNK_IDAT)
+        {
+            idat_size += length;
+        }
+        else if (type == IMAGE_PNG_CHUNK_IEND)
+        {
+            break;
+        }
+
+        pos += 12 + (usize)length;
+    }
+
+    u32 channel_count = color_type == 0   ? 1
+                        : color_type == 2 ? 3
+                        : color_type == 3 ? 1
+                        : color_type == 4 ? 2
+                        : color_type == 6 ? 4
+                                          : 0;
+    b8 valid_depth = depth == 8 || depth == 16
+                     || ((color_type == 0 || color_type == 3)
+                         && (depth == 1 || depth == 2 || depth == 4));
+    if (!has_header || !width || !height || !channel_count || !valid_depth
+        || (color_type == 3 && (depth == 16 || !palette_count)) || !idat_size)
+    {
+        PG_ERROR_MAJOR("unsupported png format");
+        return false;
+    }
+
+    u8* idat = 0;
+    usize row_size = (((usize)width * channel_count * depth) + 7) / 8;
+    usize filtered_size = (row_size + 1) * height;
+    u8* filtered = 0;
+    pg_scratch_alloc(mem, idat_size, 1, &idat, err);
+    pg_scratch_alloc(mem, filtered_size, 1, &filtered, err);
+    pg_scratch_alloc(mem, (usize)width * height * 4, 4, &img->pixels, err);
+    if (!idat || !filtered || !img->pixels)
+    {
+        return false;
+    }
+
+    usize idat_pos = 0;
+    for (pos = 8; pos + 12 <= size;)
+    {
+        u32 length = image_read_u32_be(&data[pos]);
+        if (image_read_u32_be(&data[pos + 4]) == IMAGE_PNG_CHUNK_IDAT)
+        {
+            pg_copy(&data[pos + 8], length, &idat[idat_pos], length, err);
+            idat_pos += length;
+        }
+        pos += 12 + (usize)length;
+    }
+
+    if (!image_inflate(idat, idat_size, filtered, filtered_size, mem, err))
+    {
+        return false;
+    }
+
+    // NOTE: Rows are unfiltered in place. Filters work on bytes, and operate
+    // on the byte one whole pixel (at least one byte) to the left.
+    u32 pixel_size = (channel_count * depth) / 8 ? (channel_count * depth) / 8
+                                                 : 1;
+    u8* previous = 0;
+    for (u32 y = 0; y < height; y += 1)
+    {
+        u8* row = &filtered[(y * (row_size + 1)) + 1];
+        u32 filter = row[-1];
+        for (usize x = 0; x < row_size; x += 1)
+        {
+            u8 a = x >= pixel_size ? row[x - pixel_size] : 0;
+            u8 b = previous ? previous[x] : 0;
+            u8 c = (previous && x >= pixel_size) ? previous[x - pixel_size] : 0;
+            switch (filter)
+            {
+                case 0:
+                    break;
+                case 1:
+                    row[x] = (u8)(row[x] + a);
+                    break;
+                case 2:
+                    row[x] = (u8)(row[x] + b);
+                    break;
+                case 3:
+                    row[x] = (u8)(row[x] + (((u32)a + b) / 2));
+                    break;
+                case 4:
+                    row[x] = (u8)(row[x] + image_png_paeth(a, b, c));
+                    break;
+                default:
+                {
+                    PG_ERROR_MAJOR("invalid png filter");
+                    return false;
+                }
+            }
+        }
+        previous = row;
+    }
+
+    // Convert to RGBA.
+    u32 max_value = (1u << depth) - 1;
+    for (u32 y = 0; y < height; y += 1)
+    {
+        u8* row = &filtered[(y * (row_size + 1)) + 1];
+        u8* out = &img->pixels[(usize)y * width * 4];
+        for (u32 x = 0; x < width; x += 1)
+        {
+            u32 samples[4] = {0};
+            for (u32 c = 0; c < channel_count; c += 1)
+            {
+                samples[c]
+                    = image_png_sample(row, (x * channel_count) + c, depth);
+            }
+
+            u8 rgba[4] = {0};
+            if (color_type == 3)
+            {
+                u32 index = samples[0] < palette_count ? samples[0] : 0;
+                pg_copy(&palette[index * 4], 4, rgba, 4, err);
+            }
+            else
+            {
+                u8 values[4] = {0};
+                for (u32 c = 0; c < channel_count; c += 1)
+                {
+                    values[c] = depth == 16 ? (u8)(samples[c] >> 8)
+                                            : (u8)((samples[c] * 255)
+                                                   / max_value);
+                }
+                b8 gray = color_type == 0 || color_type == 4;
+                b8 alpha = color_type == 4 || color_type == 6;
+                rgba[0] = values[0];
+                rgba[1] = gray ? values[0] : values[1];
+                rgba[2] = gray ? values[0] : values[2];
+                rgba[3] = alpha ? values[channel_count - 1] : 255;
+                if (has_transparent
+                    && samples[0] == transparent[0]
+                    && (gray
+                        || (samples[1] == transparent[1]
+                            && samples[2] == transparent[2])))
+                {
+                    rgba[3] = 0;
+                }
+            }
+            out[(x * 4) + 0] = rgba[0];
+            out[(x * 4) + 1] = rgba[1];
+            out[(x * 4) + 2] = rgba[2];
+            out[(x * 4) + 3] = rgba[3];
+        }
+    }
+
+    img->width = width;
+    img->height = height;
+
+    return true;
+}
+
+// JPEG
+
+// NOTE: Entries are `length << 8 | symbol`, indexed by the next 16 bits of the
+// stream, and an entry of 0 is an invalid code.
+typedef struct
+{
+    u16 entries[1 << 16];
+} image_jpeg_huffman;
+
+typedef struct
+{
+    u32 id;
+    u32 h;
+    u32 v;
+    u32 quant_id;
+    u32 dc_table;
+    u32 ac_table;
+    u32 blocks_x; // Padded to whole MCUs
+    u32 blocks_y;
+    u32 width; // Samples actually covered by the image
+    u32 height;
+    s32 dc_predictor;
+    s16* coefficients; // 64 per block, in natural order
+    u8* samples;
+} image_jpeg_component;
+
+typedef struct
+{
+    u8* data;
+    usize size;
+    usize pos;
+    u64 bits; // Left-aligned
+    u32 bit_count;
+    b8 invalid;
+    u16 quant[4][64];
+    image_jpeg_huffman* dc[4];
+    image_jpeg_huffman* ac[4];
+    image_jpeg_component components[IMAGE_JPEG_MAX_COMPONENT_COUNT];
+    u32 component_count;
+    u32 width;
+    u32 height;
+    u32 max_h;
+    u32 max_v;
+    u32 mcus_x;
+    u32 mcus_y;
+    u32 restart_interval;
+    u32 eob_run;
+    b8 progressive;
+    s32 adobe_transform; // -1 if there is no Adobe marker
+} image_jpeg;
+
+GLOBAL u8 image_jpeg_zigzag[64]
+    = {0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,
+       12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+       35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+       58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+// NOTE: cos(k * pi / 16) for k in [0, 8].
+GLOBAL f32 image_jpeg_cosines[9] = {1.0f,
+                                    0.98078528f,
+                                    0.92387953f,
+                                    0.83146961f,
+                                    0.70710678f,
+                                    0.55557023f,
+                                    0.38268343f,
+                                    0.19509032f,
+                                    0.0f};
+
+FUNCTION u32
+image_read_u16_be(u8* data)
+{
+    return ((u32)data[0] << 8) | data[1];
+}
+
+// NOTE: Markers are never consumed. Once one is reached, zeros are read and
+// the scan is expected to end before they matter.
+FUNCTION void
+image_jpeg_fill(image_jpeg* j)
+{
+    while (j->bit_count <= 56)
+    {
+        u32 byte = 0;
+        if (j->pos < j->size)
+        {
+            byte = j->data[j->pos];
+            if (byte == 0xFF)
+            {
+                u32 next = j->pos + 1 < j->size ? j->data[j->pos + 1] : 0xD9;
+                if (next == 0)
+                {
+                    j->pos += 2;
+                }
+                else
+                {
+                    byte = 0;
+                }
+            }
+            else
+            {
+                j->pos += 1;
+            }
+        }
+        j->bits |= (u64)byte << (56 - j->bit_count);
+        j->bit_count += 8;
+    }
+}
+
+FUNCTION u32
+image_jpeg_bits(image_jpeg* j, u32 count)
+{
+    if (!count)
+    {
+        return 0;
+    }
+    image_jpeg_fill(j);
+    u32 value = (u32)(j->bits >> (64 - count));
+    j->bits <<= count;
+    j->bit_count -= count;
+    return value;
+}
+
+FUNCTION s32
+image_jpeg_extend(image_jpeg* j, u32 count)
+{
+    s32 value = (s32)image_jpeg_bits(j, count);
+    if (count && value < (1 << (count - 1)))
+    {
+        value += (s32)(-1 * (1 << count)) + 1;
+    }
+    return value;
+}
+
+FUNCTION u32
+image_jpeg_decode(image_jpeg* j, image_jpeg_huffman* table)
+{
+    image_jpeg_fill(j);
+    u32 entry = table ? table->entries[j->bits >> 48] : 0;
+    if (!entry)
+    {
+        j->invalid = true;
+        return 0;
+    }
+    j->bits <<= entry >> 8;
+    j->bit_count -= entry >> 8;
+    return entry & 0xFF;
+}
+
+FUNCTION b8
+image_jpeg_read_huffman(image_jpeg* j,
+                        u8* segment,
+                        u32 length,
+                        pg_scratch_allocator* mem,
+                        pg_error* err)
+{
+    u32 pos = 0;
+    while (pos + 17 <= length)
+    {
+        u32 table_class = segment[pos] >> 4;
+        u32 table_id = segment[pos] & 0xF;
+        u8* counts = &segment[pos + 1];
+        u32 symbol_count = 0;
+        for (u32 i = 0; i < 16; i += 1)
+        {
+            symbol_count += counts[i];
+        }
+        u8* symbols = &segment[pos + 17];
+        if (table_class > 1 || table_id > 3 || symbol_count > 256
+            || pos + 17 + symbol_count > length)
+        {
+            PG_ERROR_MAJOR("invalid jpeg huffman table");
+            return false;
+        }
+
+        image_jpeg_huffman** slot
+            = table_class ? &j->ac[table_id] : &j->dc[table_id];
+        if (!*slot)
+        {
+            pg_scratch_alloc(mem,
+                             sizeof(image_jpeg_huffman),
+                             alignof(image_jpeg_huffman),
+                             slot,
+                             err);
+            if (!*slot)
+            {
+                return false;
+            }
+        }
+        image_jpeg_huffman* table = *slot;
+        for (u32 i = 0; i < CAP(table->entries); i += 1)
+        {
+            table->entries[i] = 0;
+        }
+
+        u32 code = 0;
+        u32 s = 0;
+        for (u32 l = 1; l <= 16; l += 1)
+        {
+            for (u32 i = 0; i < counts[l - 1]; i += 1)
+            {
+                u32 first = code << (16 - l);
+                u32 fill = 1u << (16 - l);
+                if (first + fill > CAP(table->entries))
+                {
+                    PG_ERROR_MAJOR("invalid jpeg huffman code");
+                    return false;
+                }
+                for (u32 e = 0; e < fill; e += 1)
+                {
+                    table->entries[first + e] = (u16)((l << 8) | symbols[s]);
+                }
+                code += 1;
+                s += 1;
+            }
+            code <<= 1;
+        }
+
+        pos += 17 + symbol_count;
+    }
+
+    return true;
+}
+
+FUNCTION void
+image_jpeg_decode_block(image_jpeg* j,
+                        image_jpeg_component* c,
+                        s16* block,
+                        u32 spectral_start,
+                        u32 spectral_end,
+                        u32 approx_high,
+                        u32 approx_low)
+{
+    if (!j->progressive)
+    {
+        u32 t = image_jpeg_decode(j, j->dc[c->dc_table]);
+        c->dc_predictor += t ? image_jpeg_extend(j, t) : 0;
+        block[0] = (s16)c->dc_predictor;
+        for (u32 k = 1; k < 64;)
+        {
+            u32 rs = image_jpeg_decode(j, j->ac[c->ac_table]);
+            u32 r = rs >> 4;
+            u32 s = rs & 0xF;
+            if (!s)
+            {
+                if (r != 15)
+                {
+                    break;
+                }
+                k += 16;
+                continue;
+            }
+            k += r;
+            if (k > 63)
+            {
+                j->invalid = true;
+                return;
+            }
+            block[image_jpeg_zigzag[k]] = (s16)image_jpeg_extend(j, s);
+            k += 1;
+        }
+        return;
+    }
+
+    if (!spectral_start)
+    {
+        // DC scans.
+        if (!approx_high)
+        {
+            u32 t = image_jpeg_decode(j, j->dc[c->dc_table]);
+            c->dc_predictor += t ? image_jpeg_extend(j, t) : 0;
+            block[0] = (s16)(c->dc_predictor * (1 << approx_low));
+        }
+        else if (image_jpeg_bits(j, 1))
+        {
+            block[0] = (s16)(block[0] | (1 << approx_low));
+        }
+        return;
+    }
+
+    if (!approx_high)
+    {
+        // First AC scan.
+        if (j->eob_run)
+        {
+            j->eob_run -= 1;
+            return;
+        }
+        for (u32 k = spectral_start; k <= spectral_end;)
+        {
+            u32 rs = image_jpeg_decode(j, j->ac[c->ac_table]);
+            u32 r = rs >> 4;
+            u32 s = rs & 0xF;
+            if (!s)
+            {
+                if (r < 15)
+                {
+                    j->eob_run = (1u << r) - 1 + image_jpeg_bits(j, r);
+                    break;
+                }
+                k += 16;
+                continue;
+            }
+            k += r;
+            if (k > 63)
+            {
+                j->invalid = true;
+                return;
+            }
+            block[image_jpeg_zigzag[k]]
+                = (s16)(image_jpeg_extend(j, s) * (1 << approx_low));
+            k += 1;
+        }
+        return;
+    }
+
+    // AC refinement scan. Every nonzero coefficient in the band gets a
+    // correction bit, and new coefficients (always +-1) are placed after
+    // skipping `r` zero coefficients.
+    s32 bit = 1 << approx_low;
+    u32 k = spectral_start;
+    if (!j->eob_run)
+    {
+        while (k <= spectral_end)
+        {
+            u32 rs = image_jpeg_decode(j, j->ac[c->ac_table]);
+            u32 r = rs >> 4;
+            u32 s = rs & 0xF;
+            s32 value = 0;
+            if (!s)
+            {
+                if (r < 15)
+                {
+                    // NOTE: The rest of this block is refined below as the
+                    // first block of the run.
+                    j->eob_run = (1u << r) + image_jpeg_bits(j, r);
+                    break;
+                }
+            }
+            else
+            {
+                if (s != 1)
+                {
+                    j->invalid = true;
+                    return;
+                }
+                value = image_jpeg_bits(j, 1) ? bit : -bit;
+            }
+
+            while (k <= spectral_end)
+            {
+                s16* coefficient = &block[image_jpeg_zigzag[k]];
+                k += 1;
+                if (*coefficient)
+                {
+                    if (image_jpeg_bits(j, 1) && !(*coefficient & bit))
+                    {
+                        *coefficient = (s16)(*coefficient
+                                             + (*coefficient > 0 ? bit : -bit));
+                    }
+                }
+                else
+                {
+                    if (!r)
+                    {
+                        *coefficient = (s16)value;
+                        break;
+                    }
+                    r -= 1;
+                }
+            }
+        }
+    }
+
+    if (j->eob_run)
+    {
+        for (; k <= spectral_end; k += 1)
+        {
+            s16* coefficient = &block[image_jpeg_zigzag[k]];
+            if (*coefficient && image_jpeg_bits(j, 1) && !(*coefficient & bit))
+            {
+                *coefficient
+                    = (s16)(*coefficient + (*coefficient > 0 ? bit : -bit));
+            }
+        }
+        j->eob_run -= 1;
+    }
+}
+
+// NOTE: Skips to the restart marker, which resets the bit reader, the DC
+// predictors and the end-of-band run.
+FUNCTION void
+image_jpeg_restart(image_jpeg* j)
+{
+    j->bits = 0;
+    j->bit_count = 0;
+    while (j->pos + 1 < j->size
+           && !(j->data[j->pos] == 0xFF && j->data[j->pos + 1] >= 0xD0
+                && j->data[j->pos + 1] <= 0xD7))
+    {
+        j->pos += 1;
+    }
+    j->pos += 2;
+    j->eob_run = 0;
+    for (u32 i = 0; i < j->component_count; i += 1)
+    {
+        j->components[i].dc_predictor = 0;
+    }
+}
+
+FUNCTION b8
+image_jpeg_read_scan(image_jpeg* j, u8* segment, u32 length, pg_error* err)
+{
+    u32 scan_count = segment[0];
+    if (!scan_count || scan_count > j->component_count
+        || length < 4 + (scan_count * 2))
+    {
+        PG_ERROR_MAJOR("invalid jpeg scan");
+        return false;
+    }
+
+    image_jpeg_component* scan[IMAGE_JPEG_MAX_COMPONENT_COUNT] = {0};
+    for (u32 i = 0; i < scan_count; i += 1)
+    {
+        u32 id = segment[1 + (i * 2)];
+        u32 tables = segment[2 + (i * 2)];
+        for (u32 c = 0; c < j->component_count; c += 1)
+        {
+            if (j->components[c].id == id)
+            {
+                scan[i] = &j->components[c];
+            }
+        }
+        if (!scan[i] || (tables >> 4) > 3 || (tables & 0xF) > 3)
+        {
+            PG_ERROR_MAJOR("invalid jpeg scan component");
+            return false;
+        }
+        scan[i]->dc_table = tables >> 4;
+        scan[i]->ac_table = tables & 0xF;
+    }
+    u8* params = &segment[1 + (scan_count * 2)];
+    u32 spectral_start = params[0];
+    u32 spectral_end = params[1];
+    u32 approx_high = params[2] >> 4;
+    u32 approx_low = params[2] & 0xF;
+    if (!j->progressive)
+    {
+        spectral_start = 0;
+        spectral_end = 63;
+        approx_high = 0;
+        approx_low = 0;
+    }
+    else if (spectral_end > 63 || spectral_start > spectral_end
+             || (spectral_start && scan_count != 1) || approx_low > 13)
+    {
+        PG_ERROR_MAJOR("invalid jpeg progressive scan");
+        return false;
+    }
+
+    j->pos = (usize)(segment - j->data) + length;
+    j->bits = 0;
+    j->bit_count = 0;
+    j->eob_run = 0;
+    for (u32 i = 0; i < j->component_count; i += 1)
+    {
+        j->components[i].dc_predictor = 0;
+    }
+
+    // NOTE: A scan of one component covers only its own blocks within the
+    // image, in raster order, rather than whole MCUs.
+    u32 unit_count = 0;
+    if (scan_count == 1)
+    {
+        image_jpeg_component* c = scan[0];
+        u32 blocks_x = (c->width + 7) / 8;
+        u32 blocks_y = (c->height + 7) / 8;
+        for (u32 by = 0; by < blocks_y; by += 1)
+        {
+            for (u32 bx = 0; bx < blocks_x; bx += 1)
+            {
+                if (j->restart_interval && unit_count
+                    && unit_count % j->restart_interval == 0)
+                {
+                    image_jpeg_restart(j);
+                }
+                s16* block
+                    = &c->coefficients[((by * c->blocks_x) + bx) * 64];
+                image_jpeg_decode_block(j,
+                                        c,
+                                        block,
+                                        spectral_start,
+                                        spectral_end,
+                                        approx_high,
+                                        approx_low);
+                unit_count += 1;
+            }
+        }
+    }
+    else
+    {
+        for (u32 my = 0; my < j->mcus_y; my += 1)
+        {
+            for (u32 mx = 0; mx < j->mcus_x; mx += 1)
+            {
+                if (j->restart_interval && unit_count
+                    && unit_count % j->restart_interval == 0)
+                {
+                    image_jpeg_restart(j);
+                }
+                for (u32 i = 0; i < scan_count; i += 1)
+                {
+                    image_jpeg_component* c = scan[i];
+                    for (u32 v = 0; v < c->v; v += 1)
+                    {
+                        for (u32 h = 0; h < c->h; h += 1)
+                        {
+                            u32 bx = (mx * c->h) + h;
+                            u32 by = (my * c->v) + v;
+                            s16* block
+                                = &c->coefficients[((by * c->blocks_x) + bx)
+                                                   * 64];
+                            image_jpeg_decode_block(j,
+                                                    c,
+                                                    block,
+                                                    spectral_start,
+                                                    spectral_end,
+                                                    approx_high,
+                                                    approx_low);
+                        }
+                    }
+                }
+                unit_count += 1;
+            }
+        }
+    }
+
+    if (j->invalid)
+    {
+        PG_ERROR_MAJOR("invalid jpeg huffman data");
+        return false;
+    }
+
+    // NOTE: The reader stops in front of markers, so the next marker is found
+    // by skipping what is left of the entropy-coded data.
+    while (j->pos + 1 < j->size
+           && !(j->data[j->pos] == 0xFF && j->data[j->pos + 1]
+                && !(j->data[j->pos + 1] >= 0xD0 && j->data[j->pos + 1] <= 0xD7)
+                && j->data[j->pos + 1] != 0xFF))
+    {
+        j->pos += 1;
+    }
+
+    return true;
+}
+
+// Dequantizes and inverse transforms every block of every component into its
+// samples.
+FUNCTION void
+image_jpeg_reconstruct(image_jpeg* j)
+{
+    // NOTE: idct[x][u] = C(u) / 2 * cos((2x + 1) * u * pi / 16), where C(0)
+    // is 1 / sqrt(2).
+    f32 idct[8][8] = {0};
+    for (u32 x = 0; x < 8; x += 1)
+    {
+        for (u32 u = 0; u < 8; u += 1)
+        {
+            u32 k = ((2 * x) + 1) * u % 32;
+            f32 sign = 1.0f;
+            if (k > 16)
+            {
+                k = 32 - k;
+            }
+            if (k > 8)
+            {
+                k = 16 - k;
+                sign = -1.0f;
+            }
+            f32 scale = u ? 0.5f : 0.5f * image_jpeg_cosines[4];
+            idct[x][u] = sign * scale * image_jpeg_cosines[k];
+        }
+    }
+
+    for (u32 i = 0; i < j->component_count; i += 1)
+    {
+        image_jpeg_component* c = &j->components[i];
+        u16* quant = j->quant[c->quant_id];
+        u32 stride = c->blocks_x * 8;
+        for (u32 by = 0; by < c->blocks_y; by += 1)
+        {
+            for (u32 bx = 0; bx < c->blocks_x; bx += 1)
+            {
+                s16* block = &c->coefficients[((by * c->blocks_x) + bx) * 64];
+                f32 coefficients[64];
+                for (u32 k = 0; k < 64; k += 1)
+                {
+                    coefficients[k] = (f32)block[k] * (f32)quant[k];
+                }
+
+                // Rows (over u), then columns (over v).
+                f32 rows[64];
+                for (u32 v = 0; v < 8; v += 1)
+                {
+                    for (u32 x = 0; x < 8; x += 1)
+                    {
+                        f32 sum = 0.0f;
+                        for (u32 u = 0; u < 8; u += 1)
+                        {
+                            sum += idct[x][u] * coefficients[(v * 8) + u];
+                        }
+                        rows[(v * 8) + x] = sum;
+                    }
+                }
+                for (u32 y = 0; y < 8; y += 1)
+                {
+                    u8* out = &c->samples[(((by * 8) + y) * stride) + (bx * 8)];
+                    for (u32 x = 0; x < 8; x += 1)
+                    {
+                        f32 sum = 128.5f;
+                        for (u32 v = 0; v < 8; v += 1)
+                        {
+                            sum += idct[y][v] * rows[(v * 8) + x];
+                        }
+                        out[x] = sum <= 0.0f     ? 0
+                                 : sum >= 255.0f ? 255
+                                                 : (u8)sum;
+                    }
+                }
+            }
+        }
+    }
+}
+
+FUNCTION u8
+image_clamp_u8(f32 value)
+{
+    return value <= 0.0f ? 0 : value >= 255.0f ? 255 : (u8)(value + 0.5f);
+}
+
+FUNCTION b8
+image_decode_jpeg(u8* data,
+                  usize size,
+                  pg_scratch_allocator* mem,
+                  rgba_image* img,
+                  pg_error* err)
+{
+    image_jpeg* j = 0;
+    pg_scratch_alloc(mem, sizeof(image_jpeg), alignof(image_jpeg), &j, err);
+    if (!j)
+    {
+        return false;
+    }
+    *j = (image_jpeg){.data = data, .size = size, .adobe_transform = -1};
+
+    b8 has_frame = false;
+    b8 done = false;
+    usize pos = 2;
+    while (!done)
+    {
+        while (pos < size && data[pos] != 0xFF)
+        {
+            pos += 1;
+        }
+        while (pos < size && data[pos] == 0xFF)
+        {
+            pos += 1;
+        }
+        if (pos >= size)
+        {
+            break;
+        }
+        u32 marker = data[pos];
+        pos += 1;
+        if (marker == 0xD9)
+        {
+            break;
+        }
+        if ((marker >= 0xD0 && marker <= 0xD7) || marker == 0x01)
+        {
+            continue;
+        }
+        if (pos + 2 > size)
+        {
+            break;
+        }
+        u32 length = image_read_u16_be(&data[pos]);
+        if (length < 2 || pos + length > size)
+        {
+            PG_ERROR_MAJOR("jpeg segment exceeds file");
+            return false;
+        }
+        u8* segment = &data[pos + 2];
+        length -= 2;
+        pos += 2 + length;
+
+        switch (marker)
+        {
+            case 0xC4:
+            {
+                if (!image_jpeg_read_huffman(j, segment, length, mem, err))
+                {
+                    return false;
+                }
+                break;
+            }
+            case 0xDB:
+            {
+                for (u32 p = 0; p < length;)
+                {
+                    u32 precision = segment[p] >> 4;
+                    u32 id = segment[p] & 0xF;
+                    if (id > 3 || p + 1 + (64 * (precision + 1)) > length)
+                    {
+                        PG_ERROR_MAJOR("invalid jpeg quantization table");
+                        return false;
+                    }
+                    for (u32 k = 0; k < 64; k += 1)
+                    {
+                        j->quant[id][image_jpeg_zigzag[k]]
+                            = (u16)(precision
+                                        ? image_read_u16_be(
+                                              &segment[p + 1 + (k * 2)])
+                                        : segment[p + 1 + k]);
+                    }
+                    p += 1 + (64 * (precision + 1));
+                }
+                break;
+            }
+            case 0xDD:
+            {
+                j->restart_interval
+                    = length >= 2 ? image_read_u16_be(segment) : 0;
+                break;
+            }
+            case 0xEE:
+            {
+                if (length >= 12
+                    && image_read_u32_be(segment) == IMAGE_JPEG_ADOBE
+                    && segment[4] == 'e')
+                {
+                    j->adobe_transform = segment[11];
+                }
+                break;
+            }
+            case 0xC0:
+            case 0xC1:
+            case 0xC2:
+            {
+                j->progressive = marker == 0xC2;
+                j->component_count = length >= 6 ? segment[5] : 0;
+                if (has_frame || segment[0] != 8
+                    || (j->component_count != 1 && j->component_count != 3)
+                    || length < 6 + (j->component_count * 3))
+                {
+                    PG_ERROR_MAJOR("unsupported jpeg frame");
+                    return false;
+                }
+                j->height = image_read_u16_be(&segment[1]);
+                j->width = image_read_u16_be(&segment[3]);
+                for (u32 i = 0; i < j->component_count; i += 1)
+                {
+                    image_jpeg_component* c = &j->components[i];
+                    u8* s = &segment[6 + (i * 3)];
+                    c->id = s[0];
+                    c->h = s[1] >> 4;
+                    c->v = s[1] & 0xF;
+                    c->quant_id = s[2] & 3;
+                    if (!c->h || c->h > 4 || !c->v || c->v > 4)
+                    {
+                        PG_ERROR_MAJOR("invalid jpeg sampling factors");
+                        return false;
+                    }
+                    j->max_h = c->h > j->max_h ? c->h : j->max_h;
+                    j->max_v = c->v > j->max_v ? c->v : j->max_v;
+                }
+                if (!j->width || !j->height)
+                {
+                    PG_ERROR_MAJOR("invalid jpeg dimensions");
+                    return false;
+                }
+
+                j->mcus_x = (j->width + (8 * j->max_h) - 1) / (8 * j->max_h);
+                j->mcus_y = (j->height + (8 * j->max_v) - 1) / (8 * j->max_v);
+                for (u32 i = 0; i < j->component_count; i += 1)
+                {
+                    image_jpeg_component* c = &j->components[i];
+                    c->blocks_x = j->mcus_x * c->h;
+                    c->blocks_y = j->mcus_y * c->v;
+                    c->width = ((j->width * c->h) + j->max_h - 1) / j->max_h;
+                    c->height = ((j->height * c->v) + j->max_v - 1) / j->max_v;
+                    usize block_count = (usize)c->blocks_x * c->blocks_y;
+                    pg_scratch_alloc(mem,
+                                     block_count * 64 * sizeof(s16),
+                                     alignof(s16),
+                                     &c->coefficients,
+                                     err);
+                    pg_scratch_alloc(mem,
+                                     block_count * 64,
+                                     1,
+                                     &c->samples,
+                                     err);
+                    if (!c->coefficients || !c->samples)
+                    {
+                        return false;
+                    }
+                    for (usize k = 0; k < block_count * 64; k += 1)
+                    {
+                        c->coefficients[k] = 0;
+                    }
+                }
+                has_frame = true;
+                break;
+            }
+            case 0xDA:
+            {
+                if (!has_frame
+                    || !image_jpeg_read_scan(j, segment, length, err))
+                {
+                    PG_ERROR_MAJOR("invalid jpeg scan");
+                    return false;
+                }
+                if (!j->progressive)
+                {
+                    done = true;
+                }
+                pos = j->pos;
+                break;
+            }
+            default:
+            {
+                if ((marker >= 0xC3 && marker <= 0xCF && marker != 0xC4
+                     && marker != 0xC8 && marker != 0xCC))
+                {
+                    PG_ERROR_MAJOR("unsupported jpeg coding");
+                    return false;
+                }
+                break;
+            }
+        }
+    }
+
+    if (!has_frame)
+    {
+        PG_ERROR_MAJOR("jpeg has no frame");
+        return false;
+    }
+
+    image_jpeg_reconstruct(j);
+
+    pg_scratch_alloc(mem,
+                     (usize)j->width * j->height * 4,
+                     4,
+                     &img->pixels,
+                     err);
+    if (!img->pixels)
+    {
+        return false;
+    }
+
+    // NOTE: Three components are YCbCr unless an Adobe marker says they are
+    // not transformed.
+    b8 ycbcr = j->component_count == 3 && j->adobe_transform != 0;
+    for (u32 y = 0; y < j->height; y += 1)
+    {
+        u8* out = &img->pixels[(usize)y * j->width * 4];
+        for (u32 x = 0; x < j->width; x += 1)
+        {
+            u8 values[IMAGE_JPEG_MAX_COMPONENT_COUNT] = {0};
+            for (u32 i = 0; i < j->component_count; i += 1)
+            {
+                image_jpeg_component* c = &j->components[i];
+                u32 cx = (x * c->h) / j->max_h;
+                u32 cy = (y * c->v) / j->max_v;
+                values[i] = c->samples[(cy * c->blocks_x * 8) + cx];
+            }
+
+            if (j->component_count == 1)
+            {
+                out[(x * 4) + 0] = values[0];
+                out[(x * 4) + 1] = values[0];
+                out[(x * 4) + 2] = values[0];
+            }
+            else if (ycbcr)
+            {
+                f32 luma = (f32)values[0];
+                f32 cb = (f32)values[1] - 128.0f;
+                f32 cr = (f32)values[2] - 128.0f;
+                out[(x * 4) + 0] = image_clamp_u8(luma + (1.402f * cr));
+                out[(x * 4) + 1] = image_clamp_u8(luma - (0.344136f * cb)
+                                                  - (0.714136f * cr));
+                out[(x * 4) + 2] = image_clamp_u8(luma + (1.772f * cb));
+            }
+            else
+            {
+                out[(x * 4) + 0] = values[0];
+                out[(x * 4) + 1] = values[1];
+                out[(x * 4) + 2] = values[2];
+            }
+            out[(x * 4) + 3] = 255;
+        }
+    }
+
+    img->width = j->width;
+    img->height = j->height;
+
+    return true;
+}
+
+// Decodes a PNG or JPEG image (detected from its signature) to RGBA.
+FUNCTION b8
+image_decode(u8* data,
+             usize size,
+             pg_scratch_allocator* mem,
+             rgba_image* img,
+             pg_error* err)
+{
+    *img = (rgba_image){0};
+
+    u64 signature = 0;
+    for (u32 i = 0; i < 8 && i < size; i += 1)
+    {
+        signature |= (u64)data[i] << (i * 8);
+    }
+    if (size >= 8 && signature == IMAGE_PNG_SIGNATURE)
+    {
+        return image_decode_png(data, size, mem, img, err);
+    }
+    if (size >= 4 && data[0] == 0xFF && data[1] == 0xD8)
+    {
+        return image_decode_jpeg(data, size, mem, img, err);
+    }
+
+    PG_ERROR_MAJOR("unsupported image format");
+    return false;
+}
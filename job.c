@@ -0,0 +1,607 @@
+// Job system
+//
+// Work-stealing scheduler that splits the CPU side of a frame across cores.
+// Each worker owns a fixed-size deque of jobs. It pushes and pops its own jobs
+// at the bottom (newest first, while their data is still in cache), and a
+// worker that runs out steals from the top (oldest first) of another worker's
+// deque, starting from a random one. The thread that initializes the system is
+// worker 0, and a worker waiting on jobs runs jobs (its own or stolen ones)
+// until they finish instead of blocking, so one worker runs everything
+// serially.
+//
+// A job runs a function over a range of items, and loops are usually split
+// into jobs of a batch of items each by `job_parallel_for`. Kicking a job adds
+// to a counter that the job decrements when it finishes, so waiting on the
+// counter waits for every job kicked with it. Each worker also has a scratch
+// allocator for memory its jobs return to the frame, since the frame's
+// transient allocator is not thread-safe. It is freed when the frame ends (see
+// `job_system_end_frame`).
+//
+// NOTE: Workers spin for a while after they run out of jobs, then sleep until
+// more are kicked.
+// NOTE: Kicking a job to a full deque runs the job right away.
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(LINUX)
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+#endif
+
+#define JOB_MAX_WORKER_COUNT 64
+#define JOB_DEQUE_CAPACITY 1024 // NOTE: Must be a power of 2.
+#define JOB_WORKER_MEM_SIZE PG_MEBIBYTE(1)
+#define JOB_SPIN_COUNT 2048 // Attempts to find a job before sleeping
+#define JOB_CACHE_LINE_SIZE 64
+
+// NOTE: The deque indices and counters are only ever accessed through these,
+// which order them like the C11 atomics of the same names (x64 loads and
+// stores are already acquire and release, so MSVC only needs compiler barriers
+// for them).
+#if defined(_MSC_VER) && !defined(__clang__)
+FUNCTION s64
+job_load_acquire(volatile s64* value)
+{
+    s64 result = *value;
+    _ReadWriteBarrier();
+    return result;
+}
+
+FUNCTION void
+job_store_release(volatile s64* value, s64 new_value)
+{
+    _ReadWriteBarrier();
+    *value = new_value;
+}
+
+FUNCTION b8
+job_compare_exchange(volatile s64* value, s64 expected, s64 new_value)
+{
+    return _InterlockedCompareExchange64(value, new_value, expected)
+           == expected;
+}
+
+FUNCTION s64
+job_add(volatile s64* value, s64 addend)
+{
+    return _InterlockedExchangeAdd64(value, addend) + addend;
+}
+
+FUNCTION s64
+job_exchange(volatile s64* value, s64 new_value)
+{
+    return _InterlockedExchange64(value, new_value);
+}
+
+FUNCTION void
+job_fence(void)
+{
+    _mm_mfence();
+}
+#else
+FUNCTION s64
+job_load_acquire(volatile s64* value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+FUNCTION void
+job_store_release(volatile s64* value, s64 new_value)
+{
+    __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+}
+
+FUNCTION b8
+job_compare_exchange(volatile s64* value, s64 expected, s64 new_value)
+{
+    return __atomic_compare_exchange_n(value,
+                                       &expected,
+                                       new_value,
+                                       false,
+                                       __ATOMIC_SEQ_CST,
+                                       __ATOMIC_RELAXED);
+}
+
+FUNCTION s64
+job_add(volatile s64* value, s64 addend)
+{
+    return __atomic_add_fetch(value, addend, __ATOMIC_SEQ_CST);
+}
+
+FUNCTION s64
+job_exchange(volatile s64* value, s64 new_value)
+{
+    return __atomic_exchange_n(value, new_value, __ATOMIC_SEQ_CST);
+}
+
+FUNCTION void
+job_fence(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+#endif
+
+typedef struct job_system job_system;
+typedef struct job_worker job_worker;
+
+typedef struct
+{
+    volatile s64 pending; // Jobs kicked and not yet finished
+} job_counter;
+
+typedef void (*job_fp)(job_worker* worker, void* data, u32 begin, u32 end);
+
+typedef struct
+{
+    job_fp fp;
+    void* data;
+    job_counter* counter;
+    u32 begin;
+    u32 end;
+} job;
+
+// NOTE: Workers are cache line aligned so that one worker's deque indices and
+// counts never share a line with another's.
+struct job_worker
+{
+    alignas(JOB_CACHE_LINE_SIZE) volatile s64 top; // Next job to steal
+    alignas(JOB_CACHE_LINE_SIZE) volatile s64 bottom; // Next job to push
+    job* jobs;                                        // JOB_DEQUE_CAPACITY
+    job_system* system;
+    pg_scratch_allocator mem; // Freed by `job_system_end_frame`
+    u32 id;
+    u32 random; // Of the next worker to steal from
+    u32 job_count;
+    u32 steal_count;
+};
+
+// NOTE: The worker count is published before any worker starts and never
+// changes after, and `quit` is only set once.
+struct job_system
+{
+    job_worker* workers;
+    volatile s64 worker_count;
+    u32 thread_count; // Workers (other than worker 0) whose thread started
+    volatile s64 sleeping_count;
+    volatile s64 quit;
+#if defined(LINUX)
+    sem_t wake;
+    pthread_t threads[JOB_MAX_WORKER_COUNT];
+#elif defined(WINDOWS)
+    HANDLE wake;
+    HANDLE threads[JOB_MAX_WORKER_COUNT];
+#endif
+};
+
+// NOTE: Per frame, over every worker.
+typedef struct
+{
+    u32 worker_count;
+    u32 job_count;
+    u32 steal_count;
+} job_stats;
+
+FUNCTION u32
+job_get_core_count(void)
+{
+#if defined(LINUX)
+    s64 count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (u32)count : 1;
+#elif defined(WINDOWS)
+    SYSTEM_INFO info = {0};
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+#endif
+}
+
+// NOTE: Only the worker that owns a deque pushes and pops it.
+FUNCTION b8
+job_push(job_worker* worker, job* j)
+{
+    s64 bottom = worker->bottom;
+    s64 top = job_load_acquire(&worker->top);
+    if (bottom - top >= JOB_DEQUE_CAPACITY)
+    {
+        return false;
+    }
+
+    worker->jobs[bottom & (JOB_DEQUE_CAPACITY - 1)] = *j;
+    job_store_release(&worker->bottom, bottom + 1);
+
+    return true;
+}
+
+FUNCTION b8
+job_pop(job_worker* worker, job* j)
+{
+    s64 bottom = worker->bottom - 1;
+    worker->bottom = bottom;
+    job_fence();
+    s64 top = job_load_acquire(&worker->top);
+    if (top > bottom)
+    {
+        worker->bottom = bottom + 1;
+        return false;
+    }
+
+    *j = worker->jobs[bottom & (JOB_DEQUE_CAPACITY - 1)];
+
+    // NOTE: The last job may be stolen at the same time, so it goes to
+    // whichever of the two takes the top first.
+    b8 popped = true;
+    if (top == bottom)
+    {
+        popped = job_compare_exchange(&worker->top, top, top + 1);
+        worker->bottom = bottom + 1;
+    }
+
+    return popped;
+}
+
+FUNCTION b8
+job_steal(job_worker* victim, job* j)
+{
+    s64 top = job_load_acquire(&victim->top);
+    job_fence();
+    s64 bottom = job_load_acquire(&victim->bottom);
+    if (top >= bottom)
+    {
+        return false;
+    }
+
+    // NOTE: The job may be overwritten as soon as another thief takes it, in
+    // which case the exchange below fails and this copy is dropped.
+    *j = victim->jobs[top & (JOB_DEQUE_CAPACITY - 1)];
+
+    return job_compare_exchange(&victim->top, top, top + 1);
+}
+
+FUNCTION b8
+job_find(job_worker* worker, job* j)
+{
+    if (job_pop(worker, j))
+    {
+        return true;
+    }
+
+    // NOTE: Victims are visited in order from a random one (xorshift), so
+    // thieves spread out over the busy workers.
+    job_system* js = worker->system;
+    u32 random = worker->random;
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    worker->random = random;
+    u32 worker_count = (u32)job_load_acquire(&js->worker_count);
+    for (u32 i = 0; i < worker_count; i += 1)
+    {
+        job_worker* victim = &js->workers[(random + i) % worker_count];
+        if (victim != worker && job_steal(victim, j))
+        {
+            worker->steal_count += 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+FUNCTION void
+job_run(job_worker* worker, job* j)
+{
+    j->fp(worker, j->data, j->begin, j->end);
+    worker->job_count += 1;
+    if (j->counter)
+    {
+        job_add(&j->counter->pending, -1);
+    }
+}
+
+FUNCTION void
+job_wake(job_system* js, u32 job_count)
+{
+    // NOTE: Pairs with the fence in `job_worker_loop`, so either the kicker
+    // sees the sleeper or the sleeper sees the job.
+    job_fence();
+    s64 sleeping_count = job_load_acquire(&js->sleeping_count);
+    for (s64 i = 0; i < sleeping_count && (u32)i < job_count; i += 1)
+    {
+#if defined(LINUX)
+        sem_post(&js->wake);
+#elif defined(WINDOWS)
+        ReleaseSemaphore(js->wake, 1, 0);
+#endif
+    }
+}
+
+FUNCTION void
+job_kick(job_worker* worker,
+         job_fp fp,
+         void* data,
+         u32 begin,
+         u32 end,
+         job_counter* counter)
+{
+    job j = {.fp = fp,
+             .data = data,
+             .counter = counter,
+             .begin = begin,
+             .end = end};
+    if (counter)
+    {
+        job_add(&counter->pending, 1);
+    }
+
+    if (!job_push(worker, &j))
+    {
+        job_run(worker, &j);
+        return;
+    }
+
+    job_wake(worker->system, 1);
+}
+
+// NOTE: A loop that fits in one batch runs right away on the calling worker,
+// without a job.
+FUNCTION void
+job_parallel_for(job_worker* worker,
+                 job_fp fp,
+                 void* data,
+                 u32 count,
+                 u32 batch_size,
+                 job_counter* counter)
+{
+    if (count <= batch_size)
+    {
+        if (count)
+        {
+            fp(worker, data, 0, count);
+        }
+        return;
+    }
+
+    u32 batch_count = (count + batch_size - 1) / batch_size;
+    job_add(&counter->pending, batch_count);
+    u32 pushed_count = 0;
+    for (u32 i = 0; i < batch_count; i += 1)
+    {
+        u32 end = (i + 1) * batch_size;
+        job j = {.fp = fp,
+                 .data = data,
+                 .counter = counter,
+                 .begin = i * batch_size,
+                 .end = end < count ? end : count};
+        if (job_push(worker, &j))
+        {
+            pushed_count += 1;
+        }
+        else
+        {
+            job_run(worker, &j);
+        }
+    }
+
+    job_wake(worker->system, pushed_count);
+}
+
+FUNCTION void
+job_wait(job_worker* worker, job_counter* counter)
+{
+    job j;
+    while (job_load_acquire(&counter->pending) > 0)
+    {
+        if (job_find(worker, &j))
+        {
+            job_run(worker, &j);
+        }
+        else
+        {
+            _mm_pause();
+        }
+    }
+}
+
+FUNCTION void
+job_worker_loop(job_worker* worker)
+{
+    job_system* js = worker->system;
+    job j;
+    u32 spin_count = 0;
+    while (!job_load_acquire(&js->quit))
+    {
+        if (job_find(worker, &j))
+        {
+            job_run(worker, &j);
+            spin_count = 0;
+            continue;
+        }
+
+        if (spin_count < JOB_SPIN_COUNT)
+        {
+            spin_count += 1;
+            _mm_pause();
+            continue;
+        }
+
+        // Sleep until a job is kicked, unless one was kicked before this
+        // worker was counted as sleeping.
+        job_add(&js->sleeping_count, 1);
+        job_fence();
+        b8 found = job_find(worker, &j);
+        if (!found && !job_load_acquire(&js->quit))
+        {
+#if defined(LINUX)
+            sem_wait(&js->wake);
+#elif defined(WINDOWS)
+            WaitForSingleObject(js->wake, INFINITE);
+#endif
+        }
+        job_add(&js->sleeping_count, -1);
+        if (found)
+        {
+            job_run(worker, &j);
+        }
+        spin_count = 0;
+    }
+}
+
+#if defined(LINUX)
+FUNCTION void*
+job_thread_main(void* data)
+{
+    job_worker_loop(data);
+    return 0;
+}
+#elif defined(WINDOWS)
+FUNCTION DWORD WINAPI
+job_thread_main(LPVOID data)
+{
+    job_worker_loop(data);
+    return 0;
+}
+#endif
+
+// NOTE: A thread count of 0 starts one worker per core (including the calling
+// thread, which is worker 0).
+FUNCTION b8
+job_system_init(job_system* js,
+                u32 thread_count,
+                pg_scratch_allocator* mem,
+                pg_error* err)
+{
+    *js = (job_system){0};
+
+    u32 worker_count = thread_count ? thread_count : job_get_core_count();
+    if (worker_count > JOB_MAX_WORKER_COUNT)
+    {
+        worker_count = JOB_MAX_WORKER_COUNT;
+    }
+
+    pg_scratch_alloc(mem,
+                     worker_count * sizeof(job_worker),
+                     alignof(job_worker),
+                     &js->workers,
+                     err);
+    if (!js->workers)
+    {
+        return false;
+    }
+    for (u32 i = 0; i < worker_count; i += 1)
+    {
+        job_worker* w = &js->workers[i];
+        *w = (job_worker){.system = js, .id = i, .random = i + 1};
+
+        u8* worker_memory = 0;
+        pg_scratch_alloc(mem,
+                         JOB_DEQUE_CAPACITY * sizeof(job),
+                         alignof(job),
+                         &w->jobs,
+                         err);
+        pg_scratch_alloc(mem,
+                         JOB_WORKER_MEM_SIZE,
+                         JOB_CACHE_LINE_SIZE,
+                         &worker_memory,
+                         err);
+        if (!w->jobs || !worker_memory)
+        {
+            return false;
+        }
+        pg_scratch_init(&w->mem, worker_memory, JOB_WORKER_MEM_SIZE);
+    }
+
+#if defined(LINUX)
+    if (sem_init(&js->wake, 0, 0))
+    {
+        PG_ERROR_MAJOR("failed to create job semaphore");
+        return false;
+    }
+#elif defined(WINDOWS)
+    js->wake = CreateSemaphoreW(0, 0, JOB_MAX_WORKER_COUNT, 0);
+    if (!js->wake)
+    {
+        PG_ERROR_MAJOR("failed to create job semaphore");
+        return false;
+    }
+#endif
+
+    // NOTE: Workers whose thread fails to start never kick jobs, so their
+    // deques stay empty and every job still runs on the workers that did.
+    job_store_release(&js->worker_count, worker_count);
+    for (u32 i = 1; i < worker_count; i += 1)
+    {
+#if defined(LINUX)
+        if (pthread_create(&js->threads[i],
+                           0,
+                           &job_thread_main,
+                           &js->workers[i]))
+        {
+            break;
+        }
+#elif defined(WINDOWS)
+        js->threads[i]
+            = CreateThread(0, 0, &job_thread_main, &js->workers[i], 0, 0);
+        if (!js->threads[i])
+        {
+            break;
+        }
+#endif
+        js->thread_count += 1;
+    }
+
+    return true;
+}
+
+FUNCTION void
+job_system_release(job_system* js)
+{
+    if (!js->workers)
+    {
+        return;
+    }
+
+    job_store_release(&js->quit, true);
+    for (u32 i = 1; i <= js->thread_count; i += 1)
+    {
+#if defined(LINUX)
+        sem_post(&js->wake);
+#elif defined(WINDOWS)
+        ReleaseSemaphore(js->wake, 1, 0);
+#endif
+    }
+    for (u32 i = 1; i <= js->thread_count; i += 1)
+    {
+#if defined(LINUX)
+        pthread_join(js->threads[i], 0);
+#elif defined(WINDOWS)
+        WaitForSingleObject(js->threads[i], INFINITE);
+        CloseHandle(js->threads[i]);
+#endif
+    }
+
+#if defined(LINUX)
+    sem_destroy(&js->wake);
+#elif defined(WINDOWS)
+    CloseHandle(js->wake);
+#endif
+    *js = (job_system){0};
+}
+
+// NOTE: Must be called by worker 0 with no jobs pending, since it frees every
+// worker's scratch memory.
+FUNCTION void
+job_system_end_frame(job_system* js, job_stats* stats)
+{
+    *stats = (job_stats){.worker_count = (u32)js->worker_count};
+    for (u32 i = 0; i < stats->worker_count; i += 1)
+    {
+        job_worker* w = &js->workers[i];
+        stats->job_count += w->job_count;
+        stats->steal_count += w->steal_count;
+        w->job_count = 0;
+        w->steal_count = 0;
+        pg_scratch_free(&w->mem);
+    }
+}
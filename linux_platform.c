@@ -0,0 +1,139 @@
+// Linux platform layer
+//
+// The part of a platform layer that the headless Linux targets (the benchmark
+// and the asset packer) need: memory, file reads and error logging. There is
+// no window, GPU or input device, so the input queue is only ever read (and
+// always empty).
+//
+// NOTE: The rest of the common library is platform-independent, and only its
+// core header (pg.h, at the root of the library dir) is included here. Library
+// releases that only ship windows/pg_windows.h do not have it, and build.sh
+// checks for it before compiling the Linux targets.
+
+#include <pg.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct
+{
+    pg_scratch_allocator permanent_mem;
+    pg_scratch_allocator transient_mem;
+    pg_input_queue input_queue;
+    u8* memory; // Of both allocators
+    usize memory_size;
+} linux_platform;
+
+FUNCTION void
+linux_platform_error_log(c8* msg)
+{
+    fprintf(stderr, "error: %s\n", msg);
+}
+
+// NOTE: Permanent and transient memory are one anonymous mapping, so pages
+// are only committed as they are first written.
+FUNCTION void
+linux_platform_init_memory(linux_platform* platform,
+                           usize permanent_mem_size,
+                           usize transient_mem_size,
+                           pg_error* err)
+{
+    usize size = permanent_mem_size + transient_mem_size;
+    void* memory = mmap(0,
+                        size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS,
+                        -1,
+                        0);
+    if (memory == MAP_FAILED)
+    {
+        PG_ERROR_MAJOR("failed to allocate memory");
+        return;
+    }
+
+    platform->memory = memory;
+    platform->memory_size = size;
+    pg_scratch_init(&platform->permanent_mem,
+                    platform->memory,
+                    permanent_mem_size);
+    pg_scratch_init(&platform->transient_mem,
+                    platform->memory + permanent_mem_size,
+                    transient_mem_size);
+}
+
+FUNCTION void
+linux_platform_release(linux_platform* platform)
+{
+    if (platform->memory)
+    {
+        munmap(platform->memory, platform->memory_size);
+    }
+    *platform = (linux_platform){0};
+}
+
+// Reads the whole file at `path` into `mem`.
+FUNCTION b8
+linux_platform_file_read(pg_string path,
+                         pg_scratch_allocator* mem,
+                         u8** data,
+                         usize* size,
+                         pg_error* err)
+{
+    *data = 0;
+    *size = 0;
+
+    c8 path_cstr[PATH_MAX];
+    if (path.len >= sizeof(path_cstr))
+    {
+        PG_ERROR_MAJOR("file path is too long");
+        return false;
+    }
+    pg_copy(path.ptr, path.len, path_cstr, sizeof(path_cstr), err);
+    path_cstr[path.len] = '\0';
+
+    s32 fd = open(path_cstr, O_RDONLY);
+    if (fd < 0)
+    {
+        PG_ERROR_MAJOR("failed to open file");
+        return false;
+    }
+
+    struct stat st = {0};
+    if (fstat(fd, &st) < 0)
+    {
+        close(fd);
+        PG_ERROR_MAJOR("failed to get file size");
+        return false;
+    }
+
+    u8* file_data = 0;
+    pg_scratch_alloc(mem, (usize)st.st_size, 16, &file_data, err);
+    if (!file_data && st.st_size)
+    {
+        close(fd);
+        return false;
+    }
+
+    // NOTE: Reads may return less than requested, e.g. if interrupted.
+    usize read_size = 0;
+    while (read_size < (usize)st.st_size)
+    {
+        ssize_t result
+            = read(fd, file_data + read_size, (usize)st.st_size - read_size);
+        if (result <= 0)
+        {
+            close(fd);
+            PG_ERROR_MAJOR("failed to read file");
+            return false;
+        }
+        read_size += (usize)result;
+    }
+    close(fd);
+
+    *data = file_data;
+    *size = read_size;
+    return true;
+}
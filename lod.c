@@ -0,0 +1,705 @@
+// Levels of detail
+//
+// At pack time, each primitive gets a chain of up to LOD_MAX_LEVEL_COUNT
+// simplified triangle lists, each about half the triangles of the one before.
+// Edges are collapsed in order of quadric error (Garland-Heckbert), and every
+// level records the largest error of any collapse that built it, an estimate
+// of how far its surface is from the original in mesh space. At runtime, each
+// drawable draws the coarsest level whose error projects to less than
+// LOD_MAX_PIXEL_ERROR pixels.
+//
+// Vertices only ever collapse onto other existing vertices, so levels are
+// index lists into the primitive's original vertices. They are appended after
+// the model's indices in the INDICES section, and this section stores their
+// ranges.
+//
+// NOTE: Vertices on borders, on non-manifold edges and on attribute seams
+// (vertices that share a position with another vertex) are locked, which
+// keeps UV seams and open edges intact at the cost of simplifying less.
+// NOTE: Indices are relative to their primitive's `vertex_offset`.
+// NOTE: Requires frustum.c.
+
+#include <xmmintrin.h>
+
+#define LOD_MAX_LEVEL_COUNT 3
+// NOTE: A level is dropped (and the chain ends) if it does not remove at
+// least this fraction of the previous level's triangles.
+#define LOD_MIN_REDUCTION 0.1f
+// NOTE: Collapses that cost more than this fraction of the primitive's bounds
+// diagonal are never made.
+#define LOD_MAX_RELATIVE_ERROR 0.05f
+// NOTE: Collapses that turn a triangle's normal by more than acos of this are
+// rejected, which stops triangles from flipping over.
+#define LOD_MIN_NORMAL_DOT 0.25f
+#define LOD_MAX_PIXEL_ERROR 1.0f
+// NOTE: A drawable only moves to a coarser level once its error is this much
+// below the threshold, so drawables near a threshold do not flicker.
+#define LOD_HYSTERESIS 0.8f
+// NOTE: Distances are clamped to this, so the camera can be inside bounds.
+#define LOD_MIN_DISTANCE 0.01f
+#define LOD_NO_VERTEX 0xFFFFFFFF
+
+// NOTE: Layout of an ASSET_EXT_SECTION_LODS section: this header, the
+// primitives (in index order), then the levels of every primitive in order,
+// from finest to coarsest.
+typedef struct
+{
+    u32 primitive_count;
+    u32 level_count;
+    u32 instance_count; // Of primitives, by the model's nodes
+    u32 padding0;
+} lods_header;
+
+typedef struct
+{
+    u32 index_offset;
+    u32 index_count;
+    u32 level_offset;
+    u32 level_count;
+} lod_primitive;
+
+typedef struct
+{
+    u32 index_offset; // From the start of the INDICES section's indices.
+    u32 index_count;
+    f32 error; // Mesh space distance
+    u32 padding0;
+} lod_level;
+
+typedef struct
+{
+    lod_primitive* primitives;
+    lod_level* levels;
+    u32 primitive_count;
+    u32 level_count;
+    u32 instance_count; // At most one drawable per instance
+} lods;
+
+// NOTE: Drawables per level, where level 0 is the full primitive.
+typedef struct
+{
+    u32 drawable_counts[LOD_MAX_LEVEL_COUNT + 1];
+} lod_select_stats;
+
+FUNCTION f32
+lod_sqrt(f32 x)
+{
+    return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(x)));
+}
+
+FUNCTION usize
+lods_section_size(u32 primitive_count, u32 level_count)
+{
+    return sizeof(lods_header) + (primitive_count * sizeof(lod_primitive))
+           + (level_count * sizeof(lod_level));
+}
+
+FUNCTION b8
+lods_read(u8* section, u64 section_size, lods* ls)
+{
+    *ls = (lods){0};
+
+    if (!section || section_size < sizeof(lods_header))
+    {
+        return false;
+    }
+
+    lods_header* header = (lods_header*)section;
+    if (section_size
+        < lods_section_size(header->primitive_count, header->level_count))
+    {
+        return false;
+    }
+
+    ls->primitive_count = header->primitive_count;
+    ls->level_count = header->level_count;
+    ls->instance_count = header->instance_count;
+    ls->primitives = (lod_primitive*)(section + sizeof(lods_header));
+    ls->levels = (lod_level*)(section + sizeof(lods_header)
+                              + (header->primitive_count
+                                 * sizeof(lod_primitive)));
+
+    for (u32 i = 0; i < ls->primitive_count; i += 1)
+    {
+        lod_primitive* p = &ls->primitives[i];
+        if (p->level_offset + p->level_count > ls->level_count
+            || p->level_count > LOD_MAX_LEVEL_COUNT)
+        {
+            *ls = (lods){0};
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// NOTE: Binary search, so primitives must be sorted by `index_offset`.
+FUNCTION lod_primitive*
+lods_find_primitive(lods* ls, u32 index_offset)
+{
+    u32 low = 0;
+    u32 high = ls->primitive_count;
+    while (low < high)
+    {
+        u32 mid = low + ((high - low) / 2);
+        if (ls->primitives[mid].index_offset < index_offset)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low < ls->primitive_count
+                   && ls->primitives[low].index_offset == index_offset
+               ? &ls->primitives[low]
+               : 0;
+}
+
+// Returns the coarsest level whose error is at most LOD_MAX_PIXEL_ERROR pixels,
+// where `pixels_per_unit` is the projected size of one mesh space unit at the
+// drawable's distance. `current_level` is the level drawn last frame.
+FUNCTION u32
+lods_select(lods* ls, lod_primitive* p, f32 pixels_per_unit, u32 current_level)
+{
+    u32 level = 0;
+    for (u32 i = 1; i <= p->level_count; i += 1)
+    {
+        f32 max_error = LOD_MAX_PIXEL_ERROR;
+        if (i > current_level)
+        {
+            max_error *= LOD_HYSTERESIS;
+        }
+        if (ls->levels[p->level_offset + i - 1].error * pixels_per_unit
+            > max_error)
+        {
+            break;
+        }
+        level = i;
+    }
+
+    return level;
+}
+
+// Returns the largest scale a matrix applies along any axis.
+FUNCTION f32
+lod_matrix_scale(pg_f32_4x4* m)
+{
+    f32 max_squared_scale = 0.0f;
+    for (u32 i = 0; i < 3; i += 1)
+    {
+        f32 x = frustum_matrix_get(m, 0, i);
+        f32 y = frustum_matrix_get(m, 1, i);
+        f32 z = frustum_matrix_get(m, 2, i);
+        f32 squared_scale = (x * x) + (y * y) + (z * z);
+        if (squared_scale > max_squared_scale)
+        {
+            max_squared_scale = squared_scale;
+        }
+    }
+
+    return lod_sqrt(max_squared_scale);
+}
+
+// Returns the projected size in pixels of one mesh space unit on the near side
+// of a world space bounding sphere. `world_from_mesh_scale` is from
+// `lod_matrix_scale`, and `projection_scale` is the clip from view y scale
+// (cot(fov_y / 2)).
+FUNCTION f32
+lod_pixels_per_unit(f32 world_from_mesh_scale,
+                    pg_f32_3x center,
+                    f32 radius,
+                    pg_f32_3x camera_position,
+                    f32 projection_scale,
+                    f32 render_height)
+{
+    pg_f32_3x d = {center.x - camera_position.x,
+                   center.y - camera_position.y,
+                   center.z - camera_position.z};
+    f32 distance = lod_sqrt((d.x * d.x) + (d.y * d.y) + (d.z * d.z)) - radius;
+    if (distance < LOD_MIN_DISTANCE)
+    {
+        distance = LOD_MIN_DISTANCE;
+    }
+
+    return (world_from_mesh_scale * projection_scale * 0.5f * render_height)
+           / distance;
+}
+
+// Simplification
+
+// NOTE: A symmetric 4x4 error matrix. The error of a point p is
+// (p^T A p + 2 b.p + c) / weight, the area-weighted mean squared distance from
+// p to the planes of the triangles the quadric was built from.
+typedef struct
+{
+    f32 a00, a01, a02, a11, a12, a22;
+    f32 b0, b1, b2;
+    f32 c;
+    f32 weight;
+} lod_quadric;
+
+typedef struct
+{
+    f32 error; // Squared
+    u32 from;
+    u32 to;
+} lod_collapse;
+
+// NOTE: Quadrics are kept between calls to `lod_simplify`, so the error of
+// each level is measured against the original surface.
+typedef struct
+{
+    pg_vertex* vertices;
+    u32 vertex_count;
+    f32 error; // Largest collapse error so far
+    lod_quadric* quadrics;
+    b8* locked;
+    b8* touched;
+    u32* collapse_to;
+    u32* triangle_offsets; // Vertex to triangles, rebuilt every pass.
+    u32* triangles;
+    lod_collapse* collapses;
+    lod_collapse* sorted;
+} lod_simplifier;
+
+FUNCTION pg_f32_3x
+lod_triangle_normal(pg_f32_3x p0, pg_f32_3x p1, pg_f32_3x p2)
+{
+    pg_f32_3x e1 = {p1.x - p0.x, p1.y - p0.y, p1.z - p0.z};
+    pg_f32_3x e2 = {p2.x - p0.x, p2.y - p0.y, p2.z - p0.z};
+    return (pg_f32_3x){(e1.y * e2.z) - (e1.z * e2.y),
+                       (e1.z * e2.x) - (e1.x * e2.z),
+                       (e1.x * e2.y) - (e1.y * e2.x)};
+}
+
+FUNCTION void
+lod_quadric_add(lod_quadric* q, lod_quadric* a)
+{
+    q->a00 += a->a00;
+    q->a01 += a->a01;
+    q->a02 += a->a02;
+    q->a11 += a->a11;
+    q->a12 += a->a12;
+    q->a22 += a->a22;
+    q->b0 += a->b0;
+    q->b1 += a->b1;
+    q->b2 += a->b2;
+    q->c += a->c;
+    q->weight += a->weight;
+}
+
+FUNCTION f32
+lod_quadric_error(lod_quadric* q, pg_f32_3x p)
+{
+    f32 e = (q->a00 * p.x * p.x) + (q->a11 * p.y * p.y) + (q->a22 * p.z * p.z)
+            + (2.0f
+               * ((q->a01 * p.x * p.y) + (q->a02 * p.x * p.z)
+                  + (q->a12 * p.y * p.z) + (q->b0 * p.x) + (q->b1 * p.y)
+                  + (q->b2 * p.z)))
+            + q->c;
+    e = e < 0.0f ? -e : e;
+    return q->weight > 0.0f ? e / q->weight : 0.0f;
+}
+
+FUNCTION u32
+lod_hash(u64 key, u32 shift)
+{
+    return (u32)((key * 0x9E3779B97F4A7C15ull) >> shift);
+}
+
+// Returns the slot of `key` in an open-addressed table of directed edges, or
+// the empty slot where it would go.
+FUNCTION u32
+lod_edge_find(u64* edges, u32 table_size, u32 shift, u64 key)
+{
+    u32 slot = lod_hash(key, shift);
+    while (edges[slot] != key && edges[slot] != ~0ull)
+    {
+        slot = (slot + 1) & (table_size - 1);
+    }
+    return slot;
+}
+
+// NOTE: `indices` are only read, to find the locked vertices.
+FUNCTION void
+lod_simplifier_init(pg_vertex* vertices,
+                    PG_GRAPHICS_INDEX_TYPE* indices,
+                    u32 index_count,
+                    u32 vertex_count,
+                    pg_scratch_allocator* mem,
+                    lod_simplifier* s,
+                    pg_error* err)
+{
+    *s = (lod_simplifier){.vertices = vertices,
+                          .vertex_count = vertex_count};
+    pg_scratch_alloc(mem,
+                     vertex_count * sizeof(lod_quadric),
+                     alignof(lod_quadric),
+                     &s->quadrics,
+                     err);
+    pg_scratch_alloc(mem, vertex_count * sizeof(b8), alignof(b8), &s->locked, err);
+    pg_scratch_alloc(mem,
+                     vertex_count * sizeof(b8),
+                     alignof(b8),
+                     &s->touched,
+                     err);
+    pg_scratch_alloc(mem,
+                     vertex_count * sizeof(u32),
+                     alignof(u32),
+                     &s->collapse_to,
+                     err);
+    pg_scratch_alloc(mem,
+                     (vertex_count + 1) * sizeof(u32),
+                     alignof(u32),
+                     &s->triangle_offsets,
+                     err);
+    pg_scratch_alloc(mem,
+                     index_count * sizeof(u32),
+                     alignof(u32),
+                     &s->triangles,
+                     err);
+    pg_scratch_alloc(mem,
+                     2 * index_count * sizeof(lod_collapse),
+                     alignof(lod_collapse),
+                     &s->collapses,
+                     err);
+    pg_scratch_alloc(mem,
+                     2 * index_count * sizeof(lod_collapse),
+                     alignof(lod_collapse),
+                     &s->sorted,
+                     err);
+
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        s->quadrics[i] = (lod_quadric){0};
+        s->locked[i] = false;
+        s->collapse_to[i] = i;
+    }
+
+    // Accumulate each triangle's plane into the quadrics of its vertices.
+    for (u32 i = 0; i + 2 < index_count; i += 3)
+    {
+        pg_f32_3x p0 = vertices[indices[i]].position;
+        pg_f32_3x n = lod_triangle_normal(p0,
+                                          vertices[indices[i + 1]].position,
+                                          vertices[indices[i + 2]].position);
+        f32 length = lod_sqrt((n.x * n.x) + (n.y * n.y) + (n.z * n.z));
+        if (length <= 0.0f)
+        {
+            continue;
+        }
+        f32 area = 0.5f * length;
+        n = (pg_f32_3x){n.x / length, n.y / length, n.z / length};
+        f32 d = -((n.x * p0.x) + (n.y * p0.y) + (n.z * p0.z));
+        lod_quadric q = {.a00 = area * n.x * n.x,
+                         .a01 = area * n.x * n.y,
+                         .a02 = area * n.x * n.z,
+                         .a11 = area * n.y * n.y,
+                         .a12 = area * n.y * n.z,
+                         .a22 = area * n.z * n.z,
+                         .b0 = area * d * n.x,
+                         .b1 = area * d * n.y,
+                         .b2 = area * d * n.z,
+                         .c = area * d * d,
+                         .weight = area};
+        for (u32 k = 0; k < 3; k += 1)
+        {
+            lod_quadric_add(&s->quadrics[indices[i + k]], &q);
+        }
+    }
+
+    // Lock seams: vertices that share their position with another vertex.
+    u32 shift = 64;
+    u32 table_size = 1;
+    while (table_size < 2 * vertex_count)
+    {
+        table_size *= 2;
+        shift -= 1;
+    }
+    u32* table;
+    pg_scratch_alloc(mem, table_size * sizeof(u32), alignof(u32), &table, err);
+    for (u32 i = 0; i < table_size; i += 1)
+    {
+        table[i] = LOD_NO_VERTEX;
+    }
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        // NOTE: Adding zero turns -0 into +0, so equal positions hash equally.
+        pg_f32_3x p = {vertices[i].position.x + 0.0f,
+                       vertices[i].position.y + 0.0f,
+                       vertices[i].position.z + 0.0f};
+        u32 bits[3] = {0};
+        pg_copy(&p, sizeof(bits), bits, sizeof(bits), err);
+        u64 key = ((u64)bits[0] * 73856093u) ^ ((u64)bits[1] * 19349663u)
+                  ^ ((u64)bits[2] * 83492791u);
+        for (u32 slot = lod_hash(key, shift);; slot = (slot + 1) & (table_size - 1))
+        {
+            u32 v = table[slot];
+            if (v == LOD_NO_VERTEX)
+            {
+                table[slot] = i;
+                break;
+            }
+            pg_f32_3x q = vertices[v].position;
+            if (q.x == p.x && q.y == p.y && q.z == p.z)
+            {
+                s->locked[v] = true;
+                s->locked[i] = true;
+                break;
+            }
+        }
+    }
+
+    // Lock borders: vertices on a directed edge that has no opposite edge, or
+    // that is used more than once (non-manifold).
+    shift = 64;
+    table_size = 1;
+    while (table_size < 2 * index_count)
+    {
+        table_size *= 2;
+        shift -= 1;
+    }
+    u64* edges;
+    u32* edge_counts;
+    pg_scratch_alloc(mem, table_size * sizeof(u64), alignof(u64), &edges, err);
+    pg_scratch_alloc(mem,
+                     table_size * sizeof(u32),
+                     alignof(u32),
+                     &edge_counts,
+                     err);
+    for (u32 i = 0; i < table_size; i += 1)
+    {
+        edges[i] = ~0ull;
+        edge_counts[i] = 0;
+    }
+    for (u32 i = 0; i + 2 < index_count; i += 3)
+    {
+        for (u32 k = 0; k < 3; k += 1)
+        {
+            u64 key = ((u64)indices[i + k] << 32) | indices[i + ((k + 1) % 3)];
+            u32 slot = lod_edge_find(edges, table_size, shift, key);
+            edges[slot] = key;
+            edge_counts[slot] += 1;
+        }
+    }
+    for (u32 i = 0; i + 2 < index_count; i += 3)
+    {
+        for (u32 k = 0; k < 3; k += 1)
+        {
+            u32 a = indices[i + k];
+            u32 b = indices[i + ((k + 1) % 3)];
+            u32 slot = lod_edge_find(edges, table_size, shift, ((u64)a << 32) | b);
+            u32 opposite_slot
+                = lod_edge_find(edges, table_size, shift, ((u64)b << 32) | a);
+            if (edge_counts[slot] != 1 || edge_counts[opposite_slot] != 1)
+            {
+                s->locked[a] = true;
+                s->locked[b] = true;
+            }
+        }
+    }
+}
+
+// Collapses edges of the triangle list `indices` (in place) until at most
+// `target_index_count` indices are left or every remaining collapse would
+// cost more than `max_error`. Returns the new index count.
+FUNCTION u32
+lod_simplify(lod_simplifier* s,
+             PG_GRAPHICS_INDEX_TYPE* indices,
+             u32 index_count,
+             u32 target_index_count,
+             f32 max_error)
+{
+    pg_vertex* vertices = s->vertices;
+    f32 max_squared_error = max_error * max_error;
+
+    while (index_count > target_index_count)
+    {
+        // Build vertex to triangle adjacency.
+        for (u32 i = 0; i <= s->vertex_count; i += 1)
+        {
+            s->triangle_offsets[i] = 0;
+        }
+        for (u32 i = 0; i < index_count; i += 1)
+        {
+            s->triangle_offsets[indices[i] + 1] += 1;
+        }
+        for (u32 i = 0; i < s->vertex_count; i += 1)
+        {
+            s->triangle_offsets[i + 1] += s->triangle_offsets[i];
+        }
+        for (u32 i = 0; i < index_count; i += 1)
+        {
+            s->triangles[s->triangle_offsets[indices[i]]++] = i / 3;
+        }
+        for (u32 i = s->vertex_count; i > 0; i -= 1)
+        {
+            s->triangle_offsets[i] = s->triangle_offsets[i - 1];
+        }
+        s->triangle_offsets[0] = 0;
+
+        // Gather candidate collapses, one per unlocked end of every edge.
+        u32 collapse_count = 0;
+        for (u32 i = 0; i < index_count; i += 1)
+        {
+            u32 a = indices[i];
+            u32 b = indices[i - (i % 3) + ((i + 1) % 3)];
+            for (u32 k = 0; k < 2; k += 1)
+            {
+                u32 from = k ? b : a;
+                u32 to = k ? a : b;
+                if (s->locked[from] || from == to)
+                {
+                    continue;
+                }
+                lod_quadric q = s->quadrics[from];
+                lod_quadric_add(&q, &s->quadrics[to]);
+                s->collapses[collapse_count++]
+                    = (lod_collapse){.error = lod_quadric_error(
+                                         &q,
+                                         vertices[to].position),
+                                     .from = from,
+                                     .to = to};
+            }
+        }
+        for (u32 i = 0; i < s->vertex_count; i += 1)
+        {
+            s->touched[i] = false;
+        }
+
+        // Sort by ascending error. A bottom-up merge sort keeps collapses
+        // with equal errors in index order.
+        lod_collapse* src = s->collapses;
+        lod_collapse* dst = s->sorted;
+        for (u32 width = 1; width < collapse_count; width *= 2)
+        {
+            for (u32 lo = 0; lo < collapse_count; lo += 2 * width)
+            {
+                u32 mid = lo + width < collapse_count ? lo + width
+                                                      : collapse_count;
+                u32 hi = lo + (2 * width) < collapse_count ? lo + (2 * width)
+                                                           : collapse_count;
+                u32 a = lo;
+                u32 b = mid;
+                for (u32 i = lo; i < hi; i += 1)
+                {
+                    if (a < mid && (b >= hi || src[a].error <= src[b].error))
+                    {
+                        dst[i] = src[a++];
+                    }
+                    else
+                    {
+                        dst[i] = src[b++];
+                    }
+                }
+            }
+            lod_collapse* swap = src;
+            src = dst;
+            dst = swap;
+        }
+
+        // Apply the cheapest collapses that do not touch each other's
+        // triangles, so each one is checked against up-to-date geometry.
+        u32 removed_index_count = 0;
+        u32 applied_count = 0;
+        for (u32 i = 0; i < collapse_count
+                        && index_count - removed_index_count > target_index_count;
+             i += 1)
+        {
+            lod_collapse* c = &src[i];
+            if (c->error > max_squared_error)
+            {
+                break;
+            }
+            if (s->touched[c->from] || s->touched[c->to])
+            {
+                continue;
+            }
+
+            // Reject collapses that flip or badly turn a triangle.
+            pg_f32_3x to_position = vertices[c->to].position;
+            u32 removed_triangle_count = 0;
+            b8 flipped = false;
+            for (u32 j = s->triangle_offsets[c->from];
+                 !flipped && j < s->triangle_offsets[c->from + 1];
+                 j += 1)
+            {
+                u32 t = s->triangles[j] * 3;
+                u32 v[3] = {indices[t], indices[t + 1], indices[t + 2]};
+                if (v[0] == c->to || v[1] == c->to || v[2] == c->to)
+                {
+                    removed_triangle_count += 1;
+                    continue;
+                }
+                pg_f32_3x p[3] = {0};
+                pg_f32_3x moved[3] = {0};
+                for (u32 k = 0; k < 3; k += 1)
+                {
+                    p[k] = vertices[v[k]].position;
+                    moved[k] = v[k] == c->from ? to_position : p[k];
+                }
+                pg_f32_3x n0 = lod_triangle_normal(p[0], p[1], p[2]);
+                pg_f32_3x n1
+                    = lod_triangle_normal(moved[0], moved[1], moved[2]);
+                f32 d = (n0.x * n1.x) + (n0.y * n1.y) + (n0.z * n1.z);
+                f32 l0 = (n0.x * n0.x) + (n0.y * n0.y) + (n0.z * n0.z);
+                f32 l1 = (n1.x * n1.x) + (n1.y * n1.y) + (n1.z * n1.z);
+                flipped = d <= 0.0f
+                          || d * d < LOD_MIN_NORMAL_DOT * LOD_MIN_NORMAL_DOT
+                                         * l0 * l1;
+            }
+            if (flipped)
+            {
+                continue;
+            }
+
+            s->collapse_to[c->from] = c->to;
+            lod_quadric_add(&s->quadrics[c->to], &s->quadrics[c->from]);
+            if (c->error > s->error * s->error)
+            {
+                s->error = lod_sqrt(c->error);
+            }
+            for (u32 j = s->triangle_offsets[c->from];
+                 j < s->triangle_offsets[c->from + 1];
+                 j += 1)
+            {
+                u32 t = s->triangles[j] * 3;
+                s->touched[indices[t]] = true;
+                s->touched[indices[t + 1]] = true;
+                s->touched[indices[t + 2]] = true;
+            }
+            removed_index_count += removed_triangle_count * 3;
+            applied_count += 1;
+        }
+        if (!applied_count)
+        {
+            break;
+        }
+
+        // Rewrite indices and drop the triangles that collapsed.
+        u32 out = 0;
+        for (u32 i = 0; i < index_count; i += 3)
+        {
+            u32 a = s->collapse_to[indices[i]];
+            u32 b = s->collapse_to[indices[i + 1]];
+            u32 c = s->collapse_to[indices[i + 2]];
+            if (a != b && b != c && a != c)
+            {
+                indices[out] = (PG_GRAPHICS_INDEX_TYPE)a;
+                indices[out + 1] = (PG_GRAPHICS_INDEX_TYPE)b;
+                indices[out + 2] = (PG_GRAPHICS_INDEX_TYPE)c;
+                out += 3;
+            }
+        }
+        for (u32 i = 0; i < s->vertex_count; i += 1)
+        {
+            s->collapse_to[i] = i;
+        }
+        index_count = out;
+    }
+
+    return index_count;
+}
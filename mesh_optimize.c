@@ -0,0 +1,793 @@
+// Mesh optimization
+//
+// A pack-time pass over each primitive's triangle list:
+// 1. Vertex cache: triangles are reordered for post-transform cache hits
+//    (Forsyth's linear-speed algorithm, tuned for a 32-entry LRU cache).
+// 2. Overdraw: runs of triangles that start with a full cache miss (so they
+//    can move without costing cache hits) are sorted so that outward-facing
+//    runs draw first and hide what is behind them from the depth test.
+// 3. Vertex fetch: vertices are renumbered in order of first use, so fetches
+//    walk the vertex buffer front to back.
+//
+// The analyzers (a FIFO cache simulator, an overdraw rasterizer and a vertex
+// fetch simulator) measure each step. Results are accumulated as counts so
+// that per-primitive results can be summed into per-model results.
+//
+// NOTE: Indices are relative to their primitive's `vertex_offset`.
+
+#include <xmmintrin.h>
+
+#define MESH_CACHE_SIZE 32
+#define MESH_SIMULATED_CACHE_SIZE 16
+#define MESH_MAX_VALENCE_SCORE 32
+#define MESH_OVERDRAW_GRID_SIZE 128
+#define MESH_FETCH_LINE_SIZE 64
+#define MESH_FETCH_CACHE_LINE_COUNT 256
+
+// NOTE: Layout of an ASSET_EXT_SECTION_INDICES section: this header, then
+// `index_count` indices in place of the .pga indices, then `lod_index_count`
+// indices of simplified levels (see lod.c). If MESH_INDICES_REMAPPED_VERTICES
+// is set, the indices refer to the (remapped) compact vertices, not the .pga
+// vertices.
+typedef enum
+{
+    MESH_INDICES_REMAPPED_VERTICES = 1 << 0,
+} mesh_indices_flag;
+
+typedef struct
+{
+    u32 index_count;
+    u32 flags;
+    u32 lod_index_count;
+    u32 padding0;
+} mesh_indices_header;
+
+typedef struct
+{
+    u64 triangle_count;
+    u64 vertex_count;      // referenced vertices
+    u64 cache_miss_count;  // FIFO, MESH_SIMULATED_CACHE_SIZE entries
+    u64 pixels_covered;    // summed over all views
+    u64 pixels_shaded;     // summed over all views
+    u64 bytes_fetched;     // whole cache lines
+    u64 bytes_referenced;  // referenced vertices
+} mesh_stats;
+
+// Average cache miss ratio (transformed vertices per triangle)
+FUNCTION f32
+mesh_stats_acmr(mesh_stats* stats)
+{
+    return stats->triangle_count
+               ? (f32)stats->cache_miss_count / (f32)stats->triangle_count
+               : 0.0f;
+}
+
+// Average transform to vertex ratio (1.0 is optimal)
+FUNCTION f32
+mesh_stats_atvr(mesh_stats* stats)
+{
+    return stats->vertex_count
+               ? (f32)stats->cache_miss_count / (f32)stats->vertex_count
+               : 0.0f;
+}
+
+// Shaded pixels per covered pixel (1.0 is optimal)
+FUNCTION f32
+mesh_stats_overdraw(mesh_stats* stats)
+{
+    return stats->pixels_covered
+               ? (f32)stats->pixels_shaded / (f32)stats->pixels_covered
+               : 0.0f;
+}
+
+// Fetched bytes per referenced vertex byte (1.0 is optimal)
+FUNCTION f32
+mesh_stats_overfetch(mesh_stats* stats)
+{
+    return stats->bytes_referenced
+               ? (f32)stats->bytes_fetched / (f32)stats->bytes_referenced
+               : 0.0f;
+}
+
+FUNCTION f32
+mesh_sqrt(f32 x)
+{
+    return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(x)));
+}
+
+FUNCTION void
+mesh_analyze_vertex_cache(PG_GRAPHICS_INDEX_TYPE* indices,
+                          u32 index_count,
+                          u32 vertex_count,
+                          pg_scratch_allocator* mem,
+                          mesh_stats* stats,
+                          pg_error* err)
+{
+    // NOTE: A vertex is in the FIFO cache if fewer than
+    // MESH_SIMULATED_CACHE_SIZE misses happened since it was loaded.
+    u32* timestamps;
+    pg_scratch_alloc(mem,
+                     vertex_count * sizeof(u32),
+                     alignof(u32),
+                     &timestamps,
+                     err);
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        timestamps[i] = 0;
+    }
+
+    u32 time = MESH_SIMULATED_CACHE_SIZE + 1;
+    u32 referenced_count = 0;
+    for (u32 i = 0; i < index_count; i += 1)
+    {
+        u32 v = indices[i];
+        referenced_count += timestamps[v] == 0;
+        if (time - timestamps[v] > MESH_SIMULATED_CACHE_SIZE)
+        {
+            timestamps[v] = time;
+            time += 1;
+            stats->cache_miss_count += 1;
+        }
+    }
+
+    stats->triangle_count += index_count / 3;
+    stats->vertex_count += referenced_count;
+}
+
+FUNCTION void
+mesh_analyze_vertex_fetch(PG_GRAPHICS_INDEX_TYPE* indices,
+                          u32 index_count,
+                          u32 vertex_count,
+                          u32 vertex_size,
+                          pg_scratch_allocator* mem,
+                          mesh_stats* stats,
+                          pg_error* err)
+{
+    // NOTE: Direct-mapped cache of MESH_FETCH_CACHE_LINE_COUNT lines.
+    u64 lines[MESH_FETCH_CACHE_LINE_COUNT];
+    for (u32 i = 0; i < MESH_FETCH_CACHE_LINE_COUNT; i += 1)
+    {
+        lines[i] = ~0ull;
+    }
+
+    u8* referenced;
+    pg_scratch_alloc(mem, vertex_count, 1, &referenced, err);
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        referenced[i] = 0;
+    }
+
+    for (u32 i = 0; i < index_count; i += 1)
+    {
+        u32 v = indices[i];
+        if (!referenced[v])
+        {
+            referenced[v] = 1;
+            stats->bytes_referenced += vertex_size;
+        }
+
+        u64 first_line = ((u64)v * vertex_size) / MESH_FETCH_LINE_SIZE;
+        u64 last_line
+            = (((u64)v * vertex_size) + vertex_size - 1) / MESH_FETCH_LINE_SIZE;
+        for (u64 line = first_line; line <= last_line; line += 1)
+        {
+            u64* slot = &lines[line % MESH_FETCH_CACHE_LINE_COUNT];
+            if (*slot != line)
+            {
+                *slot = line;
+                stats->bytes_fetched += MESH_FETCH_LINE_SIZE;
+            }
+        }
+    }
+}
+
+// Estimate overdraw by rasterizing the triangles in order, with depth testing
+// and back-face culling, from both directions along each axis.
+FUNCTION void
+mesh_analyze_overdraw(pg_vertex* vertices,
+                      PG_GRAPHICS_INDEX_TYPE* indices,
+                      u32 index_count,
+                      u32 vertex_count,
+                      pg_scratch_allocator* mem,
+                      mesh_stats* stats,
+                      pg_error* err)
+{
+    if (!vertex_count || index_count < 3)
+    {
+        return;
+    }
+
+    f32* depth;
+    pg_scratch_alloc(mem,
+                     MESH_OVERDRAW_GRID_SIZE * MESH_OVERDRAW_GRID_SIZE
+                         * sizeof(f32),
+                     alignof(f32),
+                     &depth,
+                     err);
+
+    pg_f32_3x min = vertices[0].position;
+    pg_f32_3x max = min;
+    for (u32 i = 1; i < vertex_count; i += 1)
+    {
+        pg_f32_3x p = vertices[i].position;
+        min.x = p.x < min.x ? p.x : min.x;
+        min.y = p.y < min.y ? p.y : min.y;
+        min.z = p.z < min.z ? p.z : min.z;
+        max.x = p.x > max.x ? p.x : max.x;
+        max.y = p.y > max.y ? p.y : max.y;
+        max.z = p.z > max.z ? p.z : max.z;
+    }
+    f32 extent = max.x - min.x;
+    extent = max.y - min.y > extent ? max.y - min.y : extent;
+    extent = max.z - min.z > extent ? max.z - min.z : extent;
+    f32 scale = extent > 0.0f ? (MESH_OVERDRAW_GRID_SIZE - 1) / extent : 0.0f;
+
+    for (u32 view = 0; view < 6; view += 1)
+    {
+        u32 axis = view / 2;
+        f32 direction = (view % 2) ? -1.0f : 1.0f;
+
+        for (u32 i = 0; i < MESH_OVERDRAW_GRID_SIZE * MESH_OVERDRAW_GRID_SIZE;
+             i += 1)
+        {
+            depth[i] = 1e30f;
+        }
+
+        for (u32 t = 0; t + 2 < index_count; t += 3)
+        {
+            f32 x[3];
+            f32 y[3];
+            f32 z[3];
+            for (u32 k = 0; k < 3; k += 1)
+            {
+                pg_f32_3x p = vertices[indices[t + k]].position;
+                f32 c[] = {(p.x - min.x) * scale,
+                           (p.y - min.y) * scale,
+                           (p.z - min.z) * scale};
+                x[k] = c[(axis + 1) % 3];
+                y[k] = c[(axis + 2) % 3];
+                z[k] = c[axis] * direction;
+            }
+
+            // NOTE: Counter-clockwise triangles face the viewer. Looking
+            // along +axis, they wind clockwise in (u, v).
+            f32 area = ((x[1] - x[0]) * (y[2] - y[0]))
+                       - ((x[2] - x[0]) * (y[1] - y[0]));
+            if (area * direction >= 0.0f)
+            {
+                continue;
+            }
+
+            f32 min_x = x[0] < x[1] ? x[0] : x[1];
+            min_x = x[2] < min_x ? x[2] : min_x;
+            f32 max_x = x[0] > x[1] ? x[0] : x[1];
+            max_x = x[2] > max_x ? x[2] : max_x;
+            f32 min_y = y[0] < y[1] ? y[0] : y[1];
+            min_y = y[2] < min_y ? y[2] : min_y;
+            f32 max_y = y[0] > y[1] ? y[0] : y[1];
+            max_y = y[2] > max_y ? y[2] : max_y;
+
+            // NOTE: Pixel centers are at integer coordinates.
+            u32 x0 = (u32)(min_x + 0.999f);
+            u32 y0 = (u32)(min_y + 0.999f);
+            u32 x1 = (u32)max_x;
+            u32 y1 = (u32)max_y;
+            f32 inv_area = 1.0f / area;
+            for (u32 py = y0; py <= y1 && py < MESH_OVERDRAW_GRID_SIZE; py += 1)
+            {
+                for (u32 px = x0; px <= x1 && px < MESH_OVERDRAW_GRID_SIZE;
+                     px += 1)
+                {
+                    f32 fx = (f32)px;
+                    f32 fy = (f32)py;
+                    f32 w0 = (((x[1] - fx) * (y[2] - fy))
+                              - ((x[2] - fx) * (y[1] - fy)))
+                             * inv_area;
+                    f32 w1 = (((x[2] - fx) * (y[0] - fy))
+                              - ((x[0] - fx) * (y[2] - fy)))
+                             * inv_area;
+                    f32 w2 = 1.0f - w0 - w1;
+                    if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                    {
+                        continue;
+                    }
+
+                    f32 d = (w0 * z[0]) + (w1 * z[1]) + (w2 * z[2]);
+                    f32* pixel = &depth[(py * MESH_OVERDRAW_GRID_SIZE) + px];
+                    if (d <= *pixel)
+                    {
+                        stats->pixels_shaded += 1;
+                        stats->pixels_covered += *pixel == 1e30f;
+                        *pixel = d;
+                    }
+                }
+            }
+        }
+    }
+}
+
+FUNCTION void
+mesh_analyze(pg_vertex* vertices,
+             PG_GRAPHICS_INDEX_TYPE* indices,
+             u32 index_count,
+             u32 vertex_count,
+             u32 vertex_size,
+             pg_scratch_allocator* mem,
+             mesh_stats* stats,
+             pg_error* err)
+{
+    mesh_analyze_vertex_cache(indices, index_count, vertex_count, mem, stats, err);
+    mesh_analyze_vertex_fetch(indices,
+                              index_count,
+                              vertex_count,
+                              vertex_size,
+                              mem,
+                              stats,
+                              err);
+    mesh_analyze_overdraw(vertices,
+                          indices,
+                          index_count,
+                          vertex_count,
+                          mem,
+                          stats,
+                          err);
+}
+
+typedef struct
+{
+    f32 cache_scores[MESH_CACHE_SIZE];
+    f32 valence_scores[MESH_MAX_VALENCE_SCORE + 1];
+} mesh_score_table;
+
+FUNCTION void
+mesh_score_table_init(mesh_score_table* table)
+{
+    // NOTE: The three most recent vertices (the last triangle) get a fixed
+    // score so that the next triangle does not simply reuse them. Beyond
+    // those, the score decays with cache position.
+    for (u32 i = 0; i < MESH_CACHE_SIZE; i += 1)
+    {
+        if (i < 3)
+        {
+            table->cache_scores[i] = 0.75f;
+        }
+        else
+        {
+            f32 x = 1.0f - ((f32)(i - 3) / (f32)(MESH_CACHE_SIZE - 3));
+            table->cache_scores[i] = x * mesh_sqrt(x); // x^1.5
+        }
+    }
+
+    // NOTE: Vertices with few remaining triangles are boosted so that they
+    // are finished off instead of being left as stragglers.
+    table->valence_scores[0] = 0.0f;
+    for (u32 i = 1; i <= MESH_MAX_VALENCE_SCORE; i += 1)
+    {
+        table->valence_scores[i] = 2.0f / mesh_sqrt((f32)i);
+    }
+}
+
+FUNCTION f32
+mesh_vertex_score(mesh_score_table* table, s32 cache_position, u32 valence)
+{
+    if (!valence)
+    {
+        return -1.0f;
+    }
+
+    f32 score = cache_position >= 0 && cache_position < MESH_CACHE_SIZE
+                    ? table->cache_scores[cache_position]
+                    : 0.0f;
+    score += table->valence_scores[valence < MESH_MAX_VALENCE_SCORE
+                                       ? valence
+                                       : MESH_MAX_VALENCE_SCORE];
+
+    return score;
+}
+
+// NOTE: `result` must not alias `indices`.
+FUNCTION void
+mesh_optimize_vertex_cache(PG_GRAPHICS_INDEX_TYPE* indices,
+                           u32 index_count,
+                           u32 vertex_count,
+                           PG_GRAPHICS_INDEX_TYPE* result,
+                           pg_scratch_allocator* mem,
+                           pg_error* err)
+{
+    u32 triangle_count = index_count / 3;
+    if (!triangle_count)
+    {
+        return;
+    }
+
+    mesh_score_table table;
+    mesh_score_table_init(&table);
+
+    u32* valences;
+    u32* adjacency_offsets;
+    u32* adjacency;
+    s32* cache_positions;
+    f32* vertex_scores;
+    f32* triangle_scores;
+    u8* emitted;
+    pg_scratch_alloc(mem, vertex_count * sizeof(u32), alignof(u32), &valences, err);
+    pg_scratch_alloc(mem,
+                     (vertex_count + 1) * sizeof(u32),
+                     alignof(u32),
+                     &adjacency_offsets,
+                     err);
+    pg_scratch_alloc(mem,
+                     triangle_count * 3 * sizeof(u32),
+                     alignof(u32),
+                     &adjacency,
+                     err);
+    pg_scratch_alloc(mem,
+                     vertex_count * sizeof(s32),
+                     alignof(s32),
+                     &cache_positions,
+                     err);
+    pg_scratch_alloc(mem,
+                     vertex_count * sizeof(f32),
+                     alignof(f32),
+                     &vertex_scores,
+                     err);
+    pg_scratch_alloc(mem,
+                     triangle_count * sizeof(f32),
+                     alignof(f32),
+                     &triangle_scores,
+                     err);
+    pg_scratch_alloc(mem, triangle_count, 1, &emitted, err);
+
+    // Build vertex to triangle adjacency.
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        valences[i] = 0;
+        cache_positions[i] = -1;
+    }
+    for (u32 i = 0; i < triangle_count * 3; i += 1)
+    {
+        valences[indices[i]] += 1;
+    }
+    adjacency_offsets[0] = 0;
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        adjacency_offsets[i + 1] = adjacency_offsets[i] + valences[i];
+        valences[i] = 0;
+    }
+    for (u32 t = 0; t < triangle_count; t += 1)
+    {
+        for (u32 k = 0; k < 3; k += 1)
+        {
+            u32 v = indices[(t * 3) + k];
+            adjacency[adjacency_offsets[v] + valences[v]] = t;
+            valences[v] += 1;
+        }
+    }
+
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        vertex_scores[i] = mesh_vertex_score(&table, -1, valences[i]);
+    }
+    for (u32 t = 0; t < triangle_count; t += 1)
+    {
+        emitted[t] = 0;
+        triangle_scores[t] = vertex_scores[indices[t * 3]]
+                             + vertex_scores[indices[(t * 3) + 1]]
+                             + vertex_scores[indices[(t * 3) + 2]];
+    }
+
+    // NOTE: The cache has room for a triangle's vertices on top of
+    // MESH_CACHE_SIZE so that evicted vertices can be rescored.
+    u32 cache[MESH_CACHE_SIZE + 3];
+    u32 cache_count = 0;
+    u32 next_unemitted = 0;
+
+    for (u32 out = 0; out < triangle_count; out += 1)
+    {
+        // Pick the best triangle touching the cache, or else the next
+        // triangle in input order.
+        u32 best = ~0u;
+        f32 best_score = -1.0f;
+        for (u32 i = 0; i < cache_count; i += 1)
+        {
+            u32 v = cache[i];
+            for (u32 j = adjacency_offsets[v];
+                 j < adjacency_offsets[v] + valences[v];
+                 j += 1)
+            {
+                u32 t = adjacency[j];
+                if (triangle_scores[t] > best_score)
+                {
+                    best = t;
+                    best_score = triangle_scores[t];
+                }
+            }
+        }
+        if (best == ~0u)
+        {
+            while (emitted[next_unemitted])
+            {
+                next_unemitted += 1;
+            }
+            best = next_unemitted;
+        }
+
+        // Emit it and remove it from its vertices' adjacency.
+        emitted[best] = 1;
+        u32* tri = (u32[3]){indices[best * 3],
+                            indices[(best * 3) + 1],
+                            indices[(best * 3) + 2]};
+        for (u32 k = 0; k < 3; k += 1)
+        {
+            u32 v = tri[k];
+            result[(out * 3) + k] = (PG_GRAPHICS_INDEX_TYPE)v;
+
+            u32* adj = &adjacency[adjacency_offsets[v]];
+            for (u32 j = 0; j < valences[v]; j += 1)
+            {
+                if (adj[j] == best)
+                {
+                    adj[j] = adj[valences[v] - 1];
+                    valences[v] -= 1;
+                    break;
+                }
+            }
+        }
+
+        // Move its vertices to the front of the cache (LRU).
+        u32 new_cache[MESH_CACHE_SIZE + 3];
+        u32 new_cache_count = 0;
+        for (u32 k = 0; k < 3; k += 1)
+        {
+            b8 duplicate = false;
+            for (u32 j = 0; j < new_cache_count; j += 1)
+            {
+                duplicate = duplicate || new_cache[j] == tri[k];
+            }
+            if (!duplicate)
+            {
+                new_cache[new_cache_count++] = tri[k];
+            }
+        }
+        for (u32 i = 0; i < cache_count; i += 1)
+        {
+            u32 v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+            {
+                new_cache[new_cache_count++] = v;
+            }
+        }
+
+        // Rescore the vertices whose cache position changed (including the
+        // ones pushed out), then the triangles that use them.
+        for (u32 i = 0; i < new_cache_count; i += 1)
+        {
+            u32 v = new_cache[i];
+            cache_positions[v] = i < MESH_CACHE_SIZE ? (s32)i : -1;
+            vertex_scores[v]
+                = mesh_vertex_score(&table, cache_positions[v], valences[v]);
+        }
+        for (u32 i = 0; i < new_cache_count; i += 1)
+        {
+            u32 v = new_cache[i];
+            for (u32 j = adjacency_offsets[v];
+                 j < adjacency_offsets[v] + valences[v];
+                 j += 1)
+            {
+                u32 t = adjacency[j];
+                triangle_scores[t] = vertex_scores[indices[t * 3]]
+                                     + vertex_scores[indices[(t * 3) + 1]]
+                                     + vertex_scores[indices[(t * 3) + 2]];
+            }
+        }
+
+        cache_count = new_cache_count < MESH_CACHE_SIZE ? new_cache_count
+                                                        : MESH_CACHE_SIZE;
+        for (u32 i = 0; i < cache_count; i += 1)
+        {
+            cache[i] = new_cache[i];
+        }
+    }
+}
+
+typedef struct
+{
+    u32 first_triangle;
+    u32 triangle_count;
+    f32 sort_key;
+} mesh_cluster;
+
+// NOTE: `result` must not alias `indices`, which must already be optimized
+// for the vertex cache.
+FUNCTION void
+mesh_optimize_overdraw(pg_vertex* vertices,
+                       PG_GRAPHICS_INDEX_TYPE* indices,
+                       u32 index_count,
+                       u32 vertex_count,
+                       PG_GRAPHICS_INDEX_TYPE* result,
+                       pg_scratch_allocator* mem,
+                       pg_error* err)
+{
+    u32 triangle_count = index_count / 3;
+    if (!triangle_count)
+    {
+        return;
+    }
+
+    mesh_cluster* clusters;
+    pg_scratch_alloc(mem,
+                     triangle_count * sizeof(mesh_cluster),
+                     alignof(mesh_cluster),
+                     &clusters,
+                     err);
+    u32* timestamps;
+    pg_scratch_alloc(mem,
+                     vertex_count * sizeof(u32),
+                     alignof(u32),
+                     &timestamps,
+                     err);
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        timestamps[i] = 0;
+    }
+
+    // Split into clusters at triangles where all three vertices miss the
+    // simulated cache. Reordering clusters only moves those full misses.
+    u32 cluster_count = 0;
+    u32 time = MESH_SIMULATED_CACHE_SIZE + 1;
+    for (u32 t = 0; t < triangle_count; t += 1)
+    {
+        u32 miss_count = 0;
+        for (u32 k = 0; k < 3; k += 1)
+        {
+            u32 v = indices[(t * 3) + k];
+            if (time - timestamps[v] > MESH_SIMULATED_CACHE_SIZE)
+            {
+                timestamps[v] = time;
+                time += 1;
+                miss_count += 1;
+            }
+        }
+
+        if (t == 0 || miss_count == 3)
+        {
+            clusters[cluster_count++]
+                = (mesh_cluster){.first_triangle = t};
+        }
+        clusters[cluster_count - 1].triangle_count += 1;
+    }
+
+    // Sort key: how far the cluster faces outward from the mesh centroid.
+    pg_f32_3x mesh_centroid = {0};
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        mesh_centroid.x += vertices[i].position.x / (f32)vertex_count;
+        mesh_centroid.y += vertices[i].position.y / (f32)vertex_count;
+        mesh_centroid.z += vertices[i].position.z / (f32)vertex_count;
+    }
+
+    for (u32 c = 0; c < cluster_count; c += 1)
+    {
+        mesh_cluster* cluster = &clusters[c];
+        pg_f32_3x centroid = {0};
+        pg_f32_3x normal = {0};
+        f32 area_sum = 0.0f;
+        for (u32 t = cluster->first_triangle;
+             t < cluster->first_triangle + cluster->triangle_count;
+             t += 1)
+        {
+            pg_f32_3x p0 = vertices[indices[t * 3]].position;
+            pg_f32_3x p1 = vertices[indices[(t * 3) + 1]].position;
+            pg_f32_3x p2 = vertices[indices[(t * 3) + 2]].position;
+            pg_f32_3x e1 = {p1.x - p0.x, p1.y - p0.y, p1.z - p0.z};
+            pg_f32_3x e2 = {p2.x - p0.x, p2.y - p0.y, p2.z - p0.z};
+            pg_f32_3x n = {(e1.y * e2.z) - (e1.z * e2.y),
+                           (e1.z * e2.x) - (e1.x * e2.z),
+                           (e1.x * e2.y) - (e1.y * e2.x)};
+            f32 area = mesh_sqrt((n.x * n.x) + (n.y * n.y) + (n.z * n.z));
+
+            // NOTE: The cross product is area-weighted, so summing it gives
+            // the cluster's average normal direction.
+            normal.x += n.x;
+            normal.y += n.y;
+            normal.z += n.z;
+            centroid.x += area * (p0.x + p1.x + p2.x) / 3.0f;
+            centroid.y += area * (p0.y + p1.y + p2.y) / 3.0f;
+            centroid.z += area * (p0.z + p1.z + p2.z) / 3.0f;
+            area_sum += area;
+        }
+
+        f32 normal_length = mesh_sqrt((normal.x * normal.x)
+                                      + (normal.y * normal.y)
+                                      + (normal.z * normal.z));
+        if (area_sum > 0.0f && normal_length > 0.0f)
+        {
+            cluster->sort_key
+                = (((centroid.x / area_sum) - mesh_centroid.x) * normal.x
+                   + ((centroid.y / area_sum) - mesh_centroid.y) * normal.y
+                   + ((centroid.z / area_sum) - mesh_centroid.z) * normal.z)
+                  / normal_length;
+        }
+    }
+
+    // Sort by descending key. A bottom-up merge sort keeps clusters with
+    // equal keys in cache order.
+    mesh_cluster* sorted;
+    pg_scratch_alloc(mem,
+                     cluster_count * sizeof(mesh_cluster),
+                     alignof(mesh_cluster),
+                     &sorted,
+                     err);
+    mesh_cluster* src = clusters;
+    mesh_cluster* dst = sorted;
+    for (u32 width = 1; width < cluster_count; width *= 2)
+    {
+        for (u32 lo = 0; lo < cluster_count; lo += 2 * width)
+        {
+            u32 mid = lo + width < cluster_count ? lo + width : cluster_count;
+            u32 hi = lo + (2 * width) < cluster_count ? lo + (2 * width)
+                                                      : cluster_count;
+            u32 a = lo;
+            u32 b = mid;
+            for (u32 i = lo; i < hi; i += 1)
+            {
+                if (a < mid && (b >= hi || src[a].sort_key >= src[b].sort_key))
+                {
+                    dst[i] = src[a++];
+                }
+                else
+                {
+                    dst[i] = src[b++];
+                }
+            }
+        }
+        mesh_cluster* swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    u32 out = 0;
+    for (u32 c = 0; c < cluster_count; c += 1)
+    {
+        mesh_cluster* cluster = &src[c];
+        for (u32 i = cluster->first_triangle * 3;
+             i < (cluster->first_triangle + cluster->triangle_count) * 3;
+             i += 1)
+        {
+            result[out++] = indices[i];
+        }
+    }
+}
+
+// Renumber vertices in order of first use. Unreferenced vertices go last.
+// `remap` receives the new id of every old vertex.
+FUNCTION void
+mesh_optimize_vertex_fetch(PG_GRAPHICS_INDEX_TYPE* indices,
+                           u32 index_count,
+                           u32 vertex_count,
+                           u32* remap)
+{
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        remap[i] = ~0u;
+    }
+
+    u32 next = 0;
+    for (u32 i = 0; i < index_count; i += 1)
+    {
+        u32 v = indices[i];
+        if (remap[v] == ~0u)
+        {
+            remap[v] = next++;
+        }
+        indices[i] = (PG_GRAPHICS_INDEX_TYPE)remap[v];
+    }
+
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        if (remap[i] == ~0u)
+        {
+            remap[i] = next++;
+        }
+    }
+}
@@ -0,0 +1,489 @@
+// Meshlets
+//
+// At pack time, each primitive's triangle list is split into small clusters
+// of consecutive triangles, so every meshlet is a contiguous index range. Each
+// meshlet stores a bounding sphere and a normal cone, and at runtime meshlets
+// are rejected if their sphere is outside the view frustum or if the camera is
+// inside their backface cone. The surviving index ranges are merged where they
+// touch and drawn in place of the whole primitive.
+//
+// NOTE: Bounds are in mesh space (before the drawable's global transform).
+// NOTE: Skinned primitives have no meshlets, because their bounds move.
+// NOTE: Requires frustum.c.
+
+#include <xmmintrin.h>
+
+#define MESHLET_MAX_VERTEX_COUNT 64
+#define MESHLET_MAX_TRIANGLE_COUNT 124
+// NOTE: Cones that are wider than this (dot of a triangle normal with the
+// axis) would rarely be culled, so they are disabled.
+#define MESHLET_MIN_CONE_DOT 0.1f
+// NOTE: Once a meshlet has MESHLET_MIN_TRIANGLE_COUNT triangles, it is also
+// closed at the first triangle that faces away from its average normal by more
+// than this, which keeps cones narrow enough to cull.
+#define MESHLET_MIN_TRIANGLE_COUNT 8
+#define MESHLET_SPLIT_CONE_DOT 0.5f
+#define MESHLET_NO_MARK 0xFFFFFFFF
+
+typedef enum
+{
+    MESHLETS_EXT_INDICES = 1 << 0, // Built from the INDICES section.
+} meshlets_flag;
+
+// NOTE: Layout of an ASSET_EXT_SECTION_MESHLETS section: this header, the
+// primitives (in index order), then the meshlets of every primitive in order.
+typedef struct
+{
+    u32 primitive_count;
+    u32 meshlet_count;
+    u32 flags; // meshlets_flag
+    u32 padding0;
+} meshlets_header;
+
+typedef struct
+{
+    u32 index_offset;
+    u32 index_count;
+    u32 meshlet_offset;
+    u32 meshlet_count;
+} meshlet_primitive;
+
+// NOTE: A meshlet faces away from the camera if
+// dot(normalize(cone_apex - camera), cone_axis) >= cone_cutoff. A cutoff of 1
+// disables the cone test.
+typedef struct
+{
+    pg_f32_3x center;
+    f32 radius;
+    pg_f32_3x cone_apex;
+    f32 cone_cutoff;
+    pg_f32_3x cone_axis;
+    u32 index_offset; // From the start of the model's indices.
+    u32 index_count;
+    u32 padding0;
+    u32 padding1;
+    u32 padding2;
+} meshlet;
+
+typedef struct
+{
+    meshlet_primitive* primitives;
+    meshlet* meshlets;
+    u32 primitive_count;
+    u32 meshlet_count;
+    u32 flags;
+} meshlets;
+
+FUNCTION usize
+meshlets_section_size(u32 primitive_count, u32 meshlet_count)
+{
+    return sizeof(meshlets_header)
+           + (primitive_count * sizeof(meshlet_primitive))
+           + (meshlet_count * sizeof(meshlet));
+}
+
+FUNCTION b8
+meshlets_read(u8* section, u64 section_size, meshlets* ms)
+{
+    *ms = (meshlets){0};
+
+    if (!section || section_size < sizeof(meshlets_header))
+    {
+        return false;
+    }
+
+    meshlets_header* header = (meshlets_header*)section;
+    if (section_size
+        < meshlets_section_size(header->primitive_count, header->meshlet_count))
+    {
+        return false;
+    }
+
+    ms->primitive_count = header->primitive_count;
+    ms->meshlet_count = header->meshlet_count;
+    ms->flags = header->flags;
+    ms->primitives = (meshlet_primitive*)(section + sizeof(meshlets_header));
+    ms->meshlets = (meshlet*)(section + sizeof(meshlets_header)
+                              + (header->primitive_count
+                                 * sizeof(meshlet_primitive)));
+
+    for (u32 i = 0; i < ms->primitive_count; i += 1)
+    {
+        meshlet_primitive* p = &ms->primitives[i];
+        if (p->meshlet_offset + p->meshlet_count > ms->meshlet_count)
+        {
+            *ms = (meshlets){0};
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// NOTE: Binary search, so primitives must be sorted by `index_offset`.
+FUNCTION meshlet_primitive*
+meshlets_find_primitive(meshlets* ms, u32 index_offset)
+{
+    u32 low = 0;
+    u32 high = ms->primitive_count;
+    while (low < high)
+    {
+        u32 mid = low + ((high - low) / 2);
+        if (ms->primitives[mid].index_offset < index_offset)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low < ms->primitive_count
+                   && ms->primitives[low].index_offset == index_offset
+               ? &ms->primitives[low]
+               : 0;
+}
+
+FUNCTION f32
+meshlet_sqrt(f32 x)
+{
+    return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(x)));
+}
+
+FUNCTION pg_f32_3x
+meshlet_sub(pg_f32_3x a, pg_f32_3x b)
+{
+    return (pg_f32_3x){a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+FUNCTION f32
+meshlet_dot(pg_f32_3x a, pg_f32_3x b)
+{
+    return (a.x * b.x) + (a.y * b.y) + (a.z * b.z);
+}
+
+FUNCTION pg_f32_3x
+meshlet_cross(pg_f32_3x a, pg_f32_3x b)
+{
+    return (pg_f32_3x){(a.y * b.z) - (a.z * b.y),
+                       (a.z * b.x) - (a.x * b.z),
+                       (a.x * b.y) - (a.y * b.x)};
+}
+
+FUNCTION pg_f32_3x
+meshlet_normalize(pg_f32_3x v)
+{
+    f32 length = meshlet_sqrt(meshlet_dot(v, v));
+    return length > 0.0f ? (pg_f32_3x){v.x / length, v.y / length, v.z / length}
+                         : (pg_f32_3x){0};
+}
+
+// NOTE: An upper bound on the meshlets of a primitive. Every meshlet but the
+// last has at least MESHLET_MIN_TRIANGLE_COUNT triangles.
+FUNCTION u32
+meshlet_count_max(u32 index_count)
+{
+    static_assert(MESHLET_MIN_TRIANGLE_COUNT <= MESHLET_MAX_VERTEX_COUNT / 3,
+                  "meshlets may close before their minimum triangle count");
+    return ((index_count / 3) / MESHLET_MIN_TRIANGLE_COUNT) + 1;
+}
+
+// NOTE: Degenerate triangles have a zero normal.
+FUNCTION pg_f32_3x
+meshlet_triangle_normal(pg_vertex* vertices, PG_GRAPHICS_INDEX_TYPE* triangle)
+{
+    pg_f32_3x p0 = vertices[triangle[0]].position;
+    pg_f32_3x p1 = vertices[triangle[1]].position;
+    pg_f32_3x p2 = vertices[triangle[2]].position;
+    return meshlet_normalize(
+        meshlet_cross(meshlet_sub(p1, p0), meshlet_sub(p2, p0)));
+}
+
+FUNCTION void
+meshlet_compute_bounds(pg_vertex* vertices,
+                       PG_GRAPHICS_INDEX_TYPE* indices,
+                       b8 cone,
+                       meshlet* m)
+{
+    u32 triangle_count = m->index_count / 3;
+
+    // Bounding sphere around the center of the bounding box.
+    pg_f32_3x min = vertices[indices[0]].position;
+    pg_f32_3x max = min;
+    for (u32 i = 0; i < m->index_count; i += 1)
+    {
+        pg_f32_3x p = vertices[indices[i]].position;
+        min = (pg_f32_3x){p.x < min.x ? p.x : min.x,
+                          p.y < min.y ? p.y : min.y,
+                          p.z < min.z ? p.z : min.z};
+        max = (pg_f32_3x){p.x > max.x ? p.x : max.x,
+                          p.y > max.y ? p.y : max.y,
+                          p.z > max.z ? p.z : max.z};
+    }
+    m->center = (pg_f32_3x){(min.x + max.x) * 0.5f,
+                            (min.y + max.y) * 0.5f,
+                            (min.z + max.z) * 0.5f};
+    f32 radius_sq = 0.0f;
+    for (u32 i = 0; i < m->index_count; i += 1)
+    {
+        pg_f32_3x d = meshlet_sub(vertices[indices[i]].position, m->center);
+        f32 d_sq = meshlet_dot(d, d);
+        radius_sq = d_sq > radius_sq ? d_sq : radius_sq;
+    }
+    m->radius = meshlet_sqrt(radius_sq);
+
+    m->cone_apex = m->center;
+    m->cone_axis = (pg_f32_3x){0};
+    m->cone_cutoff = 1.0f;
+    if (!cone)
+    {
+        return;
+    }
+
+    // The axis is the average triangle normal, and the cutoff follows from
+    // the triangle normal furthest from it.
+    pg_f32_3x axis = {0};
+    for (u32 i = 0; i < triangle_count; i += 1)
+    {
+        pg_f32_3x n = meshlet_triangle_normal(vertices, &indices[i * 3]);
+        axis = (pg_f32_3x){axis.x + n.x, axis.y + n.y, axis.z + n.z};
+    }
+    axis = meshlet_normalize(axis);
+
+    f32 min_dot = 1.0f;
+    for (u32 i = 0; i < triangle_count; i += 1)
+    {
+        pg_f32_3x n = meshlet_triangle_normal(vertices, &indices[i * 3]);
+        if (n.x == 0.0f && n.y == 0.0f && n.z == 0.0f)
+        {
+            continue; // Degenerate triangle
+        }
+        f32 d = meshlet_dot(n, axis);
+        min_dot = d < min_dot ? d : min_dot;
+    }
+    if (min_dot <= MESHLET_MIN_CONE_DOT)
+    {
+        return;
+    }
+
+    // NOTE: The apex is moved back along the axis until it is behind every
+    // triangle's plane, so that the camera is behind all of them whenever it
+    // is inside the cone.
+    f32 max_t = 0.0f;
+    for (u32 i = 0; i < triangle_count; i += 1)
+    {
+        pg_f32_3x p0 = vertices[indices[i * 3]].position;
+        pg_f32_3x n = meshlet_triangle_normal(vertices, &indices[i * 3]);
+        f32 dn = meshlet_dot(axis, n);
+        if (dn <= 0.0f)
+        {
+            continue; // Degenerate triangle
+        }
+        f32 t = meshlet_dot(meshlet_sub(m->center, p0), n) / dn;
+        max_t = t > max_t ? t : max_t;
+    }
+
+    m->cone_apex = (pg_f32_3x){m->center.x - (axis.x * max_t),
+                               m->center.y - (axis.y * max_t),
+                               m->center.z - (axis.z * max_t)};
+    m->cone_axis = axis;
+    m->cone_cutoff = meshlet_sqrt(1.0f - (min_dot * min_dot));
+}
+
+FUNCTION u32
+meshlet_new_vertex_count(PG_GRAPHICS_INDEX_TYPE* triangle,
+                         u32* vertex_marks,
+                         u32 meshlet_id)
+{
+    u32 a = triangle[0];
+    u32 b = triangle[1];
+    u32 c = triangle[2];
+    return (vertex_marks[a] != meshlet_id)
+           + (vertex_marks[b] != meshlet_id && b != a)
+           + (vertex_marks[c] != meshlet_id && c != a && c != b);
+}
+
+// NOTE: Triangles are taken in order (which is already local after vertex
+// cache optimization), and a meshlet is closed when it reaches
+// MESHLET_MAX_TRIANGLE_COUNT triangles, the next triangle would bring it
+// above MESHLET_MAX_VERTEX_COUNT unique vertices, or (for cones) the next
+// triangle faces away from it. `vertex_marks` must have
+// room for `vertex_count` entries. `result` must have room for
+// `meshlet_count_max(index_count)` meshlets.
+FUNCTION u32
+meshlet_build(pg_vertex* vertices,
+              PG_GRAPHICS_INDEX_TYPE* indices,
+              u32 index_count,
+              u32 vertex_count,
+              u32 index_offset,
+              b8 cone,
+              u32* vertex_marks,
+              meshlet* result)
+{
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        vertex_marks[i] = MESHLET_NO_MARK;
+    }
+
+    u32 meshlet_count = 0;
+    u32 meshlet_start = 0;
+    u32 meshlet_vertex_count = 0;
+    pg_f32_3x meshlet_normal_sum = {0};
+    u32 triangle_count = index_count / 3;
+    for (u32 i = 0; i <= triangle_count; i += 1)
+    {
+        b8 close = i == triangle_count;
+        if (!close)
+        {
+            u32 new_vertex_count = meshlet_new_vertex_count(&indices[i * 3],
+                                                            vertex_marks,
+                                                            meshlet_count);
+            close = meshlet_vertex_count + new_vertex_count
+                        > MESHLET_MAX_VERTEX_COUNT
+                    || i - meshlet_start == MESHLET_MAX_TRIANGLE_COUNT;
+            if (!close && cone
+                && i - meshlet_start >= MESHLET_MIN_TRIANGLE_COUNT)
+            {
+                pg_f32_3x n = meshlet_triangle_normal(vertices, &indices[i * 3]);
+                close = meshlet_dot(n, meshlet_normalize(meshlet_normal_sum))
+                        < MESHLET_SPLIT_CONE_DOT;
+            }
+        }
+
+        if (close && i > meshlet_start)
+        {
+            meshlet* m = &result[meshlet_count];
+            *m = (meshlet){.index_offset = index_offset + (meshlet_start * 3),
+                           .index_count = (i - meshlet_start) * 3};
+            meshlet_compute_bounds(vertices,
+                                   &indices[meshlet_start * 3],
+                                   cone,
+                                   m);
+            meshlet_count += 1;
+            meshlet_start = i;
+            meshlet_vertex_count = 0;
+            meshlet_normal_sum = (pg_f32_3x){0};
+        }
+
+        if (i < triangle_count)
+        {
+            meshlet_vertex_count += meshlet_new_vertex_count(&indices[i * 3],
+                                                             vertex_marks,
+                                                             meshlet_count);
+            for (u32 k = 0; k < 3; k += 1)
+            {
+                vertex_marks[indices[(i * 3) + k]] = meshlet_count;
+            }
+            pg_f32_3x n = meshlet_triangle_normal(vertices, &indices[i * 3]);
+            meshlet_normal_sum = (pg_f32_3x){meshlet_normal_sum.x + n.x,
+                                             meshlet_normal_sum.y + n.y,
+                                             meshlet_normal_sum.z + n.z};
+        }
+    }
+
+    return meshlet_count;
+}
+
+typedef struct
+{
+    u32 drawable_id;
+    u32 index_offset;
+    u32 index_count;
+} meshlet_draw_range;
+
+typedef struct
+{
+    u32 meshlet_count; // tested
+    u32 frustum_culled_count;
+    u32 cone_culled_count;
+    u32 range_count;
+    u64 triangle_count; // before culling
+    u64 drawn_triangle_count;
+} meshlet_cull_stats;
+
+// Culls the meshlets of one drawable and appends its visible index ranges to
+// `ranges`, merging meshlets that are adjacent in the index buffer. Returns
+// the number of ranges appended (at most `p->meshlet_count`).
+// NOTE: Cones are tested in world space, which is only valid if
+// `world_from_mesh` scales uniformly and keeps the winding order. Otherwise
+// only the frustum test is used.
+FUNCTION u32
+meshlet_cull(meshlets* ms,
+             meshlet_primitive* p,
+             u32 drawable_id,
+             pg_f32_4x4* world_from_mesh,
+             pg_f32_4x4* clip_from_mesh,
+             pg_f32_3x camera_position,
+             meshlet_draw_range* ranges,
+             meshlet_cull_stats* stats)
+{
+    frustum f = {0};
+    frustum_from_matrix(clip_from_mesh, &f);
+
+    pg_f32_3x columns[3] = {0};
+    f32 scales[3] = {0};
+    for (u32 i = 0; i < 3; i += 1)
+    {
+        columns[i] = (pg_f32_3x){frustum_matrix_get(world_from_mesh, 0, i),
+                                 frustum_matrix_get(world_from_mesh, 1, i),
+                                 frustum_matrix_get(world_from_mesh, 2, i)};
+        scales[i] = meshlet_sqrt(meshlet_dot(columns[i], columns[i]));
+    }
+    f32 determinant
+        = meshlet_dot(columns[0], meshlet_cross(columns[1], columns[2]));
+    f32 scale = scales[0];
+    b8 cone = determinant > 0.0f;
+    for (u32 i = 1; i < 3; i += 1)
+    {
+        cone = cone && scales[i] >= scale * 0.99f && scales[i] <= scale * 1.01f;
+    }
+
+    u32 range_count = 0;
+    for (u32 i = 0; i < p->meshlet_count; i += 1)
+    {
+        meshlet* m = &ms->meshlets[p->meshlet_offset + i];
+        stats->meshlet_count += 1;
+        stats->triangle_count += m->index_count / 3;
+
+        if (!frustum_test_sphere(&f, m->center, m->radius))
+        {
+            stats->frustum_culled_count += 1;
+            continue;
+        }
+
+        if (cone && m->cone_cutoff < 1.0f)
+        {
+            pg_f32_3x apex
+                = frustum_transform(world_from_mesh, m->cone_apex, 1.0f);
+            pg_f32_3x axis
+                = frustum_transform(world_from_mesh, m->cone_axis, 0.0f);
+            pg_f32_3x to_apex
+                = meshlet_normalize(meshlet_sub(apex, camera_position));
+            if (meshlet_dot(to_apex, axis) >= m->cone_cutoff * scale)
+            {
+                stats->cone_culled_count += 1;
+                continue;
+            }
+        }
+
+        stats->drawn_triangle_count += m->index_count / 3;
+        meshlet_draw_range* last = range_count ? &ranges[range_count - 1] : 0;
+        if (last && last->index_offset + last->index_count == m->index_offset)
+        {
+            last->index_count += m->index_count;
+        }
+        else
+        {
+            ranges[range_count] = (meshlet_draw_range){
+                .drawable_id = drawable_id,
+                .index_offset = m->index_offset,
+                .index_count = m->index_count};
+            range_count += 1;
+        }
+    }
+
+    stats->range_count += range_count;
+
+    return range_count;
+}
@@ -0,0 +1,466 @@
+// On-demand model paging
+//
+// Every model has its own single-model .pga page, and the packer measures them
+// into a table of contents (TOC) with the counts needed to size renderer
+// buffers.
+// Only the TOC is read at startup. A page is read into a fixed-size residency
+// block when its model is selected or prefetched, and the least recently used
+// pages are evicted to keep residency within the block's byte budget.
+//
+// Prefetched pages are read on loader threads (see asset_loader.c) into space
+// reserved for them, and become resident when their completion is taken, at
+// the start of a frame and within a time budget. Only a selected model that
+// is not resident yet stalls the frame.
+//
+// NOTE: Requires file_map.c and asset_loader.c.
+
+#if defined(LINUX)
+#include <time.h>
+#endif
+
+#define MODEL_TOC_FILE_NAME "assets.pgt"
+#define MODEL_PAGE_DIR_NAME "pages"
+#define MODEL_TOC_MAGIC 0x43544750 // "PGTC"
+#define MODEL_TOC_VERSION 1
+#define MODEL_PAGE_MAX_COUNT 1024
+#define MODEL_PAGE_MAX_PATH 64
+
+// NOTE: Slack on top of the resident size measured at pack time to cover
+// arena alignment.
+#define MODEL_PAGE_SLACK PG_KIBIBYTE(64)
+
+typedef struct
+{
+    u32 magic;
+    u32 version;
+    u32 model_count;
+    u32 padding0;
+} model_toc_header;
+
+typedef struct
+{
+    u64 key;
+    u64 resident_size;
+    u32 vertex_count;
+    u32 index_count;
+    u32 joint_count;
+    u32 material_count;
+    u32 texture_count;
+    u32 animation_count;
+} model_toc_entry;
+
+typedef struct
+{
+    pg_assets* assets; // NOTE: A page holds one model at index 0.
+    u64 offset;
+    u64 size;
+    u64 last_used;
+    b8 resident;
+    b8 loading; // Its space is reserved, and it is being read
+} model_page;
+
+typedef struct
+{
+    u8* memory;
+    u64 budget;
+    u64 resident_size;
+    u64 tick;
+    u32 model_count;
+    u32 load_count;
+    u32 eviction_count;
+    u32 stall_count; // Acquires that waited for their model's page
+    b8 loaded_this_frame;
+    model_toc_entry* toc;
+    model_page* pages;
+    pg_file_read_fp file_read;
+    asset_loader* loader; // NOTE: Its completions are all the pager's.
+} model_pager;
+
+// Returns a monotonic time in microseconds.
+FUNCTION u64
+model_pager_get_time(void)
+{
+#if defined(LINUX)
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((u64)ts.tv_sec * 1000000) + ((u64)ts.tv_nsec / 1000);
+#elif defined(WINDOWS)
+    LARGE_INTEGER frequency = {0};
+    LARGE_INTEGER counter = {0};
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return ((u64)counter.QuadPart / (u64)frequency.QuadPart) * 1000000
+           + (((u64)counter.QuadPart % (u64)frequency.QuadPart) * 1000000)
+                 / (u64)frequency.QuadPart;
+#endif
+}
+
+FUNCTION void
+model_page_path(u32 model_id, c8* path, usize path_size)
+{
+    c8 digits[10] = {0};
+    u32 digit_count = 0;
+    do
+    {
+        digits[digit_count] = (c8)('0' + (model_id % 10));
+        digit_count += 1;
+        model_id /= 10;
+    } while (model_id);
+
+    c8* prefix = MODEL_PAGE_DIR_NAME "/";
+    c8* suffix = ".pga";
+    usize len = 0;
+    for (c8* c = prefix; *c && len + 1 < path_size; c += 1)
+    {
+        path[len++] = *c;
+    }
+    for (u32 i = digit_count; i > 0 && len + 1 < path_size; i -= 1)
+    {
+        path[len++] = digits[i - 1];
+    }
+    for (c8* c = suffix; *c && len + 1 < path_size; c += 1)
+    {
+        path[len++] = *c;
+    }
+    path[len] = '\0';
+}
+
+FUNCTION void
+model_pager_init(model_pager* pager,
+                 u64 budget,
+                 pg_file_read_fp file_read,
+                 asset_loader* loader,
+                 pg_scratch_allocator* mem,
+                 pg_error* err)
+{
+    *pager = (model_pager){.budget = budget,
+                           .file_read = file_read,
+                           .loader = loader};
+
+    file_view view = {0};
+    if (!file_map(MODEL_TOC_FILE_NAME, &view, err))
+    {
+        PG_ERROR_MAJOR("failed to open model table of contents");
+        return;
+    }
+
+    model_toc_header header = {0};
+    if (view.size >= sizeof(header))
+    {
+        pg_copy(view.data, sizeof(header), &header, sizeof(header), err);
+    }
+    if (header.magic != MODEL_TOC_MAGIC || header.version != MODEL_TOC_VERSION
+        || header.model_count > MODEL_PAGE_MAX_COUNT
+        || view.size
+               < sizeof(header) + (header.model_count * sizeof(model_toc_entry)))
+    {
+        PG_ERROR_MAJOR("invalid model table of contents");
+        file_unmap(&view);
+        return;
+    }
+
+    pager->model_count = header.model_count;
+    pg_scratch_alloc(mem,
+                     pager->model_count * sizeof(model_toc_entry),
+                     alignof(model_toc_entry),
+                     &pager->toc,
+                     err);
+    pg_copy(view.data + sizeof(header),
+            pager->model_count * sizeof(model_toc_entry),
+            pager->toc,
+            pager->model_count * sizeof(model_toc_entry),
+            err);
+    file_unmap(&view);
+
+    pg_scratch_alloc(mem,
+                     pager->model_count * sizeof(model_page),
+                     alignof(model_page),
+                     &pager->pages,
+                     err);
+    pg_scratch_alloc(mem, budget, PG_KIBIBYTE(4), &pager->memory, err);
+}
+
+// NOTE: First fit over the gaps between resident and loading pages.
+FUNCTION b8
+model_pager_find_space(model_pager* pager, u64 size, u64* offset)
+{
+    u64 candidate = 0;
+    for (;;)
+    {
+        b8 overlap = false;
+        for (u32 i = 0; i < pager->model_count; i += 1)
+        {
+            model_page* p = &pager->pages[i];
+            if ((p->resident || p->loading) && p->offset < candidate + size
+                && candidate < p->offset + p->size)
+            {
+                candidate = p->offset + p->size;
+                overlap = true;
+            }
+        }
+
+        if (candidate + size > pager->budget)
+        {
+            return false;
+        }
+
+        if (!overlap)
+        {
+            *offset = candidate;
+            return true;
+        }
+    }
+}
+
+FUNCTION b8
+model_pager_evict_lru(model_pager* pager, u32 pinned_model_id)
+{
+    model_page* lru = 0;
+    for (u32 i = 0; i < pager->model_count; i += 1)
+    {
+        model_page* p = &pager->pages[i];
+        if (p->resident && i != pinned_model_id
+            && (!lru || p->last_used < lru->last_used))
+        {
+            lru = p;
+        }
+    }
+
+    if (!lru)
+    {
+        return false;
+    }
+
+    pager->resident_size -= lru->size;
+    pager->eviction_count += 1;
+    *lru = (model_page){0};
+
+    return true;
+}
+
+// Reads a page into its reserved space.
+// NOTE: Runs on a loader thread, which only writes the page's assets.
+FUNCTION void
+model_pager_read_page(void* data, u32 model_id, pg_error* err)
+{
+    model_pager* pager = data;
+    model_page* page = &pager->pages[model_id];
+
+    c8 path[MODEL_PAGE_MAX_PATH] = {0};
+    model_page_path(model_id, path, sizeof(path));
+
+    pg_scratch_allocator page_mem = {0};
+    pg_scratch_init(&page_mem, pager->memory + page->offset, page->size);
+    page->assets = pg_assets_read_pga(pg_string_create(path, 0, err),
+                                      pager->file_read,
+                                      &page_mem,
+                                      err);
+    if (page->assets)
+    {
+        pg_assets_verify(page->assets, 0, 0, 0, 0, 1, err);
+    }
+}
+
+// Makes a page that was read resident, or frees its space if it failed.
+FUNCTION void
+model_pager_complete(model_pager* pager, u32 model_id, pg_error* err)
+{
+    model_page* page = &pager->pages[model_id];
+    page->loading = false;
+    if (!page->assets)
+    {
+        PG_ERROR_MINOR("failed to read model page");
+        *page = (model_page){0};
+        return;
+    }
+
+    page->resident = true;
+    pager->resident_size += page->size;
+    pager->load_count += 1;
+    pager->loaded_this_frame = true;
+}
+
+// Waits for the next page in flight. Returns false if none is.
+FUNCTION b8
+model_pager_wait(model_pager* pager, pg_error* err)
+{
+    asset_load load = {0};
+    if (!asset_loader_take(pager->loader, true, &load))
+    {
+        return false;
+    }
+    model_pager_complete(pager, load.id, err);
+    return true;
+}
+
+// Reserves space for the model's page and marks it as loading.
+// NOTE: When evicting, pages in flight are waited for until they can be
+// evicted too.
+FUNCTION b8
+model_pager_reserve(model_pager* pager,
+                    u32 model_id,
+                    b8 allow_eviction,
+                    pg_error* err)
+{
+    model_page* page = &pager->pages[model_id];
+    u64 size = pager->toc[model_id].resident_size + MODEL_PAGE_SLACK;
+    if (size > pager->budget)
+    {
+        PG_ERROR_MAJOR("model page exceeds model pager budget");
+        return false;
+    }
+
+    u64 offset = 0;
+    while (!model_pager_find_space(pager, size, &offset))
+    {
+        if (!allow_eviction
+            || (!model_pager_evict_lru(pager, model_id)
+                && !model_pager_wait(pager, err)))
+        {
+            return false;
+        }
+    }
+
+    *page = (model_page){.offset = offset,
+                         .size = size,
+                         .last_used = pager->tick,
+                         .loading = true};
+
+    return true;
+}
+
+// Takes pages that were read since the last update and makes them resident
+// until `budget` microseconds have passed. At least one is taken if any was
+// read, so prefetches always make progress.
+FUNCTION void
+model_pager_update(model_pager* pager, u64 budget, pg_error* err)
+{
+    pager->loaded_this_frame = false;
+
+    u64 start = model_pager_get_time();
+    asset_load load = {0};
+    while (asset_loader_take(pager->loader, false, &load))
+    {
+        model_pager_complete(pager, load.id, err);
+        if (model_pager_get_time() - start >= budget)
+        {
+            break;
+        }
+    }
+}
+
+// Make the model resident (evicting as needed) and mark it most recently used.
+// NOTE: A page in flight is waited for. Otherwise, the page is read on the
+// calling thread rather than queued behind the prefetches in flight.
+FUNCTION pg_assets*
+model_pager_acquire(model_pager* pager, u32 model_id, pg_error* err)
+{
+    pager->tick += 1;
+
+    if (model_id >= pager->model_count)
+    {
+        PG_ERROR_MAJOR("failed to page in model");
+        return 0;
+    }
+
+    model_page* page = &pager->pages[model_id];
+    if (!page->resident)
+    {
+        pager->stall_count += 1;
+        if (!page->loading && model_pager_reserve(pager, model_id, true, err))
+        {
+            model_pager_read_page(pager, model_id, err);
+            model_pager_complete(pager, model_id, err);
+        }
+        while (page->loading)
+        {
+            if (!model_pager_wait(pager, err))
+            {
+                break;
+            }
+        }
+        if (!page->resident)
+        {
+            PG_ERROR_MAJOR("failed to page in model");
+            return 0;
+        }
+    }
+
+    page->last_used = pager->tick;
+
+    return page->assets;
+}
+
+// Queues the model's page to be read into free space. Returns false if the
+// loader is full or the page does not fit.
+FUNCTION b8
+model_pager_request(model_pager* pager, u32 model_id, pg_error* err)
+{
+    model_page* page = &pager->pages[model_id];
+    if (page->resident || page->loading)
+    {
+        return true;
+    }
+
+    if (asset_loader_full(pager->loader)
+        || !model_pager_reserve(pager, model_id, false, err))
+    {
+        return false;
+    }
+
+    return asset_loader_submit(pager->loader,
+                               &model_pager_read_page,
+                               pager,
+                               model_id,
+                               err);
+}
+
+// Queue the neighbors (+1, -1, +2, -2, etc) of the current model to be paged
+// in, in priority order, as long as the loader has room for them.
+// NOTE: Prefetching only uses free space. It never evicts, so it cannot thrash
+// against the current model or the other neighbors.
+FUNCTION void
+model_pager_prefetch(model_pager* pager,
+                     u32 model_id,
+                     u32 radius,
+                     pg_error* err)
+{
+    for (u32 distance = 1; distance <= radius; distance += 1)
+    {
+        for (u32 sign = 0; sign < 2; sign += 1)
+        {
+            u32 neighbor_id
+                = sign == 0 ? (model_id + distance) % pager->model_count
+                            : (model_id + pager->model_count
+                               - (distance % pager->model_count))
+                                  % pager->model_count;
+            model_page* page = &pager->pages[neighbor_id];
+            if (page->resident || page->loading)
+            {
+                continue;
+            }
+            if (asset_loader_full(pager->loader))
+            {
+                return;
+            }
+
+            // NOTE: Prefetched pages count as used just before the current
+            // model, so stale pages are evicted first.
+            if (model_pager_request(pager, neighbor_id, err))
+            {
+                page->last_used = pager->tick - 1;
+            }
+        }
+    }
+}
+
+FUNCTION pg_asset_model*
+model_pager_get_resident(model_pager* pager, u32 model_id)
+{
+    if (model_id >= pager->model_count || !pager->pages[model_id].resident)
+    {
+        return 0;
+    }
+
+    return &pager->pages[model_id].assets->models[0];
+}
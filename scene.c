@@ -0,0 +1,523 @@
+// Scene hierarchy
+//
+// Pack-time copy of a model's node hierarchy (parents first, like the nodes of
+// animation.c) and of which primitives each node draws. The viewer keeps the
+// local transform of every node in one array per component, along with the
+// model space global transform it last computed for each node and a dirty
+// flag. Setting a local transform that differs from the stored one marks the
+// node dirty, and each update walks the nodes once, parents first, recomputing
+// only the global transforms of dirty nodes and of nodes below one. Static
+// models recompute nothing after their first frame.
+//
+// The first time a model is drawn, each instance (the packer's stable key for
+// a drawable) takes the asset library's drawable for its primitive, which all
+// instances of the primitive share. From then on, the viewer builds the
+// drawables from the instances, with the hierarchy's global transforms, and
+// sorts the translucent ones back to front itself, so the asset library is not
+// asked for drawables (or their transforms) every frame. Animated nodes are
+// set from the viewer's sampled pose when the model has one. Otherwise the
+// asset library animates them, so the drawables are the library's while any
+// node moves, and moving nodes are counted as updated every frame.
+//
+// NOTE: Requires animation.c.
+// NOTE: Node ids match the node ids of the model's ASSET_EXT_SECTION_ANIMATIONS
+// section, if it has one, so a sampled pose can be applied directly.
+
+#define SCENE_NO_NODE 0xFFFFFFFF
+
+typedef enum
+{
+    SCENE_NODE_ANIMATED = 1 << 0, // Targeted by an animation channel
+    SCENE_NODE_MOVING = 1 << 1    // Animated, or below an animated node
+} scene_node_flags;
+
+// NOTE: Layout of an ASSET_EXT_SECTION_SCENE section: this header, the nodes
+// (parents before children), then the instances (one per primitive of each
+// node's mesh).
+typedef struct
+{
+    u32 node_count;
+    u32 instance_count;
+    u32 animated_count; // Nodes with SCENE_NODE_ANIMATED
+    u32 padding0;
+} scene_header;
+
+typedef struct
+{
+    animation_transform local;
+    u32 parent; // ANIMATION_NO_PARENT for roots
+    u32 flags;  // scene_node_flags
+    u32 padding0;
+    u32 padding1;
+} scene_node;
+
+typedef struct
+{
+    u32 node;
+    u32 index_offset;
+    u32 index_count;
+    u32 padding0;
+} scene_instance;
+
+typedef struct
+{
+    scene_node* nodes;
+    scene_instance* instances;
+    u32 node_count;
+    u32 instance_count;
+    u32 animated_count;
+} scene;
+
+// NOTE: The state the viewer keeps per model between frames.
+typedef struct
+{
+    animation_pose locals;
+    pg_f32_4x4* globals; // Model space
+    b8* dirty;           // Local transform changed since the last update
+    b8* updated;         // Global transform recomputed by the last update
+
+    // NOTE: The asset library's drawable for each instance's primitive. Its
+    // global transform is not used.
+    pg_graphics_drawable* instance_drawables;
+
+    // NOTE: Instances in drawable order: the opaque ones in instance order,
+    // then the translucent ones back to front as of the last build.
+    u32* drawable_instances;
+
+    // NOTE: Model space boxes of instances, valid while the instance's node is
+    // not updated (see bounds.c). Only instances whose bounds do not depend on
+    // joint transforms are cached.
+    pg_f32_3x* instance_centers;
+    pg_f32_3x* instance_extents;
+    b8* instance_cached;
+
+    u32 opaque_count;   // Instances with an opaque material
+    u32 drawable_count; // Of the last build, 0 if they are the library's
+    b8 bound;           // Instances took the asset library's drawables
+    b8 bind_failed;     // Instances could not be matched to drawables
+    b8 posed;           // Animated nodes were set by `scene_set_pose`
+} scene_hierarchy;
+
+typedef struct
+{
+    u32 node_count;
+    u32 updated_count;         // Nodes whose global transform was recomputed
+    u32 cached_drawable_count; // Drawables whose boxes were reused
+} scene_update_stats;
+
+FUNCTION usize
+scene_section_size(u32 node_count, u32 instance_count)
+{
+    return sizeof(scene_header) + (node_count * sizeof(scene_node))
+           + (instance_count * sizeof(scene_instance));
+}
+
+FUNCTION b8
+scene_read(u8* section, u64 section_size, scene* sc)
+{
+    *sc = (scene){0};
+
+    if (!section || section_size < sizeof(scene_header))
+    {
+        return false;
+    }
+
+    scene_header* header = (scene_header*)section;
+    if (section_size
+        < scene_section_size(header->node_count, header->instance_count))
+    {
+        return false;
+    }
+
+    sc->nodes = (scene_node*)(section + sizeof(scene_header));
+    sc->instances
+        = (scene_instance*)(section + sizeof(scene_header)
+                            + (header->node_count * sizeof(scene_node)));
+    sc->node_count = header->node_count;
+    sc->instance_count = header->instance_count;
+    sc->animated_count = header->animated_count;
+
+    b8 valid = true;
+    for (u32 i = 0; valid && i < sc->node_count; i += 1)
+    {
+        valid = sc->nodes[i].parent == ANIMATION_NO_PARENT
+                || sc->nodes[i].parent < i;
+    }
+    for (u32 i = 0; valid && i < sc->instance_count; i += 1)
+    {
+        valid = sc->instances[i].node < sc->node_count;
+    }
+    if (!valid)
+    {
+        *sc = (scene){0};
+    }
+
+    return valid;
+}
+
+FUNCTION void
+scene_hierarchy_init(scene_hierarchy* sh,
+                     scene* sc,
+                     pg_scratch_allocator* mem,
+                     pg_error* err)
+{
+    *sh = (scene_hierarchy){0};
+    animation_pose_init(&sh->locals, sc->node_count, mem, err);
+    pg_scratch_alloc(mem,
+                     sc->node_count * sizeof(pg_f32_4x4),
+                     alignof(pg_f32_4x4),
+                     &sh->globals,
+                     err);
+    pg_scratch_alloc(mem,
+                     sc->node_count * sizeof(b8),
+                     alignof(b8),
+                     &sh->dirty,
+                     err);
+    pg_scratch_alloc(mem,
+                     sc->node_count * sizeof(b8),
+                     alignof(b8),
+                     &sh->updated,
+                     err);
+    pg_scratch_alloc(mem,
+                     sc->instance_count * sizeof(pg_graphics_drawable),
+                     alignof(pg_graphics_drawable),
+                     &sh->instance_drawables,
+                     err);
+    pg_scratch_alloc(mem,
+                     sc->instance_count * sizeof(u32),
+                     alignof(u32),
+                     &sh->drawable_instances,
+                     err);
+    pg_scratch_alloc(mem,
+                     sc->instance_count * sizeof(pg_f32_3x),
+                     alignof(pg_f32_3x),
+                     &sh->instance_centers,
+                     err);
+    pg_scratch_alloc(mem,
+                     sc->instance_count * sizeof(pg_f32_3x),
+                     alignof(pg_f32_3x),
+                     &sh->instance_extents,
+                     err);
+    pg_scratch_alloc(mem,
+                     sc->instance_count * sizeof(b8),
+                     alignof(b8),
+                     &sh->instance_cached,
+                     err);
+}
+
+// Sets node `i`'s local transform, marking it dirty if it changed.
+FUNCTION void
+scene_set_local(scene_hierarchy* sh,
+                u32 i,
+                f32* rotation,
+                f32* translation,
+                f32* scale)
+{
+    animation_pose* l = &sh->locals;
+    b8 changed = false;
+    for (u32 k = 0; k < CAP(l->rotation); k += 1)
+    {
+        changed = changed || l->rotation[k][i] != rotation[k];
+        l->rotation[k][i] = rotation[k];
+    }
+    for (u32 k = 0; k < CAP(l->translation); k += 1)
+    {
+        changed = changed || l->translation[k][i] != translation[k]
+                  || l->scale[k][i] != scale[k];
+        l->translation[k][i] = translation[k];
+        l->scale[k][i] = scale[k];
+    }
+    sh->dirty[i] = sh->dirty[i] || changed;
+}
+
+// Returns every node to its packed local transform and marks it dirty, so the
+// next update recomputes the whole hierarchy. Instances stay bound.
+FUNCTION void
+scene_hierarchy_reset(scene_hierarchy* sh, scene* sc)
+{
+    for (u32 i = 0; i < sc->node_count; i += 1)
+    {
+        animation_transform* t = &sc->nodes[i].local;
+        scene_set_local(sh,
+                        i,
+                        &t->rotation.x,
+                        &t->translation.x,
+                        &t->scale.x);
+        sh->dirty[i] = true;
+    }
+}
+
+// Sets the local transforms of the animated nodes from `pose`.
+// NOTE: Nodes that are not animated keep their packed transforms, which is
+// what `pose` holds for them too.
+FUNCTION void
+scene_set_pose(scene_hierarchy* sh, scene* sc, animation_pose* pose)
+{
+    for (u32 i = 0; i < sc->node_count; i += 1)
+    {
+        if (!(sc->nodes[i].flags & SCENE_NODE_ANIMATED))
+        {
+            continue;
+        }
+
+        f32 rotation[] = {pose->rotation[0][i],
+                          pose->rotation[1][i],
+                          pose->rotation[2][i],
+                          pose->rotation[3][i]};
+        f32 translation[] = {pose->translation[0][i],
+                             pose->translation[1][i],
+                             pose->translation[2][i]};
+        f32 scale[] = {pose->scale[0][i], pose->scale[1][i], pose->scale[2][i]};
+        scene_set_local(sh, i, rotation, translation, scale);
+    }
+}
+
+// Returns whether node `i`'s global transform is the asset library's rather
+// than the hierarchy's.
+FUNCTION b8
+scene_node_is_external(scene_hierarchy* sh, scene* sc, u32 i)
+{
+    return !sh->posed && (sc->nodes[i].flags & SCENE_NODE_MOVING);
+}
+
+// Recomputes the global transforms of dirty nodes and of every node below one,
+// then clears the dirty flags. `posed` is whether the animated nodes were set
+// from a pose since the last update.
+FUNCTION void
+scene_update(scene_hierarchy* sh,
+             scene* sc,
+             b8 posed,
+             scene_update_stats* stats)
+{
+    // NOTE: Moving nodes are stale after the asset library animated them.
+    if (posed != sh->posed)
+    {
+        for (u32 i = 0; i < sc->node_count; i += 1)
+        {
+            sh->dirty[i] = sh->dirty[i]
+                           || (sc->nodes[i].flags & SCENE_NODE_MOVING) != 0;
+        }
+        sh->posed = posed;
+    }
+
+    animation_pose* l = &sh->locals;
+    u32 updated_count = 0;
+    for (u32 i = 0; i < sc->node_count; i += 1)
+    {
+        if (scene_node_is_external(sh, sc, i))
+        {
+            sh->updated[i] = true;
+            updated_count += 1;
+            continue;
+        }
+
+        u32 parent = sc->nodes[i].parent;
+        b8 update = sh->dirty[i]
+                    || (parent != ANIMATION_NO_PARENT && sh->updated[parent]);
+        sh->updated[i] = update;
+        if (!update)
+        {
+            continue;
+        }
+
+        animation_transform t = {
+            .rotation = {l->rotation[0][i],
+                         l->rotation[1][i],
+                         l->rotation[2][i],
+                         l->rotation[3][i]},
+            .translation = {l->translation[0][i],
+                            l->translation[1][i],
+                            l->translation[2][i]},
+            .scale = {l->scale[0][i], l->scale[1][i], l->scale[2][i]}};
+        if (parent == ANIMATION_NO_PARENT)
+        {
+            animation_transform_to_matrix(&t, &sh->globals[i]);
+        }
+        else
+        {
+            pg_f32_4x4 local;
+            animation_transform_to_matrix(&t, &local);
+            animation_matrix_mul(&sh->globals[parent],
+                                 &local,
+                                 &sh->globals[i]);
+        }
+        sh->dirty[i] = false;
+        updated_count += 1;
+    }
+
+    stats->node_count = sc->node_count;
+    stats->updated_count = updated_count;
+}
+
+// Returns the node whose global transform drawable `i` of the last build
+// takes, or SCENE_NO_NODE if the drawables are the asset library's.
+FUNCTION u32
+scene_get_drawable_node(scene_hierarchy* sh, scene* sc, u32 i)
+{
+    if (i >= sh->drawable_count)
+    {
+        return SCENE_NO_NODE;
+    }
+
+    return sc->instances[sh->drawable_instances[i]].node;
+}
+
+// Gives each instance the asset library's drawable for its primitive.
+// `drawables` must be one per instance (in any order), with the opaque ones
+// first. Returns false if the counts differ or an instance's primitive has no
+// drawable.
+// NOTE: Instances of a primitive share its vertices, indices and material, so
+// which of its drawables an instance takes does not matter, and the drawables'
+// transforms (and the asset library's animation) are not used.
+FUNCTION b8
+scene_bind_drawables(scene_hierarchy* sh,
+                     scene* sc,
+                     pg_graphics_drawable* drawables,
+                     u32 drawable_count,
+                     u32 opaque_drawable_count)
+{
+    sh->bound = false;
+    sh->drawable_count = 0;
+    if (drawable_count != sc->instance_count)
+    {
+        return false;
+    }
+
+    // NOTE: Opaque instances are ordered from the front and translucent ones
+    // from the back, which the first build sorts anyway.
+    u32 opaque_count = 0;
+    u32 translucent_count = 0;
+    for (u32 i = 0; i < sc->instance_count; i += 1)
+    {
+        scene_instance* si = &sc->instances[i];
+        u32 match = drawable_count;
+        for (u32 j = 0; j < drawable_count; j += 1)
+        {
+            if (drawables[j].index_offset == si->index_offset
+                && drawables[j].index_count == si->index_count)
+            {
+                match = j;
+                break;
+            }
+        }
+        if (match == drawable_count)
+        {
+            return false;
+        }
+
+        sh->instance_drawables[i] = drawables[match];
+        sh->instance_cached[i] = false;
+        if (match < opaque_drawable_count)
+        {
+            sh->drawable_instances[opaque_count] = i;
+            opaque_count += 1;
+        }
+        else
+        {
+            translucent_count += 1;
+            sh->drawable_instances[sc->instance_count - translucent_count] = i;
+        }
+    }
+    sh->opaque_count = opaque_count;
+    sh->bound = true;
+
+    return true;
+}
+
+// Returns whether the drawables can be built from the instances: they are
+// bound, and no node is animated by the asset library.
+FUNCTION b8
+scene_can_build_drawables(scene_hierarchy* sh, scene* sc)
+{
+    return sh->bound && (sh->posed || !sc->animated_count);
+}
+
+// Returns the squared distance of instance `i`'s origin from the camera.
+FUNCTION f32
+scene_get_instance_distance(scene_hierarchy* sh,
+                            scene* sc,
+                            pg_f32_4x4* view_from_model,
+                            u32 i)
+{
+    // NOTE: The translation is the last column.
+    f32* v = (f32*)view_from_model;
+    f32* t = &((f32*)&sh->globals[sc->instances[i].node])[12];
+    f32 distance_squared = 0.0f;
+    for (u32 r = 0; r < 3; r += 1)
+    {
+        f32 d = v[0 + r] * t[0] + v[4 + r] * t[1] + v[8 + r] * t[2] + v[12 + r];
+        distance_squared += d * d;
+    }
+
+    return distance_squared;
+}
+
+// Builds the drawables from the instances, with the hierarchy's global
+// transforms, translucent ones sorted back to front. Requires
+// `scene_can_build_drawables` and an update since the nodes last changed.
+// NOTE: The translucent order is kept between frames, so sorting it again is
+// close to linear while the camera moves smoothly.
+FUNCTION void
+scene_get_drawables(scene_hierarchy* sh,
+                    scene* sc,
+                    pg_f32_4x4* view_from_model,
+                    pg_scratch_allocator* mem,
+                    pg_graphics_drawables* drawables,
+                    pg_error* err)
+{
+    *drawables = (pg_graphics_drawables){0};
+    sh->drawable_count = 0;
+    pg_scratch_alloc(mem,
+                     sc->instance_count * sizeof(pg_graphics_drawable),
+                     alignof(pg_graphics_drawable),
+                     &drawables->drawables,
+                     err);
+    if (!drawables->drawables)
+    {
+        return;
+    }
+
+    // Sort the translucent instances back to front.
+    u32* order = sh->drawable_instances;
+    u32 translucent_count = sc->instance_count - sh->opaque_count;
+    f32* distances;
+    pg_scratch_alloc(mem,
+                     translucent_count * sizeof(f32),
+                     alignof(f32),
+                     &distances,
+                     err);
+    if (!distances && translucent_count)
+    {
+        return;
+    }
+    for (u32 i = 0; i < translucent_count; i += 1)
+    {
+        distances[i] = scene_get_instance_distance(sh,
+                                                   sc,
+                                                   view_from_model,
+                                                   order[sh->opaque_count + i]);
+    }
+    for (u32 i = 1; i < translucent_count; i += 1)
+    {
+        u32 instance = order[sh->opaque_count + i];
+        f32 distance = distances[i];
+        u32 j = i;
+        for (; j > 0 && distances[j - 1] < distance; j -= 1)
+        {
+            order[sh->opaque_count + j] = order[sh->opaque_count + j - 1];
+            distances[j] = distances[j - 1];
+        }
+        order[sh->opaque_count + j] = instance;
+        distances[j] = distance;
+    }
+
+    for (u32 i = 0; i < sc->instance_count; i += 1)
+    {
+        pg_graphics_drawable* d = &drawables->drawables[i];
+        *d = sh->instance_drawables[order[i]];
+        d->global_transform = sh->globals[sc->instances[order[i]].node];
+    }
+    drawables->drawable_count = sc->instance_count;
+    drawables->opaque_drawable_count = sh->opaque_count;
+    sh->drawable_count = sc->instance_count;
+}
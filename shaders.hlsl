@@ -1,5 +1,9 @@
 #define PI 3.14159265359f
 
+// NOTE: This mirrors `compact_vertex_stream` (see compact_vertex.c).
+#define VERTEX_FLAG_COLOR (1u << 0)
+#define VERTEX_FLAG_SKIN (1u << 1)
+
 #if defined(D3D11)
 #define CONSTANT_BUFFER(type, name, reg)                                       \
     cbuffer sm50_##name : register(reg)                                        \
@@ -18,13 +22,23 @@ struct constants
     uint material_id;
     uint texture_id;
     float4x4 global_transform;
+#if defined(COMPACT_VERTICES)
+    float3 position_min;
+    uint vertex_flags;
+    float3 position_extent;
+    float padding0;
+#endif
 };
 
 struct frame_data
 {
-    float4x4 world_from_model;
     float4x4 clip_from_world;
     float3 camera_pos;
+    uint pre_skinned;
+    uint skinned_vertex_base;
+    uint padding0;
+    uint padding1;
+    uint padding2;
 };
 
 struct vertex
@@ -38,6 +52,43 @@ struct vertex
     float4 joint_weights;
 };
 
+// NOTE: These mirror `compact_vertex` and `compact_vertex_skin` (see
+// compact_vertex.c).
+struct compact_vertex
+{
+    uint position_xy;
+    uint position_z_tangent_sign;
+    uint normal;
+    uint tangent;
+    uint tex_coord;
+};
+
+struct compact_vertex_skin
+{
+    uint2 joint_ids;
+    uint joint_weights;
+};
+
+// NOTE: This mirrors `skinned_vertex` (see skinning.c).
+struct skinned_vertex
+{
+    float3 position;
+    float padding0;
+    float3 normal;
+    float padding1;
+    float4 tangent;
+};
+
+// NOTE: This mirrors `instance_sb` (see 3d_model_viewer.c).
+struct instance_data
+{
+    float4x4 world_from_model;
+    uint joint_offset; // Of the instance's joint transforms
+    uint padding0;
+    uint padding1;
+    uint padding2;
+};
+
 struct material_properties
 {
     uint has_texture;
@@ -68,37 +119,155 @@ CONSTANT_BUFFER(constants, per_draw_cb, b0);
 
 // Vertex Shader Resources
 CONSTANT_BUFFER(frame_data, per_frame_cb, b1);
+#if defined(COMPACT_VERTICES)
+StructuredBuffer<compact_vertex> vertices_sb : register(t2);
+#else
 StructuredBuffer<vertex> vertices_sb : register(t2);
+#endif
 StructuredBuffer<uint> indices_sb : register(t3);
 StructuredBuffer<float4x4> joint_transforms_sb : register(t4);
+#if defined(COMPACT_VERTICES)
+StructuredBuffer<uint> vertex_colors_sb : register(t6);
+StructuredBuffer<compact_vertex_skin> vertex_skins_sb : register(t7);
+#endif
+StructuredBuffer<skinned_vertex> skinned_vertices_sb : register(t8);
+StructuredBuffer<instance_data> instances_sb : register(t9);
 
 // Pixel Shader Resources
 StructuredBuffer<material_properties> material_properties_sb : register(t5);
 #if defined(D3D12) || defined(VULKAN)
-Texture2D textures[] : TEXTURE : register(t6, space1);
+Texture2D textures[] : TEXTURE : register(t10, space1);
 #else
-Texture2D textures[4] : TEXTURE : register(t6);
+Texture2D textures[4] : TEXTURE : register(t10);
 #endif
 SamplerState ss : SAMPLER : register(s0);
 
+#if defined(COMPACT_VERTICES)
+float
+snorm16_to_float(uint q)
+{
+    // NOTE: Sign-extend the low 16 bits.
+    return max(float(int(q << 16) >> 16) / 32767.0f, -1.0f);
+}
+
+float3
+oct_decode(uint q)
+{
+    float3 n = float3(snorm16_to_float(q), snorm16_to_float(q >> 16), 0.0f);
+    n.z = 1.0f - abs(n.x) - abs(n.y);
+    float t = max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+// NOTE: f16tof32 requires shader model 5, so half floats are decoded manually
+// for vs_4_0. Infinity and NaN are never produced by the packer.
+float
+half_to_float(uint h)
+{
+    uint exponent = (h >> 10) & 0x1F;
+    float mantissa = float(h & 0x3FF);
+    float value = exponent == 0
+                      ? mantissa * exp2(-24.0f)
+                      : (1.0f + (mantissa / 1024.0f)) * exp2(float(exponent) - 15.0f);
+    return (h & 0x8000) ? -value : value;
+}
+
+float4
+unorm8x4_to_float4(uint q)
+{
+    return float4(q & 0xFF, (q >> 8) & 0xFF, (q >> 16) & 0xFF, q >> 24)
+           / 255.0f;
+}
+
+// NOTE: The color and skin streams are only read if the draw's model has
+// them. Otherwise the vertex is white and unweighted.
+vertex
+decode_vertex(uint vertex_id)
+{
+    compact_vertex cv = vertices_sb[vertex_id];
+
+    vertex v;
+    v.position = per_draw_cb.position_min
+                 + (float3(cv.position_xy & 0xFFFF,
+                           cv.position_xy >> 16,
+                           cv.position_z_tangent_sign & 0xFFFF)
+                    / 65535.0f)
+                       * per_draw_cb.position_extent;
+    v.normal = oct_decode(cv.normal);
+    v.tangent = float4(oct_decode(cv.tangent),
+                       (cv.position_z_tangent_sign & 0x10000) ? -1.0f : 1.0f);
+    v.tex_coord = float2(half_to_float(cv.tex_coord & 0xFFFF),
+                         half_to_float(cv.tex_coord >> 16));
+    v.color = float4(1.0f, 1.0f, 1.0f, 1.0f);
+    v.joint_ids = uint4(0, 0, 0, 0);
+    v.joint_weights = float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+    if (per_draw_cb.vertex_flags & VERTEX_FLAG_COLOR)
+    {
+        v.color = unorm8x4_to_float4(vertex_colors_sb[vertex_id]);
+    }
+
+    if (per_draw_cb.vertex_flags & VERTEX_FLAG_SKIN)
+    {
+        compact_vertex_skin cs = vertex_skins_sb[vertex_id];
+        v.joint_ids = uint4(cs.joint_ids.x & 0xFFFF,
+                            cs.joint_ids.x >> 16,
+                            cs.joint_ids.y & 0xFFFF,
+                            cs.joint_ids.y >> 16);
+        v.joint_weights = unorm8x4_to_float4(cs.joint_weights);
+    }
+
+    return v;
+}
+#endif
+
 pixel
-vs(uint index_id : SV_VertexID)
+vs(uint index_id : SV_VertexID, uint instance_id : SV_InstanceID)
 {
     uint vertex_id = indices_sb[per_draw_cb.index_offset + index_id];
+    instance_data inst = instances_sb[instance_id];
+#if defined(COMPACT_VERTICES)
+    vertex v = decode_vertex(per_draw_cb.vertex_offset + vertex_id);
+#else
     vertex v = vertices_sb[per_draw_cb.vertex_offset + vertex_id];
+#endif
 
-    float joint_weight_sum = 0.0f;
-    float4x4 skin_transform = 0.0f;
-    for (uint i = 0; i < 4; i += 1)
+    // NOTE: Unweighted (static) vertices skip the joint transform fetches.
+    // Weighted vertices are read already skinned if the app skinned them this
+    // frame, which it only does when every instance shares its joints.
+    float4x4 model_transform = per_draw_cb.global_transform;
+    if (dot(v.joint_weights, float4(1.0f, 1.0f, 1.0f, 1.0f)) > 0.0f)
     {
-        skin_transform
-            += v.joint_weights[i] * joint_transforms_sb[v.joint_ids[i]];
-        joint_weight_sum += v.joint_weights[i];
+        if (per_frame_cb.pre_skinned)
+        {
+            // NOTE: Skinned vertices only hold the current model's vertices.
+            skinned_vertex sv
+                = skinned_vertices_sb[per_draw_cb.vertex_offset
+                                      - per_frame_cb.skinned_vertex_base
+                                      + vertex_id];
+            v.position = sv.position;
+            v.normal = sv.normal;
+            v.tangent = sv.tangent;
+            model_transform = float4x4(1.0f, 0.0f, 0.0f, 0.0f,
+                                       0.0f, 1.0f, 0.0f, 0.0f,
+                                       0.0f, 0.0f, 1.0f, 0.0f,
+                                       0.0f, 0.0f, 0.0f, 1.0f);
+        }
+        else
+        {
+            model_transform = 0.0f;
+            for (uint i = 0; i < 4; i += 1)
+            {
+                model_transform
+                    += v.joint_weights[i]
+                       * joint_transforms_sb[inst.joint_offset
+                                             + v.joint_ids[i]];
+            }
+        }
     }
-    float4x4 world_from_model
-        = mul(per_frame_cb.world_from_model,
-              joint_weight_sum > 0.0f ? skin_transform
-                                      : per_draw_cb.global_transform);
+    float4x4 world_from_model = mul(inst.world_from_model, model_transform);
 
     // NOTE: When multiplying the global transform, the w component must be
     // 1.0f for position vectors and 0.0f for direction vectors.
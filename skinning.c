@@ -0,0 +1,625 @@
+// Skinning
+//
+// Linear blend skinning on the CPU, once per vertex per frame. The vertex
+// shader pulls vertices by index, so the post-transform cache never applies
+// and, without this, every triangle corner blends its four joint matrices
+// again (about 6 times per vertex on typical meshes). The skinned positions,
+// normals and tangents are uploaded and read by the vertex shader in place of
+// its joint blend.
+//
+// Vertices are skinned in batches of 8, transposed to one register per
+// component (SoA), by an SSE4.1 or AVX2 kernel picked at startup from what the
+// CPU supports. The scalar kernel does the same math as `vs`, one vertex at a
+// time, and is the reference the others are checked against (see
+// `skinning_max_error`). It also skins the vertices past the last full batch.
+//
+// NOTE: Results are in model space (after the joint transforms, before
+// `world_from_model`), matching `model_transform` in `vs`. Normals and
+// tangents are not renormalized, since `vs` normalizes them after the world
+// transform.
+// NOTE: Matrices are column-major in memory (see frustum.c).
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// NOTE: MSVC allows any intrinsic in any function, but GCC and Clang only
+// allow those of the instruction sets a function is compiled for.
+// NOTE: The load and transpose helpers must be inlined, or their rows go
+// through memory.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SKINNING_TARGET(isa)
+#define SKINNING_INLINE __forceinline
+#else
+#define SKINNING_TARGET(isa) __attribute__((target(isa)))
+#define SKINNING_INLINE __attribute__((always_inline)) inline
+#endif
+
+#define SKINNING_BATCH_SIZE 8
+
+// NOTE: Errors are relative to the magnitude of the reference component (or
+// absolute below 1). The AVX2 kernel rounds once per fused multiply-add, so it
+// is not bit-exact with the reference.
+#define SKINNING_MAX_ERROR 1e-5f
+
+// NOTE: This mirrors `skinned_vertex` in shaders.hlsl.
+typedef struct
+{
+    pg_f32_3x position;
+    f32 padding0;
+    pg_f32_3x normal;
+    f32 padding1;
+    pg_f32_4x tangent; // w is the bitangent sign
+} skinned_vertex;
+
+typedef struct
+{
+    u64 skinned_vertex_count; // Vertices skinned on the CPU
+    u64 shader_blend_count;   // Joint blends `vs` would do instead
+} skinning_stats;
+
+typedef enum
+{
+    SKINNING_KERNEL_SCALAR,
+    SKINNING_KERNEL_SSE41,
+    SKINNING_KERNEL_AVX2,
+    SKINNING_KERNEL_COUNT
+} skinning_kernel;
+
+GLOBAL c8* skinning_kernel_names[] = {"Scalar", "SSE4.1", "AVX2"};
+
+FUNCTION b8
+skinning_is_weighted(pg_vertex* v)
+{
+    return v->joint_weights.x + v->joint_weights.y + v->joint_weights.z
+               + v->joint_weights.w
+           > 0.0f;
+}
+
+// Returns the number of joint blends `vs` does to draw `index_count` indices
+// without pre-skinning, one per index that references a weighted vertex.
+FUNCTION u64
+skinning_count_shader_blends(pg_vertex* vertices,
+                             PG_GRAPHICS_INDEX_TYPE* indices,
+                             u32 index_count)
+{
+    u64 count = 0;
+    for (u32 i = 0; i < index_count; i += 1)
+    {
+        count += skinning_is_weighted(&vertices[indices[i]]);
+    }
+
+    return count;
+}
+
+// Skins one vertex the way `vs` does: the weighted sum of the joint matrices,
+// in joint order, then the matrix times the position, normal and tangent.
+// NOTE: Joints past `joint_count` are ignored, where `vs` would read out of
+// bounds.
+FUNCTION void
+skinning_skin_vertex(pg_vertex* v,
+                     pg_f32_4x4* joint_transforms,
+                     u32 joint_count,
+                     skinned_vertex* out)
+{
+    f32 m[16] = {0};
+    f32 weights[4] = {v->joint_weights.x,
+                      v->joint_weights.y,
+                      v->joint_weights.z,
+                      v->joint_weights.w};
+    for (u32 j = 0; j < 4; j += 1)
+    {
+        if (v->joint_ids[j] >= joint_count)
+        {
+            continue;
+        }
+        f32* joint = (f32*)&joint_transforms[v->joint_ids[j]];
+        for (u32 k = 0; k < 16; k += 1)
+        {
+            m[k] += weights[j] * joint[k];
+        }
+    }
+
+    // NOTE: Positions are points (w = 1) and normals and tangents are
+    // directions (w = 0). Element (row, col) is m[col * 4 + row].
+    f32* p = &v->position.x;
+    f32* n = &v->normal.x;
+    f32* t = &v->tangent.x;
+    for (u32 r = 0; r < 3; r += 1)
+    {
+        (&out->position.x)[r]
+            = m[0 + r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r];
+        (&out->normal.x)[r]
+            = m[0 + r] * n[0] + m[4 + r] * n[1] + m[8 + r] * n[2];
+        (&out->tangent.x)[r]
+            = m[0 + r] * t[0] + m[4 + r] * t[1] + m[8 + r] * t[2];
+    }
+    out->padding0 = 0.0f;
+    out->padding1 = 0.0f;
+    out->tangent.w = v->tangent.w;
+}
+
+// NOTE: Every kernel skins every weighted vertex into `result[i]` and returns
+// the number of them. Unweighted vertices that share a batch with weighted
+// ones are overwritten (`vs` never reads them), and the others are untouched.
+typedef u32 (*skinning_kernel_function)(pg_vertex* vertices,
+                                         u32 vertex_count,
+                                         pg_f32_4x4* joint_transforms,
+                                         u32 joint_count,
+                                         skinned_vertex* result);
+
+FUNCTION u32
+skinning_skin_vertices_scalar(pg_vertex* vertices,
+                              u32 vertex_count,
+                              pg_f32_4x4* joint_transforms,
+                              u32 joint_count,
+                              skinned_vertex* result)
+{
+    u32 skinned_count = 0;
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        if (skinning_is_weighted(&vertices[i]))
+        {
+            skinning_skin_vertex(&vertices[i],
+                                 joint_transforms,
+                                 joint_count,
+                                 &result[i]);
+            skinned_count += 1;
+        }
+    }
+
+    return skinned_count;
+}
+
+// NOTE: Vertices are read 4 floats at a time. Offsets into a vertex are in
+// floats.
+#define SKINNING_VERTEX_STRIDE (sizeof(pg_vertex) / sizeof(f32))
+#define SKINNING_JOINT_IDS_OFFSET                                              \
+    ((u32)((f32*)&((pg_vertex*)0)->joint_ids - (f32*)0))
+#define SKINNING_JOINT_WEIGHTS_OFFSET                                          \
+    ((u32)(&((pg_vertex*)0)->joint_weights.x - (f32*)0))
+
+// Loads the 4 floats at `lanes[l] + offset` of 4 lanes and transposes them, so
+// `rows[k]` holds float k of every lane.
+SKINNING_TARGET("sse4.1")
+SKINNING_INLINE FUNCTION void
+skinning_load_rows_sse41(f32** lanes, u32 offset, __m128* rows)
+{
+    rows[0] = _mm_loadu_ps(lanes[0] + offset);
+    rows[1] = _mm_loadu_ps(lanes[1] + offset);
+    rows[2] = _mm_loadu_ps(lanes[2] + offset);
+    rows[3] = _mm_loadu_ps(lanes[3] + offset);
+    _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+}
+
+// NOTE: Each batch is skinned as two halves of 4 lanes.
+SKINNING_TARGET("sse4.1")
+FUNCTION u32
+skinning_skin_vertices_sse41(pg_vertex* vertices,
+                             u32 vertex_count,
+                             pg_f32_4x4* joint_transforms,
+                             u32 joint_count,
+                             skinned_vertex* result)
+{
+    u32 skinned_count = 0;
+    u32 batch_end = vertex_count - (vertex_count % SKINNING_BATCH_SIZE);
+    __m128i max_joint_id = _mm_set1_epi32((s32)(joint_count - 1));
+    for (u32 i = 0; i < batch_end; i += 4)
+    {
+        f32* lanes[4] = {(f32*)&vertices[i + 0],
+                         (f32*)&vertices[i + 1],
+                         (f32*)&vertices[i + 2],
+                         (f32*)&vertices[i + 3]};
+
+        __m128 weights[4];
+        __m128 joint_ids[4];
+        skinning_load_rows_sse41(lanes, SKINNING_JOINT_WEIGHTS_OFFSET, weights);
+        skinning_load_rows_sse41(lanes, SKINNING_JOINT_IDS_OFFSET, joint_ids);
+        u32 weighted_mask = (u32)_mm_movemask_ps(
+            _mm_cmpgt_ps(_mm_add_ps(_mm_add_ps(weights[0], weights[1]),
+                                    _mm_add_ps(weights[2], weights[3])),
+                         _mm_setzero_ps()));
+        if (!weighted_mask)
+        {
+            continue;
+        }
+
+        // Blend the joint matrices one lane at a time, one column per
+        // register, then transpose them so m[c][r] is element (r, c) of 4
+        // lanes.
+        // NOTE: Out of range joints are read as joint 0 with zero weight.
+        u32 lane_ids[4][4];
+        f32 lane_weights[4][4];
+        for (u32 j = 0; j < 4; j += 1)
+        {
+            __m128i ids = _mm_castps_si128(joint_ids[j]);
+            __m128i valid
+                = _mm_cmpeq_epi32(_mm_min_epu32(ids, max_joint_id), ids);
+            _mm_storeu_si128((__m128i*)lane_ids[j], _mm_and_si128(ids, valid));
+            _mm_storeu_ps(lane_weights[j],
+                          _mm_and_ps(weights[j], _mm_castsi128_ps(valid)));
+        }
+        __m128 m[4][4];
+        for (u32 l = 0; l < 4; l += 1)
+        {
+            __m128 columns[4] = {_mm_setzero_ps(),
+                                 _mm_setzero_ps(),
+                                 _mm_setzero_ps(),
+                                 _mm_setzero_ps()};
+            for (u32 j = 0; j < 4; j += 1)
+            {
+                f32* joint = (f32*)&joint_transforms[lane_ids[j][l]];
+                __m128 w = _mm_set1_ps(lane_weights[j][l]);
+                for (u32 c = 0; c < 4; c += 1)
+                {
+                    columns[c] = _mm_add_ps(
+                        columns[c],
+                        _mm_mul_ps(w, _mm_loadu_ps(&joint[c * 4])));
+                }
+            }
+            for (u32 c = 0; c < 4; c += 1)
+            {
+                m[c][l] = columns[c];
+            }
+        }
+        for (u32 c = 0; c < 4; c += 1)
+        {
+            _MM_TRANSPOSE4_PS(m[c][0], m[c][1], m[c][2], m[c][3]);
+        }
+
+        // Transform the position, normal and tangent of 4 lanes.
+        // NOTE: The first 12 floats of a vertex are the position, normal,
+        // tangent and texture coordinates.
+        // NOTE: The sums are in the same order as the reference, so the
+        // results match it bit for bit unless the compiler fuses its
+        // multiply-adds.
+        __m128 in[12];
+        skinning_load_rows_sse41(lanes, 0, &in[0]);
+        skinning_load_rows_sse41(lanes, 4, &in[4]);
+        skinning_load_rows_sse41(lanes, 8, &in[8]);
+        __m128 out[3][4];
+        for (u32 a = 0; a < 3; a += 1)
+        {
+            __m128* xyz = &in[a * 3];
+            for (u32 r = 0; r < 3; r += 1)
+            {
+                out[a][r]
+                    = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][r], xyz[0]),
+                                            _mm_mul_ps(m[1][r], xyz[1])),
+                                 _mm_mul_ps(m[2][r], xyz[2]));
+            }
+            out[a][3] = _mm_setzero_ps();
+        }
+        for (u32 r = 0; r < 3; r += 1)
+        {
+            out[0][r] = _mm_add_ps(out[0][r], m[3][r]);
+        }
+        out[2][3] = in[9];
+
+        // Transpose back to one vertex per register and store.
+        for (u32 a = 0; a < 3; a += 1)
+        {
+            _MM_TRANSPOSE4_PS(out[a][0], out[a][1], out[a][2], out[a][3]);
+        }
+        for (u32 l = 0; l < 4; l += 1)
+        {
+            skinned_vertex* sv = &result[i + l];
+            _mm_storeu_ps(&sv->position.x, out[0][l]);
+            _mm_storeu_ps(&sv->normal.x, out[1][l]);
+            _mm_storeu_ps(&sv->tangent.x, out[2][l]);
+            skinned_count += (weighted_mask >> l) & 1;
+        }
+    }
+
+    return skinned_count
+           + skinning_skin_vertices_scalar(&vertices[batch_end],
+                                           vertex_count - batch_end,
+                                           joint_transforms,
+                                           joint_count,
+                                           &result[batch_end]);
+}
+
+// Transposes 4 registers of 4 floats per 128-bit half, so `rows[k]` holds
+// float k of lanes 0-3 in its lower half and of lanes 4-7 in its upper half.
+// NOTE: On input, register l holds lane l and lane l + 4.
+SKINNING_TARGET("avx2,fma")
+SKINNING_INLINE FUNCTION void
+skinning_transpose_avx2(__m256* rows)
+{
+    __m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+    __m256 t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+    __m256 t2 = _mm256_unpacklo_ps(rows[2], rows[3]);
+    __m256 t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+    rows[0] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    rows[1] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    rows[2] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    rows[3] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// Loads the 4 floats at `lanes[l] + offset` of 8 lanes and transposes them, so
+// `rows[k]` holds float k of every lane.
+SKINNING_TARGET("avx2,fma")
+SKINNING_INLINE FUNCTION void
+skinning_load_rows_avx2(f32** lanes, u32 offset, __m256* rows)
+{
+    for (u32 l = 0; l < 4; l += 1)
+    {
+        rows[l] = _mm256_insertf128_ps(
+            _mm256_castps128_ps256(_mm_loadu_ps(lanes[l] + offset)),
+            _mm_loadu_ps(lanes[l + 4] + offset),
+            1);
+    }
+    skinning_transpose_avx2(rows);
+}
+
+SKINNING_TARGET("avx2,fma")
+FUNCTION u32
+skinning_skin_vertices_avx2(pg_vertex* vertices,
+                            u32 vertex_count,
+                            pg_f32_4x4* joint_transforms,
+                            u32 joint_count,
+                            skinned_vertex* result)
+{
+    u32 skinned_count = 0;
+    u32 batch_end = vertex_count - (vertex_count % SKINNING_BATCH_SIZE);
+    __m256i max_joint_id = _mm256_set1_epi32((s32)(joint_count - 1));
+    for (u32 i = 0; i < batch_end; i += SKINNING_BATCH_SIZE)
+    {
+        f32* lanes[SKINNING_BATCH_SIZE];
+        for (u32 l = 0; l < SKINNING_BATCH_SIZE; l += 1)
+        {
+            lanes[l] = (f32*)&vertices[i + l];
+        }
+
+        __m256 weights[4];
+        __m256 joint_ids[4];
+        skinning_load_rows_avx2(lanes, SKINNING_JOINT_WEIGHTS_OFFSET, weights);
+        skinning_load_rows_avx2(lanes, SKINNING_JOINT_IDS_OFFSET, joint_ids);
+        u32 weighted_mask = (u32)_mm256_movemask_ps(_mm256_cmp_ps(
+            _mm256_add_ps(_mm256_add_ps(weights[0], weights[1]),
+                          _mm256_add_ps(weights[2], weights[3])),
+            _mm256_setzero_ps(),
+            _CMP_GT_OQ));
+        if (!weighted_mask)
+        {
+            continue;
+        }
+
+        // Blend the joint matrices one lane at a time, two columns per
+        // register, then pair lane l with lane l + 4 and transpose them so
+        // m[c][r] is element (r, c) of 8 lanes.
+        // NOTE: Out of range joints are read as joint 0 with zero weight.
+        u32 lane_ids[4][SKINNING_BATCH_SIZE];
+        f32 lane_weights[4][SKINNING_BATCH_SIZE];
+        for (u32 j = 0; j < 4; j += 1)
+        {
+            __m256i ids = _mm256_castps_si256(joint_ids[j]);
+            __m256i valid
+                = _mm256_cmpeq_epi32(_mm256_min_epu32(ids, max_joint_id), ids);
+            _mm256_storeu_si256((__m256i*)lane_ids[j],
+                                _mm256_and_si256(ids, valid));
+            _mm256_storeu_ps(lane_weights[j],
+                             _mm256_and_ps(weights[j],
+                                           _mm256_castsi256_ps(valid)));
+        }
+        __m256 columns[2][SKINNING_BATCH_SIZE];
+        for (u32 l = 0; l < SKINNING_BATCH_SIZE; l += 1)
+        {
+            __m256 c01 = _mm256_setzero_ps();
+            __m256 c23 = _mm256_setzero_ps();
+            for (u32 j = 0; j < 4; j += 1)
+            {
+                f32* joint = (f32*)&joint_transforms[lane_ids[j][l]];
+                __m256 w = _mm256_set1_ps(lane_weights[j][l]);
+                c01 = _mm256_fmadd_ps(w, _mm256_loadu_ps(&joint[0]), c01);
+                c23 = _mm256_fmadd_ps(w, _mm256_loadu_ps(&joint[8]), c23);
+            }
+            columns[0][l] = c01;
+            columns[1][l] = c23;
+        }
+        __m256 m[4][4];
+        for (u32 l = 0; l < 4; l += 1)
+        {
+            for (u32 h = 0; h < 2; h += 1)
+            {
+                m[h * 2 + 0][l] = _mm256_permute2f128_ps(columns[h][l],
+                                                         columns[h][l + 4],
+                                                         0x20);
+                m[h * 2 + 1][l] = _mm256_permute2f128_ps(columns[h][l],
+                                                         columns[h][l + 4],
+                                                         0x31);
+            }
+        }
+        for (u32 c = 0; c < 4; c += 1)
+        {
+            skinning_transpose_avx2(m[c]);
+        }
+
+        // Transform the position, normal and tangent of 8 lanes.
+        // NOTE: The first 12 floats of a vertex are the position, normal,
+        // tangent and texture coordinates.
+        __m256 in[12];
+        skinning_load_rows_avx2(lanes, 0, &in[0]);
+        skinning_load_rows_avx2(lanes, 4, &in[4]);
+        skinning_load_rows_avx2(lanes, 8, &in[8]);
+        __m256 out[3][4];
+        for (u32 a = 0; a < 3; a += 1)
+        {
+            __m256* xyz = &in[a * 3];
+            for (u32 r = 0; r < 3; r += 1)
+            {
+                out[a][r] = _mm256_fmadd_ps(
+                    m[2][r],
+                    xyz[2],
+                    _mm256_fmadd_ps(m[1][r],
+                                    xyz[1],
+                                    _mm256_mul_ps(m[0][r], xyz[0])));
+            }
+            out[a][3] = _mm256_setzero_ps();
+        }
+        for (u32 r = 0; r < 3; r += 1)
+        {
+            out[0][r] = _mm256_add_ps(out[0][r], m[3][r]);
+        }
+        out[2][3] = in[9];
+
+        // Transpose back to one vertex per half and store.
+        for (u32 a = 0; a < 3; a += 1)
+        {
+            skinning_transpose_avx2(out[a]);
+        }
+        for (u32 l = 0; l < 4; l += 1)
+        {
+            skinned_vertex* lo = &result[i + l];
+            skinned_vertex* hi = &result[i + l + 4];
+            _mm_storeu_ps(&lo->position.x, _mm256_castps256_ps128(out[0][l]));
+            _mm_storeu_ps(&lo->normal.x, _mm256_castps256_ps128(out[1][l]));
+            _mm_storeu_ps(&lo->tangent.x, _mm256_castps256_ps128(out[2][l]));
+            _mm_storeu_ps(&hi->position.x, _mm256_extractf128_ps(out[0][l], 1));
+            _mm_storeu_ps(&hi->normal.x, _mm256_extractf128_ps(out[1][l], 1));
+            _mm_storeu_ps(&hi->tangent.x, _mm256_extractf128_ps(out[2][l], 1));
+        }
+        for (u32 l = 0; l < SKINNING_BATCH_SIZE; l += 1)
+        {
+            skinned_count += (weighted_mask >> l) & 1;
+        }
+    }
+
+    return skinned_count
+           + skinning_skin_vertices_scalar(&vertices[batch_end],
+                                           vertex_count - batch_end,
+                                           joint_transforms,
+                                           joint_count,
+                                           &result[batch_end]);
+}
+
+GLOBAL skinning_kernel_function skinning_kernel_functions[] = {
+    skinning_skin_vertices_scalar,
+    skinning_skin_vertices_sse41,
+    skinning_skin_vertices_avx2};
+
+// NOTE: AVX2 also needs the OS to save the upper halves of the registers,
+// which GCC and Clang check for.
+FUNCTION b8
+skinning_kernel_supported(skinning_kernel kernel)
+{
+    switch (kernel)
+    {
+        case SKINNING_KERNEL_SCALAR:
+        {
+            return true;
+        }
+        case SKINNING_KERNEL_SSE41:
+        {
+#if defined(_MSC_VER)
+            s32 info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 19)) != 0;
+#else
+            return __builtin_cpu_supports("sse4.1");
+#endif
+        }
+        case SKINNING_KERNEL_AVX2:
+        {
+#if defined(_MSC_VER)
+            s32 info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+            {
+                return false;
+            }
+            __cpuid(info, 1);
+            b8 fma = (info[2] & (1 << 12)) != 0;
+            b8 os_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28))
+                        && (_xgetbv(0) & 0x6) == 0x6;
+            __cpuidex(info, 7, 0);
+            return fma && os_avx && (info[1] & (1 << 5));
+#else
+            return __builtin_cpu_supports("avx2")
+                   && __builtin_cpu_supports("fma");
+#endif
+        }
+        default:
+        {
+            return false;
+        }
+    }
+}
+
+FUNCTION skinning_kernel
+skinning_best_kernel(void)
+{
+    skinning_kernel kernel = SKINNING_KERNEL_SCALAR;
+    for (skinning_kernel k = 0; k < SKINNING_KERNEL_COUNT; k += 1)
+    {
+        if (skinning_kernel_supported(k))
+        {
+            kernel = k;
+        }
+    }
+
+    return kernel;
+}
+
+// Skins every weighted vertex with `kernel`, which must be supported. Returns
+// the number of skinned vertices.
+FUNCTION u32
+skinning_skin_vertices(skinning_kernel kernel,
+                       pg_vertex* vertices,
+                       u32 vertex_count,
+                       pg_f32_4x4* joint_transforms,
+                       u32 joint_count,
+                       skinned_vertex* result)
+{
+    static_assert(CAP(skinning_kernel_functions) == SKINNING_KERNEL_COUNT,
+                  "unexpected skinning kernel count");
+    static_assert(CAP(skinning_kernel_names) == SKINNING_KERNEL_COUNT,
+                  "unexpected skinning kernel names count");
+    if (!joint_count)
+    {
+        return 0;
+    }
+
+    return skinning_kernel_functions[kernel](vertices,
+                                             vertex_count,
+                                             joint_transforms,
+                                             joint_count,
+                                             result);
+}
+
+// Returns the largest error of a weighted vertex's skinned components in
+// `result` vs. `reference` (see SKINNING_MAX_ERROR).
+FUNCTION f32
+skinning_max_error(pg_vertex* vertices,
+                   u32 vertex_count,
+                   skinned_vertex* result,
+                   skinned_vertex* reference)
+{
+    f32 max_error = 0.0f;
+    for (u32 i = 0; i < vertex_count; i += 1)
+    {
+        if (!skinning_is_weighted(&vertices[i]))
+        {
+            continue;
+        }
+
+        f32* a = &result[i].position.x;
+        f32* b = &reference[i].position.x;
+        for (u32 k = 0; k < sizeof(skinned_vertex) / sizeof(f32); k += 1)
+        {
+            f32 difference = a[k] - b[k];
+            f32 magnitude = b[k] < 0.0f ? -b[k] : b[k];
+            f32 error = (difference < 0.0f ? -difference : difference)
+                        / (magnitude > 1.0f ? magnitude : 1.0f);
+            // NOTE: NaNs fail every comparison, so they count as an error
+            // of 1.
+            if (!(error <= max_error))
+            {
+                max_error = error == error ? error : 1.0f;
+            }
+        }
+    }
+
+    return max_error;
+}
@@ -0,0 +1,222 @@
+#define APP_NAME "Skinning Test"
+
+// Skinning test
+//
+// Skins generated vertices with every skinning kernel the CPU supports and
+// checks each against a direct port of the joint blend in `vs`
+// (shaders.hlsl), rather than against the scalar kernel, so that a bug shared
+// by all kernels still fails. Exits with 1 if any kernel's error is above
+// SKINNING_MAX_ERROR or it skins a different number of vertices.
+//
+// NOTE: The vertex count is not a multiple of SKINNING_BATCH_SIZE, so the
+// vertices past the last full batch are covered too, and every batch mixes
+// weighted and unweighted vertices.
+
+#if defined(LINUX)
+#include "linux_platform.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#else
+static_assert(0, "no supported platform is defined");
+#endif
+
+#include "skinning.c"
+
+#define SKINNING_TEST_VERTEX_COUNT 1003
+#define SKINNING_TEST_JOINT_COUNT 64
+#define SKINNING_TEST_UNWEIGHTED_PERIOD 5
+
+// NOTE: A fixed-seed LCG, so failures reproduce.
+GLOBAL u32 skinning_test_seed = 0x12345678;
+
+FUNCTION f32
+skinning_test_random(f32 min, f32 max)
+{
+    skinning_test_seed = skinning_test_seed * 1664525u + 1013904223u;
+    return min + (max - min) * (f32)(skinning_test_seed >> 8) / (f32)(1 << 24);
+}
+
+// NOTE: A port of `float4x4`, indexed [row][col] like HLSL. Joint transforms
+// are column-major in memory, so loading one from the structured buffer
+// transposes it.
+typedef struct
+{
+    f32 m[4][4];
+} skinning_test_float4x4;
+
+FUNCTION skinning_test_float4x4
+skinning_test_load(pg_f32_4x4* joint)
+{
+    f32* memory = (f32*)joint;
+    skinning_test_float4x4 result;
+    for (u32 row = 0; row < 4; row += 1)
+    {
+        for (u32 col = 0; col < 4; col += 1)
+        {
+            result.m[row][col] = memory[col * 4 + row];
+        }
+    }
+
+    return result;
+}
+
+// NOTE: A port of `model_transform += v.joint_weights[i] * joint` and
+// `mul(model_transform, float4(v, w)).xyz` in `vs`.
+FUNCTION void
+skinning_test_vs(pg_vertex* v,
+                 pg_f32_4x4* joint_transforms,
+                 skinned_vertex* out)
+{
+    skinning_test_float4x4 model_transform = {0};
+    f32 joint_weights[4] = {v->joint_weights.x,
+                            v->joint_weights.y,
+                            v->joint_weights.z,
+                            v->joint_weights.w};
+    for (u32 i = 0; i < 4; i += 1)
+    {
+        skinning_test_float4x4 joint
+            = skinning_test_load(&joint_transforms[v->joint_ids[i]]);
+        for (u32 row = 0; row < 4; row += 1)
+        {
+            for (u32 col = 0; col < 4; col += 1)
+            {
+                model_transform.m[row][col]
+                    += joint_weights[i] * joint.m[row][col];
+            }
+        }
+    }
+
+    f32 position[4] = {v->position.x, v->position.y, v->position.z, 1.0f};
+    f32 normal[4] = {v->normal.x, v->normal.y, v->normal.z, 0.0f};
+    f32 tangent[4] = {v->tangent.x, v->tangent.y, v->tangent.z, 0.0f};
+    f32* results[3] = {&out->position.x, &out->normal.x, &out->tangent.x};
+    f32* vectors[3] = {position, normal, tangent};
+    for (u32 k = 0; k < 3; k += 1)
+    {
+        for (u32 row = 0; row < 3; row += 1)
+        {
+            f32 sum = 0.0f;
+            for (u32 col = 0; col < 4; col += 1)
+            {
+                sum += model_transform.m[row][col] * vectors[k][col];
+            }
+            results[k][row] = sum;
+        }
+    }
+    out->padding0 = 0.0f;
+    out->padding1 = 0.0f;
+    out->tangent.w = v->tangent.w;
+}
+
+s32
+main(void)
+{
+    pg_vertex* vertices
+        = calloc(SKINNING_TEST_VERTEX_COUNT, sizeof(pg_vertex));
+    skinned_vertex* reference
+        = calloc(SKINNING_TEST_VERTEX_COUNT, sizeof(skinned_vertex));
+    skinned_vertex* result
+        = calloc(SKINNING_TEST_VERTEX_COUNT, sizeof(skinned_vertex));
+    pg_f32_4x4* joint_transforms
+        = calloc(SKINNING_TEST_JOINT_COUNT, sizeof(pg_f32_4x4));
+    if (!vertices || !reference || !result || !joint_transforms)
+    {
+        fprintf(stderr, "failed to allocate test data\n");
+        return 1;
+    }
+
+    // NOTE: Joints are affine (last row 0, 0, 0, 1), like the joint
+    // transforms the library computes.
+    for (u32 i = 0; i < SKINNING_TEST_JOINT_COUNT; i += 1)
+    {
+        f32* joint = (f32*)&joint_transforms[i];
+        for (u32 col = 0; col < 4; col += 1)
+        {
+            for (u32 row = 0; row < 3; row += 1)
+            {
+                joint[col * 4 + row] = col == 3
+                                           ? skinning_test_random(-10.0f,
+                                                                  10.0f)
+                                           : skinning_test_random(-2.0f,
+                                                                  2.0f);
+            }
+            joint[col * 4 + 3] = col == 3 ? 1.0f : 0.0f;
+        }
+    }
+
+    u32 weighted_count = 0;
+    for (u32 i = 0; i < SKINNING_TEST_VERTEX_COUNT; i += 1)
+    {
+        pg_vertex* v = &vertices[i];
+        v->position.x = skinning_test_random(-100.0f, 100.0f);
+        v->position.y = skinning_test_random(-100.0f, 100.0f);
+        v->position.z = skinning_test_random(-100.0f, 100.0f);
+        v->normal.x = skinning_test_random(-1.0f, 1.0f);
+        v->normal.y = skinning_test_random(-1.0f, 1.0f);
+        v->normal.z = skinning_test_random(-1.0f, 1.0f);
+        v->tangent.x = skinning_test_random(-1.0f, 1.0f);
+        v->tangent.y = skinning_test_random(-1.0f, 1.0f);
+        v->tangent.z = skinning_test_random(-1.0f, 1.0f);
+        v->tangent.w = i % 2 ? 1.0f : -1.0f;
+        for (u32 j = 0; j < 4; j += 1)
+        {
+            v->joint_ids[j] = (u32)skinning_test_random(
+                                  0.0f, (f32)SKINNING_TEST_JOINT_COUNT)
+                              % SKINNING_TEST_JOINT_COUNT;
+        }
+        if (i % SKINNING_TEST_UNWEIGHTED_PERIOD)
+        {
+            f32 weights[4] = {skinning_test_random(0.0f, 1.0f),
+                              skinning_test_random(0.0f, 1.0f),
+                              skinning_test_random(0.0f, 1.0f),
+                              skinning_test_random(0.0f, 1.0f)};
+            f32 total = weights[0] + weights[1] + weights[2] + weights[3];
+            v->joint_weights.x = weights[0] / total;
+            v->joint_weights.y = weights[1] / total;
+            v->joint_weights.z = weights[2] / total;
+            v->joint_weights.w = weights[3] / total;
+            skinning_test_vs(v, joint_transforms, &reference[i]);
+            weighted_count += 1;
+        }
+    }
+
+    b8 failed = false;
+    for (u32 kernel = 0; kernel < SKINNING_KERNEL_COUNT; kernel += 1)
+    {
+        if (!skinning_kernel_supported((skinning_kernel)kernel))
+        {
+            printf("%-7s skipped (not supported)\n",
+                   skinning_kernel_names[kernel]);
+            continue;
+        }
+
+        memset(result, 0, SKINNING_TEST_VERTEX_COUNT * sizeof(skinned_vertex));
+        u32 skinned_count = skinning_skin_vertices((skinning_kernel)kernel,
+                                                   vertices,
+                                                   SKINNING_TEST_VERTEX_COUNT,
+                                                   joint_transforms,
+                                                   SKINNING_TEST_JOINT_COUNT,
+                                                   result);
+        f32 max_error = skinning_max_error(vertices,
+                                           SKINNING_TEST_VERTEX_COUNT,
+                                           result,
+                                           reference);
+        b8 passed = skinned_count == weighted_count
+                    && max_error <= SKINNING_MAX_ERROR;
+        printf("%-7s %s (skinned: %u/%u, max error: %g)\n",
+               skinning_kernel_names[kernel],
+               passed ? "passed" : "FAILED",
+               skinned_count,
+               weighted_count,
+               (f64)max_error);
+        failed |= !passed;
+    }
+
+    free(vertices);
+    free(reference);
+    free(result);
+    free(joint_transforms);
+
+    return failed ? 1 : 0;
+}
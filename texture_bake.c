@@ -0,0 +1,1035 @@
+// Texture baking
+//
+// Pack-time mip chains and block compression for material textures, for
+// renderers that upload textures as they will be sampled instead of as 8-bit
+// RGBA without mips. Each level is box filtered from the one above it: in linear
+// light for color textures, and renormalized for normal maps. Levels are then
+// encoded to the BC format suited to the texture's role:
+// * Base color and emissive: BC7 (mode 6, 8 bits per texel).
+// * Normal: BC5 (X and Y, 8 bits per texel). Z is left to be reconstructed
+//   by whichever shader samples it.
+// * Metallic-roughness: BC5 (roughness and metallic), or BC4 (roughness, 4 bits
+//   per texel) if the metallic value is the same for every texel.
+//
+// Encoding is split into rows of blocks over every level, so a texture can be
+// encoded by several threads at once.
+//
+// NOTE: Requires image.c and lod.c.
+// NOTE: This is packer-only. The viewer's renderer uploads the .pga textures
+// as 8-bit RGBA and never binds the baked levels, which are only written to
+// the extension file.
+// NOTE: BC7 blocks only use mode 6 (one subset, RGBA endpoints), which suits
+// the smooth gradients of most material textures but not sharp color edges.
+
+#define TEXTURE_NONE 0xFFFFFFFF
+#define TEXTURE_MAX_MIP_COUNT 16
+#define TEXTURE_ALIGNMENT 16
+#define TEXTURE_MAX_PSNR 99.0f // dB, for lossless textures
+#define TEXTURE_BC7_MODE_6 0x40
+
+// NOTE: In the order of the shader's texture slots.
+typedef enum
+{
+    TEXTURE_ROLE_BASE_COLOR,
+    TEXTURE_ROLE_METALLIC_ROUGHNESS,
+    TEXTURE_ROLE_NORMAL,
+    TEXTURE_ROLE_EMISSIVE,
+    TEXTURE_ROLE_COUNT
+} texture_role;
+
+typedef enum
+{
+    TEXTURE_FORMAT_NONE,
+    TEXTURE_FORMAT_BC4,
+    TEXTURE_FORMAT_BC5,
+    TEXTURE_FORMAT_BC7
+} texture_format;
+
+// NOTE: Layout of an ASSET_EXT_SECTION_TEXTURES section: this header, an image
+// id per material and role (or TEXTURE_NONE), the images, then the blocks of
+// every image (each starting at a multiple of TEXTURE_ALIGNMENT from the start
+// of the section).
+typedef struct
+{
+    u32 material_count;
+    u32 image_count;
+    u32 padding0;
+    u32 padding1;
+} textures_header;
+
+// NOTE: Levels are stored from the largest, each as rows of 4x4 blocks.
+// `metallic` is the metallic value of every texel of a BC4 metallic-roughness
+// texture. `source_size` is the size as 8-bit RGBA without mips, and `psnr`
+// compares the largest level to the source over the channels that are stored.
+typedef struct
+{
+    u32 width;
+    u32 height;
+    u32 format;
+    u32 role;
+    u32 mip_count;
+    u32 metallic;
+    u32 source_image_id;
+    f32 psnr;
+    u64 offset;
+    u64 size;
+    u64 source_size;
+    u64 padding0;
+} texture_image;
+
+typedef struct
+{
+    u32* image_ids; // material_count * TEXTURE_ROLE_COUNT
+    texture_image* images;
+    u8* data; // The section, which image offsets are relative to
+    u32 material_count;
+    u32 image_count;
+} textures;
+
+typedef struct
+{
+    rgba_image source;
+    texture_role role;
+    texture_format format;
+    u32 metallic;
+    u32 mip_count;
+    u32 widths[TEXTURE_MAX_MIP_COUNT];
+    u32 heights[TEXTURE_MAX_MIP_COUNT];
+    u8* mips[TEXTURE_MAX_MIP_COUNT]; // RGBA, the first is the source
+    u8* blocks[TEXTURE_MAX_MIP_COUNT];
+    u8* data; // Every level's blocks
+    usize size;
+    u32 row_count; // Block rows over every level
+} texture_bake;
+
+GLOBAL u32 texture_bc7_weights[16]
+    = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+FUNCTION usize
+textures_section_size(u32 material_count, u32 image_count)
+{
+    return sizeof(textures_header)
+           + (material_count * TEXTURE_ROLE_COUNT * sizeof(u32))
+           + (image_count * sizeof(texture_image));
+}
+
+FUNCTION b8
+textures_read(u8* section, u64 section_size, textures* ts)
+{
+    *ts = (textures){0};
+
+    if (!section || section_size < sizeof(textures_header))
+    {
+        return false;
+    }
+
+    textures_header* header = (textures_header*)section;
+    usize size = textures_section_size(header->material_count,
+                                       header->image_count);
+    if (section_size < size)
+    {
+        return false;
+    }
+
+    ts->material_count = header->material_count;
+    ts->image_count = header->image_count;
+    ts->image_ids = (u32*)(section + sizeof(textures_header));
+    ts->images = (texture_image*)(section + sizeof(textures_header)
+                                  + (header->material_count
+                                     * TEXTURE_ROLE_COUNT * sizeof(u32)));
+    ts->data = section;
+
+    for (u32 i = 0; i < ts->material_count * TEXTURE_ROLE_COUNT; i += 1)
+    {
+        if (ts->image_ids[i] != TEXTURE_NONE
+            && ts->image_ids[i] >= ts->image_count)
+        {
+            *ts = (textures){0};
+            return false;
+        }
+    }
+    for (u32 i = 0; i < ts->image_count; i += 1)
+    {
+        texture_image* ti = &ts->images[i];
+        if (ti->offset % TEXTURE_ALIGNMENT || ti->offset < size
+            || ti->offset + ti->size > section_size)
+        {
+            *ts = (textures){0};
+            return false;
+        }
+    }
+
+    return true;
+}
+
+FUNCTION u32
+texture_block_size(texture_format format)
+{
+    return format == TEXTURE_FORMAT_BC4 ? 8 : 16;
+}
+
+FUNCTION usize
+texture_level_size(texture_format format, u32 width, u32 height)
+{
+    return (usize)((width + 3) / 4) * ((height + 3) / 4)
+           * texture_block_size(format);
+}
+
+// sRGB
+
+// NOTE: x^(1/5) by Newton's method, which converges from above for x in
+// [0, 1].
+FUNCTION f32
+texture_fifth_root(f32 x)
+{
+    f32 y = 1.0f;
+    for (u32 i = 0; i < 16 && x > 0.0f; i += 1)
+    {
+        f32 y4 = y * y * y * y;
+        y = ((4.0f * y) + (x / y4)) * 0.2f;
+    }
+    return x > 0.0f ? y : 0.0f;
+}
+
+FUNCTION void
+texture_srgb_table(f32* to_linear)
+{
+    for (u32 i = 0; i < 256; i += 1)
+    {
+        f32 c = (f32)i / 255.0f;
+        if (c <= 0.04045f)
+        {
+            to_linear[i] = c / 12.92f;
+        }
+        else
+        {
+            // NOTE: x^2.4 = x^2 * (x^(1/5))^2.
+            f32 x = (c + 0.055f) / 1.055f;
+            f32 r = texture_fifth_root(x);
+            to_linear[i] = x * x * r * r;
+        }
+    }
+}
+
+// NOTE: Binary search for the nearest sRGB value, so that every value
+// round-trips exactly.
+FUNCTION u8
+texture_linear_to_srgb(f32* to_linear, f32 value)
+{
+    u32 low = 0;
+    u32 high = 255;
+    while (low < high)
+    {
+        u32 mid = (low + high) / 2;
+        if (value > (to_linear[mid] + to_linear[mid + 1]) * 0.5f)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return (u8)low;
+}
+
+FUNCTION u8
+texture_unorm8(f32 value)
+{
+    return value <= 0.0f   ? 0
+           : value >= 1.0f ? 255
+                           : (u8)((value * 255.0f) + 0.5f);
+}
+
+// Mips
+
+FUNCTION void
+texture_downsample(texture_bake* tb, u32 level, f32* to_linear)
+{
+    u8* src = tb->mips[level - 1];
+    u32 src_width = tb->widths[level - 1];
+    u32 src_height = tb->heights[level - 1];
+    u8* dst = tb->mips[level];
+    u32 width = tb->widths[level];
+    u32 height = tb->heights[level];
+    b8 srgb = tb->role == TEXTURE_ROLE_BASE_COLOR
+              || tb->role == TEXTURE_ROLE_EMISSIVE;
+
+    for (u32 y = 0; y < height; y += 1)
+    {
+        u32 y0 = 2 * y < src_height ? 2 * y : src_height - 1;
+        u32 y1 = (2 * y) + 1 < src_height ? (2 * y) + 1 : y0;
+        for (u32 x = 0; x < width; x += 1)
+        {
+            u32 x0 = 2 * x < src_width ? 2 * x : src_width - 1;
+            u32 x1 = (2 * x) + 1 < src_width ? (2 * x) + 1 : x0;
+            u8* texels[4] = {&src[((y0 * src_width) + x0) * 4],
+                             &src[((y0 * src_width) + x1) * 4],
+                             &src[((y1 * src_width) + x0) * 4],
+                             &src[((y1 * src_width) + x1) * 4]};
+
+            f32 sum[4] = {0};
+            for (u32 t = 0; t < 4; t += 1)
+            {
+                for (u32 c = 0; c < 4; c += 1)
+                {
+                    sum[c] += (srgb && c < 3) ? to_linear[texels[t][c]]
+                                              : (f32)texels[t][c] / 255.0f;
+                }
+            }
+
+            u8* out = &dst[((y * width) + x) * 4];
+            if (tb->role == TEXTURE_ROLE_NORMAL)
+            {
+                f32 n[3] = {0};
+                for (u32 c = 0; c < 3; c += 1)
+                {
+                    n[c] = ((sum[c] * 0.25f) * 2.0f) - 1.0f;
+                }
+                f32 length = lod_sqrt((n[0] * n[0]) + (n[1] * n[1])
+                                      + (n[2] * n[2]));
+                f32 scale = length > 0.0f ? 1.0f / length : 0.0f;
+                for (u32 c = 0; c < 3; c += 1)
+                {
+                    out[c] = texture_unorm8(((n[c] * scale) + 1.0f) * 0.5f);
+                }
+                out[3] = texture_unorm8(sum[3] * 0.25f);
+                continue;
+            }
+            for (u32 c = 0; c < 4; c += 1)
+            {
+                out[c] = (srgb && c < 3)
+                             ? texture_linear_to_srgb(to_linear, sum[c] * 0.25f)
+                             : texture_unorm8(sum[c] * 0.25f);
+            }
+        }
+    }
+}
+
+// Picks the format of `source` for `role`, builds its mip chain and allocates
+// its blocks. The blocks are then encoded with `texture_bake_encode_rows`.
+FUNCTION b8
+texture_bake_init(rgba_image* source,
+                  texture_role role,
+                  pg_scratch_allocator* mem,
+                  texture_bake* tb,
+                  pg_error* err)
+{
+    *tb = (texture_bake){.source = *source, .role = role};
+
+    switch (role)
+    {
+        case TEXTURE_ROLE_METALLIC_ROUGHNESS:
+        {
+            usize texel_count = (usize)source->width * source->height;
+            b8 uniform_metallic = true;
+            for (usize i = 1; uniform_metallic && i < texel_count; i += 1)
+            {
+                uniform_metallic
+                    = source->pixels[(i * 4) + 2] == source->pixels[2];
+            }
+            tb->format = uniform_metallic ? TEXTURE_FORMAT_BC4
+                                          : TEXTURE_FORMAT_BC5;
+            tb->metallic = source->pixels[2];
+            break;
+        }
+        case TEXTURE_ROLE_NORMAL:
+        {
+            tb->format = TEXTURE_FORMAT_BC5;
+            break;
+        }
+        default:
+        {
+            tb->format = TEXTURE_FORMAT_BC7;
+            break;
+        }
+    }
+
+    u32 width = source->width;
+    u32 height = source->height;
+    for (;;)
+    {
+        tb->widths[tb->mip_count] = width;
+        tb->heights[tb->mip_count] = height;
+        tb->row_count += (height + 3) / 4;
+        tb->size += texture_level_size(tb->format, width, height);
+        tb->mip_count += 1;
+        if ((width == 1 && height == 1)
+            || tb->mip_count == TEXTURE_MAX_MIP_COUNT)
+        {
+            break;
+        }
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+
+    pg_scratch_alloc(mem, tb->size, TEXTURE_ALIGNMENT, &tb->data, err);
+    if (!tb->data)
+    {
+        return false;
+    }
+
+    f32 to_linear[256] = {0};
+    texture_srgb_table(to_linear);
+
+    usize offset = 0;
+    tb->mips[0] = source->pixels;
+    for (u32 l = 0; l < tb->mip_count; l += 1)
+    {
+        tb->blocks[l] = &tb->data[offset];
+        offset += texture_level_size(tb->format, tb->widths[l], tb->heights[l]);
+        if (l)
+        {
+            pg_scratch_alloc(mem,
+                             (usize)tb->widths[l] * tb->heights[l] * 4,
+                             4,
+                             &tb->mips[l],
+                             err);
+            if (!tb->mips[l])
+            {
+                return false;
+            }
+            texture_downsample(tb, l, to_linear);
+        }
+    }
+
+    return true;
+}
+
+// BC4/BC5
+
+FUNCTION void
+texture_bc4_palette(u32 r0, u32 r1, u32* palette)
+{
+    palette[0] = r0;
+    palette[1] = r1;
+    for (u32 k = 2; k < 8; k += 1)
+    {
+        palette[k] = (((8 - k) * r0) + ((k - 1) * r1) + 3) / 7;
+    }
+}
+
+// NOTE: Endpoints are the block's range, pulled in by up to 2 steps at each
+// end if that lowers the error.
+FUNCTION void
+texture_encode_bc4(u8* values, u8* out)
+{
+    u32 min = 255;
+    u32 max = 0;
+    for (u32 i = 0; i < 16; i += 1)
+    {
+        min = values[i] < min ? values[i] : min;
+        max = values[i] > max ? values[i] : max;
+    }
+
+    u32 best_r0 = max;
+    u32 best_r1 = min;
+    u64 best_indices = 0;
+    u32 best_error = 0xFFFFFFFF;
+    for (u32 i = 0; i < 3 && max > min; i += 1)
+    {
+        for (u32 j = 0; j < 3; j += 1)
+        {
+            u32 r0 = max - i;
+            u32 r1 = min + j;
+            if (r0 <= r1)
+            {
+                continue;
+            }
+
+            u32 palette[8] = {0};
+            texture_bc4_palette(r0, r1, palette);
+            u64 indices = 0;
+            u32 error = 0;
+            for (u32 t = 0; t < 16; t += 1)
+            {
+                u32 best_k = 0;
+                u32 best_d = 0xFFFFFFFF;
+                for (u32 k = 0; k < 8; k += 1)
+                {
+                    s32 d = (s32)values[t] - (s32)palette[k];
+                    if ((u32)(d * d) < best_d)
+                    {
+                        best_d = (u32)(d * d);
+                        best_k = k;
+                    }
+                }
+                indices |= (u64)best_k << (t * 3);
+                error += best_d;
+            }
+            if (error < best_error)
+            {
+                best_error = error;
+                best_r0 = r0;
+                best_r1 = r1;
+                best_indices = indices;
+            }
+        }
+    }
+
+    out[0] = (u8)best_r0;
+    out[1] = (u8)best_r1;
+    for (u32 b = 0; b < 6; b += 1)
+    {
+        out[2 + b] = (u8)(best_indices >> (b * 8));
+    }
+}
+
+FUNCTION void
+texture_decode_bc4(u8* block, u8* values)
+{
+    u32 palette[8] = {0};
+    if (block[0] > block[1])
+    {
+        texture_bc4_palette(block[0], block[1], palette);
+    }
+    else
+    {
+        // NOTE: Never written by the encoder, which only uses 8 values.
+        palette[0] = block[0];
+        palette[1] = block[1];
+        for (u32 k = 2; k < 6; k += 1)
+        {
+            palette[k] = (((6 - k) * block[0]) + ((k - 1) * block[1]) + 2) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    u64 indices = 0;
+    for (u32 b = 0; b < 6; b += 1)
+    {
+        indices |= (u64)block[2 + b] << (b * 8);
+    }
+    for (u32 t = 0; t < 16; t += 1)
+    {
+        values[t] = (u8)palette[(indices >> (t * 3)) & 7];
+    }
+}
+
+// BC7
+
+FUNCTION void
+texture_put_bits(u8* out, u32* pos, u32 value, u32 count)
+{
+    for (u32 b = 0; b < count; b += 1)
+    {
+        u32 bit = *pos + b;
+        out[bit / 8] = (u8)(out[bit / 8] | (((value >> b) & 1) << (bit % 8)));
+    }
+    *pos += count;
+}
+
+FUNCTION u32
+texture_get_bits(u8* block, u32* pos, u32 count)
+{
+    u32 value = 0;
+    for (u32 b = 0; b < count; b += 1)
+    {
+        u32 bit = *pos + b;
+        value |= (u32)((block[bit / 8] >> (bit % 8)) & 1) << b;
+    }
+    *pos += count;
+    return value;
+}
+
+// Quantizes both endpoints to 7 bits plus their p-bits, picks the nearest
+// palette entry for every texel, and returns the error.
+FUNCTION u32
+texture_bc7_fit(u8 texels[16][4],
+                f32 endpoints[2][4],
+                u32 p0,
+                u32 p1,
+                u32 quantized[2][4],
+                u32* indices)
+{
+    u32 p[2] = {p0, p1};
+    u32 values[2][4] = {0};
+    for (u32 e = 0; e < 2; e += 1)
+    {
+        for (u32 c = 0; c < 4; c += 1)
+        {
+            f32 q = ((endpoints[e][c] - (f32)p[e]) * 0.5f) + 0.5f;
+            u32 q7 = q <= 0.0f ? 0 : q >= 127.0f ? 127 : (u32)q;
+            quantized[e][c] = q7;
+            values[e][c] = (q7 << 1) | p[e];
+        }
+    }
+
+    u32 palette[16][4] = {0};
+    for (u32 k = 0; k < 16; k += 1)
+    {
+        u32 w = texture_bc7_weights[k];
+        for (u32 c = 0; c < 4; c += 1)
+        {
+            palette[k][c]
+                = (((64 - w) * values[0][c]) + (w * values[1][c]) + 32) >> 6;
+        }
+    }
+
+    u32 error = 0;
+    for (u32 t = 0; t < 16; t += 1)
+    {
+        u32 best_k = 0;
+        u32 best_d = 0xFFFFFFFF;
+        for (u32 k = 0; k < 16; k += 1)
+        {
+            u32 d = 0;
+            for (u32 c = 0; c < 4; c += 1)
+            {
+                s32 diff = (s32)texels[t][c] - (s32)palette[k][c];
+                d += (u32)(diff * diff);
+            }
+            if (d < best_d)
+            {
+                best_d = d;
+                best_k = k;
+            }
+        }
+        indices[t] = best_k;
+        error += best_d;
+    }
+
+    return error;
+}
+
+// Tries every p-bit pair for the endpoints, keeping the best in `best_*`.
+FUNCTION void
+texture_bc7_fit_best(u8 texels[16][4],
+                     f32 endpoints[2][4],
+                     u32* best_error,
+                     u32 best_quantized[2][4],
+                     u32* best_p,
+                     u32* best_indices)
+{
+    for (u32 p = 0; p < 4; p += 1)
+    {
+        u32 quantized[2][4] = {0};
+        u32 indices[16] = {0};
+        u32 error = texture_bc7_fit(texels,
+                                    endpoints,
+                                    p & 1,
+                                    p >> 1,
+                                    quantized,
+                                    indices);
+        if (error < *best_error)
+        {
+            *best_error = error;
+            *best_p = p;
+            for (u32 e = 0; e < 2; e += 1)
+            {
+                for (u32 c = 0; c < 4; c += 1)
+                {
+                    best_quantized[e][c] = quantized[e][c];
+                }
+            }
+            for (u32 t = 0; t < 16; t += 1)
+            {
+                best_indices[t] = indices[t];
+            }
+        }
+    }
+}
+
+// NOTE: Endpoints start at the ends of the texels' principal axis (found by
+// power iteration on their covariance), and are refit once by least squares
+// to the palette weights the texels picked.
+FUNCTION void
+texture_encode_bc7(u8 texels[16][4], u8* out)
+{
+    f32 mean[4] = {0};
+    for (u32 t = 0; t < 16; t += 1)
+    {
+        for (u32 c = 0; c < 4; c += 1)
+        {
+            mean[c] += (f32)texels[t][c] * (1.0f / 16.0f);
+        }
+    }
+
+    f32 covariance[4][4] = {0};
+    f32 min[4] = {255.0f, 255.0f, 255.0f, 255.0f};
+    f32 max[4] = {0};
+    for (u32 t = 0; t < 16; t += 1)
+    {
+        f32 d[4] = {0};
+        for (u32 c = 0; c < 4; c += 1)
+        {
+            d[c] = (f32)texels[t][c] - mean[c];
+            min[c] = (f32)texels[t][c] < min[c] ? (f32)texels[t][c] : min[c];
+            max[c] = (f32)texels[t][c] > max[c] ? (f32)texels[t][c] : max[c];
+        }
+        for (u32 i = 0; i < 4; i += 1)
+        {
+            for (u32 j = 0; j < 4; j += 1)
+            {
+                covariance[i][j] += d[i] * d[j];
+            }
+        }
+    }
+
+    f32 axis[4] = {0};
+    for (u32 c = 0; c < 4; c += 1)
+    {
+        axis[c] = max[c] - min[c];
+    }
+    for (u32 iteration = 0; iteration < 8; iteration += 1)
+    {
+        f32 next[4] = {0};
+        f32 largest = 0.0f;
+        for (u32 i = 0; i < 4; i += 1)
+        {
+            for (u32 j = 0; j < 4; j += 1)
+            {
+                next[i] += covariance[i][j] * axis[j];
+            }
+            f32 a = next[i] < 0.0f ? -next[i] : next[i];
+            largest = a > largest ? a : largest;
+        }
+        if (largest <= 0.0f)
+        {
+            break;
+        }
+        for (u32 c = 0; c < 4; c += 1)
+        {
+            axis[c] = next[c] / largest;
+        }
+    }
+
+    f32 axis_length_squared = 0.0f;
+    for (u32 c = 0; c < 4; c += 1)
+    {
+        axis_length_squared += axis[c] * axis[c];
+    }
+    f32 t_min = 0.0f;
+    f32 t_max = 0.0f;
+    for (u32 t = 0; t < 16 && axis_length_squared > 0.0f; t += 1)
+    {
+        f32 projection = 0.0f;
+        for (u32 c = 0; c < 4; c += 1)
+        {
+            projection += ((f32)texels[t][c] - mean[c]) * axis[c];
+        }
+        projection /= axis_length_squared;
+        t_min = projection < t_min ? projection : t_min;
+        t_max = projection > t_max ? projection : t_max;
+    }
+
+    f32 endpoints[2][4] = {0};
+    for (u32 c = 0; c < 4; c += 1)
+    {
+        f32 e0 = mean[c] + (axis[c] * t_min);
+        f32 e1 = mean[c] + (axis[c] * t_max);
+        endpoints[0][c] = e0 < 0.0f ? 0.0f : e0 > 255.0f ? 255.0f : e0;
+        endpoints[1][c] = e1 < 0.0f ? 0.0f : e1 > 255.0f ? 255.0f : e1;
+    }
+
+    u32 error = 0xFFFFFFFF;
+    u32 quantized[2][4] = {0};
+    u32 p = 0;
+    u32 indices[16] = {0};
+    texture_bc7_fit_best(texels, endpoints, &error, quantized, &p, indices);
+
+    // Refit.
+    f32 aa = 0.0f;
+    f32 ab = 0.0f;
+    f32 bb = 0.0f;
+    f32 ax[4] = {0};
+    f32 bx[4] = {0};
+    for (u32 t = 0; t < 16; t += 1)
+    {
+        f32 w = (f32)texture_bc7_weights[indices[t]] * (1.0f / 64.0f);
+        aa += (1.0f - w) * (1.0f - w);
+        ab += (1.0f - w) * w;
+        bb += w * w;
+        for (u32 c = 0; c < 4; c += 1)
+        {
+            ax[c] += (1.0f - w) * (f32)texels[t][c];
+            bx[c] += w * (f32)texels[t][c];
+        }
+    }
+    f32 determinant = (aa * bb) - (ab * ab);
+    if (determinant > 1e-6f || determinant < -1e-6f)
+    {
+        for (u32 c = 0; c < 4; c += 1)
+        {
+            f32 e0 = ((bb * ax[c]) - (ab * bx[c])) / determinant;
+            f32 e1 = ((aa * bx[c]) - (ab * ax[c])) / determinant;
+            endpoints[0][c] = e0 < 0.0f ? 0.0f : e0 > 255.0f ? 255.0f : e0;
+            endpoints[1][c] = e1 < 0.0f ? 0.0f : e1 > 255.0f ? 255.0f : e1;
+        }
+        texture_bc7_fit_best(texels, endpoints, &error, quantized, &p, indices);
+    }
+
+    // NOTE: The first index's top bit is implied to be 0, so if it is set the
+    // endpoints are swapped and the indices inverted.
+    u32 p_bits[2] = {p & 1, p >> 1};
+    if (indices[0] & 8)
+    {
+        for (u32 c = 0; c < 4; c += 1)
+        {
+            u32 q = quantized[0][c];
+            quantized[0][c] = quantized[1][c];
+            quantized[1][c] = q;
+        }
+        u32 pb = p_bits[0];
+        p_bits[0] = p_bits[1];
+        p_bits[1] = pb;
+        for (u32 t = 0; t < 16; t += 1)
+        {
+            indices[t] = 15 - indices[t];
+        }
+    }
+
+    for (u32 b = 0; b < 16; b += 1)
+    {
+        out[b] = 0;
+    }
+    u32 pos = 0;
+    texture_put_bits(out, &pos, TEXTURE_BC7_MODE_6, 7);
+    for (u32 c = 0; c < 4; c += 1)
+    {
+        texture_put_bits(out, &pos, quantized[0][c], 7);
+        texture_put_bits(out, &pos, quantized[1][c], 7);
+    }
+    texture_put_bits(out, &pos, p_bits[0], 1);
+    texture_put_bits(out, &pos, p_bits[1], 1);
+    for (u32 t = 0; t < 16; t += 1)
+    {
+        texture_put_bits(out, &pos, indices[t], t ? 4 : 3);
+    }
+}
+
+// NOTE: Only decodes mode 6, the only mode the encoder writes.
+FUNCTION void
+texture_decode_bc7(u8* block, u8 texels[16][4])
+{
+    u32 pos = 0;
+    if (texture_get_bits(block, &pos, 7) != TEXTURE_BC7_MODE_6)
+    {
+        for (u32 t = 0; t < 16; t += 1)
+        {
+            texels[t][0] = texels[t][1] = texels[t][2] = texels[t][3] = 0;
+        }
+        return;
+    }
+
+    u32 endpoints[2][4] = {0};
+    for (u32 c = 0; c < 4; c += 1)
+    {
+        endpoints[0][c] = texture_get_bits(block, &pos, 7) << 1;
+        endpoints[1][c] = texture_get_bits(block, &pos, 7) << 1;
+    }
+    u32 p0 = texture_get_bits(block, &pos, 1);
+    u32 p1 = texture_get_bits(block, &pos, 1);
+    for (u32 c = 0; c < 4; c += 1)
+    {
+        endpoints[0][c] |= p0;
+        endpoints[1][c] |= p1;
+    }
+    for (u32 t = 0; t < 16; t += 1)
+    {
+        u32 w = texture_bc7_weights[texture_get_bits(block, &pos, t ? 4 : 3)];
+        for (u32 c = 0; c < 4; c += 1)
+        {
+            texels[t][c] = (u8)((((64 - w) * endpoints[0][c])
+                                 + (w * endpoints[1][c]) + 32)
+                                >> 6);
+        }
+    }
+}
+
+// Encoding
+
+// NOTE: Which source channels are stored, in block channel order.
+FUNCTION u32
+texture_channels(texture_bake* tb, u32* channels)
+{
+    switch (tb->format)
+    {
+        case TEXTURE_FORMAT_BC4:
+        {
+            channels[0] = 1; // Roughness
+            return 1;
+        }
+        case TEXTURE_FORMAT_BC5:
+        {
+            b8 metallic_roughness
+                = tb->role == TEXTURE_ROLE_METALLIC_ROUGHNESS;
+            channels[0] = metallic_roughness ? 1 : 0;
+            channels[1] = metallic_roughness ? 2 : 1;
+            return 2;
+        }
+        default:
+        {
+            for (u32 c = 0; c < 4; c += 1)
+            {
+                channels[c] = c;
+            }
+            return 4;
+        }
+    }
+}
+
+// NOTE: Texels past the edge of the level repeat the last row or column.
+FUNCTION void
+texture_read_block(texture_bake* tb,
+                   u32 level,
+                   u32 bx,
+                   u32 by,
+                   u8 texels[16][4])
+{
+    u32 width = tb->widths[level];
+    u32 height = tb->heights[level];
+    for (u32 y = 0; y < 4; y += 1)
+    {
+        u32 sy = (by * 4) + y < height ? (by * 4) + y : height - 1;
+        for (u32 x = 0; x < 4; x += 1)
+        {
+            u32 sx = (bx * 4) + x < width ? (bx * 4) + x : width - 1;
+            u8* texel = &tb->mips[level][((sy * width) + sx) * 4];
+            for (u32 c = 0; c < 4; c += 1)
+            {
+                texels[(y * 4) + x][c] = texel[c];
+            }
+        }
+    }
+}
+
+// Encodes `row_count` block rows starting at `first_row`, counting rows over
+// every level from the largest. Rows may be encoded in any order and by any
+// number of threads at once.
+FUNCTION void
+texture_bake_encode_rows(texture_bake* tb, u32 first_row, u32 row_count)
+{
+    u32 channels[4] = {0};
+    u32 channel_count = texture_channels(tb, channels);
+    u32 block_size = texture_block_size(tb->format);
+
+    u32 level = 0;
+    u32 level_first_row = 0;
+    u32 end_row = first_row + row_count < tb->row_count ? first_row + row_count
+                                                        : tb->row_count;
+    for (u32 row = first_row; row < end_row; row += 1)
+    {
+        while (row >= level_first_row + ((tb->heights[level] + 3) / 4))
+        {
+            level_first_row += (tb->heights[level] + 3) / 4;
+            level += 1;
+        }
+
+        u32 by = row - level_first_row;
+        u32 blocks_x = (tb->widths[level] + 3) / 4;
+        for (u32 bx = 0; bx < blocks_x; bx += 1)
+        {
+            u8 texels[16][4] = {0};
+            texture_read_block(tb, level, bx, by, texels);
+            u8* out = &tb->blocks[level][((by * blocks_x) + bx) * block_size];
+            if (tb->format == TEXTURE_FORMAT_BC7)
+            {
+                texture_encode_bc7(texels, out);
+                continue;
+            }
+            for (u32 c = 0; c < channel_count; c += 1)
+            {
+                u8 values[16] = {0};
+                for (u32 t = 0; t < 16; t += 1)
+                {
+                    values[t] = texels[t][channels[c]];
+                }
+                texture_encode_bc4(values, &out[c * 8]);
+            }
+        }
+    }
+}
+
+// NOTE: ln(x) = 2 * atanh((m - 1) / (m + 1)) + e * ln(2) for x = m * 2^e.
+FUNCTION f64
+texture_log10(f64 x)
+{
+    s32 exponent = 0;
+    while (x >= 2.0)
+    {
+        x *= 0.5;
+        exponent += 1;
+    }
+    while (x < 1.0)
+    {
+        x *= 2.0;
+        exponent -= 1;
+    }
+    f64 z = (x - 1.0) / (x + 1.0);
+    f64 z2 = z * z;
+    f64 term = z;
+    f64 sum = 0.0;
+    for (u32 k = 1; k < 32; k += 2)
+    {
+        sum += term / (f64)k;
+        term *= z2;
+    }
+    f64 ln = (2.0 * sum) + ((f64)exponent * 0.69314718055994531);
+    return ln / 2.30258509299404568;
+}
+
+// Decodes the largest level and returns its PSNR against the source (in dB)
+// over the channels that are stored.
+FUNCTION f32
+texture_bake_psnr(texture_bake* tb)
+{
+    u32 channels[4] = {0};
+    u32 channel_count = texture_channels(tb, channels);
+    u32 block_size = texture_block_size(tb->format);
+    u32 width = tb->widths[0];
+    u32 height = tb->heights[0];
+    u32 blocks_x = (width + 3) / 4;
+    u32 blocks_y = (height + 3) / 4;
+
+    u64 squared_error = 0;
+    for (u32 by = 0; by < blocks_y; by += 1)
+    {
+        for (u32 bx = 0; bx < blocks_x; bx += 1)
+        {
+            u8* block = &tb->blocks[0][((by * blocks_x) + bx) * block_size];
+            u8 decoded[16][4] = {0};
+            if (tb->format == TEXTURE_FORMAT_BC7)
+            {
+                texture_decode_bc7(block, decoded);
+            }
+            else
+            {
+                for (u32 c = 0; c < channel_count; c += 1)
+                {
+                    u8 values[16] = {0};
+                    texture_decode_bc4(&block[c * 8], values);
+                    for (u32 t = 0; t < 16; t += 1)
+                    {
+                        decoded[t][c] = values[t];
+                    }
+                }
+            }
+
+            for (u32 t = 0; t < 16; t += 1)
+            {
+                u32 x = (bx * 4) + (t % 4);
+                u32 y = (by * 4) + (t / 4);
+                if (x >= width || y >= height)
+                {
+                    continue;
+                }
+                u8* texel = &tb->mips[0][((y * width) + x) * 4];
+                for (u32 c = 0; c < channel_count; c += 1)
+                {
+                    s32 d = (s32)decoded[t][c] - (s32)texel[channels[c]];
+                    squared_error += (u64)(d * d);
+                }
+            }
+        }
+    }
+
+    if (!squared_error)
+    {
+        return TEXTURE_MAX_PSNR;
+    }
+    f64 mse = (f64)squared_error / ((f64)width * height * channel_count);
+    f64 psnr = 10.0 * texture_log10((255.0 * 255.0) / mse);
+    return psnr < TEXTURE_MAX_PSNR ? (f32)psnr : TEXTURE_MAX_PSNR;
+}